@@ -7,4 +7,6 @@ function(mmseqs_setup_test NAME)
 
     mmseqs_setup_derived_target(${BASE_NAME})
     target_link_libraries(${BASE_NAME} version)
+    # tests write their databases below the build tree
+    target_compile_definitions(${BASE_NAME} PRIVATE "TEST_TMP_DIR=\"${CMAKE_CURRENT_BINARY_DIR}/tmp\"")
 endfunction()
@@ -38,7 +38,12 @@ while [ "$STEP" -lt "$STEPS" ]; do
     fi
 
     # call alignment module
-    if notExists "$TMP_PATH/aln_$SENS"; then
+    if [ -p "$3" ]; then
+        # a single step search aligns directly into the named pipe the next module reads from
+        # shellcheck disable=SC2086
+        "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$SENS" "$3" $ALIGNMENT_PAR  \
+            || fail "Alignment died"
+    elif notExists "$TMP_PATH/aln_$SENS"; then
         # shellcheck disable=SC2086
         $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$SENS" "$TMP_PATH/aln_$SENS" $ALIGNMENT_PAR  \
             || fail "Alignment died"
@@ -75,8 +80,10 @@ while [ "$STEP" -lt "$STEPS" ]; do
 done
 
 # post processing
-(mv -f "$TMP_PATH/aln_${SENSE_0}" "$3" && mv -f "$TMP_PATH/aln_${SENSE_0}.index" "$3.index" ) \
-    || fail "Could not move result to $3"
+if [ ! -p "$3" ]; then
+    (mv -f "$TMP_PATH/aln_${SENSE_0}" "$3" && mv -f "$TMP_PATH/aln_${SENSE_0}.index" "$3.index" ) \
+        || fail "Could not move result to $3"
+fi
 
 if [ -n "$REMOVE_TMP" ]; then
     echo "Remove temporary files"
@@ -21,6 +21,7 @@ notExists() {
 
 QUERYDB="$1"
 TMP_PATH="$4"
+ORIGINAL="$1"
 
 STEP=0
 # processing
@@ -57,7 +58,7 @@ while [ $STEP -lt $NUM_IT ]; do
 
     if [ $STEP -gt 0 ]; then
         if notExists "$TMP_PATH/aln_$STEP.hasmerge"; then
-            "$MMSEQS" mergedbs "$QUERYDB" "$TMP_PATH/aln_new" "$TMP_PATH/aln_0" "$TMP_PATH/aln_$STEP" \
+            "$MMSEQS" mergedbs "$ORIGINAL" "$TMP_PATH/aln_new" "$TMP_PATH/aln_0" "$TMP_PATH/aln_$STEP" \
                 || fail "Merge died"
             mv -f "$TMP_PATH/aln_new" "$TMP_PATH/aln_0"
             mv -f "$TMP_PATH/aln_new.index" "$TMP_PATH/aln_0.index"
@@ -67,11 +68,28 @@ while [ $STEP -lt $NUM_IT ]; do
 
 # create profiles
     if [ $STEP -ne $((NUM_IT  - 1)) ]; then
+        # queries without new hits in this iteration have converged, their next profile and
+        # their next hits would be the same. Only the other queries continue with a view of aln_0
+        PROFILE_INPUT="$TMP_PATH/aln_0"
+        if [ $STEP -ge 1 ] && { [ $STEP -lt $((NUM_IT - 2)) ] || [ -n "$CONVERGE_LAST" ]; }; then
+            PROFILE_INPUT="$TMP_PATH/aln_active_$STEP"
+            if notExists "$TMP_PATH/profile_$STEP"; then
+                ln -sf "aln_0" "$PROFILE_INPUT"
+                awk 'NR == FNR { if ($3 > 1) { active[$1] = 1; } next; } $1 in active' \
+                    "$TMP_PATH/aln_$STEP.index" "$TMP_PATH/aln_0.index" > "$PROFILE_INPUT.index" \
+                    || fail "Convergence check died"
+                echo "$(wc -l < "$PROFILE_INPUT.index") queries not converged after iteration $STEP"
+            fi
+            if [ ! -s "$PROFILE_INPUT.index" ]; then
+                echo "All queries converged"
+                break
+            fi
+        fi
         if notExists "$TMP_PATH/profile_$STEP"; then
             PARAM="PROFILE_PAR_$STEP"
             eval TMP="\$$PARAM"
             # shellcheck disable=SC2086
-            $RUNNER "$MMSEQS" result2profile "$QUERYDB" "$2" "$TMP_PATH/aln_0" "$TMP_PATH/profile_$STEP" ${TMP} \
+            $RUNNER "$MMSEQS" result2profile "$QUERYDB" "$2" "$PROFILE_INPUT" "$TMP_PATH/profile_$STEP" ${TMP} \
                 || fail "Create profile died"
         fi
     fi
@@ -90,6 +108,7 @@ if [ -n "$REMOVE_TMP" ]; then
     rm -f "$TMP_PATH/pref_$STEP" "$TMP_PATH/pref_$STEP.index"
     rm -f "$TMP_PATH/aln_$STEP" "$TMP_PATH/aln_$STEP.index"
     rm -f "$TMP_PATH/profile_$STEP" "$TMP_PATH/profile_$STEP.index" "$TMP_PATH/profile_${STEP}_h" "$TMP_PATH/profile_${STEP}_h.index"
+    rm -f "$TMP_PATH/aln_active_$STEP" "$TMP_PATH/aln_active_$STEP.index"
     STEP=$((STEP+1))
  done
 
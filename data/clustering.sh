@@ -45,8 +45,15 @@ if notExists "${TMP_PATH}/pref"; then
         || fail "Prefilter died"
 fi
 
-# call alignment module
-if notExists "${TMP_PATH}/aln"; then
+# call alignment module, with --greedy-clustering it writes the clustering directly
+# it can not be split over several processes, so it is only enabled without RUNNER
+if [ -n "$GREEDY_ALIGN" ]; then
+    if notExists "${TMP_PATH}/clu_step0"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$INPUT" "${TMP_PATH}/pref" "${TMP_PATH}/clu_step0" $ALIGNMENT_PAR \
+            || fail "Alignment died"
+    fi
+elif notExists "${TMP_PATH}/aln"; then
     # shellcheck disable=SC2086
     $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$INPUT" "${TMP_PATH}/pref" "${TMP_PATH}/aln" $ALIGNMENT_PAR \
         || fail "Alignment died"
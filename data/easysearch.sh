@@ -8,6 +8,20 @@ notExists() {
 	[ ! -f "$1" ]
 }
 
+# runs a module in the background and writes its exit status to ${TMP_PATH}/NAME.status
+inBackground() {
+    NAME="$1"
+    shift
+    rm -f "${TMP_PATH}/${NAME}.status"
+    (
+        if "$@"; then
+            echo 0 > "${TMP_PATH}/${NAME}.status"
+        else
+            echo 1 > "${TMP_PATH}/${NAME}.status"
+        fi
+    ) &
+}
+
 # check number of input variables
 [ "$#" -ne 4 ] && echo "Please provide <queryFASTA> <targetFASTA>|<targetDB> <outFile> <tmp>" && exit 1;
 # check paths
@@ -37,25 +51,77 @@ if notExists "${TARGET}.dbtype"; then
 fi
 
 INTERMEDIATE="${TMP_PATH}/result"
-if notExists "${INTERMEDIATE}"; then
+if [ -n "${STREAM}" ] && notExists "${INTERMEDIATE}" && notExists "${TMP_PATH}/alis"; then
+    # all modules run at the same time and hand over the results through named pipes.
+    # A module reading a pipe holds the full result in memory before it processes it
+    PIPES="${TMP_PATH}/result"
+    STAGES="search convertalis"
+    [ -n "${GREEDY_BEST_HITS}" ] && PIPES="${PIPES} ${TMP_PATH}/result_best" && STAGES="${STAGES} summarizeresult"
+    for PIPE in ${PIPES}; do
+        rm -f "${PIPE}"
+        mkfifo "${PIPE}" || fail "mkfifo died"
+    done
     # shellcheck disable=SC2086
-    "$MMSEQS" search "${TMP_PATH}/query" "${TARGET}" "${INTERMEDIATE}" "${TMP_PATH}/search_tmp" ${SEARCH_PAR} \
-        || fail "Search died"
-fi
+    inBackground search "$MMSEQS" search "${TMP_PATH}/query" "${TARGET}" "${TMP_PATH}/result" "${TMP_PATH}/search_tmp" ${SEARCH_PAR}
+    if [ -n "${GREEDY_BEST_HITS}" ]; then
+        # shellcheck disable=SC2086
+        inBackground summarizeresult "$MMSEQS" summarizeresult "${TMP_PATH}/result" "${TMP_PATH}/result_best" ${SUMMARIZE_PAR}
+        INTERMEDIATE="${TMP_PATH}/result_best"
+    fi
+    # shellcheck disable=SC2086
+    inBackground convertalis "$MMSEQS" convertalis "${TMP_PATH}/query" "${TARGET}" "${INTERMEDIATE}" "${TMP_PATH}/alis" ${CONVERT_PAR}
 
-if [ -n "${GREEDY_BEST_HITS}" ]; then
-    if notExists "${TMP_PATH}/result_best"; then
+    FAILED=""
+    while true; do
+        RUNNING=""
+        for STAGE in ${STAGES}; do
+            if notExists "${TMP_PATH}/${STAGE}.status"; then
+                RUNNING="TRUE"
+            elif [ "$(cat "${TMP_PATH}/${STAGE}.status")" -ne 0 ]; then
+                FAILED="${STAGE}"
+            fi
+        done
+        [ -z "${RUNNING}" ] && break
+        if [ -n "${FAILED}" ]; then
+            # the other modules might wait for the dead one to open its end of a pipe
+            for PIPE in ${PIPES}; do
+                exec 3<>"${PIPE}"
+                exec 3>&-
+            done
+        fi
+        sleep 1
+    done
+    wait
+    for STAGE in ${STAGES}; do
+        rm -f "${TMP_PATH}/${STAGE}.status"
+    done
+    # shellcheck disable=SC2086
+    rm -f ${PIPES}
+    if [ -n "${FAILED}" ]; then
+        rm -f "${TMP_PATH}/alis" "${TMP_PATH}/alis.index"
+        fail "${FAILED} died"
+    fi
+else
+    if notExists "${INTERMEDIATE}"; then
         # shellcheck disable=SC2086
-        "$MMSEQS" summarizeresult "${TMP_PATH}/result" "${TMP_PATH}/result_best" ${SUMMARIZE_PAR} \
+        "$MMSEQS" search "${TMP_PATH}/query" "${TARGET}" "${INTERMEDIATE}" "${TMP_PATH}/search_tmp" ${SEARCH_PAR} \
             || fail "Search died"
     fi
-    INTERMEDIATE="${TMP_PATH}/result_best"
-fi
 
-if notExists "${TMP_PATH}/alis"; then
-    # shellcheck disable=SC2086
-    "$MMSEQS" convertalis "${TMP_PATH}/query" "${TARGET}" "${INTERMEDIATE}" "${TMP_PATH}/alis" ${CONVERT_PAR} \
-        || fail "Convert Alignments died"
+    if [ -n "${GREEDY_BEST_HITS}" ]; then
+        if notExists "${TMP_PATH}/result_best"; then
+            # shellcheck disable=SC2086
+            "$MMSEQS" summarizeresult "${TMP_PATH}/result" "${TMP_PATH}/result_best" ${SUMMARIZE_PAR} \
+                || fail "Search died"
+        fi
+        INTERMEDIATE="${TMP_PATH}/result_best"
+    fi
+
+    if notExists "${TMP_PATH}/alis"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" convertalis "${TMP_PATH}/query" "${TARGET}" "${INTERMEDIATE}" "${TMP_PATH}/alis" ${CONVERT_PAR} \
+            || fail "Convert Alignments died"
+    fi
 fi
 
 mv -f "${TMP_PATH}/alis" "${RESULTS}" || fail "Could not move result to ${RESULTS}"
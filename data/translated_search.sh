@@ -57,14 +57,21 @@ if notExists "$4/aln"; then
         || fail "Search step died"
 fi
 
-if notExists "$4/aln_offset"; then
+if [ -p "$3" ]; then
+    # the next module reads the result from this named pipe
     # shellcheck disable=SC2086
-    "$MMSEQS" offsetalignment "$QUERY_ORF" "$TARGET_ORF" "$4/aln"  "$4/aln_offset" ${OFFSETALIGNMENT_PAR} \
+    "$MMSEQS" offsetalignment "$QUERY_ORF" "$TARGET_ORF" "$4/aln"  "$3" ${OFFSETALIGNMENT_PAR} \
         || fail "Offset step died"
-fi
+else
+    if notExists "$4/aln_offset"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" offsetalignment "$QUERY_ORF" "$TARGET_ORF" "$4/aln"  "$4/aln_offset" ${OFFSETALIGNMENT_PAR} \
+            || fail "Offset step died"
+    fi
 
-(mv -f "$4/aln_offset" "$3" && mv -f "$4/aln_offset.index" "$3.index") \
-    || fail "Could not move result to $3"
+    (mv -f "$4/aln_offset" "$3" && mv -f "$4/aln_offset.index" "$3.index") \
+        || fail "Could not move result to $3"
+fi
 
 if [ -n "$REMOVE_TMP" ]; then
   echo "Remove temporary files"
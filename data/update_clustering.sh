@@ -192,11 +192,26 @@ echo "==================================================="
 echo "======== Search the new sequences against ========="
 echo "========= previous (rep seq of) clusters =========="
 echo "==================================================="
-mkdir -p "${TMP_PATH}/search"
-if notExists "${TMP_PATH}/newSeqsHits"; then
-    # shellcheck disable=SC2086
-    "$MMSEQS" search "${TMP_PATH}/NEWDB.newSeqs" "${TMP_PATH}/OLDDB.repSeq" "${TMP_PATH}/newSeqsHits" "${TMP_PATH}/search" ${SEARCH_PAR} \
-        || fail "Search died"
+# the representative k-mer table of the previous clustering is written by an update with --kmer-table,
+# without it the first update searches and only writes the table of the new clustering
+if [ -n "${USE_KMER_TABLE}" ] && [ -f "${OLDCLUST}.kmertable" ]; then
+    if notExists "${TMP_PATH}/newSeqsPref"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" kmermatcher "${TMP_PATH}/NEWDB.newSeqs" "${TMP_PATH}/newSeqsPref" --kmer-table-in "${OLDCLUST}.kmertable" ${KMERMATCHER_PAR} \
+            || fail "Kmermatcher died"
+    fi
+    if notExists "${TMP_PATH}/newSeqsHits"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" align "${TMP_PATH}/NEWDB.newSeqs" "${TMP_PATH}/OLDDB.repSeq" "${TMP_PATH}/newSeqsPref" "${TMP_PATH}/newSeqsHits" ${ALIGN_PAR} \
+            || fail "Alignment died"
+    fi
+else
+    mkdir -p "${TMP_PATH}/search"
+    if notExists "${TMP_PATH}/newSeqsHits"; then
+        # shellcheck disable=SC2086
+        "$MMSEQS" search "${TMP_PATH}/NEWDB.newSeqs" "${TMP_PATH}/OLDDB.repSeq" "${TMP_PATH}/newSeqsHits" "${TMP_PATH}/search" ${SEARCH_PAR} \
+            || fail "Search died"
+    fi
 fi
 
 if notExists "${TMP_PATH}/newSeqsHits.swapped.all"; then
@@ -281,6 +296,38 @@ else
     fi
 fi
 
+if [ -n "${USE_KMER_TABLE}" ] && notExists "${NEWCLUST}.kmertable"; then
+    debugWait
+    echo "==================================================="
+    echo "===== Add the new clusters to the k-mer table ====="
+    echo "==================================================="
+    if [ ! -f "${OLDCLUST}.kmertable" ]; then
+        # the first table holds all representatives of the new clustering
+        if notExists "${TMP_PATH}/NEWCLUST.repSeq"; then
+            "$MMSEQS" result2repseq "$NEWDB" "$NEWCLUST" "${TMP_PATH}/NEWCLUST.repSeq" \
+                || fail "Result2repseq died"
+            ln -sf "${NEWDB}.dbtype" "${TMP_PATH}/NEWCLUST.repSeq.dbtype"
+        fi
+        # shellcheck disable=SC2086
+        "$MMSEQS" kmermatcher "${TMP_PATH}/NEWCLUST.repSeq" "${TMP_PATH}/kmerTableEmpty" \
+            --kmer-table-out "${NEWCLUST}.kmertable" ${KMERMATCHER_PAR} \
+            || fail "Kmermatcher died"
+    elif [ -f "${TMP_PATH}/newClusters" ]; then
+        if notExists "${TMP_PATH}/newClusters.repSeq"; then
+            "$MMSEQS" result2repseq "${TMP_PATH}/toBeClusteredSeparately" "${TMP_PATH}/newClusters" "${TMP_PATH}/newClusters.repSeq" \
+                || fail "Result2repseq died"
+            ln -sf "${NEWDB}.dbtype" "${TMP_PATH}/newClusters.repSeq.dbtype"
+        fi
+        # shellcheck disable=SC2086
+        "$MMSEQS" kmermatcher "${TMP_PATH}/newClusters.repSeq" "${TMP_PATH}/kmerTableEmpty" \
+            --kmer-table-in "${OLDCLUST}.kmertable" --kmer-table-out "${NEWCLUST}.kmertable" ${KMERMATCHER_PAR} \
+            || fail "Kmermatcher died"
+    else
+        cp -f "${OLDCLUST}.kmertable" "${NEWCLUST}.kmertable" \
+            || fail "Could not copy k-mer table"
+    fi
+fi
+
 debugWait
 if [ -n "$REMOVE_TMP" ]; then
     echo "Remove temporary files 3/3"
@@ -298,7 +345,12 @@ if [ -n "$REMOVE_TMP" ]; then
 	rm -f "${TMP_PATH}/OLDDB.repSeq" "${TMP_PATH}/OLDDB.repSeq.index" \
 	      "${TMP_PATH}/updatedClust" "${TMP_PATH}/updatedClust.index"
 
-	rmdir "${TMP_PATH}/search" "${TMP_PATH}/cluster"
+	rm -f "${TMP_PATH}/newSeqsPref" "${TMP_PATH}/newSeqsPref.index" \
+	      "${TMP_PATH}/newClusters.repSeq" "${TMP_PATH}/newClusters.repSeq.index" "${TMP_PATH}/newClusters.repSeq.dbtype" \
+	      "${TMP_PATH}/NEWCLUST.repSeq" "${TMP_PATH}/NEWCLUST.repSeq.index" "${TMP_PATH}/NEWCLUST.repSeq.dbtype" \
+	      "${TMP_PATH}/kmerTableEmpty" "${TMP_PATH}/kmerTableEmpty.index" "${TMP_PATH}/kmerTableEmpty.dbtype"
+
+	rmdir "${TMP_PATH}/search" "${TMP_PATH}/cluster" 2>/dev/null || true
 
     rm -f "${TMP_PATH}/update_clustering.sh"
 fi
@@ -117,6 +117,9 @@ typedef __m512i simd_int;
 #define simdi32_mul(x,y)    _mm512_mullo_epi32(x,y)
 #define simdui8_max(x,y)    NOT_YET_IMP()
 #define simdi16_max(x,y)    _mm512_max_epi32(x,y)
+#define simdi16_min(x,y)    _mm512_min_epi16(x,y)
+#define simdi16_sub(x,y)    _mm512_sub_epi16(x,y)
+#define simdi16_loadu8(x)   _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(x))) // zero extend VECSIZE_INT*2 bytes
 #define simdi32_max(x,y)    _mm512_max_epi32(x,y)
 #define simdi_load(x)       _mm512_load_si512(x)
 #define simdi_streamload(x) _mm512_stream_load_si512(x)
@@ -147,6 +150,7 @@ typedef __m512i simd_int;
 #define simdi16_extract(x,y) NOT_YET_IMP()
 #define simdi16_slli(x,y)	_mm512_slli_epi16(x,y) // shift integers in a left by y
 #define simdi16_srli(x,y)	_mm512_srli_epi16(x,y) // shift integers in a right by y
+#define simdi16_srai(x,y)	_mm512_srai_epi16(x,y) // shift integers in a right by y, shifting in sign bits
 #define simdi32_slli(x,y)	_mm512_slli_epi32(x,y) // shift integers in a left by y
 #define simdi32_srli(x,y)	_mm512_srli_epi32(x,y) // shift integers in a right by y
 #define simdi32_i2f(x) 	    _mm512_cvtepi32_ps(x)  // convert integer to s.p. float
@@ -183,6 +187,9 @@ typedef __m256i simd_int;
 #define simdi32_mul(x,y)    _mm256_mullo_epi32(x,y)
 #define simdi32_max(x,y)    _mm256_max_epi32(x,y)
 #define simdi16_max(x,y)    _mm256_max_epi16(x,y)
+#define simdi16_min(x,y)    _mm256_min_epi16(x,y)
+#define simdi16_sub(x,y)    _mm256_sub_epi16(x,y)
+#define simdi16_loadu8(x)   _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(x))) // zero extend VECSIZE_INT*2 bytes
 #define simdi16_hmax(x)     simd_hmax16_avx(x)
 #define simdui8_max(x,y)    _mm256_max_epu8(x,y)
 #define simdi8_hmax(x)      simd_hmax8_avx(x)
@@ -218,6 +225,7 @@ typedef __m256i simd_int;
 #define simdi16_extract(x,y) extract_epi16(x,y)
 #define simdi16_slli(x,y)	_mm256_slli_epi16(x,y) // shift integers in a left by y
 #define simdi16_srli(x,y)	_mm256_srli_epi16(x,y) // shift integers in a right by y
+#define simdi16_srai(x,y)	_mm256_srai_epi16(x,y) // shift integers in a right by y, shifting in sign bits
 #define simdi32_slli(x,y)   _mm256_slli_epi32(x,y) // shift integers in a left by y
 #define simdi32_srli(x,y)   _mm256_srli_epi32(x,y) // shift integers in a right by y
 #define simdi32_i2f(x) 	    _mm256_cvtepi32_ps(x)  // convert integer to s.p. float
@@ -349,6 +357,9 @@ typedef __m128i simd_int;
 #define simdi32_mul(x,y)    _mm_mullo_epi32(x,y) // SSE4.1
 #define simdi32_max(x,y)    _mm_max_epi32(x,y) // SSE4.1
 #define simdi16_max(x,y)    _mm_max_epi16(x,y)
+#define simdi16_min(x,y)    _mm_min_epi16(x,y)
+#define simdi16_sub(x,y)    _mm_sub_epi16(x,y)
+#define simdi16_loadu8(x)   _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(x))) // zero extend VECSIZE_INT*2 bytes, SSE4.1
 #define simdi16_hmax(x)     simd_hmax16(x)
 #define simdui8_max(x,y)    _mm_max_epu8(x,y)
 #define simdi8_hmax(x)      simd_hmax8(x)
@@ -383,6 +394,7 @@ typedef __m128i simd_int;
 #define simdi16_extract(x,y) extract_epi16(x,y)
 #define simdi16_slli(x,y)	_mm_slli_epi16(x,y) // shift integers in a left by y
 #define simdi16_srli(x,y)	_mm_srli_epi16(x,y) // shift integers in a right by y
+#define simdi16_srai(x,y)	_mm_srai_epi16(x,y) // shift integers in a right by y, shifting in sign bits
 #define simdi32_slli(x,y)	_mm_slli_epi32(x,y) // shift integers in a left by y
 #define simdi32_srli(x,y)	_mm_srli_epi32(x,y) // shift integers in a right by y
 #define simdi32_i2f(x) 	    _mm_cvtepi32_ps(x)  // convert integer to s.p. float
@@ -2,7 +2,10 @@
 #define COMMANDDECLARATIONS_H
 #include "Command.h"
 
+class WorkflowResources;
+
 extern int align(int argc, const char **argv, const Command& command);
+extern int align(int argc, const char **argv, const Command& command, WorkflowResources *resources);
 extern int alignall(int argc, const char **argv, const Command& command);
 extern int alignbykmer(int argc, const char **argv, const Command& command);
 extern int apply(int argc, const char **argv, const Command& command);
@@ -50,6 +53,7 @@ extern int multihitsearch(int argc, const char **argv, const Command& command);
 extern int offsetalignment(int argc, const char **argv, const Command& command);
 extern int orftocontig(int argc, const char **argv, const Command& command);
 extern int prefilter(int argc, const char **argv, const Command& command);
+extern int prefilter(int argc, const char **argv, const Command& command, WorkflowResources *resources);
 extern int prefixid(int argc, const char **argv, const Command& command);
 extern int profile2cs(int argc, const char **argv, const Command& command);
 extern int profile2pssm(int argc, const char **argv, const Command& command);
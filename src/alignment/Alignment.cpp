@@ -10,6 +10,16 @@
 #include "SubstitutionMatrix.h"
 #include "PrefilteringIndexReader.h"
 #include "FileUtil.h"
+#include "UngappedAlignment.h"
+#include "KmerIdentityFilter.h"
+#include "itoa.h"
+#include "Metrics.h"
+#include "Progress.h"
+#include "MPIScheduler.h"
+#include "WorkflowResources.h"
+
+#include <limits>
+#include <sched.h>
 
 #ifdef OPENMP
 #include <omp.h>
@@ -19,13 +29,15 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
                      const std::string &targetSeqDB, const std::string &targetSeqDBIndex,
                      const std::string &prefDB, const std::string &prefDBIndex,
                      const std::string &outDB, const std::string &outDBIndex,
-                     const Parameters &par) :
+                     const Parameters &par, WorkflowResources *resources) :
 
         covThr(par.covThr), canCovThr(par.covThr), covMode(par.covMode), seqIdMode(par.seqIdMode), evalThr(par.evalThr), seqIdThr(par.seqIdThr),
         includeIdentity(par.includeIdentity), addBacktrace(par.addBacktrace), realign(par.realign), scoreBias(par.scoreBias),
-        threads(static_cast<unsigned int>(par.threads)), outDB(outDB), outDBIndex(outDBIndex),
-        maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), altAlignment(par.altAlignment), qdbr(NULL), qSeqLookup(NULL),
-        tdbr(NULL), tidxdbr(NULL), tSeqLookup(NULL), templateDBIsIndex(false) {
+        threads(static_cast<unsigned int>(par.threads)),
+        checkpointSignature(par.hashCheckpoint(par.align)), checkpointInterval(par.checkpointInterval),
+        outDB(outDB), outDBIndex(outDBIndex),
+        maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), altAlignment(par.altAlignment), bandWidth(par.bandWidth), ungappedPrescore(par.ungappedPrescore), fastIdentity(par.fastIdentity), greedyClustering(par.greedyClustering), qdbr(NULL), qSeqLookup(NULL),
+        tdbr(NULL), tidxdbr(NULL), tSeqLookup(NULL), templateDBIsIndex(false), resources(resources) {
 
 
     unsigned int alignmentMode = par.alignmentMode;
@@ -93,7 +105,13 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
         }
     }
 
-    if (templateDBIsIndex == false) {
+    if (templateDBIsIndex == false && resources != NULL) {
+        tdbr = resources->getSequenceDb(targetSeqDB, targetSeqDBIndex, par.preloadMode != Parameters::PRELOAD_MODE_MMAP);
+        tSeqLookup = resources->getSequenceLookup(targetSeqDB);
+        if (tSeqLookup != NULL) {
+            Debug(Debug::INFO) << "Use the sequence lookup of the prefilter\n";
+        }
+    } else if (templateDBIsIndex == false) {
         tdbr = new DBReader<unsigned int>(targetSeqDB.c_str(), targetSeqDBIndex.c_str());
         tdbr->open(DBReader<unsigned int>::NOSORT);
         if (par.preloadMode != Parameters::PRELOAD_MODE_MMAP) {
@@ -107,6 +125,9 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
         qdbr = tdbr;
         qSeqLookup = tSeqLookup;
         querySeqType = targetSeqType;
+    } else if (resources != NULL) {
+        qdbr = resources->getSequenceDb(querySeqDB, querySeqDBIndex, true);
+        querySeqType = qdbr->getDbtype();
     } else {
         // open the sequence, prefiltering and output databases
         qdbr = new DBReader<unsigned int>(querySeqDB.c_str(), querySeqDBIndex.c_str());
@@ -154,32 +175,60 @@ Alignment::Alignment(const std::string &querySeqDB, const std::string &querySeqD
     } else if (querySeqType == Sequence::HMM_PROFILE && targetSeqType == Sequence::PROFILE_STATE_SEQ) {
         querySeqType = Sequence::PROFILE_STATE_PROFILE;
     }
+    if (ungappedPrescore == true && (tSeqLookup == NULL || targetSeqType != Sequence::AMINO_ACIDS
+                                     || (querySeqType != Sequence::AMINO_ACIDS && querySeqType != Sequence::HMM_PROFILE))) {
+        Debug(Debug::WARNING) << "Ungapped prescore requires a protein target index created with createindex. Disabling it.\n";
+        ungappedPrescore = false;
+    }
+    if (fastIdentity == true && (querySeqType != Sequence::AMINO_ACIDS || targetSeqType != Sequence::AMINO_ACIDS
+                                 || swMode != Matcher::SCORE_COV_SEQID)) {
+        Debug(Debug::WARNING) << "Fast identity requires protein sequences and an alignment mode that computes the seq. id. Disabling it.\n";
+        fastIdentity = false;
+    }
     Debug(Debug::INFO) << "Query database type: " << DBReader<unsigned int>::getDbTypeName(querySeqType) << "\n";
     Debug(Debug::INFO) << "Target database type: " << DBReader<unsigned int>::getDbTypeName(targetSeqType) << "\n";
 
     prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str());
     prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
+    const std::string matrixKey = "align " + SSTR(querySeqType) + " " + par.scoringMatrixFile + " " + scoringMatrixFile + " " + SSTR(scoreBias);
+    m = (resources != NULL) ? resources->getMatrix(matrixKey) : NULL;
     if (querySeqType == Sequence::NUCLEOTIDES) {
-        m = new NucleotideMatrix(par.scoringMatrixFile.c_str(), 1.0, scoreBias);
+        if (m == NULL) {
+            m = new NucleotideMatrix(par.scoringMatrixFile.c_str(), 1.0, scoreBias);
+        }
         gapOpen = 7;
         gapExtend = 1;
     } else if (querySeqType == Sequence::PROFILE_STATE_PROFILE){
-        SubstitutionMatrix s(par.scoringMatrixFile.c_str(), 2.0, scoreBias);
-        this->m = new SubstitutionMatrixProfileStates(s.matrixName, s.probMatrix, s.pBack, s.subMatrixPseudoCounts, 2.0, scoreBias, 255);
+        if (m == NULL) {
+            SubstitutionMatrix s(par.scoringMatrixFile.c_str(), 2.0, scoreBias);
+            this->m = new SubstitutionMatrixProfileStates(s.matrixName, s.probMatrix, s.pBack, s.subMatrixPseudoCounts, 2.0, scoreBias, 255);
+        }
         gapOpen = par.gapOpen;
         gapExtend = par.gapExtend;
     } else {
         // keep score bias at 0.0 (improved ROC)
-        m = new SubstitutionMatrix(scoringMatrixFile.c_str(), 2.0, scoreBias);
+        if (m == NULL) {
+            m = new SubstitutionMatrix(scoringMatrixFile.c_str(), 2.0, scoreBias);
+        }
         gapOpen = par.gapOpen;
         gapExtend = par.gapExtend;
     }
 
+    realign_m = NULL;
+    const std::string realignMatrixKey = "align realign " + scoringMatrixFile + " " + SSTR(scoreBias - 0.2f);
     if (realign == true) {
-        realign_m = new SubstitutionMatrix(scoringMatrixFile.c_str(), 2.0, scoreBias-0.2f);
-    } else {
-        realign_m = NULL;
+        realign_m = (resources != NULL) ? resources->getMatrix(realignMatrixKey) : NULL;
+        if (realign_m == NULL) {
+            realign_m = new SubstitutionMatrix(scoringMatrixFile.c_str(), 2.0, scoreBias-0.2f);
+        }
+    }
+
+    if (resources != NULL) {
+        resources->addMatrix(matrixKey, m);
+        if (realign_m != NULL) {
+            resources->addMatrix(realignMatrixKey, realign_m);
+        }
     }
 }
 
@@ -223,13 +272,17 @@ void Alignment::initSWMode(unsigned int alignmentMode) {
 }
 
 Alignment::~Alignment() {
-    if (realign == true) {
-        delete realign_m;
+    if (resources == NULL) {
+        if (realign == true) {
+            delete realign_m;
+        }
+        delete m;
     }
-    delete m;
 
-    tdbr->close();
-    delete tdbr;
+    if (resources == NULL || templateDBIsIndex == true) {
+        tdbr->close();
+        delete tdbr;
+    }
 
     if (templateDBIsIndex == true) {
         delete tSeqLookup;
@@ -237,7 +290,7 @@ Alignment::~Alignment() {
         delete tidxdbr;
     }
 
-    if (sameQTDB == false) {
+    if (sameQTDB == false && resources == NULL) {
         qdbr->close();
         delete qdbr;
     }
@@ -249,14 +302,21 @@ Alignment::~Alignment() {
 void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc,
                     const unsigned int maxAlnNum, const unsigned int maxRejected) {
 
-    size_t dbFrom = 0;
-    size_t dbSize = 0;
-    Util::decomposeDomainByAminoAcid(prefdbr->getAminoAcidDBSize(), prefdbr->getSeqLens(),
-                                     prefdbr->getSize(), mpiRank, mpiNumProc, &dbFrom, &dbSize);
+    if (greedyClustering == true && mpiNumProc > 1) {
+        Debug(Debug::ERROR) << "Greedy clustering can not be split over several processes.\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // small chunks are handed out on demand, a process that is faster or got the short queries asks for more
+    const size_t dbSize = prefdbr->getSize();
+    const size_t chunkSize = std::max(static_cast<size_t>(threads) * 16, dbSize / (static_cast<size_t>(mpiNumProc) * 64));
+    MPIScheduler scheduler(0, dbSize, chunkSize);
 
-    Debug(Debug::INFO) << "Compute split from " << dbFrom << " to " << (dbFrom + dbSize) << "\n";
     std::pair<std::string, std::string> tmpOutput = Util::createTmpFileNames(outDB, outDBIndex, mpiRank);
-    run(tmpOutput.first, tmpOutput.second, dbFrom, dbSize, maxAlnNum, maxRejected);
+    DBWriter dbw(tmpOutput.first.c_str(), tmpOutput.second.c_str(), threads);
+    dbw.open();
+    run(dbw, scheduler, dbSize, maxAlnNum, maxRejected);
+    dbw.close();
 
 #ifdef HAVE_MPI
     MPI_Barrier(MPI_COMM_WORLD);
@@ -280,18 +340,65 @@ void Alignment::run(const unsigned int maxAlnNum, const unsigned int maxRejected
 void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
                     const size_t dbFrom, const size_t dbSize,
                     const unsigned int maxAlnNum, const unsigned int maxRejected) {
-    size_t alignmentsNum = 0;
-    size_t totalPassedNum = 0;
-
+    if (greedyClustering == true) {
+        runGreedyClustering(outDB, outDBIndex);
+        return;
+    }
     DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads);
+    // the queries before resumeFrom were aligned by an interrupted run
+    size_t resumeFrom = dbFrom;
+    const std::string state = dbw.enableCheckpoints(checkpointSignature, checkpointInterval);
+    if (state.empty() == false) {
+        resumeFrom = strtoull(state.c_str(), NULL, 10);
+        if (resumeFrom < dbFrom || resumeFrom > dbFrom + dbSize) {
+            Debug(Debug::ERROR) << "Invalid checkpoint state " << state << " of " << outDB << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        Debug(Debug::INFO) << "Continuing with query " << resumeFrom << " of " << (dbFrom + dbSize) << "\n";
+    }
     dbw.open();
 
-    EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), this->m, gapOpen, gapExtend);
-    size_t totalMemory = Util::getTotalSystemMemory();
     size_t flushSize = 1000000;
-    if(totalMemory > prefdbr->getDataSize()){
+    if (Util::getTotalSystemMemory() > prefdbr->getDataSize()) {
         flushSize = dbSize;
     }
+    if (dbw.hasCheckpoints()) {
+        // a checkpoint can only be taken between two chunks, the first one measures the speed
+        // and run() sizes the next ones to the checkpoint interval
+        flushSize = std::min(flushSize, static_cast<size_t>(threads) * 256);
+    }
+    MPIScheduler scheduler(resumeFrom, dbFrom + dbSize - resumeFrom, flushSize);
+    run(dbw, scheduler, dbFrom + dbSize - resumeFrom, maxAlnNum, maxRejected);
+    dbw.close();
+}
+
+void Alignment::run(DBWriter &dbw, MPIScheduler &scheduler, const size_t totalSize,
+                    const unsigned int maxAlnNum, const unsigned int maxRejected) {
+    Metrics::Phase phase("align");
+    size_t alignmentsNum = 0;
+    size_t totalPassedNum = 0;
+    size_t kmerRejectedNum = 0;
+    size_t ungappedAcceptedNum = 0;
+
+    EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), this->m, gapOpen, gapExtend);
+    EvalueComputation *ungappedEvaluer = NULL;
+    if (ungappedPrescore == true) {
+        ungappedEvaluer = new EvalueComputation(tdbr->getAminoAcidDBSize(), this->m);
+    }
+    // amino acid targets are aligned directly from the index without mapping them into a Sequence
+    const bool targetFromLookup = (tSeqLookup != NULL && targetSeqType == Sequence::AMINO_ACIDS
+                                   && querySeqType != Sequence::NUCLEOTIDES);
+    // the mapped prefilter results are released after this many queries
+    size_t flushSize = 1000000;
+    if (Util::getTotalSystemMemory() > prefdbr->getDataSize()) {
+        flushSize = std::numeric_limits<size_t>::max();
+    }
+    size_t processedNum = 0;
+    size_t unmappedNum = 0;
+    bool hasChunk = false;
+    size_t chunkFrom = 0;
+    size_t chunkSize = 0;
+    Progress progress("align", totalSize);
 #pragma omp parallel
     {
         unsigned int thread_idx = 0;
@@ -303,27 +410,58 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
         char buffer[1024+32768];
         Sequence qSeq(maxSeqLen, querySeqType, m, 0, false, compBiasCorrection);
         Sequence dbSeq(maxSeqLen, targetSeqType, m, 0, false, compBiasCorrection);
-        Matcher matcher(querySeqType, maxSeqLen, m, &evaluer, compBiasCorrection, gapOpen, gapExtend);
+        Matcher matcher(querySeqType, maxSeqLen, m, &evaluer, compBiasCorrection, gapOpen, gapExtend, bandWidth);
         Matcher *realigner = NULL;
         if (realign ==  true) {
             realigner = new Matcher(querySeqType, maxSeqLen, realign_m, &evaluer, compBiasCorrection, gapOpen, gapExtend);
         }
+        UngappedAlignment *ungappedAlignment = NULL;
+        float *compositionBias = NULL;
+        if (ungappedPrescore == true) {
+            ungappedAlignment = new UngappedAlignment(maxSeqLen, m, tSeqLookup);
+            compositionBias = new float[maxSeqLen];
+        }
+        KmerIdentityFilter *identityFilter = NULL;
+        if (fastIdentity == true) {
+            identityFilter = new KmerIdentityFilter(maxSeqLen, m);
+        }
 
-        size_t iterations = static_cast<size_t>(ceil(static_cast<double>(dbSize) / static_cast<double>(flushSize)));
-        for (size_t i = 0; i < iterations; i++) {
-            size_t start = dbFrom + (i * flushSize);
-            size_t bucketSize = std::min(dbSize - (i * flushSize), flushSize);
+        while (true) {
+#pragma omp master
+            {
+                hasChunk = scheduler.next(&chunkFrom, &chunkSize);
+            }
+#pragma omp barrier
+            if (hasChunk == false) {
+                break;
+            }
+            const size_t start = chunkFrom;
+            const size_t bucketSize = chunkSize;
 
-#pragma omp for schedule(dynamic, 5) reduction(+: alignmentsNum, totalPassedNum)
+#pragma omp for schedule(dynamic, 5) reduction(+: alignmentsNum, totalPassedNum, kmerRejectedNum, ungappedAcceptedNum)
             for (size_t id = start; id < (start + bucketSize); id++) {
-                Debug::printProgress(id);
-
+                if (thread_idx == 0) {
+                    // MPI is only called from the master thread
+                    scheduler.serve();
+                }
                 // get the prefiltering list
                 char *data = prefdbr->getData(id);
                 unsigned int queryDbKey = prefdbr->getDbKey(id);
                 setQuerySequence(qSeq, id, queryDbKey);
+                progress.update(1, qSeq.L);
 
                 matcher.initQuery(&qSeq);
+                if (ungappedAlignment != NULL) {
+                    if (compBiasCorrection == true && qSeq.getSeqType() == Sequence::AMINO_ACIDS) {
+                        SubstitutionMatrix::calcLocalAaBiasCorrection(m, qSeq.int_sequence, qSeq.L, compositionBias);
+                    } else {
+                        memset(compositionBias, 0, sizeof(float) * qSeq.L);
+                    }
+                    ungappedAlignment->processQuery(&qSeq, compositionBias, NULL, 0);
+                }
+                if (identityFilter != NULL) {
+                    identityFilter->initQuery(&qSeq);
+                }
                 // parse the prefiltering list and calculate a Smith-Waterman alignment for each sequence in the list
                 std::vector<Matcher::result_t> swResults;
                 std::vector<Matcher::result_t> swRealignResults;
@@ -342,12 +480,21 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
                     // Prefilter result (need to make this better)
                     if(elements == 3){
                         hit_t hit = QueryMatcher::parsePrefilterHit(data);
-                        diagonal = hit.diagonal;
+                        diagonal = static_cast<short>(hit.diagonal);
                     }
 
-                    setTargetSequence(dbSeq, dbKey);
+                    const unsigned char *lookupSeq = NULL;
+                    unsigned int dbLen;
+                    if (targetFromLookup) {
+                        std::pair<const unsigned char*, const unsigned int> sequence = tSeqLookup->getSequence(tdbr->getId(dbKey));
+                        lookupSeq = sequence.first;
+                        dbLen = sequence.second;
+                    } else {
+                        setTargetSequence(dbSeq, dbKey);
+                        dbLen = dbSeq.L;
+                    }
                     // check if the sequences could pass the coverage threshold
-                    if(Util::canBeCovered(canCovThr, covMode, static_cast<float>(qSeq.L), static_cast<float>(dbSeq.L)) == false )
+                    if(Util::canBeCovered(canCovThr, covMode, static_cast<float>(qSeq.L), static_cast<float>(dbLen)) == false )
                     {
                         rejected++;
                         data = Util::skipLine(data);
@@ -355,8 +502,49 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
                     }
                     const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB)) ? true : false;
 
+                    // decide high seq. id. pairs by their shared k-mers and the ungapped diagonal
+                    if (identityFilter != NULL && isIdentity == false) {
+                        const bool canReachSeqId = (targetFromLookup)
+                                ? identityFilter->canReachSeqId(lookupSeq, dbLen, seqIdThr, seqIdMode, covMode, covThr)
+                                : identityFilter->canReachSeqId(dbSeq.int_sequence, dbLen, seqIdThr, seqIdMode, covMode, covThr);
+                        if (canReachSeqId == false) {
+                            kmerRejectedNum++;
+                            rejected++;
+                            data = Util::skipLine(data);
+                            continue;
+                        }
+                        Matcher::result_t res;
+                        const bool hasUngapped = (targetFromLookup)
+                                ? identityFilter->ungappedResult(dbKey, lookupSeq, dbLen, diagonal, &evaluer, seqIdMode, res)
+                                : identityFilter->ungappedResult(dbKey, dbSeq.int_sequence, dbLen, diagonal, &evaluer, seqIdMode, res);
+                        if (hasUngapped == true && checkCriteria(res, false, evalThr, seqIdThr, covMode, covThr)) {
+                            swResults.emplace_back(res);
+                            ungappedAcceptedNum++;
+                            passedNum++;
+                            totalPassedNum++;
+                            rejected = 0;
+                            data = Util::skipLine(data);
+                            continue;
+                        }
+                    }
+
+                    // the ungapped score on the prefilter diagonal has to be significant already
+                    if (ungappedAlignment != NULL && isIdentity == false && diagonal != INT_MAX) {
+                        const unsigned short minDistToDiagonal = static_cast<unsigned short>(abs(diagonal));
+                        const int ungappedScore = ungappedAlignment->scoreSingleSequence(std::make_pair(lookupSeq, dbLen),
+                                                                                         static_cast<unsigned short>(diagonal),
+                                                                                         minDistToDiagonal);
+                        if (ungappedEvaluer->computeEvalue(ungappedScore, qSeq.L) > evalThr) {
+                            rejected++;
+                            data = Util::skipLine(data);
+                            continue;
+                        }
+                    }
+
                     // calculate Smith-Waterman alignment
-                    Matcher::result_t res = matcher.getSWResult(&dbSeq, diagonal, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity);
+                    Matcher::result_t res = (targetFromLookup)
+                            ? matcher.getSWResult(dbKey, std::make_pair(lookupSeq, dbLen), diagonal, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity)
+                            : matcher.getSWResult(&dbSeq, diagonal, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity);
                     alignmentsNum++;
 
                     //set coverage and seqid if identity
@@ -418,34 +606,64 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
                 alnResultsOutString.clear();
             }
 
-#pragma omp barrier
-            if (thread_idx == 0) {
-                prefdbr->remapData();
+#pragma omp master
+            {
+                processedNum += bucketSize;
+                unmappedNum += bucketSize;
+                if (unmappedNum >= flushSize) {
+                    prefdbr->remapData();
+                    unmappedNum = 0;
+                }
+                // the other threads wait for the next chunk, nothing is written meanwhile
+                dbw.checkpoint(SSTR(chunkFrom + chunkSize));
+                if (dbw.hasCheckpoints()) {
+                    scheduler.setChunkSize(dbw.checkpointChunkSize(processedNum, static_cast<size_t>(threads) * 256));
+                }
             }
-#pragma omp barrier
         }
 
         if (realign == true) {
             delete realigner;
         }
+        if (ungappedAlignment != NULL) {
+            delete ungappedAlignment;
+            delete [] compositionBias;
+        }
+        if (identityFilter != NULL) {
+            delete identityFilter;
+        }
+    }
+    progress.finish();
+    if (ungappedEvaluer != NULL) {
+        delete ungappedEvaluer;
     }
 
-    dbw.close();
+    Metrics::addCounter("alignments", alignmentsNum);
+    Metrics::addCounter("alignmentsPassed", totalPassedNum);
+    Metrics::addCounter("kmerRejected", kmerRejectedNum);
+    Metrics::addCounter("ungappedAccepted", ungappedAcceptedNum);
 
     Debug(Debug::INFO) << "\nAll sequences processed.\n\n";
     Debug(Debug::INFO) << alignmentsNum << " alignments calculated.\n";
     Debug(Debug::INFO) << totalPassedNum << " sequence pairs passed the thresholds ("
                        << ((float) totalPassedNum / (float) alignmentsNum) << " of overall calculated).\n";
+    if (fastIdentity == true) {
+        Debug(Debug::INFO) << kmerRejectedNum << " sequence pairs rejected by shared k-mers, "
+                           << ungappedAcceptedNum << " accepted by ungapped alignment.\n";
+    }
 
-    size_t hits = totalPassedNum / dbSize;
-    size_t hits_rest = totalPassedNum % dbSize;
-    float hits_f = ((float) hits) + ((float) hits_rest) / (float) dbSize;
-    Debug(Debug::INFO) << hits_f << " hits per query sequence.\n";
+    if (processedNum > 0) {
+        size_t hits = totalPassedNum / processedNum;
+        size_t hits_rest = totalPassedNum % processedNum;
+        float hits_f = ((float) hits) + ((float) hits_rest) / (float) processedNum;
+        Debug(Debug::INFO) << hits_f << " hits per query sequence.\n";
+    }
 }
 
 inline void Alignment::setQuerySequence(Sequence &seq, size_t id, unsigned int key) {
     if (qSeqLookup != NULL) {
-        std::pair<const unsigned char*, const unsigned int> sequence = qSeqLookup->getSequence(id);
+        // id refers to the prefilter database, the lookup is ordered like the query database
+        std::pair<const unsigned char*, const unsigned int> sequence = qSeqLookup->getSequence(qdbr->getId(key));
         seq.mapSequence(id, key, sequence);
     } else {
         // map the query sequence
@@ -526,17 +744,336 @@ void Alignment::computeAlternativeAlignment(unsigned int queryDbKey, Sequence &d
         for (int pos = swResults[i].dbStartPos; pos < swResults[i].dbEndPos; ++pos) {
             dbSeq.int_sequence[pos] = xIndex;
         }
-        bool nextAlignment = true;
-        for (int altAli = 0; altAli < altAlignment && nextAlignment; altAli++) {
-            Matcher::result_t res = matcher.getSWResult(&dbSeq, INT_MAX, covMode, covThr, evalThr, swMode,
-                                                        seqIdMode, isIdentity);
-            nextAlignment = checkCriteria(res, isIdentity, evalThr, seqIdThr, covMode, covThr);
-            if (nextAlignment == true) {
-                swResults.emplace_back(res);
-                for (int pos = res.dbStartPos; pos < res.dbEndPos; pos++) {
-                    dbSeq.int_sequence[pos] = xIndex;
+        // all alternatives are traced back from the column maxima of one sweep over the masked target
+        std::vector<Matcher::result_t> altResults = matcher.getAlternativeSWResults(&dbSeq, altAlignment, covMode, covThr,
+                                                                                    evalThr, swMode, seqIdMode);
+        for (size_t altAli = 0; altAli < altResults.size(); altAli++) {
+            if (checkCriteria(altResults[altAli], isIdentity, evalThr, seqIdThr, covMode, covThr) == false) {
+                break;
+            }
+            swResults.emplace_back(altResults[altAli]);
+        }
+    }
+}
+
+bool Alignment::acceptHit(Matcher &matcher, KmerIdentityFilter *identityFilter, EvalueComputation &evaluer,
+                          Sequence &qSeq, Sequence &dbSeq, bool targetFromLookup,
+                          unsigned int dbKey, int diagonal, size_t &alignmentsNum, Matcher::result_t &res) {
+    const unsigned char *lookupSeq = NULL;
+    unsigned int dbLen;
+    if (targetFromLookup) {
+        std::pair<const unsigned char*, const unsigned int> sequence = tSeqLookup->getSequence(tdbr->getId(dbKey));
+        lookupSeq = sequence.first;
+        dbLen = sequence.second;
+    } else {
+        setTargetSequence(dbSeq, dbKey);
+        dbLen = dbSeq.L;
+    }
+    if (Util::canBeCovered(canCovThr, covMode, static_cast<float>(qSeq.L), static_cast<float>(dbLen)) == false) {
+        return false;
+    }
+    if (identityFilter != NULL) {
+        const bool canReachSeqId = (targetFromLookup)
+                ? identityFilter->canReachSeqId(lookupSeq, dbLen, seqIdThr, seqIdMode, covMode, covThr)
+                : identityFilter->canReachSeqId(dbSeq.int_sequence, dbLen, seqIdThr, seqIdMode, covMode, covThr);
+        if (canReachSeqId == false) {
+            return false;
+        }
+        const bool hasUngapped = (targetFromLookup)
+                ? identityFilter->ungappedResult(dbKey, lookupSeq, dbLen, diagonal, &evaluer, seqIdMode, res)
+                : identityFilter->ungappedResult(dbKey, dbSeq.int_sequence, dbLen, diagonal, &evaluer, seqIdMode, res);
+        if (hasUngapped == true && checkCriteria(res, false, evalThr, seqIdThr, covMode, covThr)) {
+            return true;
+        }
+    }
+    res = (targetFromLookup)
+            ? matcher.getSWResult(dbKey, std::make_pair(lookupSeq, dbLen), diagonal, covMode, covThr, evalThr, swMode, seqIdMode, false)
+            : matcher.getSWResult(&dbSeq, diagonal, covMode, covThr, evalThr, swMode, seqIdMode, false);
+    alignmentsNum++;
+    return checkCriteria(res, false, evalThr, seqIdThr, covMode, covThr);
+}
+
+// parses a prefilter hit, returns the id of the target
+static size_t parseGreedyHit(DBReader<unsigned int> *tdbr, char *data, unsigned int *dbKey, int *diagonal) {
+    char dbKeyBuffer[255 + 1];
+    char *words[10];
+    Util::parseKey(data, dbKeyBuffer);
+    *dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
+    const size_t targetId = tdbr->getId(*dbKey);
+    if (targetId == UINT_MAX) {
+        Debug(Debug::ERROR) << "ERROR: Sequence " << *dbKey
+                            << " is required in the prefiltering, but is not contained in the target sequence database!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    *diagonal = INT_MAX;
+    if (Util::getWordsOfLine(data, words, 10) == 3) {
+        hit_t hit = QueryMatcher::parsePrefilterHit(data);
+        *diagonal = static_cast<short>(hit.diagonal);
+    }
+    return targetId;
+}
+
+// the representative of a longer sequence, waits until the thread that clusters it has decided
+static inline unsigned int waitForRepresentative(const unsigned int *assigned, unsigned int rank) {
+    unsigned int representative;
+    while ((representative = __atomic_load_n(&assigned[rank], __ATOMIC_ACQUIRE)) == UINT_MAX) {
+        sched_yield();
+    }
+    return representative;
+}
+
+// clust --cluster-mode 2 assigns each sequence, from long to short, to the first representative among
+// its neighbours: its own alignments in the order align writes them, then the sequences that aligned
+// to it by their rank. The same decision only needs the alignments with the longer representatives,
+// and it depends on nothing but the decisions for the longer sequences, so the result is the same for
+// any number of threads. Hits with the same E-value and score are taken in the order of their target
+// key, align leaves their order to its sort.
+void Alignment::runGreedyClustering(const std::string &outDB, const std::string &outDBIndex) {
+    Metrics::Phase phase("greedyAlign");
+    if (sameQTDB == false) {
+        Debug(Debug::ERROR) << "Greedy clustering needs the same query and target database.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (querySeqType == Sequence::HMM_PROFILE || querySeqType == Sequence::PROFILE_STATE_PROFILE) {
+        Debug(Debug::ERROR) << "Greedy clustering does not support profiles.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const size_t dbSize = tdbr->getSize();
+
+    // same order as clust: longer sequences first, by id on ties
+    std::pair<unsigned int, unsigned int> *order = new std::pair<unsigned int, unsigned int>[dbSize];
+    for (size_t i = 0; i < dbSize; i++) {
+        order[i] = std::make_pair(static_cast<unsigned int>(i), static_cast<unsigned int>(tdbr->getSeqLens(i)));
+    }
+    std::sort(order, order + dbSize, DBReader<unsigned int>::comparePairBySeqLength());
+    unsigned int *rank = new unsigned int[dbSize];
+    for (size_t pos = 0; pos < dbSize; pos++) {
+        rank[order[pos].first] = pos;
+    }
+
+    // the prefilter database is opened for linear access, its ids are not ordered by key
+    size_t *prefIds = new size_t[dbSize];
+    std::fill_n(prefIds, dbSize, SIZE_MAX);
+
+    // back links: rank and diagonal of the longer sequences with the sequence among their prefilter hits
+    size_t *backOffsets = new size_t[dbSize + 1];
+    std::fill_n(backOffsets, dbSize + 1, 0);
+#pragma omp parallel for schedule(dynamic, 1000)
+    for (size_t id = 0; id < prefdbr->getSize(); id++) {
+        const size_t queryId = tdbr->getId(prefdbr->getDbKey(id));
+        if (queryId == UINT_MAX) {
+            continue;
+        }
+        prefIds[rank[queryId]] = id;
+        char *data = prefdbr->getData(id);
+        while (*data != '\0') {
+            unsigned int dbKey;
+            int diagonal;
+            const unsigned int targetRank = rank[parseGreedyHit(tdbr, data, &dbKey, &diagonal)];
+            if (targetRank > rank[queryId]) {
+                __atomic_fetch_add(&backOffsets[targetRank + 1], 1, __ATOMIC_RELAXED);
+            }
+            data = Util::skipLine(data);
+        }
+    }
+    for (size_t pos = 0; pos < dbSize; pos++) {
+        backOffsets[pos + 1] += backOffsets[pos];
+    }
+    std::pair<unsigned int, int> *backLinks = new std::pair<unsigned int, int>[backOffsets[dbSize]];
+    size_t *backFill = new size_t[dbSize];
+    std::copy(backOffsets, backOffsets + dbSize, backFill);
+#pragma omp parallel for schedule(dynamic, 1000)
+    for (size_t id = 0; id < prefdbr->getSize(); id++) {
+        const size_t queryId = tdbr->getId(prefdbr->getDbKey(id));
+        if (queryId == UINT_MAX) {
+            continue;
+        }
+        char *data = prefdbr->getData(id);
+        while (*data != '\0') {
+            unsigned int dbKey;
+            int diagonal;
+            const unsigned int targetRank = rank[parseGreedyHit(tdbr, data, &dbKey, &diagonal)];
+            if (targetRank > rank[queryId]) {
+                const size_t pos = __atomic_fetch_add(&backFill[targetRank], 1, __ATOMIC_RELAXED);
+                backLinks[pos] = std::make_pair(rank[queryId], diagonal);
+            }
+            data = Util::skipLine(data);
+        }
+    }
+    delete [] backFill;
+#pragma omp parallel for schedule(dynamic, 1000)
+    for (size_t pos = 0; pos < dbSize; pos++) {
+        std::sort(backLinks + backOffsets[pos], backLinks + backOffsets[pos + 1]);
+    }
+
+    // rank of the representative, UINT_MAX until the sequence is decided
+    unsigned int *assigned = new unsigned int[dbSize];
+    std::fill_n(assigned, dbSize, UINT_MAX);
+
+    size_t alignmentsNum = 0;
+    size_t backLinkNum = 0;
+    EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), this->m, gapOpen, gapExtend);
+    const bool targetFromLookup = (tSeqLookup != NULL && targetSeqType == Sequence::AMINO_ACIDS
+                                   && querySeqType != Sequence::NUCLEOTIDES);
+    Progress progress("align", dbSize);
+    // the sequences are handed out in rank order, so a longer sequence a thread waits for is decided
+    // already or being decided by another thread
+    size_t nextPos = 0;
+#pragma omp parallel reduction(+: alignmentsNum, backLinkNum)
+    {
+        Sequence qSeq(maxSeqLen, querySeqType, m, 0, false, compBiasCorrection);
+        Sequence dbSeq(maxSeqLen, targetSeqType, m, 0, false, compBiasCorrection);
+        Matcher matcher(querySeqType, maxSeqLen, m, &evaluer, compBiasCorrection, gapOpen, gapExtend, bandWidth);
+        KmerIdentityFilter *identityFilter = NULL;
+        if (fastIdentity == true) {
+            identityFilter = new KmerIdentityFilter(maxSeqLen, m);
+        }
+        // rank, key and diagonal of the prefilter hits to longer sequences
+        std::vector<std::pair<unsigned int, std::pair<unsigned int, int> > > hits;
+
+        size_t pos;
+        while ((pos = __atomic_fetch_add(&nextPos, 1, __ATOMIC_RELAXED)) < dbSize) {
+            // the sequence lengths include the newline and the null byte
+            progress.update(1, order[pos].second - 2);
+            const unsigned int queryId = order[pos].first;
+            const unsigned int queryDbKey = tdbr->getDbKey(queryId);
+            char *data = (prefIds[pos] != SIZE_MAX) ? prefdbr->getData(prefIds[pos]) : NULL;
+            hits.clear();
+            while (data != NULL && *data != '\0') {
+                unsigned int dbKey;
+                int diagonal;
+                const unsigned int targetRank = rank[parseGreedyHit(tdbr, data, &dbKey, &diagonal)];
+                if (targetRank < pos) {
+                    hits.push_back(std::make_pair(targetRank, std::make_pair(dbKey, diagonal)));
                 }
+                data = Util::skipLine(data);
             }
+
+            // the representative that align would write first among the alignments of the query
+            unsigned int representative = UINT_MAX;
+            Matcher::result_t best;
+            bool queryIsSet = false;
+            for (size_t i = 0; i < hits.size(); i++) {
+                const unsigned int targetRank = hits[i].first;
+                if (waitForRepresentative(assigned, targetRank) != targetRank) {
+                    continue;
+                }
+                if (queryIsSet == false) {
+                    setQuerySequence(qSeq, queryId, queryDbKey);
+                    matcher.initQuery(&qSeq);
+                    if (identityFilter != NULL) {
+                        identityFilter->initQuery(&qSeq);
+                    }
+                    queryIsSet = true;
+                }
+                Matcher::result_t res;
+                if (acceptHit(matcher, identityFilter, evaluer, qSeq, dbSeq, targetFromLookup,
+                              hits[i].second.first, hits[i].second.second, alignmentsNum, res)
+                    && (representative == UINT_MAX || Matcher::compareHitsAndId(res, best))) {
+                    representative = targetRank;
+                    best = res;
+                }
+            }
+
+            // otherwise the longest representative whose alignment with the sequence passes
+            for (size_t i = backOffsets[pos]; i < backOffsets[pos + 1] && representative == UINT_MAX; i++) {
+                const unsigned int repRank = backLinks[i].first;
+                if (waitForRepresentative(assigned, repRank) != repRank) {
+                    continue;
+                }
+                const unsigned int repId = order[repRank].first;
+                setQuerySequence(qSeq, repId, tdbr->getDbKey(repId));
+                matcher.initQuery(&qSeq);
+                if (identityFilter != NULL) {
+                    identityFilter->initQuery(&qSeq);
+                }
+                Matcher::result_t res;
+                if (acceptHit(matcher, identityFilter, evaluer, qSeq, dbSeq, targetFromLookup,
+                              queryDbKey, backLinks[i].second, alignmentsNum, res)) {
+                    representative = repRank;
+                    backLinkNum++;
+                }
+            }
+
+            if (representative == UINT_MAX) {
+                representative = static_cast<unsigned int>(pos);
+            }
+            __atomic_store_n(&assigned[pos], representative, __ATOMIC_RELEASE);
+        }
+        if (identityFilter != NULL) {
+            delete identityFilter;
+        }
+    }
+    progress.finish();
+    delete [] backLinks;
+    delete [] backOffsets;
+    delete [] prefIds;
+
+    // members in rank order after their representative
+    size_t *offsets = new size_t[dbSize + 1];
+    std::fill_n(offsets, dbSize + 1, 0);
+    for (size_t pos = 0; pos < dbSize; pos++) {
+        offsets[assigned[pos] + 1]++;
+    }
+    for (size_t pos = 0; pos < dbSize; pos++) {
+        offsets[pos + 1] += offsets[pos];
+    }
+    unsigned int *members = new unsigned int[dbSize];
+    for (size_t pos = 0; pos < dbSize; pos++) {
+        if (assigned[pos] == pos) {
+            members[offsets[pos]++] = pos;
+        }
+    }
+    for (size_t pos = 0; pos < dbSize; pos++) {
+        if (assigned[pos] != pos) {
+            members[offsets[assigned[pos]]++] = pos;
         }
     }
+    for (size_t pos = dbSize; pos > 0; pos--) {
+        offsets[pos] = offsets[pos - 1];
+    }
+    offsets[0] = 0;
+
+    size_t clusterNum = 0;
+    DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads);
+    dbw.open();
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        std::string result;
+        char buffer[32];
+#pragma omp for schedule(dynamic, 1000) reduction(+: clusterNum)
+        for (size_t pos = 0; pos < dbSize; pos++) {
+            if (assigned[pos] != pos) {
+                continue;
+            }
+            for (size_t i = offsets[pos]; i < offsets[pos + 1]; i++) {
+                char *outpos = Itoa::u32toa_sse2(tdbr->getDbKey(order[members[i]].first), buffer);
+                result.append(buffer, (outpos - buffer - 1));
+                result.push_back('\n');
+            }
+            dbw.writeData(result.c_str(), result.length(), tdbr->getDbKey(order[pos].first), thread_idx);
+            result.clear();
+            clusterNum++;
+        }
+    }
+    dbw.close();
+
+    delete [] members;
+    delete [] offsets;
+    delete [] assigned;
+    delete [] rank;
+    delete [] order;
+
+    Metrics::addCounter("alignments", alignmentsNum);
+    Metrics::addCounter("greedyBackLinks", backLinkNum);
+    Metrics::addCounter("clusters", clusterNum);
+
+    Debug(Debug::INFO) << "\nAll sequences processed.\n\n";
+    Debug(Debug::INFO) << alignmentsNum << " alignments calculated.\n";
+    Debug(Debug::INFO) << backLinkNum << " sequences joined a representative that aligned to them.\n";
+    Debug(Debug::INFO) << clusterNum << " clusters.\n";
 }
@@ -12,6 +12,11 @@
 #include "SequenceLookup.h"
 #include "Matcher.h"
 
+class KmerIdentityFilter;
+class DBWriter;
+class MPIScheduler;
+class WorkflowResources;
+
 class Alignment {
 
 public:
@@ -20,7 +25,7 @@ public:
               const std::string &targetSeqDB, const std::string &targetSeqDBIndex,
               const std::string &prefDB, const std::string &prefDBIndex,
               const std::string &outDB, const std::string &outDBIndex,
-              const Parameters &par);
+              const Parameters &par, WorkflowResources *resources = NULL);
 
     ~Alignment();
 
@@ -36,6 +41,10 @@ public:
              const size_t dbFrom, const size_t dbSize,
              const unsigned int maxAlnNum, const unsigned int maxRejected);
 
+    // aligns the chunks handed out by the scheduler
+    void run(DBWriter &dbw, MPIScheduler &scheduler, const size_t totalSize,
+             const unsigned int maxAlnNum, const unsigned int maxRejected);
+
     static bool checkCriteria(Matcher::result_t &res, bool isIdentity, double evalThr, double seqIdThr, int covMode, float covThr);
 
 
@@ -77,6 +86,10 @@ private:
     unsigned int swMode;
     unsigned int threads;
 
+    // identifies the run for resuming it from a checkpoint
+    const size_t checkpointSignature;
+    const int checkpointInterval;
+
     const std::string outDB;
     const std::string outDBIndex;
 
@@ -86,6 +99,10 @@ private:
     const bool compBiasCorrection;
 
     int altAlignment;
+    const int bandWidth;
+    bool ungappedPrescore;
+    bool fastIdentity;
+    const bool greedyClustering;
 
     BaseMatrix *m;
     // costs to open a gap
@@ -108,6 +125,9 @@ private:
 
     bool templateDBIsIndex;
 
+    // an in-process workflow lends the sequence databases, the matrices and the sequence lookup of the prefilter
+    WorkflowResources *resources;
+
     void initSWMode(unsigned int alignmentMode);
 
     void setQuerySequence(Sequence &seq, size_t id, unsigned int key);
@@ -116,6 +136,15 @@ private:
 
     static size_t estimateHDDMemoryConsumption(int dbSize, int maxSeqs);
 
+    // aligns the sequences by decreasing length against the longer representatives and writes the
+    // greedy incremental clustering that clust --cluster-mode 2 computes from all alignments
+    void runGreedyClustering(const std::string &outDB, const std::string &outDBIndex);
+
+    // decides if the query and the target pass the thresholds, counts the computed alignments
+    bool acceptHit(Matcher &matcher, KmerIdentityFilter *identityFilter, EvalueComputation &evaluer,
+                   Sequence &qSeq, Sequence &dbSeq, bool targetFromLookup,
+                   unsigned int dbKey, int diagonal, size_t &alignmentsNum, Matcher::result_t &res);
+
     void computeAlternativeAlignment(unsigned int queryDbKey, Sequence &dbSeq,
                                      std::vector<Matcher::result_t> &vector, Matcher &matcher,
                                      float evalThr, int swMode);
@@ -0,0 +1,141 @@
+#include "KmerIdentityFilter.h"
+#include "DistanceCalculator.h"
+#include "StripedSmithWaterman.h"
+#include "Parameters.h"
+#include "Util.h"
+
+#include <cmath>
+#include <climits>
+
+KmerIdentityFilter::KmerIdentityFilter(unsigned int maxSeqLen, BaseMatrix *m) : m(m), query(NULL), queryLength(0) {
+    tableSize = static_cast<size_t>(pow(m->alphabetSize, KMER_SIZE));
+    queryKmerCounts = new unsigned int[tableSize];
+    memset(queryKmerCounts, 0, sizeof(unsigned int) * tableSize);
+    queryCharSequence = new unsigned char[maxSeqLen + 1];
+    subMat = new const char*[m->alphabetSize];
+    subMatData = new char[m->alphabetSize * m->alphabetSize];
+    for (int i = 0; i < m->alphabetSize; i++) {
+        for (int j = 0; j < m->alphabetSize; j++) {
+            subMatData[i * m->alphabetSize + j] = static_cast<char>(m->subMatrix[i][j]);
+        }
+        subMat[i] = &subMatData[i * m->alphabetSize];
+    }
+}
+
+KmerIdentityFilter::~KmerIdentityFilter() {
+    delete [] queryKmerCounts;
+    delete [] queryCharSequence;
+    delete [] subMat;
+    delete [] subMatData;
+}
+
+void KmerIdentityFilter::initQuery(Sequence *seq) {
+    // reset the counts of the previous query, the Sequence object might already hold the next one
+    for (int pos = 0; pos + KMER_SIZE <= queryLength; pos++) {
+        queryKmerCounts[kmerIndex(queryCharSequence + pos)] = 0;
+    }
+    query = seq;
+    queryLength = query->L;
+    for (int pos = 0; pos < queryLength; pos++) {
+        queryCharSequence[pos] = static_cast<unsigned char>(query->int_sequence[pos]);
+    }
+    for (int pos = 0; pos + KMER_SIZE <= queryLength; pos++) {
+        queryKmerCounts[kmerIndex(queryCharSequence + pos)]++;
+    }
+}
+
+template <typename T>
+bool KmerIdentityFilter::canReachSeqId(const T *dbSeq, unsigned int dbLen, double seqIdThr, int seqIdMode,
+                                       int covMode, float covThr) {
+    // the number of identity runs is only bounded if the seq. id. is normalized by the alignment length
+    const double minSeqId = static_cast<double>(KMER_SIZE - 1) / static_cast<double>(KMER_SIZE);
+    if (seqIdMode != Parameters::SEQ_ID_ALN_LEN || seqIdThr <= minSeqId) {
+        return true;
+    }
+    const double queryLen = static_cast<double>(query->L);
+    const double targetLen = static_cast<double>(dbLen);
+    double minAlnLen = 0.0;
+    switch (covMode) {
+        case Parameters::COV_MODE_BIDIRECTIONAL:
+            minAlnLen = covThr * std::max(queryLen, targetLen);
+            break;
+        case Parameters::COV_MODE_TARGET:
+            minAlnLen = covThr * targetLen;
+            break;
+        case Parameters::COV_MODE_QUERY:
+            minAlnLen = covThr * queryLen;
+            break;
+        default:
+            minAlnLen = 0.0;
+    }
+    const double minIdentities = seqIdThr * minAlnLen;
+    const double runsPerIdentity = (1.0 - seqIdThr) / seqIdThr;
+    const double minShared = floor(minIdentities - (KMER_SIZE - 1) * (minIdentities * runsPerIdentity + 1.0));
+    if (minShared <= 0.0) {
+        return true;
+    }
+    const size_t requiredShared = static_cast<size_t>(minShared);
+    size_t shared = 0;
+    for (unsigned int pos = 0; pos + KMER_SIZE <= dbLen; pos++) {
+        shared += queryKmerCounts[kmerIndex(dbSeq + pos)];
+        if (shared >= requiredShared) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+bool KmerIdentityFilter::ungappedResult(unsigned int dbKey, const T *dbSeq, unsigned int dbLen, int diagonal,
+                                        EvalueComputation *evaluer, int seqIdMode, Matcher::result_t &result) {
+    if (diagonal == INT_MAX) {
+        return false;
+    }
+    const int queryLen = query->L;
+    const int targetLen = static_cast<int>(dbLen);
+    const unsigned int distanceToDiagonal = abs(diagonal);
+    int qOffset = 0;
+    int tOffset = 0;
+    int diagonalLen = 0;
+    if (diagonal >= 0 && static_cast<int>(distanceToDiagonal) < queryLen) {
+        qOffset = distanceToDiagonal;
+        diagonalLen = std::min(targetLen, queryLen - qOffset);
+    } else if (diagonal < 0 && static_cast<int>(distanceToDiagonal) < targetLen) {
+        tOffset = distanceToDiagonal;
+        diagonalLen = std::min(targetLen - tOffset, queryLen);
+    }
+    if (diagonalLen <= 0) {
+        return false;
+    }
+    const T *querySeq = querySequence(dbSeq) + qOffset;
+    const T *targetSeq = dbSeq + tOffset;
+    DistanceCalculator::LocalAlignment alignment =
+            DistanceCalculator::computeUngappedAlignment(querySeq, targetSeq, diagonalLen, subMat);
+    if (alignment.score == 0) {
+        return false;
+    }
+    int aaIds = 0;
+    for (int pos = alignment.startPos; pos <= alignment.endPos; pos++) {
+        aaIds += (querySeq[pos] == targetSeq[pos]);
+    }
+    const unsigned int qStartPos = qOffset + alignment.startPos;
+    const unsigned int qEndPos = qOffset + alignment.endPos;
+    const unsigned int dbStartPos = tOffset + alignment.startPos;
+    const unsigned int dbEndPos = tOffset + alignment.endPos;
+    const unsigned int alnLength = alignment.endPos - alignment.startPos + 1;
+    const float qcov = SmithWaterman::computeCov(qStartPos, qEndPos, queryLen);
+    const float dbcov = SmithWaterman::computeCov(dbStartPos, dbEndPos, targetLen);
+    const float seqId = Util::computeSeqId(seqIdMode, aaIds, queryLen, targetLen, alnLength);
+    const double evalue = evaluer->computeEvalue(alignment.score, queryLen);
+    const int bitScore = static_cast<short>(evaluer->computeBitScore(alignment.score) + 0.5);
+    result = Matcher::result_t(dbKey, bitScore, qcov, dbcov, seqId, evalue, alnLength, qStartPos, qEndPos,
+                               queryLen, dbStartPos, dbEndPos, targetLen, std::string(alnLength, 'M'));
+    return true;
+}
+
+template bool KmerIdentityFilter::canReachSeqId<int>(const int *, unsigned int, double, int, int, float);
+template bool KmerIdentityFilter::canReachSeqId<unsigned char>(const unsigned char *, unsigned int, double, int, int, float);
+template bool KmerIdentityFilter::ungappedResult<int>(unsigned int, const int *, unsigned int, int,
+                                                      EvalueComputation *, int, Matcher::result_t &);
+template bool KmerIdentityFilter::ungappedResult<unsigned char>(unsigned int, const unsigned char *, unsigned int, int,
+                                                                EvalueComputation *, int, Matcher::result_t &);
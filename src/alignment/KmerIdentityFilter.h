@@ -0,0 +1,67 @@
+#ifndef MMSEQS_KMERIDENTITYFILTER_H
+#define MMSEQS_KMERIDENTITYFILTER_H
+
+// Decides sequence pairs for high sequence identity thresholds without gapped alignment.
+//
+// An alignment with I identical columns and a seq. id. of at least t (normalized by the
+// alignment length) has at most I(1-t)/t non-identical columns and therefore at most
+// I(1-t)/t + 1 runs of identical residues. A run of length r contains r-k+1 k-mer matches,
+// so query and target share at least I - (k-1) * (I(1-t)/t + 1) k-mer matches.
+// The coverage threshold gives the smallest I, pairs sharing fewer k-mers can not pass.
+
+#include "BaseMatrix.h"
+#include "Sequence.h"
+#include "Matcher.h"
+#include "EvalueComputation.h"
+
+class KmerIdentityFilter {
+public:
+    KmerIdentityFilter(unsigned int maxSeqLen, BaseMatrix *m);
+    ~KmerIdentityFilter();
+
+    // counts the k-mers of the query
+    void initQuery(Sequence *query);
+
+    // false if the pair can not reach seqIdThr with the required coverage
+    template <typename T>
+    bool canReachSeqId(const T *dbSeq, unsigned int dbLen, double seqIdThr, int seqIdMode,
+                       int covMode, float covThr);
+
+    // local ungapped alignment on the prefilter diagonal, returns false if the diagonal lies outside of the pair
+    template <typename T>
+    bool ungappedResult(unsigned int dbKey, const T *dbSeq, unsigned int dbLen, int diagonal,
+                        EvalueComputation *evaluer, int seqIdMode, Matcher::result_t &result);
+
+    static const int KMER_SIZE = 4;
+
+private:
+    BaseMatrix *m;
+    Sequence *query;
+    int queryLength;
+    unsigned char *queryCharSequence;
+    unsigned int *queryKmerCounts;
+    size_t tableSize;
+
+    // substitution matrix rows indexed by residue code, as used by the DistanceCalculator
+    const char **subMat;
+    char *subMatData;
+
+    const int *querySequence(const int *) {
+        return query->int_sequence;
+    }
+
+    const unsigned char *querySequence(const unsigned char *) {
+        return queryCharSequence;
+    }
+
+    template <typename T>
+    size_t kmerIndex(const T *seq) {
+        size_t index = 0;
+        for (int i = 0; i < KMER_SIZE; i++) {
+            index = index * m->alphabetSize + static_cast<size_t>(seq[i]);
+        }
+        return index;
+    }
+};
+
+#endif
@@ -3,21 +3,24 @@
 #include "Debug.h"
 #include "Util.h"
 #include "MMseqsMPI.h"
+#include "PerfCounters.h"
+#include "WorkflowResources.h"
 
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
 
-int align(int argc, const char **argv, const Command& command) {
+int align(int argc, const char **argv, const Command& command, WorkflowResources *resources) {
     MMseqsMPI::init(argc, argv);
 
     Parameters& par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, 4, true, 0, MMseqsParameter::COMMAND_ALIGN);
+    PerfCounters::init(par.perfCounters);
 
     Debug(Debug::INFO) << "Init data structures...\n";
     Alignment aln(par.db1, par.db1Index, par.db2, par.db2Index,
-                  par.db3, par.db3Index, par.db4, par.db4Index, par);
+                  par.db3, par.db3Index, par.db4, par.db4Index, par, resources);
 
     Debug(Debug::INFO) << "Calculation of Smith-Waterman alignments.\n";
 
@@ -26,8 +29,11 @@ int align(int argc, const char **argv, const Command& command) {
 #else
     aln.run(par.maxAccept, par.maxRejected);
 #endif
+    PerfCounters::print();
 
     return EXIT_SUCCESS;
 }
 
-
+int align(int argc, const char **argv, const Command& command) {
+    return align(argc, argv, command, NULL);
+}
@@ -7,11 +7,12 @@
 
 
 Matcher::Matcher(int querySeqType, int maxSeqLen, BaseMatrix *m, EvalueComputation * evaluer,
-                 bool aaBiasCorrection, int gapOpen, int gapExtend){
+                 bool aaBiasCorrection, int gapOpen, int gapExtend, int bandWidth){
     this->m = m;
     this->tinySubMat = NULL;
     this->gapOpen = gapOpen;
     this->gapExtend = gapExtend;
+    this->bandWidth = bandWidth;
     if(querySeqType != Sequence::PROFILE_STATE_PROFILE ) {
         setSubstitutionMatrix(m);
     }
@@ -66,18 +67,6 @@ void Matcher::initQuery(Sequence* query){
 Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, const int covMode, const float covThr,
                                        const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode,
                                        bool isIdentity){
-    // calculation of the score and traceback of the alignment
-    int32_t maskLen = currentQuery->L / 2;
-
-    // calcuate stop score
-//    const double qL = static_cast<double>(currentQuery->L);
-//    const double dbL = static_cast<double>(dbSeq->L);
-
-    // avoid nummerical issues -log(evalThr/(qL*dbL*seqDbSize))
-//    double datapoints = -log(static_cast<double>(seqDbSize)) - log(qL) - log(dbL) + log(evalThr);
-    //std::cout << seqDbSize << " " << 100 << " " << scoreThr << std::endl;
-    //std::cout <<datapoints << " " << m->getBitFactor() <<" "<< evalThr << " " << seqDbSize << " " << currentQuery->L << " " << dbSeq->L<< " " << scoreThr << " " << std::endl;
-    s_align alignment;
     if(dbSeq->getSequenceType()==Sequence::NUCLEOTIDES){
         if(diagonal==INT_MAX){
             Debug(Debug::ERROR) << "ERROR: Query sequence " << currentQuery->getDbKey()
@@ -85,14 +74,63 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
                                 << "Please check your database.\n";
             EXIT(EXIT_FAILURE);
         }
-        alignment = nuclaligner->align(dbSeq,diagonal,evaluer);
-        alignmentMode = Matcher::SCORE_COV_SEQID;
+        s_align alignment = nuclaligner->align(dbSeq,diagonal,evaluer);
+        return alignmentToResult(alignment, dbSeq->int_sequence, dbSeq->L, dbSeq->getDbKey(),
+                                 Matcher::SCORE_COV_SEQID, seqIdMode, isIdentity);
+    }
+    return computeSWResult(dbSeq->int_sequence, dbSeq->L, dbSeq->getDbKey(), diagonal, covMode, covThr, evalThr,
+                           alignmentMode, seqIdMode, isIdentity);
+}
+
+Matcher::result_t Matcher::getSWResult(unsigned int dbKey, std::pair<const unsigned char *, const unsigned int> dbSeq,
+                                       const int diagonal, const int covMode, const float covThr,
+                                       const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode,
+                                       bool isIdentity){
+    return computeSWResult(dbSeq.first, dbSeq.second, dbKey, diagonal, covMode, covThr, evalThr,
+                           alignmentMode, seqIdMode, isIdentity);
+}
+
+std::vector<Matcher::result_t> Matcher::getAlternativeSWResults(Sequence* dbSeq, const int maxAlignments,
+                                                                const int covMode, const float covThr,
+                                                                const double evalThr, unsigned int alignmentMode,
+                                                                unsigned int seqIdMode){
+    std::vector<result_t> results;
+    if(dbSeq->getSequenceType()==Sequence::NUCLEOTIDES){
+        return results;
+    }
+    int32_t maskLen = currentQuery->L / 2;
+    std::vector<s_align> alignments = aligner->ssw_align_alternatives(dbSeq->int_sequence, dbSeq->L, gapOpen, gapExtend,
+                                                                      alignmentMode, evalThr, evaluer, covMode, covThr,
+                                                                      maskLen, maxAlignments);
+    for(size_t i = 0; i < alignments.size(); i++){
+        results.emplace_back(alignmentToResult(alignments[i], dbSeq->int_sequence, dbSeq->L, dbSeq->getDbKey(),
+                                               alignmentMode, seqIdMode, false));
+    }
+    return results;
+}
+
+template <typename T>
+Matcher::result_t Matcher::computeSWResult(const T *dbSeq, const int dbLen, const unsigned int dbKey, const int diagonal,
+                                           const int covMode, const float covThr, const double evalThr,
+                                           unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentity){
+    // calculation of the score and traceback of the alignment
+    int32_t maskLen = currentQuery->L / 2;
+    s_align alignment;
+    if(isIdentity==false && bandWidth > 0 && diagonal != INT_MAX){
+        alignment = aligner->ssw_align_banded(dbSeq, dbLen, diagonal, bandWidth, gapOpen, gapExtend,
+                                              alignmentMode, evalThr, evaluer, covMode, covThr, maskLen);
     }else if(isIdentity==false){
-        alignment = aligner->ssw_align(dbSeq->int_sequence, dbSeq->L, gapOpen, gapExtend, alignmentMode, evalThr, evaluer, covMode, covThr, maskLen);
+        alignment = aligner->ssw_align(dbSeq, dbLen, gapOpen, gapExtend, alignmentMode, evalThr, evaluer, covMode, covThr, maskLen);
     }else{
-        alignment = aligner->scoreIdentical(dbSeq->int_sequence, dbSeq->L, evaluer, alignmentMode);
+        alignment = aligner->scoreIdentical(dbSeq, dbLen, evaluer, alignmentMode);
     }
+    return alignmentToResult(alignment, dbSeq, dbLen, dbKey, alignmentMode, seqIdMode, isIdentity);
+}
 
+template <typename T>
+Matcher::result_t Matcher::alignmentToResult(const s_align &alignment, const T *dbSeq, const int dbLen,
+                                             const unsigned int dbKey, unsigned int alignmentMode,
+                                             unsigned int seqIdMode, bool isIdentity){
     // calculation of the coverage and e-value
     float qcov = 0.0;
     float dbcov = 0.0;
@@ -112,7 +150,7 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
 
                     for (uint32_t i = 0; i < length; ++i){
                         if (letter == 'M') {
-                            if (dbSeq->int_sequence[targetPos] == currentQuery->int_sequence[queryPos]){
+                            if (dbSeq[targetPos] == currentQuery->int_sequence[queryPos]){
                                 aaIds++;
                             }
                             ++queryPos;
@@ -144,7 +182,7 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
     const unsigned int qEndPos = alignment.qEndPos1;
     const unsigned int dbEndPos = alignment.dbEndPos1;
     // normalize score
-//    alignment->score1 = alignment->score1 - log2(dbSeq->L);
+//    alignment->score1 = alignment->score1 - log2(dbLen);
     if(alignmentMode == Matcher::SCORE_COV || alignmentMode == Matcher::SCORE_COV_SEQID) {
         qcov  = alignment.qCov;
         dbcov = alignment.tCov;
@@ -158,7 +196,7 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
             // OVERWRITE alnLength with gapped value
             alnLength = backtrace.size();
         }
-        seqId = Util::computeSeqId(seqIdMode, aaIds, currentQuery->L, dbSeq->L, alnLength);
+        seqId = Util::computeSeqId(seqIdMode, aaIds, currentQuery->L, dbLen, alnLength);
 
     }else if( alignmentMode == Matcher::SCORE_COV){
         // "20%   30%   40%   50%   60%   70%   80%   90%   99%"
@@ -178,7 +216,7 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, cons
     double evalue = alignment.evalue;
     int bitScore = static_cast<short>(evaluer->computeBitScore(alignment.score1)+0.5);
 
-    result_t result(dbSeq->getDbKey(), bitScore, qcov, dbcov, seqId, evalue, alnLength, qStartPos, qEndPos, currentQuery->L, dbStartPos, dbEndPos, dbSeq->L, backtrace);
+    result_t result(dbKey, bitScore, qcov, dbcov, seqId, evalue, alnLength, qStartPos, qEndPos, currentQuery->L, dbStartPos, dbEndPos, dbLen, backtrace);
     delete [] alignment.cigar;
     return result;
 }
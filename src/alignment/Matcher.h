@@ -62,7 +62,7 @@ public:
 
     Matcher(int querySeqType, int maxSeqLen, BaseMatrix *m,
             EvalueComputation * evaluer, bool aaBiasCorrection,
-            int gapOpen, int gapExtend);
+            int gapOpen, int gapExtend, int bandWidth = 0);
 
     ~Matcher();
 
@@ -70,6 +70,16 @@ public:
     result_t getSWResult(Sequence* dbSeq, const int diagonal, const int covMode, const float covThr, const double evalThr,
                          unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical);
 
+    // same as above for amino acid targets taken directly from a SequenceLookup, no Sequence mapping required
+    result_t getSWResult(unsigned int dbKey, std::pair<const unsigned char *, const unsigned int> dbSeq,
+                         const int diagonal, const int covMode, const float covThr, const double evalThr,
+                         unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical);
+
+    // suboptimal alignments from a single sweep over dbSeq, regions already reported should be masked
+    std::vector<result_t> getAlternativeSWResults(Sequence* dbSeq, const int maxAlignments, const int covMode,
+                                                  const float covThr, const double evalThr,
+                                                  unsigned int alignmentMode, unsigned int seqIdMode);
+
     // need for sorting the results
     static bool compareHits (const result_t &first, const result_t &second){
         //return (first.eval < second.eval);
@@ -84,6 +94,15 @@ public:
         return false;
     }
 
+    // compareHits with ties by target, so the order does not depend on the sort
+    static bool compareHitsAndId(const result_t &first, const result_t &second){
+        if(compareHits(first, second))
+            return true;
+        if(compareHits(second, first))
+            return false;
+        return first.dbKey < second.dbKey;
+    }
+
     // map new query into memory (create queryProfile, ...)
     void initQuery(Sequence* query);
 
@@ -110,6 +129,9 @@ private:
     // costs to extend a gap
     int gapExtend;
 
+    // initial half band width around the prefilter diagonal, 0 computes the full matrix
+    int bandWidth;
+
     // calculate the query queryProfile for SIMD registers processing 8 elements
     int maxSeqLen;
 
@@ -129,6 +151,17 @@ private:
     // set substituion matrix
     void setSubstitutionMatrix(BaseMatrix *m);
 
+    // align the current query against a target encoded as int (Sequence) or unsigned char (SequenceLookup)
+    template <typename T>
+    result_t computeSWResult(const T *dbSeq, const int dbLen, const unsigned int dbKey, const int diagonal,
+                             const int covMode, const float covThr, const double evalThr,
+                             unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentity);
+
+    // compute coverage, sequence identity and backtrace of an alignment
+    template <typename T>
+    result_t alignmentToResult(const s_align &alignment, const T *dbSeq, const int dbLen, const unsigned int dbKey,
+                               unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentity);
+
 };
 
 #endif
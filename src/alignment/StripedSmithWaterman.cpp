@@ -29,6 +29,9 @@
 #include "Util.h"
 #include "SubstitutionMatrix.h"
 #include "Debug.h"
+#include "PerfCounters.h"
+
+#include <algorithm>
 
 
 SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCorrection) {
@@ -62,6 +65,16 @@ SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCo
 	memset(profile->mat_rev, 0, maxSequenceLength * aaSize);
 	memset(profile->composition_bias, 0, maxSequenceLength * sizeof(int8_t));
 	memset(profile->composition_bias_rev, 0, maxSequenceLength * sizeof(int8_t));
+
+	bandedProfile = NULL;
+	bandedProfileRev = NULL;
+	bandedProfileSize = 0;
+	bandedProfilePad = 0;
+	bandedProfileStride = 0;
+	bandedProfileReady = false;
+	bandedH = NULL;
+	bandedE = NULL;
+	bandedBufferSize = 0;
 }
 
 SmithWaterman::~SmithWaterman(){
@@ -84,6 +97,14 @@ SmithWaterman::~SmithWaterman(){
 	delete [] tmp_composition_bias;
 	delete [] maxColumn;
 	delete profile;
+	if (bandedProfile != NULL) {
+		free(bandedProfile);
+		free(bandedProfileRev);
+	}
+	if (bandedH != NULL) {
+		free(bandedH);
+		free(bandedE);
+	}
 }
 
 
@@ -126,8 +147,9 @@ void SmithWaterman::createQueryProfile(simd_int *profile, const int8_t *query_se
 }
 
 
+template <typename T>
 s_align SmithWaterman::ssw_align (
-		const int *db_sequence,
+		const T *db_sequence,
 		int32_t db_length,
 		const uint8_t gap_open,
 		const uint8_t gap_extend,
@@ -136,6 +158,7 @@ s_align SmithWaterman::ssw_align (
 		EvalueComputation * evaluer,
 		const int covMode, const float covThr,
 		const int32_t maskLen) {
+	PerfCounters::Scope perfScope(PerfCounters::SMITH_WATERMAN);
 
 	alignment_end* bests = 0, *bests_reverse = 0;
 	int32_t word = 0, query_length = profile->query_length;
@@ -261,6 +284,412 @@ s_align SmithWaterman::ssw_align (
 
 
 
+template <typename T>
+s_align SmithWaterman::ssw_align_banded (
+		const T *db_sequence,
+		int32_t db_length,
+		int32_t diagonal,
+		int32_t bandWidth,
+		const uint8_t gap_open,
+		const uint8_t gap_extend,
+		const uint8_t alignmentMode,
+		const double  evalueThr,
+		EvalueComputation * evaluer,
+		const int covMode, const float covThr,
+		const int32_t maskLen) {
+	PerfCounters::Scope perfScope(PerfCounters::SMITH_WATERMAN);
+	const int32_t query_length = profile->query_length;
+	const int32_t SIMD_SIZE = VECSIZE_INT * 2;
+	// only plain amino acid sequences have a linear word profile without position specific scores
+	if (profile->sequence_type != Sequence::AMINO_ACIDS || diagonal == INT_MAX || bandWidth <= 0) {
+		return ssw_align(db_sequence, db_length, gap_open, gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, maskLen);
+	}
+
+	int32_t halfWidth = bandWidth;
+	int32_t lanes = 0;
+	int32_t diagonalStart = 0;
+	banded_end best;
+	while (true) {
+		lanes = ((2 * halfWidth + 1 + SIMD_SIZE - 1) / SIMD_SIZE) * SIMD_SIZE;
+		// band covers a large part of the matrix, the striped alignment is faster
+		if (2 * lanes >= query_length) {
+			return ssw_align(db_sequence, db_length, gap_open, gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, maskLen);
+		}
+		initBandedProfile();
+		diagonalStart = diagonal - (lanes - 1) / 2;
+		best = sw_banded_word(db_sequence, 0, db_length, query_length, diagonalStart, lanes, gap_open, gap_extend,
+							  bandedProfile + bandedProfilePad, bandedProfileStride, -1);
+		// no cell in the band or score close to overflow
+		if (best.score <= 0 || best.score >= SHRT_MAX - 255) {
+			return ssw_align(db_sequence, db_length, gap_open, gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, maskLen);
+		}
+		// the alignment drifted towards the band border, it might continue outside
+		if (2 * abs((best.read - best.ref) - diagonal) > halfWidth || 2 * best.edgeScore > best.score) {
+			halfWidth *= 2;
+			continue;
+		}
+		break;
+	}
+
+	s_align r;
+	r.dbStartPos1 = -1;
+	r.qStartPos1 = -1;
+	r.cigar = 0;
+	r.cigarLen = 0;
+	r.score1 = best.score;
+	r.dbEndPos1 = best.ref;
+	r.qEndPos1 = best.read;
+	r.score2 = 0;
+	r.ref_end2 = -1;
+	r.evalue = evaluer->computeEvalue(r.score1, query_length);
+	bool hasLowerEvalue = r.evalue > evalueThr;
+	r.qCov = computeCov(0, r.qEndPos1, query_length);
+	r.tCov = computeCov(0, r.dbEndPos1, db_length);
+	bool hasLowerCoverage = !(Util::hasCoverage(covThr, covMode, r.qCov, r.tCov));
+
+	if (alignmentMode == 0 || ((alignmentMode == 2 || alignmentMode == 1) && hasLowerEvalue && hasLowerCoverage)){
+		return r;
+	}
+
+	// Find the beginning position of the best alignment by aligning the reversed sequences in the mirrored band
+	const int32_t diagonalEnd = diagonalStart + lanes - 1;
+	const int32_t revDiagonalStart = (r.qEndPos1 - r.dbEndPos1) - diagonalEnd;
+	const short * revProfile = bandedProfileRev + bandedProfilePad + (query_length - 1 - r.qEndPos1);
+	banded_end bestReverse = sw_banded_word(db_sequence, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, revDiagonalStart, lanes,
+											gap_open, gap_extend, revProfile, bandedProfileStride, r.score1);
+	if (bestReverse.score != r.score1) {
+		return ssw_align(db_sequence, db_length, gap_open, gap_extend, alignmentMode, evalueThr, evaluer, covMode, covThr, maskLen);
+	}
+	r.dbStartPos1 = r.dbEndPos1 - bestReverse.ref;
+	r.qStartPos1 = r.qEndPos1 - bestReverse.read;
+	if (2 * abs((r.qStartPos1 - r.dbStartPos1) - diagonal) > halfWidth) {
+		return ssw_align_banded(db_sequence, db_length, diagonal, halfWidth * 2, gap_open, gap_extend, alignmentMode,
+								evalueThr, evaluer, covMode, covThr, maskLen);
+	}
+	r.qCov = computeCov(r.qStartPos1, r.qEndPos1, query_length);
+	r.tCov = computeCov(r.dbStartPos1, r.dbEndPos1, db_length);
+	hasLowerCoverage = !(Util::hasCoverage(covThr, covMode, r.qCov, r.tCov));
+	if (alignmentMode == 1 || hasLowerCoverage) {
+		return r;
+	}
+
+	// Generate cigar, the band of banded_sw is relative to the diagonal through the start positions
+	const int32_t startDiagonal = r.qStartPos1 - r.dbStartPos1;
+	const int32_t band_width = std::max(abs(diagonalStart - startDiagonal), abs(diagonalEnd - startDiagonal)) + 1;
+	cigar* path = banded_sw<SUBSTITUTIONMATRIX>(db_sequence + r.dbStartPos1,
+												profile->query_sequence + r.qStartPos1,
+												profile->composition_bias + r.qStartPos1,
+												r.dbEndPos1 - r.dbStartPos1 + 1, r.qEndPos1 - r.qStartPos1 + 1,
+												r.qStartPos1, r.score1, gap_open, gap_extend, band_width,
+												profile->mat, profile->alphabetSize);
+	if (path != 0) {
+		r.cigar = path->seq;
+		r.cigarLen = path->length;
+	}
+	delete(path);
+	return r;
+}
+
+template <typename T>
+std::vector<s_align> SmithWaterman::ssw_align_alternatives (
+		const T *db_sequence,
+		int32_t db_length,
+		const uint8_t gap_open,
+		const uint8_t gap_extend,
+		const uint8_t alignmentMode,
+		const double  evalueThr,
+		EvalueComputation * evaluer,
+		const int covMode, const float covThr,
+		const int32_t maskLen,
+		const int32_t maxAlignments) {
+	std::vector<s_align> alignments;
+	const int32_t query_length = profile->query_length;
+	const bool isProfile = profile->sequence_type == Sequence::HMM_PROFILE
+						   || profile->sequence_type == Sequence::PROFILE_STATE_PROFILE;
+	if (maxAlignments <= 0) {
+		return alignments;
+	}
+
+	// single forward pass, maxColumn holds the best score ending in each target column afterwards
+	alignment_end* bests = sw_sse2_word(db_sequence, 0, db_length, query_length, gap_open, gap_extend,
+										profile->profile_word, -1, maskLen);
+	free(bests);
+	// the end of an alignment is a peak of the column maxima, its trailing columns only decline
+	std::vector<std::pair<uint16_t, int32_t> > peaks;
+	const uint16_t * columnMax = (const uint16_t *) maxColumn;
+	for (int32_t j = 0; j < db_length; j++) {
+		const uint16_t score = columnMax[j];
+		if (score > 0 && (j == 0 || score > columnMax[j - 1]) && (j == db_length - 1 || score >= columnMax[j + 1])) {
+			peaks.emplace_back(score, j);
+		}
+	}
+	std::sort(peaks.begin(), peaks.end(), [](const std::pair<uint16_t, int32_t> &a, const std::pair<uint16_t, int32_t> &b) {
+		return (a.first > b.first) || (a.first == b.first && a.second < b.second);
+	});
+
+	// reverse profile of the full query, the start of every alignment is searched with it
+	if (isProfile) {
+		createQueryProfile<int16_t, VECSIZE_INT * 2, PROFILE>(profile->profile_rev_word, profile->query_rev_sequence, NULL, profile->mat_rev,
+															  query_length, profile->alphabetSize, 0, 1, query_length);
+	} else {
+		createQueryProfile<int16_t, VECSIZE_INT * 2, SUBSTITUTIONMATRIX>(profile->profile_rev_word, profile->query_rev_sequence, profile->composition_bias_rev,
+																		 profile->mat, query_length, profile->alphabetSize, 0, 1, 0);
+	}
+
+	for (size_t p = 0; p < peaks.size() && static_cast<int32_t>(alignments.size()) < maxAlignments; p++) {
+		const uint16_t score = peaks[p].first;
+		const int32_t peakColumn = peaks[p].second;
+		const double evalue = evaluer->computeEvalue(score, query_length);
+		if (evalue > evalueThr) {
+			break;
+		}
+		bool overlaps = false;
+		for (size_t i = 0; i < alignments.size() && overlaps == false; i++) {
+			overlaps = peakColumn >= alignments[i].dbStartPos1 && peakColumn <= alignments[i].dbEndPos1;
+		}
+		if (overlaps) {
+			continue;
+		}
+
+		// start position from the peak column backwards
+		alignment_end* start = sw_sse2_word(db_sequence, 1, peakColumn + 1, query_length, gap_open, gap_extend,
+											profile->profile_rev_word, score, maskLen);
+		const int32_t dbStart = start[0].ref;
+		const int32_t qStart = query_length - 1 - start[0].read;
+		const bool startFound = start[0].score == score;
+		free(start);
+		if (startFound == false) {
+			continue;
+		}
+
+		// end position from the start forwards, profile_rev_byte serves as scratch space for the suffix profile
+		const int32_t suffixLength = query_length - qStart;
+		if (isProfile) {
+			createQueryProfile<int16_t, VECSIZE_INT * 2, PROFILE>(profile->profile_rev_byte, profile->query_sequence, NULL, profile->mat,
+																  suffixLength, profile->alphabetSize, 0, qStart + 1, query_length);
+		} else {
+			createQueryProfile<int16_t, VECSIZE_INT * 2, SUBSTITUTIONMATRIX>(profile->profile_rev_byte, profile->query_sequence, profile->composition_bias,
+																			 profile->mat, suffixLength, profile->alphabetSize, 0, qStart, 0);
+		}
+		alignment_end* end = sw_sse2_word(db_sequence + dbStart, 0, peakColumn - dbStart + 1, suffixLength, gap_open, gap_extend,
+										  profile->profile_rev_byte, score, maskLen);
+		const int32_t dbEnd = dbStart + end[0].ref;
+		const int32_t qEnd = qStart + end[0].read;
+		const bool endFound = end[0].score == score;
+		free(end);
+		if (endFound == false) {
+			continue;
+		}
+
+		// declumping: the path runs through an alignment that was already reported
+		for (size_t i = 0; i < alignments.size() && overlaps == false; i++) {
+			overlaps = dbStart <= alignments[i].dbEndPos1 && dbEnd >= alignments[i].dbStartPos1;
+		}
+		if (overlaps) {
+			continue;
+		}
+
+		s_align r;
+		r.score1 = score;
+		r.score2 = 0;
+		r.ref_end2 = -1;
+		r.evalue = evalue;
+		r.qStartPos1 = qStart;
+		r.qEndPos1 = qEnd;
+		r.dbStartPos1 = dbStart;
+		r.dbEndPos1 = dbEnd;
+		r.cigar = 0;
+		r.cigarLen = 0;
+		r.qCov = computeCov(qStart, qEnd, query_length);
+		r.tCov = computeCov(dbStart, dbEnd, db_length);
+		const bool hasLowerCoverage = !(Util::hasCoverage(covThr, covMode, r.qCov, r.tCov));
+		if (alignmentMode == 2 && hasLowerCoverage == false) {
+			const int32_t alnDbLength = dbEnd - dbStart + 1;
+			const int32_t alnQueryLength = qEnd - qStart + 1;
+			const int32_t band_width = abs(alnDbLength - alnQueryLength) + 1;
+			cigar* path;
+			if (isProfile) {
+				path = banded_sw<PROFILE>(db_sequence + dbStart, profile->query_sequence + qStart, NULL,
+										  alnDbLength, alnQueryLength, qStart, score, gap_open, gap_extend, band_width,
+										  profile->mat, profile->query_length);
+			} else {
+				path = banded_sw<SUBSTITUTIONMATRIX>(db_sequence + dbStart, profile->query_sequence + qStart,
+													 profile->composition_bias + qStart, alnDbLength, alnQueryLength,
+													 qStart, score, gap_open, gap_extend, band_width,
+													 profile->mat, profile->alphabetSize);
+			}
+			if (path != 0) {
+				r.cigar = path->seq;
+				r.cigarLen = path->length;
+			}
+			delete(path);
+		}
+		alignments.push_back(r);
+	}
+	return alignments;
+}
+
+void SmithWaterman::initBandedProfile() {
+	if (bandedProfileReady) {
+		return;
+	}
+	const int32_t SIMD_SIZE = VECSIZE_INT * 2;
+	const int32_t query_length = profile->query_length;
+	// banded alignment is only used while 2 * lanes < query_length, the padding covers the outermost lanes
+	bandedProfilePad = query_length / 2 + 2 * SIMD_SIZE;
+	bandedProfileStride = query_length + 2 * bandedProfilePad;
+	const size_t size = static_cast<size_t>(profile->alphabetSize) * bandedProfileStride;
+	if (size > bandedProfileSize) {
+		if (bandedProfile != NULL) {
+			free(bandedProfile);
+			free(bandedProfileRev);
+		}
+		bandedProfile = (short *) mem_align(ALIGN_INT, size * sizeof(short));
+		bandedProfileRev = (short *) mem_align(ALIGN_INT, size * sizeof(short));
+		bandedProfileSize = size;
+	}
+	// padding is scored low enough that it can never be part of a positive scoring path
+	const short padScore = SHRT_MIN / 4;
+	for (int32_t aa = 0; aa < profile->alphabetSize; aa++) {
+		short * forward = bandedProfile + aa * bandedProfileStride;
+		short * reverse = bandedProfileRev + aa * bandedProfileStride;
+		std::fill(forward, forward + bandedProfileStride, padScore);
+		std::fill(reverse, reverse + bandedProfileStride, padScore);
+		const short * linear = profile->profile_word_linear[aa];
+		for (int32_t i = 0; i < query_length; i++) {
+			forward[bandedProfilePad + i] = linear[i];
+			reverse[bandedProfilePad + i] = linear[query_length - 1 - i];
+		}
+	}
+	bandedProfileReady = true;
+}
+
+template <typename T>
+SmithWaterman::banded_end SmithWaterman::sw_banded_word(const T* db_sequence,
+														int8_t ref_dir,
+														int32_t db_length,
+														int32_t query_length,
+														int32_t diagonalStart,
+														int32_t lanes,
+														const uint8_t gap_open,
+														const uint8_t gap_extend,
+														const short * query_profile_linear,
+														int32_t profileStride,
+														int32_t terminate) {
+	const int32_t SIMD_SIZE = VECSIZE_INT * 2;
+	const int32_t segLen = lanes / SIMD_SIZE;
+	// one extra vector so that lane k + 1 of the last vector can be read
+	const size_t columnSize = lanes + SIMD_SIZE;
+	if (2 * columnSize > bandedBufferSize) {
+		if (bandedH != NULL) {
+			free(bandedH);
+			free(bandedE);
+		}
+		bandedH = (short *) mem_align(ALIGN_INT, 2 * columnSize * sizeof(short));
+		bandedE = (short *) mem_align(ALIGN_INT, 2 * columnSize * sizeof(short));
+		bandedBufferSize = 2 * columnSize;
+	}
+	memset(bandedH, 0, 2 * columnSize * sizeof(short));
+	memset(bandedE, 0, 2 * columnSize * sizeof(short));
+	short * pvHLoad = bandedH;
+	short * pvHStore = bandedH + columnSize;
+	short * pvELoad = bandedE;
+	short * pvEStore = bandedE + columnSize;
+
+	short fLast[VECSIZE_INT * 2] __attribute__((aligned(ALIGN_INT)));
+	short laneIndex[VECSIZE_INT * 2] __attribute__((aligned(ALIGN_INT)));
+	short gapRamp[VECSIZE_INT * 2] __attribute__((aligned(ALIGN_INT)));
+	for (int32_t k = 0; k < SIMD_SIZE; k++) {
+		laneIndex[k] = k;
+		gapRamp[k] = -k * gap_extend;
+	}
+	const simd_int vZero = simdi_setzero();
+	const simd_int vGapO = simdi16_set(-gap_open);
+	const simd_int vGapE = simdi16_set(-gap_extend);
+	const simd_int vGapE2 = simdi16_set(-2 * gap_extend);
+	const simd_int vGapE4 = simdi16_set(-4 * gap_extend);
+#ifdef AVX2
+	const simd_int vGapE8 = simdi16_set(-8 * gap_extend);
+#endif
+	const simd_int vPad = simdi16_set(SHRT_MIN / 4);
+	const simd_int vLaneIndex = simdi_load((simd_int*)laneIndex);
+	const simd_int vGapRamp = simdi_load((simd_int*)gapRamp);
+
+	banded_end result;
+	result.score = 0;
+	result.ref = -1;
+	result.read = -1;
+	result.edgeScore = 0;
+
+	// columns in which the band intersects the query
+	const int32_t jStart = std::max(0, -(diagonalStart + lanes - 1));
+	const int32_t jEnd = std::min(db_length, query_length - diagonalStart);
+	for (int32_t j = jStart; j < jEnd; j++) {
+		const int32_t row = j + diagonalStart;
+		const int32_t dbPos = (ref_dir == 0) ? j : (db_length - 1 - j);
+		const short * vP = query_profile_linear + db_sequence[dbPos] * profileStride + row;
+		simd_int vMaxColumn = vZero;
+		int32_t carry = 0;
+		for (int32_t seg = 0; seg < segLen; seg++) {
+			const int32_t offset = seg * SIMD_SIZE;
+			simd_int vScore = simdi_loadu((simd_int*)(vP + offset));
+			// lanes above the first query row (only reachable through the reverse profile offset)
+			if (UNLIKELY(row + offset < 0)) {
+				simd_int vMask = simdi16_gt(simdi16_add(vLaneIndex, simdi16_set(offset)), simdi16_set(-row - 1));
+				vScore = simdi_or(simdi_and(vMask, vScore), simdi_andnot(vMask, vPad));
+			}
+			simd_int vH = simdi16_adds(simdi_load((simd_int*)(pvHLoad + offset)), vScore);
+			vH = simdi16_max(vH, vZero);
+
+			simd_int vE = simdi16_adds(simdi_loadu((simd_int*)(pvHLoad + offset + 1)), vGapO);
+			vE = simdi16_max(vE, simdi16_adds(simdi_loadu((simd_int*)(pvELoad + offset + 1)), vGapE));
+			simdi_store((simd_int*)(pvEStore + offset), vE);
+			vH = simdi16_max(vH, vE);
+
+			// prefix maximum along the query for the vertical gaps
+			simd_int vF = simdi16_adds(simdi8_shiftl(vH, 2), vGapO);
+			vF = simdi16_max(vF, simdi16_adds(simdi8_shiftl(vF, 2), vGapE));
+			vF = simdi16_max(vF, simdi16_adds(simdi8_shiftl(vF, 4), vGapE2));
+			vF = simdi16_max(vF, simdi16_adds(simdi8_shiftl(vF, 8), vGapE4));
+#ifdef AVX2
+			vF = simdi16_max(vF, simdi16_adds(simdi8_shiftl(vF, 16), vGapE8));
+#endif
+			vF = simdi16_max(vF, simdi16_adds(simdi16_set(carry), vGapRamp));
+			vH = simdi16_max(vH, vF);
+			simdi_store((simd_int*)(pvHStore + offset), vH);
+			simdi_store((simd_int*)fLast, vF);
+			vMaxColumn = simdi16_max(vMaxColumn, vH);
+			carry = std::max(pvHStore[offset + SIMD_SIZE - 1] - gap_open, fLast[SIMD_SIZE - 1] - gap_extend);
+		}
+
+		const int32_t maxColumn = simdi16_hmax(vMaxColumn);
+		// border cells that score better than a gap from the column maximum in the band center
+		// are part of a path along the border, lanes outside of the query are only reached by gaps
+		const int32_t edgeTop = (row >= 0) ? pvHStore[0] : 0;
+		const int32_t edgeBottom = (row + lanes - 1 < query_length) ? pvHStore[lanes - 1] : 0;
+		const int32_t edge = std::max(edgeTop, edgeBottom);
+		if (edge > 0 && edge > maxColumn - gap_open - (lanes / 2) * gap_extend) {
+			result.edgeScore = std::max(result.edgeScore, edge);
+		}
+		if (maxColumn > result.score) {
+			result.score = maxColumn;
+			result.ref = j;
+			for (int32_t k = 0; k < lanes; k++) {
+				if (pvHStore[k] == maxColumn) {
+					result.read = row + k;
+					break;
+				}
+			}
+		}
+		if (result.score == terminate) {
+			break;
+		}
+		std::swap(pvHLoad, pvHStore);
+		std::swap(pvELoad, pvEStore);
+	}
+	return result;
+}
+
 char SmithWaterman::cigar_int_to_op (uint32_t cigar_int)
 {
 	uint8_t letter_code = cigar_int & 0xfU;
@@ -289,7 +718,8 @@ uint32_t SmithWaterman::cigar_int_to_len (uint32_t cigar_int)
 	return res;
 }
 
-SmithWaterman::alignment_end* SmithWaterman::sw_sse2_byte (const int* db_sequence,
+template <typename T>
+SmithWaterman::alignment_end* SmithWaterman::sw_sse2_byte (const T* db_sequence,
 														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
 														   int32_t db_length,
 														   int32_t query_length,
@@ -516,7 +946,8 @@ SmithWaterman::alignment_end* SmithWaterman::sw_sse2_byte (const int* db_sequenc
 }
 
 
-SmithWaterman::alignment_end* SmithWaterman::sw_sse2_word (const int* db_sequence,
+template <typename T>
+SmithWaterman::alignment_end* SmithWaterman::sw_sse2_word (const T* db_sequence,
 														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
 														   int32_t db_length,
 														   int32_t query_lenght,
@@ -783,9 +1214,10 @@ void SmithWaterman::ssw_init (const Sequence* q,
 	}
 	profile->query_length = q->L;
 	profile->alphabetSize = alphabetSize;
+	bandedProfileReady = false;
 }
-template <const unsigned int type>
-SmithWaterman::cigar * SmithWaterman::banded_sw(const int *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias,
+template <const unsigned int type, typename T>
+SmithWaterman::cigar * SmithWaterman::banded_sw(const T *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias,
 												int32_t db_length, int32_t query_length, int32_t queryStart,
 												int32_t score, const uint32_t gap_open,
 												const uint32_t gap_extend, int32_t band_width, const int8_t *mat, int32_t n) {
@@ -1063,7 +1495,8 @@ float SmithWaterman::computeCov(unsigned int startPos, unsigned int endPos, unsi
     return (std::min(len, endPos) - startPos + 1) / (float) len;
 }
 
-s_align SmithWaterman::scoreIdentical(int *dbSeq, int L, EvalueComputation * evaluer, int alignmentMode) {
+template <typename T>
+s_align SmithWaterman::scoreIdentical(const T *dbSeq, int L, EvalueComputation * evaluer, int alignmentMode) {
 	if(profile->query_length != L){
 		std::cerr << "scoreIdentical has different length L: "
 				  << L << " query_length: " << profile->query_length
@@ -1159,3 +1592,19 @@ int SmithWaterman::ungapped_alignment(const int *db_sequence, int32_t db_length)
 #undef SWAP
 }
 
+template s_align SmithWaterman::ssw_align<int>(const int *, int32_t, const uint8_t, const uint8_t, const uint8_t,
+											   const double, EvalueComputation *, const int, const float, const int32_t);
+template s_align SmithWaterman::ssw_align<unsigned char>(const unsigned char *, int32_t, const uint8_t, const uint8_t, const uint8_t,
+														 const double, EvalueComputation *, const int, const float, const int32_t);
+template s_align SmithWaterman::ssw_align_banded<int>(const int *, int32_t, int32_t, int32_t, const uint8_t, const uint8_t, const uint8_t,
+													  const double, EvalueComputation *, const int, const float, const int32_t);
+template s_align SmithWaterman::ssw_align_banded<unsigned char>(const unsigned char *, int32_t, int32_t, int32_t, const uint8_t, const uint8_t,
+																const uint8_t, const double, EvalueComputation *, const int, const float, const int32_t);
+template s_align SmithWaterman::scoreIdentical<int>(const int *, int, EvalueComputation *, int);
+template s_align SmithWaterman::scoreIdentical<unsigned char>(const unsigned char *, int, EvalueComputation *, int);
+template std::vector<s_align> SmithWaterman::ssw_align_alternatives<int>(const int *, int32_t, const uint8_t, const uint8_t, const uint8_t,
+																		 const double, EvalueComputation *, const int, const float,
+																		 const int32_t, const int32_t);
+template std::vector<s_align> SmithWaterman::ssw_align_alternatives<unsigned char>(const unsigned char *, int32_t, const uint8_t, const uint8_t,
+																				   const uint8_t, const double, EvalueComputation *, const int,
+																				   const float, const int32_t, const int32_t);
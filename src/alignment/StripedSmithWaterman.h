@@ -38,6 +38,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 
 #if !defined(__APPLE__)
 #include <malloc.h>
@@ -96,7 +97,7 @@ public:
     /*!	@function	Do Striped Smith-Waterman alignment.
 
      @param	db_sequence	pointer to the target sequence; the target sequence needs to be numbers and corresponding to the mat parameter of
-     function ssw_init
+     function ssw_init. Either int (Sequence::int_sequence) or unsigned char (SequenceLookup) encoded.
 
      @param	db_length	length of the target sequence
 
@@ -134,7 +135,8 @@ public:
      while bit 8 is not, the function will return cigar only when both criteria are fulfilled. All returned positions are
      0-based coordinate.
      */
-    s_align  ssw_align (const int*db_sequence,
+    template <typename T>
+    s_align  ssw_align (const T*db_sequence,
                         int32_t db_length,
                         const uint8_t gap_open,
                         const uint8_t gap_extend,
@@ -145,6 +147,51 @@ public:
                         const int32_t maskLen);
 
 
+    /*!	@function	Banded Smith-Waterman alignment around a seed diagonal.
+
+     @param	diagonal	seed diagonal (query position - target position), e.g. taken from the prefilter hit
+
+     @param	bandWidth	initial half-width of the band. The band is doubled as long as the start or end of the
+     alignment drifted more than half the band width away from the seed diagonal or a high scoring path runs
+     along the band border. If the band grows too wide
+     for banding to pay off, ssw_align is used instead.
+
+     All other parameters and the returned structure are identical to ssw_align.
+     */
+    template <typename T>
+    s_align  ssw_align_banded (const T*db_sequence,
+                               int32_t db_length,
+                               int32_t diagonal,
+                               int32_t bandWidth,
+                               const uint8_t gap_open,
+                               const uint8_t gap_extend,
+                               const uint8_t alignmentMode,
+                               const double filters,
+                               EvalueComputation * filterd,
+                               const int covMode, const float covThr,
+                               const int32_t maskLen);
+
+    /*!	@function	Find up to maxAlignments local alignments that do not overlap on the target from a single
+     forward pass. Peaks of the per-column maxima of the forward pass are visited by decreasing score, each peak
+     is traced back to its start by a reverse pass and extended to its end from there. Alignments overlapping an
+     already reported one on the target are discarded (declumping).
+
+     @param	maxAlignments	maximal number of returned alignments
+
+     All other parameters are identical to ssw_align. The alignments are sorted by decreasing score.
+     */
+    template <typename T>
+    std::vector<s_align> ssw_align_alternatives (const T*db_sequence,
+                                                 int32_t db_length,
+                                                 const uint8_t gap_open,
+                                                 const uint8_t gap_extend,
+                                                 const uint8_t alignmentMode,
+                                                 const double evalueThr,
+                                                 EvalueComputation * evaluer,
+                                                 const int covMode, const float covThr,
+                                                 const int32_t maskLen,
+                                                 const int32_t maxAlignments);
+
     /*!	@function computed ungapped alignment score
 
    @param	db_sequence	pointer to the target sequence; the target sequence needs to be numbers and corresponding to the mat parameter of
@@ -185,7 +232,8 @@ public:
 
     static float computeCov(unsigned int startPos, unsigned int endPos, unsigned int len);
 
-    s_align scoreIdentical(int *dbSeq, int L, EvalueComputation * evaluer, int alignmentMode);
+    template <typename T>
+    s_align scoreIdentical(const T *dbSeq, int L, EvalueComputation * evaluer, int alignmentMode);
 
     static void seq_reverse(int8_t * reverse, const int8_t* seq, int32_t end)	/* end is 0-based alignment ending position */
     {
@@ -255,7 +303,8 @@ private:
      wight_match > 0, all other weights < 0.
      The returned positions are 0-based.
      */
-    alignment_end* sw_sse2_byte (const int*db_sequence,
+    template <typename T>
+    alignment_end* sw_sse2_byte (const T*db_sequence,
                                  int8_t ref_dir,	// 0: forward ref; 1: reverse ref
                                  int32_t db_length,
                                  int32_t query_length,
@@ -269,7 +318,8 @@ private:
                                  uint8_t bias,  /* Shift 0 point to a positive value. */
                                  int32_t maskLen);
 
-    alignment_end* sw_sse2_word (const int* db_sequence,
+    template <typename T>
+    alignment_end* sw_sse2_word (const T* db_sequence,
                                  int8_t ref_dir,	// 0: forward ref; 1: reverse ref
                                  int32_t db_length,
                                  int32_t query_lenght,
@@ -279,8 +329,36 @@ private:
                                  uint16_t terminate,
                                  int32_t maskLen);
 
-    template <const unsigned int type>
-    SmithWaterman::cigar *banded_sw(const int *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias, int32_t db_length, int32_t query_length, int32_t queryStart, int32_t score, const uint32_t gap_open, const uint32_t gap_extend, int32_t band_width, const int8_t *mat, int32_t n);
+    typedef struct {
+        int32_t score;
+        int32_t ref;      // 0-based position
+        int32_t read;     // 0-based position
+        int32_t edgeScore; // best score of a path running along the band border
+    } banded_end;
+
+    /* Diagonal banded Smith-Waterman on 16 bit words.
+     The band covers the cells with diagonalStart <= i - j < diagonalStart + lanes.
+     Lane k of column j holds the cell (j + diagonalStart + k, j), therefore the diagonal predecessor
+     is found in the same lane of the previous column and the horizontal predecessor in lane k + 1.
+     */
+    template <typename T>
+    banded_end sw_banded_word(const T* db_sequence,
+                              int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+                              int32_t db_length,
+                              int32_t query_length,
+                              int32_t diagonalStart,
+                              int32_t lanes,
+                              const uint8_t gap_open,
+                              const uint8_t gap_extend,
+                              const short * query_profile_linear, // query profile with padding, position 0 of residue 0
+                              int32_t profileStride,
+                              int32_t terminate);
+
+    // padded linear forward and reverse query profiles used by the banded alignment
+    void initBandedProfile();
+
+    template <const unsigned int type, typename T>
+    SmithWaterman::cigar *banded_sw(const T *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias, int32_t db_length, int32_t query_length, int32_t queryStart, int32_t score, const uint32_t gap_open, const uint32_t gap_extend, int32_t band_width, const int8_t *mat, int32_t n);
 
     /*!	@function		Produce CIGAR 32-bit unsigned integer from CIGAR operation and CIGAR length
      @param	length		length of CIGAR
@@ -301,5 +379,16 @@ private:
     float *tmp_composition_bias;
     short * profile_word_linear_data;
     bool aaBiasCorrection;
+
+    // banded alignment buffers, allocated on first use
+    short * bandedProfile;
+    short * bandedProfileRev;
+    size_t bandedProfileSize;
+    int32_t bandedProfilePad;
+    int32_t bandedProfileStride;
+    bool bandedProfileReady;
+    short * bandedH;
+    short * bandedE;
+    size_t bandedBufferSize;
 };
 #endif /* SMITH_WATERMAN_SSE2_H */
@@ -10,6 +10,7 @@
 #include "CovSeqidQscPercMinDiagTargetCov.out.h"
 #include "QueryMatcher.h"
 #include "NucleotideMatrix.h"
+#include "Progress.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -102,6 +103,7 @@ int doRescorediagonal(Parameters &par,
         flushSize = resultReader.getSize();
     }
     size_t iterations = static_cast<int>(ceil(static_cast<double>(dbSize) / static_cast<double>(flushSize)));
+    Progress progress("rescorediagonal", dbSize);
     for (size_t i = 0; i < iterations; i++) {
         size_t start = dbFrom + (i * flushSize);
         size_t bucketSize = std::min(dbSize - (i * flushSize), flushSize);
@@ -123,13 +125,12 @@ int doRescorediagonal(Parameters &par,
 
 #pragma omp for schedule(dynamic, 1)
             for (size_t id = start; id < (start + bucketSize); id++) {
-                Debug::printProgress(id);
-
                 char *data = resultReader.getData(id);
                 size_t queryKey = resultReader.getDbKey(id);
                 unsigned int queryId = qdbr.getId(queryKey);
                 char *querySeq = qdbr.getData(queryId);
                 int queryLen = std::max(0, static_cast<int>(qdbr.getSeqLens(queryId)) - 2);
+                progress.update(1, queryLen);
 
 //                if(par.rescoreMode != Parameters::RESCORE_MODE_HAMMING){
 //                    query.mapSequence(id, queryId, querySeq);
@@ -162,10 +163,10 @@ int doRescorediagonal(Parameters &par,
                                     querySeq + distanceToDiagonal, targetSeq, diagonalLen);
                         } else if (par.rescoreMode == Parameters::RESCORE_MODE_SUBSTITUTION) {
                             distance = DistanceCalculator::computeSubstitutionDistance(
-                                    querySeq + distanceToDiagonal, targetSeq, diagonalLen, fastMatrix.matrix, par.globalAlignment);
+                                    querySeq + distanceToDiagonal, targetSeq, diagonalLen, fastMatrix.matrix, par.globalAlignment, par.rescoreXDrop);
                         } else if (par.rescoreMode == Parameters::RESCORE_MODE_ALIGNMENT) {
                             alignment = DistanceCalculator::computeSubstitutionStartEndDistance(
-                                    querySeq + distanceToDiagonal, targetSeq, diagonalLen, fastMatrix.matrix);
+                                    querySeq + distanceToDiagonal, targetSeq, diagonalLen, fastMatrix.matrix, par.rescoreXDrop);
                             distance = alignment.score;
                         }
                     } else if (diagonal < 0 && distanceToDiagonal < dbLen) {
@@ -175,10 +176,10 @@ int doRescorediagonal(Parameters &par,
                                     querySeq, targetSeq + distanceToDiagonal, diagonalLen);
                         } else if (par.rescoreMode == Parameters::RESCORE_MODE_SUBSTITUTION) {
                             distance = DistanceCalculator::computeSubstitutionDistance(
-                                    querySeq, targetSeq + distanceToDiagonal, diagonalLen, fastMatrix.matrix, par.globalAlignment);
+                                    querySeq, targetSeq + distanceToDiagonal, diagonalLen, fastMatrix.matrix, par.globalAlignment, par.rescoreXDrop);
                         } else if (par.rescoreMode == Parameters::RESCORE_MODE_ALIGNMENT) {
                             alignment = DistanceCalculator::computeSubstitutionStartEndDistance(
-                                    querySeq, targetSeq + distanceToDiagonal, diagonalLen, fastMatrix.matrix);
+                                    querySeq, targetSeq + distanceToDiagonal, diagonalLen, fastMatrix.matrix, par.rescoreXDrop);
                             distance = alignment.score;
                         }
                     }
@@ -300,7 +301,8 @@ int doRescorediagonal(Parameters &par,
         }
         resultReader.remapData();
     }
-    Debug(Debug::INFO) << "\nDone.\n";
+    progress.finish();
+    Debug(Debug::INFO) << "Done.\n";
     qdbr.close();
     if (sameDB == false) {
         tdbr->close();
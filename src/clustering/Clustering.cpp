@@ -5,13 +5,22 @@
 #include "Util.h"
 #include "itoa.h"
 #include "Timer.h"
+#include "Metrics.h"
+#include "FileUtil.h"
 
 Clustering::Clustering(const std::string &seqDB, const std::string &seqDBIndex,
                        const std::string &alnDB, const std::string &alnDBIndex,
                        const std::string &outDB, const std::string &outDBIndex,
-                       unsigned int maxIteration, int similarityScoreType, int threads) : maxIteration(maxIteration),
+                       unsigned int maxIteration, int similarityScoreType, int threads,
+                       bool parallelSetCover, float setCoverEps,
+                       const std::string &graphCache, bool unionFind, int memoryLimit) : maxIteration(maxIteration),
                                                                similarityScoreType(similarityScoreType),
                                                                threads(threads),
+                                                               parallelSetCover(parallelSetCover),
+                                                               setCoverEps(setCoverEps),
+                                                               graphCache(graphCache),
+                                                               unionFind(unionFind),
+                                                               memoryLimit(memoryLimit),
                                                                outDB(outDB),
                                                                outDBIndex(outDBIndex) {
     Debug(Debug::INFO) << "Init...\n";
@@ -34,14 +43,21 @@ Clustering::~Clustering() {
 
 void Clustering::run(int mode) {
     Timer timer;
+    Metrics::Phase phase("clustering");
 
     DBWriter *dbw = new DBWriter(outDB.c_str(), outDBIndex.c_str(), 1);
     dbw->open();
 
+    // the out-of-core graph needs a file, keep it only if it was requested as cache
+    const bool tmpGraph = memoryLimit > 0 && graphCache.empty();
+    const std::string graphFile = tmpGraph ? outDB + ".graph" : graphCache;
+
     std::unordered_map<unsigned int, std::vector<unsigned int>> ret;
     ClusteringAlgorithms *algorithm = new ClusteringAlgorithms(seqDbr, alnDbr,
                                                                threads, similarityScoreType,
-                                                               maxIteration);
+                                                               maxIteration, parallelSetCover, setCoverEps,
+                                                               graphFile, unionFind,
+                                                               static_cast<size_t>(memoryLimit) * 1024 * 1024);
 
     if (mode == Parameters::GREEDY) {
         Debug(Debug::INFO) << "Clustering mode: Greedy\n";
@@ -50,10 +66,10 @@ void Clustering::run(int mode) {
         Debug(Debug::INFO) << "Clustering mode: Greedy Low Mem\n";
         ret = algorithm->execute(4);
     } else if (mode == Parameters::SET_COVER) {
-        Debug(Debug::INFO) << "Clustering mode: Set Cover\n";
+        Debug(Debug::INFO) << "Clustering mode: " << (parallelSetCover ? "Parallel Set Cover" : "Set Cover") << "\n";
         ret = algorithm->execute(1);
     } else if (mode == Parameters::CONNECTED_COMPONENT) {
-        Debug(Debug::INFO) << "Clustering mode: Connected Component\n";
+        Debug(Debug::INFO) << "Clustering mode: " << (unionFind ? "Connected Component (Union Find)" : "Connected Component") << "\n";
         ret = algorithm->execute(3);
     } else {
         Debug(Debug::ERROR) << "ERROR: Wrong clustering mode!\n";
@@ -66,10 +82,14 @@ void Clustering::run(int mode) {
     Debug(Debug::INFO) << "Time for clustering: " << timer.lap() << "\n";
 
     delete algorithm;
+    if (tmpGraph && FileUtil::fileExists(graphFile.c_str())) {
+        FileUtil::deleteFile(graphFile);
+    }
 
     size_t dbSize = alnDbr->getSize();
     size_t seqDbSize = seqDbr->getSize();
     size_t cluNum = ret.size();
+    Metrics::addCounter("clusters", cluNum);
 
     seqDbr->close();
     alnDbr->close();
@@ -14,7 +14,9 @@ public:
     Clustering(const std::string &seqDB, const std::string &seqDBIndex,
                const std::string &alnResultsDB, const std::string &alnResultsDBIndex,
                const std::string &outDB, const std::string &outDBIndex,
-               unsigned int maxIteration, int similarityScoreType, int threads);
+               unsigned int maxIteration, int similarityScoreType, int threads,
+               bool parallelSetCover = false, float setCoverEps = 0.0,
+               const std::string &graphCache = "", bool unionFind = false, int memoryLimit = 0);
 
     void run(int mode);
 
@@ -33,6 +35,11 @@ private:
     int similarityScoreType;
 
     int threads;
+    bool parallelSetCover;
+    float setCoverEps;
+    std::string graphCache;
+    bool unionFind;
+    int memoryLimit;
     std::string outDB;
     std::string outDBIndex;
 };
@@ -3,14 +3,24 @@
 #include "Debug.h"
 #include "AlignmentSymmetry.h"
 #include "Timer.h"
+#include "FileUtil.h"
+#include "Parameters.h"
 
 #include <queue>
 #include <algorithm>
 #include <climits>
+#include <cmath>
+#include <stdint.h>
 #include <unordered_map>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/resource.h>
 
 ClusteringAlgorithms::ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBReader<unsigned int>* alnDbr,
-                                           int threads, int scoretype, int maxiterations){
+                                           int threads, int scoretype, int maxiterations,
+                                           bool parallelSetCover, float setCoverEps,
+                                           const std::string &graphCache, bool unionFind,
+                                           size_t memoryLimit){
     this->seqDbr=seqDbr;
     if(seqDbr->getSize() != alnDbr->getSize()){
         Debug(Debug::ERROR) << "Sequence db size != result db size\n";
@@ -21,6 +31,13 @@ ClusteringAlgorithms::ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBRea
     this->threads=threads;
     this->scoretype=scoretype;
     this->maxiterations=maxiterations;
+    this->parallelSetCover=parallelSetCover;
+    this->setCoverEps=setCoverEps;
+    this->graphCache=graphCache;
+    this->unionFind=unionFind;
+    this->memoryLimit=memoryLimit;
+    this->alnBytesRead=0;
+    this->graphBytesWritten=0;
     ///time
     this->clustersizes=new int[dbSize];
     std::fill_n(clustersizes, dbSize, 0);
@@ -42,10 +59,10 @@ std::unordered_map<unsigned int, std::vector<unsigned int>>  ClusteringAlgorithm
     //time
     if (mode==4) {
         greedyIncrementalLowMem(assignedcluster);
+    }else if (mode == 3 && unionFind) {
+        unionFindComponents(assignedcluster);
     }else {
-        const size_t elementCount = Util::countLines(data, dataSize);
-        unsigned int * elements = new(std::nothrow) unsigned int[elementCount];
-        Util::checkAllocation(elements, "Could not allocate elements memory in ClusteringAlgorithms::execute");
+        unsigned int * elements = NULL;
         unsigned int ** elementLookupTable = new(std::nothrow) unsigned int*[dbSize];
         Util::checkAllocation(elementLookupTable, "Could not allocate elementLookupTable memory in ClusteringAlgorithms::execute");
         unsigned short **scoreLookupTable = new(std::nothrow) unsigned short *[dbSize];
@@ -58,12 +75,35 @@ std::unordered_map<unsigned int, std::vector<unsigned int>>  ClusteringAlgorithm
         Util::checkAllocation(bestscore, "Could not allocate bestscore memory in ClusteringAlgorithms::execute");
         std::fill_n(bestscore, dbSize, SHRT_MIN);
 
-        readInClusterData(elementLookupTable, elements, scoreLookupTable, score, elementOffsets, elementCount);
+        char *graphCacheData = NULL;
+        size_t graphCacheSize = 0;
+        if (graphCache.empty() == false && FileUtil::fileExists(graphCache.c_str())) {
+            graphCacheData = readGraphCache(elementLookupTable, scoreLookupTable, elementOffsets, graphCacheSize);
+        }
+        if (graphCacheData == NULL && memoryLimit > 0) {
+            buildGraphOutOfCore();
+            graphCacheData = readGraphCache(elementLookupTable, scoreLookupTable, elementOffsets, graphCacheSize);
+        }
+        if (graphCacheData != NULL) {
+            // greedy incremental walks the sets in order, the others jump between them
+            madvise(graphCacheData, graphCacheSize, (mode == 2) ? MADV_SEQUENTIAL : MADV_RANDOM);
+        }
+        if (graphCacheData == NULL) {
+            const size_t elementCount = Util::countLines(data, dataSize);
+            elements = new(std::nothrow) unsigned int[elementCount];
+            Util::checkAllocation(elements, "Could not allocate elements memory in ClusteringAlgorithms::execute");
+            readInClusterData(elementLookupTable, elements, scoreLookupTable, score, elementOffsets, elementCount);
+            if (graphCache.empty() == false) {
+                writeGraphCache(elements, score, elementOffsets);
+            }
+        }
 
 
         if (mode==2){
             greedyIncremental(elementLookupTable, elementOffsets,
                               dbSize, assignedcluster);
+        }else if (mode == 1 && parallelSetCover) {
+            parallelSetCoverRounds(elementLookupTable, scoreLookupTable, assignedcluster, elementOffsets);
         }else {
             ClusteringAlgorithms::initClustersizes();
             if (mode == 1) {
@@ -105,6 +145,9 @@ std::unordered_map<unsigned int, std::vector<unsigned int>>  ClusteringAlgorithm
             delete [] borders_of_set;
         }
 
+        if (graphCacheData != NULL) {
+            munmap(graphCacheData, graphCacheSize);
+        }
         delete [] elementLookupTable;
         delete [] elements;
         delete [] elementOffsets;
@@ -113,6 +156,15 @@ std::unordered_map<unsigned int, std::vector<unsigned int>>  ClusteringAlgorithm
         delete [] bestscore;
     }
 
+    if (memoryLimit > 0) {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        Debug(Debug::INFO) << "Out-of-core clustering: peak memory " << usage.ru_maxrss / 1024 << " MB, "
+                           << "alignments read " << alnBytesRead / (1024 * 1024) << " MB, "
+                           << "graph written " << graphBytesWritten / (1024 * 1024) << " MB, "
+                           << "disk blocks in " << usage.ru_inblock << ", out " << usage.ru_oublock << "\n";
+    }
+
 
 
     std::unordered_map<unsigned int, std::vector<unsigned int>> retMap;
@@ -261,6 +313,200 @@ void ClusteringAlgorithms::setCover(unsigned int **elementLookupTable, unsigned
     }
 }
 
+static inline void atomicMax(uint64_t *target, uint64_t value) {
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > current
+           && !__atomic_compare_exchange_n(target, &current, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// keeps the ids for which keep(id) is true, in their original order independent of the number of threads
+template <typename Predicate>
+static void parallelFilter(const std::vector<unsigned int> &in, std::vector<unsigned int> &out, const Predicate &keep) {
+    const size_t blocks = 256;
+    const size_t blockSize = (in.size() + blocks - 1) / blocks;
+    std::vector<size_t> blockOffsets(blocks + 1, 0);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t block = 0; block < blocks; block++) {
+        const size_t end = std::min(in.size(), (block + 1) * blockSize);
+        for (size_t i = block * blockSize; i < end; i++) {
+            blockOffsets[block + 1] += keep(in[i]);
+        }
+    }
+    for (size_t block = 0; block < blocks; block++) {
+        blockOffsets[block + 1] += blockOffsets[block];
+    }
+    out.resize(blockOffsets[blocks]);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t block = 0; block < blocks; block++) {
+        const size_t end = std::min(in.size(), (block + 1) * blockSize);
+        size_t writePos = blockOffsets[block];
+        for (size_t i = block * blockSize; i < end; i++) {
+            if (keep(in[i])) {
+                out[writePos++] = in[i];
+            }
+        }
+    }
+}
+
+struct SetCoverCovered {
+    const char *covered;
+    SetCoverCovered(const char *covered) : covered(covered) {}
+    bool operator()(unsigned int id) const {
+        return covered[id] == 0;
+    }
+};
+
+struct SetCoverCandidate {
+    const char *covered;
+    const int *clustersizes;
+    int threshold;
+    SetCoverCandidate(const char *covered, const int *clustersizes, int threshold)
+            : covered(covered), clustersizes(clustersizes), threshold(threshold) {}
+    bool operator()(unsigned int id) const {
+        return covered[id] == 0 && clustersizes[id] >= threshold;
+    }
+};
+
+static bool compareByPriority(const std::pair<uint64_t, unsigned int> &first, const std::pair<uint64_t, unsigned int> &second) {
+    return first.first > second.first;
+}
+
+// Bucket synchronous set cover (Blelloch et al.): every round takes the uncovered sets with
+// size >= largest size / (1 + eps) as candidates. Each candidate claims its uncovered elements with
+// its priority (size, then lower id). Candidates that won all their elements are disjoint and become
+// representatives together. Members go to the representative with the best score as in setCover.
+// All decisions are maxima, so the result does not depend on the number of threads.
+void ClusteringAlgorithms::parallelSetCoverRounds(unsigned int **elementLookupTable, unsigned short **elementScoreLookupTable,
+                                                  unsigned int *assignedcluster, size_t *elementOffsets) {
+    // set i is alive as long as element i is uncovered, clustersizes[i] counts its uncovered elements
+    char *covered = new(std::nothrow) char[dbSize];
+    Util::checkAllocation(covered, "Could not allocate covered memory in ClusteringAlgorithms::parallelSetCoverRounds");
+    std::fill_n(covered, dbSize, 0);
+    uint64_t *claims = new(std::nothrow) uint64_t[dbSize];
+    Util::checkAllocation(claims, "Could not allocate claims memory in ClusteringAlgorithms::parallelSetCoverRounds");
+    std::fill_n(claims, dbSize, 0);
+    // best (score, earliest representative) per element
+    uint64_t *assignment = new(std::nothrow) uint64_t[dbSize];
+    Util::checkAllocation(assignment, "Could not allocate assignment memory in ClusteringAlgorithms::parallelSetCoverRounds");
+    std::fill_n(assignment, dbSize, 0);
+
+    std::vector<unsigned int> active(dbSize);
+    for (size_t i = 0; i < dbSize; i++) {
+        active[i] = i;
+    }
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> remaining;
+    std::vector<std::pair<uint64_t, unsigned int> > selected;
+    std::vector<unsigned int> representatives;
+    size_t rounds = 0;
+    while (active.empty() == false) {
+        int maxSize = 0;
+#pragma omp parallel for schedule(static) reduction(max:maxSize)
+        for (size_t i = 0; i < active.size(); i++) {
+            maxSize = std::max(maxSize, clustersizes[active[i]]);
+        }
+        const int threshold = std::max(1, static_cast<int>(std::ceil(maxSize / (1.0 + setCoverEps))));
+        parallelFilter(active, candidates, SetCoverCandidate(covered, clustersizes, threshold));
+        if (candidates.empty()) {
+            // sets without any elements, not even themselves
+            candidates = active;
+        }
+
+#pragma omp parallel for schedule(dynamic, 100)
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const unsigned int candidate = candidates[i];
+            const uint64_t priority = (static_cast<uint64_t>(std::max(0, clustersizes[candidate])) << 32) | (UINT_MAX - candidate);
+            atomicMax(&claims[candidate], priority);
+            const size_t elementSize = elementOffsets[candidate + 1] - elementOffsets[candidate];
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                const unsigned int element = elementLookupTable[candidate][elementId];
+                if (covered[element] == 0) {
+                    atomicMax(&claims[element], priority);
+                }
+            }
+        }
+
+        selected.clear();
+#pragma omp parallel
+        {
+            std::vector<std::pair<uint64_t, unsigned int> > localSelected;
+#pragma omp for schedule(dynamic, 100)
+            for (size_t i = 0; i < candidates.size(); i++) {
+                const unsigned int candidate = candidates[i];
+                const uint64_t priority = (static_cast<uint64_t>(std::max(0, clustersizes[candidate])) << 32) | (UINT_MAX - candidate);
+                bool won = (claims[candidate] == priority);
+                const size_t elementSize = elementOffsets[candidate + 1] - elementOffsets[candidate];
+                for (size_t elementId = 0; won && elementId < elementSize; elementId++) {
+                    const unsigned int element = elementLookupTable[candidate][elementId];
+                    won = (covered[element] != 0 || claims[element] == priority);
+                }
+                if (won) {
+                    localSelected.push_back(std::make_pair(priority, candidate));
+                }
+            }
+#pragma omp critical
+            selected.insert(selected.end(), localSelected.begin(), localSelected.end());
+        }
+        // number representatives in greedy order, earlier representatives keep members on equal scores
+        std::sort(selected.begin(), selected.end(), compareByPriority);
+        const size_t orderOffset = representatives.size();
+        for (size_t i = 0; i < selected.size(); i++) {
+            representatives.push_back(selected[i].second);
+        }
+
+#pragma omp parallel for schedule(dynamic, 100)
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const unsigned int candidate = candidates[i];
+            claims[candidate] = 0;
+            const size_t elementSize = elementOffsets[candidate + 1] - elementOffsets[candidate];
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                claims[elementLookupTable[candidate][elementId]] = 0;
+            }
+        }
+
+        // selected sets are disjoint on uncovered elements, so each newly covered element has one owner
+#pragma omp parallel for schedule(dynamic, 10)
+        for (size_t i = 0; i < selected.size(); i++) {
+            const unsigned int representative = selected[i].second;
+            const uint64_t order = UINT_MAX - (orderOffset + i);
+            atomicMax(&assignment[representative], (static_cast<uint64_t>(USHRT_MAX) << 32) | order);
+            const size_t elementSize = elementOffsets[representative + 1] - elementOffsets[representative];
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                const unsigned int element = elementLookupTable[representative][elementId];
+                const short score = elementScoreLookupTable[representative][elementId];
+                atomicMax(&assignment[element], (static_cast<uint64_t>(score - SHRT_MIN) << 32) | order);
+            }
+            for (size_t elementId = 0; elementId <= elementSize; elementId++) {
+                const unsigned int element = (elementId < elementSize) ? elementLookupTable[representative][elementId] : representative;
+                if (covered[element] != 0) {
+                    continue;
+                }
+                covered[element] = 1;
+                // decrease the size of the sets that contain the element
+                const size_t currElementSize = elementOffsets[element + 1] - elementOffsets[element];
+                for (size_t elementId2 = 0; elementId2 < currElementSize; elementId2++) {
+                    __sync_fetch_and_sub(&clustersizes[elementLookupTable[element][elementId2]], 1);
+                }
+            }
+        }
+
+        parallelFilter(active, remaining, SetCoverCovered(covered));
+        active.swap(remaining);
+        rounds++;
+    }
+
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < dbSize; i++) {
+        const unsigned int order = UINT_MAX - static_cast<unsigned int>(assignment[i] & UINT_MAX);
+        assignedcluster[i] = representatives[order];
+    }
+    Debug(Debug::INFO) << "Parallel set cover selected " << representatives.size() << " representatives in " << rounds << " rounds\n";
+
+    delete [] covered;
+    delete [] claims;
+    delete [] assignment;
+}
+
 void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluster) {
     // two step clustering
     // 1.) we define the rep. sequences by minimizing the ids (smaller ID = longer sequence)
@@ -425,3 +671,435 @@ void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable,
     delete[] newElementOffsets;
     Debug(Debug::INFO) << "\nTime for read in: " << timer.lap() << "\n";
 }
+
+// root of x, halves the path on the way (a concurrent union can only move a root below another root)
+static inline unsigned int findRoot(unsigned int *parent, unsigned int x) {
+    unsigned int p = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+    while (p != x) {
+        unsigned int grandparent = __atomic_load_n(&parent[p], __ATOMIC_RELAXED);
+        if (grandparent != p) {
+            __atomic_compare_exchange_n(&parent[x], &p, grandparent, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+        x = grandparent;
+        p = __atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+    }
+    return x;
+}
+
+// links the larger root below the smaller one, so the roots do not depend on the order of the unions
+static inline void unite(unsigned int *parent, unsigned int a, unsigned int b) {
+    while (true) {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a == b) {
+            return;
+        }
+        if (a < b) {
+            std::swap(a, b);
+        }
+        unsigned int expected = a;
+        if (__atomic_compare_exchange_n(&parent[a], &expected, b, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+}
+
+void ClusteringAlgorithms::unionFindComponents(unsigned int *assignedcluster) {
+    Timer timer;
+    unsigned int *parent = new(std::nothrow) unsigned int[dbSize];
+    Util::checkAllocation(parent, "Could not allocate parent memory in ClusteringAlgorithms::unionFindComponents");
+    unsigned int *degree = new(std::nothrow) unsigned int[dbSize];
+    Util::checkAllocation(degree, "Could not allocate degree memory in ClusteringAlgorithms::unionFindComponents");
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < dbSize; i++) {
+        parent[i] = i;
+        degree[i] = 0;
+    }
+
+#pragma omp parallel for schedule(dynamic, 1000)
+    for (size_t id = 0; id < dbSize; id++) {
+        Debug::printProgress(id);
+        char *data = alnDbr->getDataByDBKey(seqDbr->getDbKey(id));
+        unsigned int edges = 0;
+        while (*data != '\0') {
+            char dbKey[255 + 1];
+            Util::parseKey(data, dbKey);
+            const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+            const unsigned int currElement = seqDbr->getId(key);
+            if (currElement == UINT_MAX) {
+                Debug(Debug::ERROR) << "ERROR: Element " << dbKey
+                                    << " contained in some alignment list, but not contained in the sequence database!\n";
+                EXIT(EXIT_FAILURE);
+            }
+            if (currElement != id) {
+                unite(parent, id, currElement);
+                __atomic_fetch_add(&degree[currElement], 1, __ATOMIC_RELAXED);
+                edges++;
+            }
+            data = Util::skipLine(data);
+        }
+        __atomic_fetch_add(&degree[id], edges, __ATOMIC_RELAXED);
+    }
+
+    // the member with the most alignments represents the component, the longer sequence on ties
+    uint64_t *best = new(std::nothrow) uint64_t[dbSize];
+    Util::checkAllocation(best, "Could not allocate best memory in ClusteringAlgorithms::unionFindComponents");
+    std::fill_n(best, dbSize, 0);
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < dbSize; i++) {
+        parent[i] = findRoot(parent, i);
+        atomicMax(&best[parent[i]], (static_cast<uint64_t>(degree[i]) << 32) | (UINT_MAX - i));
+    }
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < dbSize; i++) {
+        assignedcluster[i] = UINT_MAX - static_cast<unsigned int>(best[parent[i]] & UINT_MAX);
+    }
+    delete [] best;
+    delete [] degree;
+    delete [] parent;
+    Debug(Debug::INFO) << "\nTime for union find: " << timer.lap() << "\n";
+}
+
+struct GraphCacheHeader {
+    char magic[4];
+    unsigned int version;
+    int scoretype;
+    unsigned int dbSize;
+    size_t elementCount;
+    // identifies the sequence order and the alignment database the graph was built from
+    size_t key;
+    size_t alnDataSize;
+    // a rebuilt alignment database of the same size has a newer data or index file
+    long long alnDataMtime;
+    long long alnIndexMtime;
+};
+
+static const char GRAPH_CACHE_MAGIC[4] = {'C', 'S', 'R', 'G'};
+static const unsigned int GRAPH_CACHE_VERSION = 2;
+
+size_t ClusteringAlgorithms::graphCacheKey() {
+    size_t key = dbSize;
+    for (size_t i = 0; i < dbSize; i++) {
+        key = key * 31 + seqDbr->getDbKey(i);
+    }
+    return key;
+}
+
+// layout: header, dbSize + 1 offsets, elementCount element ids, elementCount scores
+void ClusteringAlgorithms::writeGraphCache(unsigned int *elements, unsigned short *scores, size_t *elementOffsets) {
+    Timer timer;
+    GraphCacheHeader header;
+    memcpy(header.magic, GRAPH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_CACHE_VERSION;
+    header.scoretype = scoretype;
+    header.dbSize = dbSize;
+    header.elementCount = elementOffsets[dbSize];
+    header.key = graphCacheKey();
+    header.alnDataSize = alnDbr->getDataSize();
+    header.alnDataMtime = FileUtil::getModificationTime(alnDbr->getDataFileName());
+    header.alnIndexMtime = FileUtil::getModificationTime(alnDbr->getIndexFileName());
+
+    std::string tmpFile = graphCache + ".tmp";
+    FILE *file = FileUtil::openFileOrDie(tmpFile.c_str(), "wb", false);
+    if (fwrite(&header, sizeof(GraphCacheHeader), 1, file) != 1
+        || fwrite(elementOffsets, sizeof(size_t), dbSize + 1, file) != dbSize + 1
+        || fwrite(elements, sizeof(unsigned int), header.elementCount, file) != header.elementCount
+        || fwrite(scores, sizeof(unsigned short), header.elementCount, file) != header.elementCount) {
+        Debug(Debug::ERROR) << "Could not write graph cache " << tmpFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(file) != 0 || rename(tmpFile.c_str(), graphCache.c_str()) != 0) {
+        Debug(Debug::ERROR) << "Could not write graph cache " << graphCache << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    Debug(Debug::INFO) << "Time for writing graph cache: " << timer.lap() << "\n";
+}
+
+char *ClusteringAlgorithms::readGraphCache(unsigned int **elementLookupTable, unsigned short **scoreLookupTable,
+                                           size_t *elementOffsets, size_t &mappedSize) {
+    Timer timer;
+    FILE *file = FileUtil::openFileOrDie(graphCache.c_str(), "r", true);
+    char *data = static_cast<char *>(FileUtil::mmapFile(file, &mappedSize));
+    fclose(file);
+
+    GraphCacheHeader header;
+    bool fits = mappedSize >= sizeof(GraphCacheHeader);
+    if (fits) {
+        memcpy(&header, data, sizeof(GraphCacheHeader));
+        fits = memcmp(header.magic, GRAPH_CACHE_MAGIC, sizeof(header.magic)) == 0;
+    }
+    if (fits && header.version != GRAPH_CACHE_VERSION) {
+        Debug(Debug::WARNING) << "Graph cache " << graphCache << " was written by another version and is rebuilt\n";
+        munmap(data, mappedSize);
+        return NULL;
+    }
+    if (fits) {
+        fits = header.dbSize == dbSize
+               && mappedSize == sizeof(GraphCacheHeader) + sizeof(size_t) * (dbSize + 1)
+                                + (sizeof(unsigned int) + sizeof(unsigned short)) * header.elementCount;
+    }
+    if (fits == false) {
+        Debug(Debug::ERROR) << graphCache << " is not a graph cache for this database\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (header.scoretype != scoretype || header.key != graphCacheKey() || header.alnDataSize != alnDbr->getDataSize()
+        || header.alnDataMtime != FileUtil::getModificationTime(alnDbr->getDataFileName())
+        || header.alnIndexMtime != FileUtil::getModificationTime(alnDbr->getIndexFileName())) {
+        Debug(Debug::WARNING) << "Graph cache " << graphCache << " was built from other inputs and is rebuilt\n";
+        munmap(data, mappedSize);
+        return NULL;
+    }
+
+    char *pos = data + sizeof(GraphCacheHeader);
+    memcpy(elementOffsets, pos, sizeof(size_t) * (dbSize + 1));
+    pos += sizeof(size_t) * (dbSize + 1);
+    unsigned int *elements = reinterpret_cast<unsigned int *>(pos);
+    pos += sizeof(unsigned int) * header.elementCount;
+    unsigned short *scores = reinterpret_cast<unsigned short *>(pos);
+    AlignmentSymmetry::setupPointers<unsigned int>(elements, elementLookupTable, elementOffsets, dbSize, header.elementCount);
+    AlignmentSymmetry::setupPointers<unsigned short>(scores, scoreLookupTable, elementOffsets, dbSize, header.elementCount);
+
+    maxClustersize = 0;
+    for (size_t i = 0; i < dbSize; i++) {
+        size_t elementCount = elementOffsets[i + 1] - elementOffsets[i];
+        maxClustersize = std::max((unsigned int) elementCount, maxClustersize);
+        clustersizes[i] = elementCount;
+    }
+    Debug(Debug::INFO) << "Time for reading graph cache: " << timer.lap() << "\n";
+    return data;
+}
+
+// a set member while a part of the graph is built, ordered like readInClusterData orders them:
+// the alignments of the set in file order first, then the missing back links by the id of their set
+struct GraphPartEntry {
+    unsigned int order;
+    unsigned int id;
+    unsigned short score;
+    bool backLink;
+
+    static bool compareByOrder(const GraphPartEntry &first, const GraphPartEntry &second) {
+        if (first.backLink != second.backLink) {
+            return second.backLink;
+        }
+        return first.order < second.order;
+    }
+};
+
+static inline unsigned short parseClusterScore(char *data, int scoretype) {
+    char similarity[255 + 1];
+    if (scoretype == Parameters::APC_ALIGNMENTSCORE) {
+        //column 1 = alignment score
+        Util::parseByColumnNumber(data, similarity, 1);
+        return (unsigned short) (atof(similarity));
+    }
+    //column 2 = sequence identity
+    Util::parseByColumnNumber(data, similarity, 2);
+    return (unsigned short) (atof(similarity) * 1000.0f);
+}
+
+// writes the same graph as readInClusterData into the graph cache file, in id ranges whose
+// members fit into memoryLimit next to the arrays over all ids. Every range reads the whole
+// alignment database once.
+void ClusteringAlgorithms::buildGraphOutOfCore() {
+    Timer timer;
+    const size_t alnDataSize = alnDbr->getDataSize();
+    // upper bound of the set sizes: own alignments plus back links
+    unsigned int *maxSetSize = new(std::nothrow) unsigned int[dbSize];
+    Util::checkAllocation(maxSetSize, "Could not allocate maxSetSize memory in ClusteringAlgorithms::buildGraphOutOfCore");
+    std::fill_n(maxSetSize, dbSize, 0);
+#pragma omp parallel for schedule(dynamic, 1000)
+    for (size_t i = 0; i < dbSize; i++) {
+        char *data = alnDbr->getDataByDBKey(seqDbr->getDbKey(i));
+        unsigned int count = 0;
+        while (*data != '\0') {
+            char dbKey[255 + 1];
+            Util::parseKey(data, dbKey);
+            const unsigned int currElement = seqDbr->getId((unsigned int) strtoul(dbKey, NULL, 10));
+            if (currElement == UINT_MAX) {
+                Debug(Debug::ERROR) << "ERROR: Element " << dbKey
+                                    << " contained in some alignment list, but not contained in the sequence database!\n";
+                EXIT(EXIT_FAILURE);
+            }
+            __atomic_fetch_add(&maxSetSize[currElement], 1, __ATOMIC_RELAXED);
+            count++;
+            data = Util::skipLine(data);
+        }
+        __atomic_fetch_add(&maxSetSize[i], count, __ATOMIC_RELAXED);
+    }
+    alnDbr->remapData();
+    alnBytesRead += alnDataSize;
+
+    // split the ids into ranges, maxSetSize, offsets and the copy buffer are held for all of them
+    const size_t copyBufferSize = 1024 * 1024;
+    const size_t fixedMemory = dbSize * sizeof(unsigned int) + (dbSize + 1) * sizeof(size_t) + copyBufferSize;
+    if (fixedMemory >= memoryLimit) {
+        Debug(Debug::WARNING) << "--cluster-memory-limit is below the " << fixedMemory / (1024 * 1024) + 1
+                              << "MB needed for " << dbSize << " sequences. Building the graph one set at a time.\n";
+    }
+    const size_t partMemory = (fixedMemory < memoryLimit) ? memoryLimit - fixedMemory : 0;
+    std::vector<size_t> partStarts(1, 0);
+    size_t memory = 0;
+    for (size_t i = 0; i < dbSize; i++) {
+        // the set entries, its partOffsets and fill entry
+        const size_t setMemory = maxSetSize[i] * sizeof(GraphPartEntry) + sizeof(size_t) + sizeof(unsigned int);
+        if (memory > 0 && memory + setMemory > partMemory) {
+            partStarts.push_back(i);
+            memory = 0;
+        }
+        memory += setMemory;
+    }
+    partStarts.push_back(dbSize);
+    const size_t parts = partStarts.size() - 1;
+    Debug(Debug::INFO) << "Build graph in " << parts << " parts\n";
+
+    const std::string tmpFile = graphCache + ".tmp";
+    const std::string scoreFile = graphCache + ".scores";
+    FILE *file = FileUtil::openFileOrDie(tmpFile.c_str(), "wb", false);
+    FILE *scoreOut = FileUtil::openFileOrDie(scoreFile.c_str(), "wb", false);
+    size_t *offsets = new(std::nothrow) size_t[dbSize + 1];
+    Util::checkAllocation(offsets, "Could not allocate offsets memory in ClusteringAlgorithms::buildGraphOutOfCore");
+    offsets[0] = 0;
+    const size_t elementStart = sizeof(GraphCacheHeader) + sizeof(size_t) * (dbSize + 1);
+    if (fseek(file, elementStart, SEEK_SET) != 0) {
+        Debug(Debug::ERROR) << "Could not write graph " << tmpFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    for (size_t part = 0; part < parts; part++) {
+        const unsigned int start = partStarts[part];
+        const unsigned int end = partStarts[part + 1];
+        const size_t partSize = end - start;
+        size_t *partOffsets = new size_t[partSize + 1];
+        unsigned int *fill = new unsigned int[partSize];
+        partOffsets[0] = 0;
+        for (size_t i = 0; i < partSize; i++) {
+            partOffsets[i + 1] = partOffsets[i] + maxSetSize[start + i];
+            fill[i] = 0;
+        }
+        GraphPartEntry *partEntries = new(std::nothrow) GraphPartEntry[partOffsets[partSize]];
+        Util::checkAllocation(partEntries, "Could not allocate graph part memory in ClusteringAlgorithms::buildGraphOutOfCore");
+
+#pragma omp parallel for schedule(dynamic, 1000)
+        for (size_t i = 0; i < dbSize; i++) {
+            char *data = alnDbr->getDataByDBKey(seqDbr->getDbKey(i));
+            const bool inPart = i >= start && i < end;
+            unsigned int line = 0;
+            while (*data != '\0') {
+                char dbKey[255 + 1];
+                Util::parseKey(data, dbKey);
+                const unsigned int currElement = seqDbr->getId((unsigned int) strtoul(dbKey, NULL, 10));
+                const bool linkedInPart = currElement >= start && currElement < end;
+                if (inPart || linkedInPart) {
+                    const unsigned short score = parseClusterScore(data, scoretype);
+                    if (inPart) {
+                        const unsigned int pos = __atomic_fetch_add(&fill[i - start], 1, __ATOMIC_RELAXED);
+                        GraphPartEntry &entry = partEntries[partOffsets[i - start] + pos];
+                        entry.order = line;
+                        entry.id = currElement;
+                        entry.score = score;
+                        entry.backLink = false;
+                    }
+                    if (linkedInPart) {
+                        const unsigned int pos = __atomic_fetch_add(&fill[currElement - start], 1, __ATOMIC_RELAXED);
+                        GraphPartEntry &entry = partEntries[partOffsets[currElement - start] + pos];
+                        entry.order = i;
+                        entry.id = i;
+                        entry.score = score;
+                        entry.backLink = true;
+                    }
+                }
+                line++;
+                data = Util::skipLine(data);
+            }
+        }
+        alnDbr->remapData();
+        alnBytesRead += alnDataSize;
+
+        // order each set and drop back links that are alignments of the set already.
+        // Back links are sorted by id, so they are merged with the sorted alignment ids.
+#pragma omp parallel
+        {
+            std::vector<unsigned int> alignmentIds;
+#pragma omp for schedule(dynamic, 1000)
+            for (size_t i = 0; i < partSize; i++) {
+                GraphPartEntry *set = partEntries + partOffsets[i];
+                const size_t setSize = fill[i];
+                std::sort(set, set + setSize, GraphPartEntry::compareByOrder);
+                size_t alignments = 0;
+                alignmentIds.clear();
+                while (alignments < setSize && set[alignments].backLink == false) {
+                    alignmentIds.push_back(set[alignments].id);
+                    alignments++;
+                }
+                std::sort(alignmentIds.begin(), alignmentIds.end());
+                size_t writePos = alignments;
+                size_t k = 0;
+                for (size_t j = alignments; j < setSize; j++) {
+                    while (k < alignmentIds.size() && alignmentIds[k] < set[j].id) {
+                        k++;
+                    }
+                    if (k == alignmentIds.size() || alignmentIds[k] != set[j].id) {
+                        set[writePos++] = set[j];
+                    }
+                }
+                fill[i] = writePos;
+            }
+        }
+
+        for (size_t i = 0; i < partSize; i++) {
+            const GraphPartEntry *set = partEntries + partOffsets[i];
+            for (size_t j = 0; j < fill[i]; j++) {
+                if (fwrite(&set[j].id, sizeof(unsigned int), 1, file) != 1
+                    || fwrite(&set[j].score, sizeof(unsigned short), 1, scoreOut) != 1) {
+                    Debug(Debug::ERROR) << "Could not write graph " << tmpFile << "\n";
+                    EXIT(EXIT_FAILURE);
+                }
+            }
+            offsets[start + i + 1] = offsets[start + i] + fill[i];
+        }
+        delete [] partEntries;
+        delete [] fill;
+        delete [] partOffsets;
+    }
+    delete [] maxSetSize;
+    fclose(scoreOut);
+
+    // scores follow the elements
+    const size_t elementCount = offsets[dbSize];
+    FILE *scoreIn = FileUtil::openFileOrDie(scoreFile.c_str(), "rb", true);
+    char *buffer = new char[copyBufferSize];
+    size_t read;
+    while ((read = fread(buffer, 1, copyBufferSize, scoreIn)) > 0) {
+        if (fwrite(buffer, 1, read, file) != read) {
+            Debug(Debug::ERROR) << "Could not write graph " << tmpFile << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+    delete [] buffer;
+    fclose(scoreIn);
+    FileUtil::deleteFile(scoreFile);
+
+    GraphCacheHeader header;
+    memcpy(header.magic, GRAPH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_CACHE_VERSION;
+    header.scoretype = scoretype;
+    header.dbSize = dbSize;
+    header.elementCount = elementCount;
+    header.key = graphCacheKey();
+    header.alnDataSize = alnDataSize;
+    header.alnDataMtime = FileUtil::getModificationTime(alnDbr->getDataFileName());
+    header.alnIndexMtime = FileUtil::getModificationTime(alnDbr->getIndexFileName());
+    if (fseek(file, 0, SEEK_SET) != 0
+        || fwrite(&header, sizeof(GraphCacheHeader), 1, file) != 1
+        || fwrite(offsets, sizeof(size_t), dbSize + 1, file) != dbSize + 1) {
+        Debug(Debug::ERROR) << "Could not write graph " << tmpFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    delete [] offsets;
+    if (fclose(file) != 0 || rename(tmpFile.c_str(), graphCache.c_str()) != 0) {
+        Debug(Debug::ERROR) << "Could not write graph " << graphCache << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    graphBytesWritten += elementStart + elementCount * (sizeof(unsigned int) + 2 * sizeof(unsigned short));
+    Debug(Debug::INFO) << "Time for building the graph out-of-core: " << timer.lap() << "\n";
+}
@@ -15,7 +15,10 @@
 
 class ClusteringAlgorithms {
 public:
-    ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBReader<unsigned int>* alnDbr, int threads,int scoretype, int maxiterations);
+    ClusteringAlgorithms(DBReader<unsigned int>* seqDbr, DBReader<unsigned int>* alnDbr, int threads,int scoretype, int maxiterations,
+                         bool parallelSetCover = false, float setCoverEps = 0.0,
+                         const std::string &graphCache = "", bool unionFind = false,
+                         size_t memoryLimit = 0);
     ~ClusteringAlgorithms();
     std::unordered_map<unsigned int, std::vector<unsigned int>> execute(int mode);
 private:
@@ -43,22 +46,48 @@ private:
     void decreaseClustersize(int clusterid);
 //for connected component
     int maxiterations;
+//for parallel set cover
+    bool parallelSetCover;
+    float setCoverEps;
+//binary CSR file of the symmetrized graph
+    std::string graphCache;
+//connected component by union find on the alignment database
+    bool unionFind;
+//out-of-core graph, built in parts of at most memoryLimit bytes into the graph cache file
+    size_t memoryLimit;
+    size_t alnBytesRead;
+    size_t graphBytesWritten;
 
 
     void setCover(unsigned int **elementLookup, unsigned short ** elementScoreLookupTable,
                   unsigned int *assignedcluster, short *bestscore, size_t *offsets);
 
+    void parallelSetCoverRounds(unsigned int **elementLookupTable, unsigned short **elementScoreLookupTable,
+                                unsigned int *assignedcluster, size_t *elementOffsets);
+
     void greedyIncremental(unsigned int **elementLookupTable, size_t *elementOffsets,
                            size_t n, unsigned int *assignedcluster) ;
 
 
     void greedyIncrementalLowMem(unsigned int *assignedcluster) ;
 
+    void unionFindComponents(unsigned int *assignedcluster);
+
 
     void readInClusterData(unsigned int **elementLookupTable, unsigned int *&elements,
                            unsigned short **scoreLookupTable, unsigned short *&scores,
                            size_t *elementOffsets, size_t totalElementCount)  ;
 
+    void writeGraphCache(unsigned int *elements, unsigned short *scores, size_t *elementOffsets);
+
+    // maps the graph cache and sets up the tables on it, returns the mapping or NULL if the cache does not fit
+    char *readGraphCache(unsigned int **elementLookupTable, unsigned short **scoreLookupTable,
+                         size_t *elementOffsets, size_t &mappedSize);
+
+    size_t graphCacheKey();
+
+    void buildGraphOutOfCore();
+
 };
 
 
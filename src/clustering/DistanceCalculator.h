@@ -4,6 +4,8 @@
 #include <sstream>
 #include <cstring>
 #include <vector>
+#include <algorithm>
+#include <type_traits>
 
 #include "simd.h"
 #include "MathUtil.h"
@@ -15,21 +17,16 @@ public:
     static unsigned int computeSubstitutionDistance(const T *seq1,
                                                     const T *seq2,
                                                     const unsigned int length,
-                                                    const char **subMat, bool globalAlignment = false) {
+                                                    const char **subMat, bool globalAlignment = false,
+                                                    const int xDrop = 0) {
         int max = 0;
-        int score = 0;
         if (globalAlignment)
         {
             for(unsigned int pos = 0; pos < length; pos++){
                 max += subMat[static_cast<int>(seq1[pos])][static_cast<int>(seq2[pos])];
             }
         } else {
-            for(unsigned int pos = 0; pos < length; pos++){
-                int curr = subMat[static_cast<int>(seq1[pos])][static_cast<int>(seq2[pos])];
-                score = curr  + score;
-                score = (score < 0) ? 0 : score;
-                max = (score > max)? score : max;
-            }
+            max = computeUngappedAlignment(seq1, seq2, length, subMat, xDrop).score;
         }
         if (max<0)
             max = 0;
@@ -54,23 +51,137 @@ public:
     static LocalAlignment computeSubstitutionStartEndDistance(const T *seq1,
                                                               const T *seq2,
                                                               const unsigned int length,
-                                                              const char **subMat) {
+                                                              const char **subMat,
+                                                              const int xDrop = 0) {
+        return computeUngappedAlignment(seq1, seq2, length, subMat, xDrop);
+    }
+
+    // matrix diagonal for the ASCII codes 64 to 95 (upper case letters), 16 bytes per shuffle table,
+    // repeated for every 128 bit lane because the byte shuffle does not cross them
+    struct DiagonalScores {
+        simd_int low;
+        simd_int high;
+        void init(const char **subMat) {
+            char lowTable[VECSIZE_INT * 4] __attribute__((aligned(ALIGN_INT)));
+            char highTable[VECSIZE_INT * 4] __attribute__((aligned(ALIGN_INT)));
+            for (int i = 0; i < VECSIZE_INT * 4; i++) {
+                lowTable[i] = subMat[64 + i % 16][64 + i % 16];
+                highTable[i] = subMat[80 + i % 16][80 + i % 16];
+            }
+            low = simdi_load((simd_int *) lowTable);
+            high = simdi_load((simd_int *) highTable);
+        }
+    };
+
+    template<typename T>
+    static inline void fillBlockScores(const T *seq1, const T *seq2, const char **subMat, const DiagonalScores &,
+                                       short *scores) {
+        for (unsigned int i = 0; i < VECSIZE_INT * 2; i++) {
+            scores[i] = subMat[static_cast<int>(seq1[i])][static_cast<int>(seq2[i])];
+        }
+    }
+
+    // identical upper case residues take their score from the diagonal by a byte shuffle,
+    // only the remaining positions are looked up in the matrix
+    static inline void fillBlockScores(const char *seq1, const char *seq2, const char **subMat, const DiagonalScores &diagonal,
+                                       short *scores) {
+        const simd_int residues1 = simdi16_loadu8(seq1);
+        const simd_int residues2 = simdi16_loadu8(seq2);
+        const simd_int index = simdi_and(residues1, simdi16_set(0x1F));
+        const simd_int isUpper = simdi16_eq(simdi_and(residues1, simdi16_set(0xE0)), simdi16_set(0x40));
+        const simd_int isMatch = simdi_and(simdi16_eq(residues1, residues2), isUpper);
+        const simd_int isHigh = simdi16_gt(index, simdi16_set(15));
+        // the set high byte of each lane selects a zero, the low byte is sign extended afterwards
+        const simd_int shuffleIndex = simdi_or(simdi_and(index, simdi16_set(0x0F)), simdi16_set(static_cast<short>(0x8000)));
+        const simd_int diagonalScores = simdi_or(simdi_and(isHigh, simdi8_shuffle(diagonal.high, shuffleIndex)),
+                                                 simdi_andnot(isHigh, simdi8_shuffle(diagonal.low, shuffleIndex)));
+        simdi_store((simd_int *) scores, simdi16_srai(simdi16_slli(diagonalScores, 8), 8));
+        // two mask bits per lane, only the lower one is kept
+        unsigned int mismatches = ~static_cast<unsigned int>(simdi8_movemask(isMatch))
+                                  & static_cast<unsigned int>(0x5555555555555555ull >> (64 - VECSIZE_INT * 4));
+        while (mismatches != 0) {
+            const unsigned int i = __builtin_ctz(mismatches) / 2;
+            scores[i] = subMat[static_cast<int>(seq1[i])][static_cast<int>(seq2[i])];
+            mismatches &= mismatches - 1;
+        }
+    }
+
+    // Best local ungapped alignment along a diagonal, VECSIZE_INT * 2 positions per step.
+    // The clamped running score S_j = max(0, S_{j-1} + s_j) of a block equals
+    // Q_j - min(-S, min_{i<=j} Q_i), with Q the prefix sum of the block scores and S the
+    // score entering the block. Both prefix operations are done in register.
+    // S is capped before entering the 16 bit lanes, the cap exceeds any drop inside a block.
+    // With xDrop > 0 the scan stops at the first block end whose score is more than xDrop below the best.
+    template<typename T>
+    static LocalAlignment computeUngappedAlignment(const T *seq1,
+                                                   const T *seq2,
+                                                   const unsigned int length,
+                                                   const char **subMat, const int xDrop = 0) {
+        const unsigned int lanes = VECSIZE_INT * 2;
+        const int scoreCap = 8192;
+        short scores[VECSIZE_INT * 2] __attribute__((aligned(ALIGN_INT)));
+        const simd_int vZero = simdi_setzero();
+        // only ASCII encoded sequences take the shuffle path
+        DiagonalScores diagonal;
+        if (std::is_same<T, char>::value) {
+            diagonal.init(subMat);
+        }
         int maxScore = 0;
         int maxEndPos = 0;
         int maxStartPos = 0;
         int minPos = -1;
-//        int maxMinPos = 0;
         int score = 0;
-        for(unsigned int pos = 0; pos < length; pos++){
-            int curr = subMat[static_cast<int>(seq1[pos])][static_cast<int>(seq2[pos])];
-            score = curr  + score;
-            const bool isMinScore = (score <= 0);
-            score =  (isMinScore) ? 0 : score;
-            minPos = (isMinScore) ? pos : minPos;
-            const bool isNewMaxScore = (score > maxScore);
-            maxEndPos = (isNewMaxScore) ? pos : maxEndPos;
-            maxStartPos = (isNewMaxScore) ? minPos + 1 : maxStartPos;
-            maxScore = (isNewMaxScore)? score : maxScore;
+        for (unsigned int blockStart = 0; blockStart < length; blockStart += lanes) {
+            const unsigned int blockLen = std::min(lanes, length - blockStart);
+            if (blockLen == lanes) {
+                fillBlockScores(seq1 + blockStart, seq2 + blockStart, subMat, diagonal, scores);
+            } else {
+                for (unsigned int i = 0; i < blockLen; i++) {
+                    scores[i] = subMat[static_cast<int>(seq1[blockStart + i])][static_cast<int>(seq2[blockStart + i])];
+                }
+                for (unsigned int i = blockLen; i < lanes; i++) {
+                    scores[i] = 0;
+                }
+            }
+            simd_int prefix = simdi_load((simd_int *) scores);
+            prefix = simdi16_add(prefix, simdi8_shiftl(prefix, 2));
+            prefix = simdi16_add(prefix, simdi8_shiftl(prefix, 4));
+            prefix = simdi16_add(prefix, simdi8_shiftl(prefix, 8));
+#ifdef AVX2
+            prefix = simdi16_add(prefix, simdi8_shiftl(prefix, 16));
+#endif
+            // the zeros shifted in stand for the block entry, which is never below -S
+            simd_int prefixMin = simdi16_min(prefix, simdi8_shiftl(prefix, 2));
+            prefixMin = simdi16_min(prefixMin, simdi8_shiftl(prefixMin, 4));
+            prefixMin = simdi16_min(prefixMin, simdi8_shiftl(prefixMin, 8));
+#ifdef AVX2
+            prefixMin = simdi16_min(prefixMin, simdi8_shiftl(prefixMin, 16));
+#endif
+            const int cappedScore = std::min(score, scoreCap);
+            const int scoreOffset = score - cappedScore;
+            prefixMin = simdi16_min(prefixMin, simdi16_set(-cappedScore));
+            const simd_int blockScores = simdi16_sub(prefix, prefixMin);
+
+            // two mask bits per lane, lanes beyond the sequence end are ignored
+            const unsigned int laneMask = (blockLen * 2 >= 32) ? 0xFFFFFFFFu : ((1u << (blockLen * 2)) - 1);
+            const unsigned int zeroMask = (scoreOffset == 0)
+                                          ? static_cast<unsigned int>(simdi8_movemask(simdi16_eq(blockScores, vZero))) & laneMask : 0;
+            const int blockMax = static_cast<int>(simdi16_hmax(blockScores)) + scoreOffset;
+            if (blockMax > maxScore) {
+                const unsigned int maxMask = simdi8_movemask(simdi16_eq(blockScores, simdi16_set(blockMax - scoreOffset)));
+                const unsigned int endLane = __builtin_ctz(maxMask) / 2;
+                const unsigned int zerosBeforeEnd = zeroMask & ((1u << (endLane * 2)) - 1);
+                maxStartPos = (zerosBeforeEnd != 0) ? blockStart + (31 - __builtin_clz(zerosBeforeEnd)) / 2 + 1 : minPos + 1;
+                maxEndPos = blockStart + endLane;
+                maxScore = blockMax;
+            }
+            if (zeroMask != 0) {
+                minPos = blockStart + (31 - __builtin_clz(zeroMask)) / 2;
+            }
+            score = static_cast<int>(simdi16_extract(blockScores, lanes - 1)) + scoreOffset;
+            if (xDrop > 0 && maxScore - score > xDrop) {
+                break;
+            }
         }
         return LocalAlignment(maxStartPos, maxEndPos, maxScore);
     }
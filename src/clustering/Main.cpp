@@ -17,7 +17,9 @@ int clust(int argc, const char **argv, const Command& command) {
 #endif
     Clustering* clu = new Clustering(par.db1, par.db1Index, par.db2, par.db2Index,
                                      par.db3, par.db3Index, par.maxIteration,
-                                     par.similarityScoreType, par.threads);
+                                     par.similarityScoreType, par.threads,
+                                     par.parallelSetCover, par.setCoverEps, par.graphCache,
+                                     par.unionFind, par.clusterMemoryLimit);
 
     clu->run(par.clusteringMode);
 
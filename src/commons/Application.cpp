@@ -3,6 +3,7 @@
 #include "Command.h"
 #include "DistanceCalculator.h"
 #include "Timer.h"
+#include "Metrics.h"
 
 #include <CpuInfo.h>
 #include <iomanip>
@@ -54,8 +55,10 @@ int getCommandIndex(const char *s) {
 
 int runCommand(const Command &p, int argc, const char **argv) {
     Timer timer;
+    Metrics::beginModule(p.cmd, argc, argv);
     int status = p.commandFunction(argc, argv, p);
     Debug(Debug::INFO) << "Time for processing: " << timer.lap() << "\n";
+    Metrics::endModule(status);
     return status;
 }
 
@@ -0,0 +1,113 @@
+#include "Checkpoint.h"
+#include "Debug.h"
+#include "FileUtil.h"
+#include "Util.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+Checkpoint::Checkpoint(const std::string &fileName, size_t signature) : fileName(fileName), signature(signature) {}
+
+bool Checkpoint::load() {
+    entries.clear();
+    FILE *file = fopen(fileName.c_str(), "r");
+    if (file == NULL) {
+        return false;
+    }
+    std::string content;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, read);
+    }
+    fclose(file);
+
+    bool matches = false;
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t end = content.find('\n', start);
+        if (end == std::string::npos) {
+            end = content.size();
+        }
+        const std::string line = content.substr(start, end - start);
+        start = end + 1;
+        const size_t tab = line.find('\t');
+        if (tab == std::string::npos) {
+            continue;
+        }
+        const std::string key = line.substr(0, tab);
+        const std::string value = line.substr(tab + 1);
+        if (key == "signature") {
+            matches = strtoull(value.c_str(), NULL, 10) == signature;
+        } else {
+            entries.push_back(std::make_pair(key, value));
+        }
+    }
+    if (matches == false) {
+        Debug(Debug::WARNING) << "Ignoring checkpoint " << fileName << " of a run with other input or parameters\n";
+        entries.clear();
+    }
+    return matches;
+}
+
+void Checkpoint::save() {
+    std::string content = "signature\t" + SSTR(signature) + "\n";
+    for (size_t i = 0; i < entries.size(); ++i) {
+        content.append(entries[i].first);
+        content.append("\t");
+        content.append(entries[i].second);
+        content.append("\n");
+    }
+
+    const std::string tmpFile = fileName + ".tmp";
+    FILE *file = fopen(tmpFile.c_str(), "w");
+    if (file == NULL) {
+        Debug(Debug::ERROR) << "Could not open checkpoint " << tmpFile << " for writing: " << strerror(errno) << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fwrite(content.c_str(), 1, content.size(), file) != content.size() || fflush(file) != 0
+        || fsync(fileno(file)) != 0) {
+        Debug(Debug::ERROR) << "Could not write checkpoint " << tmpFile << ": " << strerror(errno) << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    fclose(file);
+    if (rename(tmpFile.c_str(), fileName.c_str()) != 0) {
+        Debug(Debug::ERROR) << "Could not move checkpoint " << tmpFile << " to " << fileName << ": " << strerror(errno) << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // the rename is only durable once the directory is synced
+    int dir = open(FileUtil::dirName(fileName).c_str(), O_RDONLY);
+    if (dir != -1) {
+        fsync(dir);
+        close(dir);
+    }
+}
+
+void Checkpoint::remove() {
+    if (unlink(fileName.c_str()) != 0 && errno != ENOENT) {
+        Debug(Debug::WARNING) << "Could not remove checkpoint " << fileName << "\n";
+    }
+}
+
+std::string Checkpoint::get(const std::string &key) const {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].first == key) {
+            return entries[i].second;
+        }
+    }
+    return "";
+}
+
+std::vector<std::string> Checkpoint::getAll(const std::string &key) const {
+    std::vector<std::string> values;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].first == key) {
+            values.push_back(entries[i].second);
+        }
+    }
+    return values;
+}
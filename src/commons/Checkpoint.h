@@ -0,0 +1,52 @@
+#ifndef MMSEQS_CHECKPOINT_H
+#define MMSEQS_CHECKPOINT_H
+
+// Manifest of the progress of a module, so a run that was interrupted can resume where it stopped.
+//
+// The manifest is a text file of key/value lines. The signature identifies the run it belongs to
+// (input files and parameters), a run with another signature starts over. Every save writes a
+// temporary file, syncs it and renames it over the manifest, so a crash leaves the old or the new
+// manifest, never a partial one.
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Checkpoint {
+public:
+    Checkpoint(const std::string &fileName, size_t signature);
+
+    // reads the manifest, false if there is none or it belongs to another run
+    bool load();
+
+    // writes the entries to disk
+    void save();
+
+    // deletes the manifest once the module finished
+    void remove();
+
+    void clear() {
+        entries.clear();
+    }
+
+    void add(const std::string &key, const std::string &value) {
+        entries.push_back(std::make_pair(key, value));
+    }
+
+    // first value of the key, empty if it is missing
+    std::string get(const std::string &key) const;
+
+    std::vector<std::string> getAll(const std::string &key) const;
+
+    const std::string &getFileName() const {
+        return fileName;
+    }
+
+private:
+    std::string fileName;
+    size_t signature;
+    std::vector<std::pair<std::string, std::string> > entries;
+};
+
+#endif
@@ -1,11 +1,13 @@
 #include "CommandCaller.h"
 #include "Util.h"
 #include "Debug.h"
+#include "Metrics.h"
 
 #include <strings.h>
 #include <cstdlib>
 #include <unistd.h>
 #include <sstream>
+#include <sys/wait.h>
 
 #ifdef OPENMP
 #include <omp.h>
@@ -41,7 +43,10 @@ int CommandCaller::callProgram(const char* program, size_t argc, const char **ar
     }
 
     std::string argString = argStream.str();
-    if (std::system(argString.c_str()) != EXIT_SUCCESS) {
+    Metrics::beginChildren();
+    int status = std::system(argString.c_str());
+    Metrics::endChildren();
+    if (status != EXIT_SUCCESS) {
         EXIT(EXIT_FAILURE);
     }
 
@@ -57,6 +62,27 @@ void CommandCaller::execProgram(const char* program, const std::vector<std::stri
     }
     pArgv[argv.size() + 1] = NULL;
 
+    if (Metrics::isEnabled()) {
+        // stay alive to collect the reports of the modules the program runs
+        Metrics::beginChildren();
+        pid_t pid = fork();
+        if (pid == 0) {
+            execvp(program, (char * const *) pArgv);
+            _exit(127);
+        }
+        int status = EXIT_FAILURE;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0) {
+            Debug(Debug::ERROR) << "Failed to execute " << program << " with error " << errno << ".\n";
+            status = EXIT_FAILURE;
+        } else {
+            status = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+        }
+        Metrics::endChildren();
+        Metrics::endModule(status);
+        delete[] pArgv;
+        EXIT(status);
+    }
+
     int res = execvp(program, (char * const *) pArgv);
 
     if (res == -1) {
@@ -1,4 +1,5 @@
 #include "DBReader.h"
+#include "DBWriter.h"
 
 #include <iostream>
 #include <fstream>
@@ -7,6 +8,7 @@
 #include <cstring>
 #include <cstddef>
 #include <random>
+#include <vector>
 
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -16,6 +18,7 @@
 #include "Debug.h"
 #include "Util.h"
 #include "FileUtil.h"
+#include "Metrics.h"
 
 template <typename T>
 DBReader<T>::DBReader(const char* dataFileName_, const char* indexFileName_, int dataMode) :
@@ -84,7 +87,15 @@ template <typename T> bool DBReader<T>::open(int accessType){
     // count the number of entries
     this->accessType = accessType;
     bool isSortedById = false;
-    if (dataMode & USE_DATA) {
+    const bool isStream = externalData == false && FileUtil::isNamedPipe(dataFileName);
+    if (isStream) {
+        if ((dataMode & USE_DATA) == 0) {
+            Debug(Debug::ERROR) << "Streamed database " << dataFileName << " can only be opened with data\n";
+            EXIT(EXIT_FAILURE);
+        }
+        // the type is sent at the end of the stream
+        readStream();
+    } else if (dataMode & USE_DATA) {
         FILE* dataFile = fopen(dataFileName, "r");
         dbtype = parseDbType(dataFileName);
         if (dataFile == NULL) {
@@ -95,17 +106,22 @@ template <typename T> bool DBReader<T>::open(int accessType){
         fclose(dataFile);
         dataMapped = true;
     }
+    if (isStream || (dataMode & USE_DATA)) {
+        Metrics::addCounter("dbReadBytes", dataSize);
+    }
 
     if (externalData == false) {
-        if(FileUtil::fileExists(indexFileName)==false){
-            Debug(Debug::ERROR) << "Could not open index file " << indexFileName << "!\n";
-            EXIT(EXIT_FAILURE);
-        }
-        size = FileUtil::countLines(indexFileName);
-        index = new Index[this->size];
-        seqLens = new unsigned int[size];
+        if (isStream == false) {
+            if(FileUtil::fileExists(indexFileName)==false){
+                Debug(Debug::ERROR) << "Could not open index file " << indexFileName << "!\n";
+                EXIT(EXIT_FAILURE);
+            }
+            size = FileUtil::countLines(indexFileName);
+            index = new Index[this->size];
+            seqLens = new unsigned int[size];
 
-        isSortedById = readIndex(indexFileName, index, seqLens);
+            isSortedById = readIndex(indexFileName, index, seqLens);
+        }
         if (accessType != HARDNOSORT) {
             sortIndex(isSortedById);
         }
@@ -289,6 +305,72 @@ void DBReader<unsigned int>::sortIndex(bool isSortedById) {
     }
 }
 
+static void setStreamKey(unsigned int key, unsigned int *id) {
+    *id = key;
+}
+
+static void setStreamKey(unsigned int key, std::string *id) {
+    *id = SSTR(key);
+}
+
+template <typename T> void DBReader<T>::readStream() {
+    FILE *stream = fopen(dataFileName, "r");
+    if (stream == NULL) {
+        Debug(Debug::ERROR) << "Could not open data file " << dataFileName << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    Debug(Debug::INFO) << "Read streamed database " << dataFileName << "\n";
+
+    std::vector<std::pair<unsigned int, size_t> > entries;
+    size_t capacity = 1024 * 1024;
+    data = static_cast<char*>(malloc(capacity));
+    Util::checkAllocation(data, "Not enough system memory to read in the streamed database.");
+    dataSize = 0;
+    unsigned int key;
+    size_t length;
+    bool complete = false;
+    while (fread(&key, sizeof(unsigned int), 1, stream) == 1) {
+        if (fread(&length, sizeof(size_t), 1, stream) != 1) {
+            break;
+        }
+        if (length == DBWriter::STREAM_END) {
+            complete = fread(&dbtype, sizeof(int), 1, stream) == 1;
+            break;
+        }
+        if (dataSize + length > capacity) {
+            while (dataSize + length > capacity) {
+                capacity *= 2;
+            }
+            data = static_cast<char*>(realloc(data, capacity));
+            Util::checkAllocation(data, "Not enough system memory to read in the streamed database.");
+        }
+        if (fread(data + dataSize, sizeof(char), length, stream) != length) {
+            Debug(Debug::ERROR) << "Streamed database " << dataFileName << " is truncated\n";
+            EXIT(EXIT_FAILURE);
+        }
+        entries.push_back(std::make_pair(key, dataSize));
+        dataSize += length;
+    }
+    fclose(stream);
+    if (complete == false) {
+        Debug(Debug::ERROR) << "Streamed database " << dataFileName << " is truncated\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    size = entries.size();
+    index = new Index[size];
+    seqLens = new unsigned int[size];
+    for (size_t i = 0; i < size; i++) {
+        setStreamKey(entries[i].first, &index[i].id);
+        index[i].offset = entries[i].second;
+        const size_t end = (i + 1 < size) ? entries[i + 1].second : dataSize;
+        seqLens[i] = static_cast<unsigned int>(end - entries[i].second);
+    }
+    // the entries live in memory, unmapData frees them
+    dataMode |= USE_FREAD;
+    dataMapped = true;
+}
+
 template <typename T> char* DBReader<T>::mmapData(FILE * file, size_t *dataSize){
     struct stat sb;
     if (fstat(fileno(file), &sb) < 0)
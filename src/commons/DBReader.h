@@ -95,6 +95,10 @@ public:
 
     void readMmapedDataInMemory();
 
+    // reads all entries and the dbtype that an upstream DBWriter writes to the named pipe dataFileName,
+    // the full stream is held in memory
+    void readStream();
+
     void mlock();
 
     void sortIndex(bool isSortedById);
@@ -6,10 +6,16 @@
 #include "Concat.h"
 #include "itoa.h"
 #include "Timer.h"
+#include "Metrics.h"
+#include "Checkpoint.h"
 
 #include <cstdlib>
+#include <algorithm>
+#include <limits>
 #include <cstdio>
 #include <sstream>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #ifdef OPENMP
@@ -17,7 +23,8 @@
 #endif
 
 DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsigned int threads, size_t mode)
-        : threads(threads), mode(mode) {
+        : stream(false), streamFile(NULL), streamBuffers(NULL), threads(threads), mode(mode),
+          checkpointManifest(NULL), checkpointInterval(0), checkpointStart(0), lastCheckpoint(0) {
     dataFileName = strdup(dataFileName_);
     indexFileName = strdup(indexFileName_);
 
@@ -44,6 +51,7 @@ DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsign
 }
 
 DBWriter::~DBWriter() {
+    delete checkpointManifest;
     delete[] offsets;
     delete[] starts;
     delete[] indexFileNames;
@@ -126,6 +134,19 @@ char* makeResultFilename(const char* name, size_t split) {
 }
 
 void DBWriter::open(size_t bufferSize) {
+    if (FileUtil::isNamedPipe(dataFileName)) {
+        // blocks until the downstream module opens the pipe for reading
+        streamFile = fopen(dataFileName, "w");
+        if (streamFile == NULL) {
+            Debug(Debug::ERROR) << "Could not open " << dataFileName << " for writing!\n";
+            EXIT(EXIT_FAILURE);
+        }
+        stream = true;
+        streamBuffers = new std::string[threads];
+        closed = false;
+        return;
+    }
+
     for (unsigned int i = 0; i < threads; i++) {
         dataFileNames[i] = makeResultFilename(dataFileName, i);
         indexFileNames[i] = makeResultFilename(indexFileName, i);
@@ -182,10 +203,33 @@ void DBWriter::open(size_t bufferSize) {
 }
 
 void DBWriter::close(int dbType) {
-    // close all datafiles
+    size_t dataBytes = 0;
     for (unsigned int i = 0; i < threads; i++) {
-        fclose(dataFiles[i]);
-        fclose(indexFiles[i]);
+        dataBytes += offsets[i];
+    }
+    Metrics::addCounter("dbWrittenBytes", dataBytes);
+
+    if (stream) {
+        // the reader can not wait for the dbtype file, it only sees the pipe
+        const unsigned int endKey = 0;
+        const size_t endLength = STREAM_END;
+        if (fwrite(&endKey, sizeof(unsigned int), 1, streamFile) != 1
+            || fwrite(&endLength, sizeof(size_t), 1, streamFile) != 1
+            || fwrite(&dbType, sizeof(int), 1, streamFile) != 1) {
+            Debug(Debug::ERROR) << "Could not write to " << dataFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        if (fclose(streamFile) != 0) {
+            Debug(Debug::ERROR) << "Could not close " << dataFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        delete[] streamBuffers;
+    } else {
+        // close all datafiles
+        for (unsigned int i = 0; i < threads; i++) {
+            fclose(dataFiles[i]);
+            fclose(indexFiles[i]);
+        }
     }
 
     if (dbType > -1){
@@ -204,17 +248,144 @@ void DBWriter::close(int dbType) {
         fclose(dbtypeDataFile);
     }
 
-    mergeResults(dataFileName, indexFileName,
-                 (const char **) dataFileNames, (const char **) indexFileNames, threads, ((mode & LEXICOGRAPHIC_MODE) != 0));
+    if (stream == false) {
+        std::vector<const char *> dataFilesToMerge(dataFileNames, dataFileNames + threads);
+        std::vector<const char *> indexFilesToMerge(indexFileNames, indexFileNames + threads);
+        for (size_t i = 0; i < keptFiles.size(); i++) {
+            dataFilesToMerge.push_back(keptFiles[i].first.c_str());
+            indexFilesToMerge.push_back(keptFiles[i].second.c_str());
+        }
+        mergeResults(dataFileName, indexFileName, &dataFilesToMerge[0], &indexFilesToMerge[0],
+                     dataFilesToMerge.size(), ((mode & LEXICOGRAPHIC_MODE) != 0));
+        keptFiles.clear();
+        if (checkpointManifest != NULL) {
+            checkpointManifest->remove();
+        }
 
-    for (unsigned int i = 0; i < threads; i++) {
-        delete [] dataFilesBuffer[i];
-        free(dataFileNames[i]);
-        free(indexFileNames[i]);
+        for (unsigned int i = 0; i < threads; i++) {
+            delete [] dataFilesBuffer[i];
+            free(dataFileNames[i]);
+            free(indexFileNames[i]);
+        }
     }
     closed = true;
 }
 
+static double wallSeconds() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec + 1e-6 * now.tv_usec;
+}
+
+static size_t fileSize(const std::string &file) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0) {
+        return 0;
+    }
+    return static_cast<size_t>(st.st_size);
+}
+
+std::string DBWriter::enableCheckpoints(size_t signature, int interval) {
+    if (interval <= 0 || FileUtil::isNamedPipe(dataFileName)) {
+        return "";
+    }
+    checkpointInterval = interval;
+    checkpointStart = wallSeconds();
+    lastCheckpoint = checkpointStart;
+    checkpointManifest = new Checkpoint(std::string(dataFileName) + ".checkpoint", signature);
+    if (checkpointManifest->load() == false) {
+        return "";
+    }
+
+    // the files of every earlier attempt, with the size they had at its last checkpoint
+    std::vector<std::string> files = checkpointManifest->getAll("file");
+    std::vector<std::string> dataFiles;
+    std::vector<std::string> indexFiles;
+    std::vector<size_t> dataSizes;
+    std::vector<size_t> indexSizes;
+    for (size_t i = 0; i < files.size(); i++) {
+        std::vector<std::string> fields = Util::split(files[i], "\t");
+        if (fields.size() != 4) {
+            Debug(Debug::WARNING) << "Ignoring the invalid checkpoint " << checkpointManifest->getFileName() << "\n";
+            return "";
+        }
+        dataFiles.push_back(fields[0]);
+        dataSizes.push_back(strtoull(fields[1].c_str(), NULL, 10));
+        indexFiles.push_back(fields[2]);
+        indexSizes.push_back(strtoull(fields[3].c_str(), NULL, 10));
+        if (fileSize(dataFiles[i]) < dataSizes[i] || fileSize(indexFiles[i]) < indexSizes[i]) {
+            Debug(Debug::WARNING) << "Ignoring the checkpoint " << checkpointManifest->getFileName()
+                                  << ", " << dataFiles[i] << " is missing or incomplete\n";
+            return "";
+        }
+    }
+
+    // everything written after the checkpoint is dropped, the thread files are kept under a new name
+    // since open() truncates them
+    size_t keptBytes = 0;
+    for (size_t i = 0; i < dataFiles.size(); i++) {
+        const std::string keptData = std::string(dataFileName) + ".kept." + SSTR(i);
+        const std::string keptIndex = std::string(indexFileName) + ".kept." + SSTR(i);
+        if (truncate(dataFiles[i].c_str(), dataSizes[i]) != 0 || truncate(indexFiles[i].c_str(), indexSizes[i]) != 0
+            || (dataFiles[i] != keptData && std::rename(dataFiles[i].c_str(), keptData.c_str()) != 0)
+            || (indexFiles[i] != keptIndex && std::rename(indexFiles[i].c_str(), keptIndex.c_str()) != 0)) {
+            Debug(Debug::ERROR) << "Could not restore " << dataFiles[i] << " from the checkpoint\n";
+            EXIT(EXIT_FAILURE);
+        }
+        keptFiles.push_back(std::make_pair(keptData, keptIndex));
+        keptBytes += dataSizes[i];
+    }
+    std::string state = checkpointManifest->get("state");
+    Debug(Debug::INFO) << "Resuming from checkpoint " << checkpointManifest->getFileName()
+                       << " (" << Util::formatBytes(keptBytes) << " of results kept)\n";
+    Metrics::addCounter("checkpointKeptBytes", keptBytes);
+    return state;
+}
+
+void DBWriter::checkpoint(const std::string &state) {
+    if (checkpointManifest == NULL || closed == true || stream == true) {
+        return;
+    }
+    const double now = wallSeconds();
+    if (now - lastCheckpoint < checkpointInterval) {
+        return;
+    }
+
+    checkpointManifest->clear();
+    checkpointManifest->add("state", state);
+    for (size_t i = 0; i < keptFiles.size(); i++) {
+        checkpointManifest->add("file", keptFiles[i].first + "\t" + SSTR(fileSize(keptFiles[i].first)) + "\t"
+                                        + keptFiles[i].second + "\t" + SSTR(fileSize(keptFiles[i].second)));
+    }
+    for (unsigned int i = 0; i < threads; i++) {
+        if (fflush(dataFiles[i]) != 0 || fflush(indexFiles[i]) != 0
+            || fsync(fileno(dataFiles[i])) != 0 || fsync(fileno(indexFiles[i])) != 0) {
+            Debug(Debug::ERROR) << "Could not write " << dataFileNames[i] << " to disk for the checkpoint\n";
+            EXIT(EXIT_FAILURE);
+        }
+        const long indexSize = ftell(indexFiles[i]);
+        checkpointManifest->add("file", std::string(dataFileNames[i]) + "\t" + SSTR(offsets[i]) + "\t"
+                                        + indexFileNames[i] + "\t" + SSTR(indexSize));
+    }
+    checkpointManifest->save();
+    Metrics::addCounter("checkpoints", 1);
+    lastCheckpoint = wallSeconds();
+}
+
+size_t DBWriter::checkpointChunkSize(size_t finished, size_t minChunkSize) const {
+    const double now = wallSeconds();
+    const double elapsed = now - checkpointStart;
+    if (finished == 0 || elapsed <= 0) {
+        return minChunkSize;
+    }
+    const double untilDue = std::max(0.0, checkpointInterval - (now - lastCheckpoint));
+    const double chunkSize = static_cast<double>(finished) / elapsed * untilDue;
+    if (chunkSize <= static_cast<double>(minChunkSize)) {
+        return minChunkSize;
+    }
+    return static_cast<size_t>(std::min(chunkSize, static_cast<double>(std::numeric_limits<size_t>::max() / 2)));
+}
+
 void DBWriter::writeStart(unsigned int thrIdx) {
     checkClosed();
     if (thrIdx >= threads) {
@@ -222,6 +393,10 @@ void DBWriter::writeStart(unsigned int thrIdx) {
         EXIT(EXIT_FAILURE);
     }
 
+    if (stream) {
+        streamBuffers[thrIdx].clear();
+        return;
+    }
     starts[thrIdx] = offsets[thrIdx];
 }
 
@@ -232,6 +407,10 @@ void DBWriter::writeAdd(const char* data, size_t dataSize, unsigned int thrIdx)
         EXIT(EXIT_FAILURE);
     }
 
+    if (stream) {
+        streamBuffers[thrIdx].append(data, dataSize);
+        return;
+    }
     size_t written = fwrite(data, sizeof(char), dataSize, dataFiles[thrIdx]);
     if (written != dataSize) {
         Debug(Debug::ERROR) << "Could not write to data file " << dataFileNames[thrIdx] << "\n";
@@ -241,6 +420,14 @@ void DBWriter::writeAdd(const char* data, size_t dataSize, unsigned int thrIdx)
 }
 
 void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte) {
+    if (stream) {
+        if (addNullByte == true) {
+            streamBuffers[thrIdx].push_back('\0');
+        }
+        offsets[thrIdx] += streamBuffers[thrIdx].size();
+        writeStreamEntry(key, streamBuffers[thrIdx]);
+        return;
+    }
     size_t written;
     // entries are always separated by a null byte
     if(addNullByte == true){
@@ -264,6 +451,19 @@ void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte)
     }
 }
 
+void DBWriter::writeStreamEntry(unsigned int key, const std::string &entry) {
+    const size_t length = entry.size();
+#pragma omp critical(DBWriterStream)
+    {
+        if (fwrite(&key, sizeof(unsigned int), 1, streamFile) != 1
+            || fwrite(&length, sizeof(size_t), 1, streamFile) != 1
+            || fwrite(entry.c_str(), sizeof(char), length, streamFile) != length) {
+            Debug(Debug::ERROR) << "Could not write to " << dataFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+}
+
 void DBWriter::writeData(const char *data, size_t dataSize, unsigned int key, unsigned int thrIdx, bool addNullByte) {
     writeStart(thrIdx);
     writeAdd(data, dataSize, thrIdx);
@@ -283,6 +483,9 @@ size_t DBWriter::indexToBuffer(char *buff1, unsigned int key, size_t offsetStart
 }
 
 void DBWriter::alignToPageSize() {
+    if (stream) {
+        return;
+    }
     if (threads > 1) {
         Debug(Debug::ERROR) << "Data file can only be aligned in single threaded mode.\n";
         EXIT(EXIT_FAILURE);
@@ -366,6 +569,7 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
                             const char **dataFileNames, const char **indexFileNames,
                             const unsigned long fileCount, const bool lexicographicOrder) {
     Timer timer;
+    Metrics::Phase phase("mergeResults");
     // merge results from each thread into one result file
     if (fileCount > 1) {
         FILE *outFile = fopen(outFileName, "w");
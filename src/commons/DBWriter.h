@@ -7,12 +7,23 @@
 // For parallel write access, one ffindex DB per thread is generated.
 // After the parallel calculation is done, all ffindexes are merged into one.
 //
+// If the data file is a named pipe, the entries are written to it as soon as they
+// are finished (key, length, data) and no index is written. close() ends the stream with
+// the length STREAM_END followed by the database type. A downstream module reads
+// the pipe with DBReader instead of a data and index file.
+//
+// With checkpoints enabled, the thread files are synced to disk from time to time and their sizes
+// are recorded in a manifest next to the data file. If the module is interrupted and started again
+// with the same input and parameters, the entries up to the last checkpoint are kept and merged
+// with the new ones on close.
+//
 
 #include <string>
 #include <vector>
 #include "DBReader.h"
 
 template <typename T> class DBReader;
+class Checkpoint;
 
 class DBWriter {
     public:
@@ -20,6 +31,9 @@ class DBWriter {
         static const size_t BINARY_MODE = 1;
         static const size_t LEXICOGRAPHIC_MODE = 2;
 
+        // entry length that marks the end of a streamed database
+        static const size_t STREAM_END = static_cast<size_t>(-1);
+
 
         DBWriter(const char* dataFileName, const char* indexFileName, unsigned int threads = 1, size_t mode = ASCII_MODE);
 
@@ -28,6 +42,22 @@ class DBWriter {
         void open(size_t bufferSize = 64 * 1024 * 1024);
 
         void close(int dbType = -1);
+
+        // called before open(), returns the state recorded with the last checkpoint of an interrupted
+        // run with the same signature, or an empty string if the writer starts from the beginning
+        std::string enableCheckpoints(size_t signature, int interval);
+
+        // called while no thread writes, records the entries written so far together with the state
+        // of the caller, at most once per interval
+        void checkpoint(const std::string &state);
+
+        bool hasCheckpoints() const { return checkpointManifest != NULL; }
+
+        // entries to compute until the next checkpoint is due, estimated from the finished entries
+        // of this run. Callers take checkpoints between chunks of this size, so that the threads only
+        // wait for each other about once per interval. Never below minChunkSize, which is also the
+        // size of the first chunk.
+        size_t checkpointChunkSize(size_t finished, size_t minChunkSize) const;
     
         char* getDataFileName() { return dataFileName; }
     
@@ -66,9 +96,16 @@ private:
 
     void checkClosed();
 
+    void writeStreamEntry(unsigned int key, const std::string &entry);
+
     char* dataFileName;
     char* indexFileName;
 
+    // entries are written to a named pipe instead of per thread files
+    bool stream;
+    FILE* streamFile;
+    std::string* streamBuffers;
+
     FILE** dataFiles;
     char** dataFilesBuffer;
     size_t bufferSize;
@@ -87,6 +124,12 @@ private:
 
     std::string datafileMode;
 
+    Checkpoint* checkpointManifest;
+    int checkpointInterval;
+    double checkpointStart;
+    double lastCheckpoint;
+    // entries of an interrupted run, merged on close
+    std::vector<std::pair<std::string, std::string> > keptFiles;
 
 };
 
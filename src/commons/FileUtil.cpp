@@ -22,6 +22,11 @@ bool FileUtil::directoryExists(const char* directoryName) {
     return stat(directoryName, &st) == 0 && S_ISDIR(st.st_mode);
 }
 
+bool FileUtil::isNamedPipe(const char* fileName) {
+    struct stat st;
+    return stat(fileName, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
 bool FileUtil::makeDir(const char* directoryName, const int mode ) {
     return mkdir(directoryName, mode) == 0;
 }
@@ -209,6 +214,12 @@ size_t FileUtil::getFileSize(const std::string &fileName) {
     return rc == 0 ? stat_buf.st_size : -1;
 }
 
+long long FileUtil::getModificationTime(const std::string &fileName) {
+    struct stat stat_buf;
+    int rc = stat(fileName.c_str(), &stat_buf);
+    return rc == 0 ? static_cast<long long>(stat_buf.st_mtime) : -1;
+}
+
 
 bool FileUtil::symlinkExists(const std::string &path)  {
     struct stat buf;
@@ -12,6 +12,8 @@ public:
 
     static bool directoryExists(const char *directoryName);
 
+    static bool isNamedPipe(const char *fileName);
+
     static FILE* openFileOrDie(const char *fileName, const char *mode, bool shouldExist);
 
     static size_t countLines(const char *name);
@@ -37,6 +39,9 @@ public:
 
     static size_t getFileSize(const std::string &fileName);
 
+    // modification time in seconds since the epoch, -1 if the file does not exist
+    static long long getModificationTime(const std::string &fileName);
+
     static bool symlinkExists(const std::string &path);
 
     static void copyFile(const char *src, const char *dst);
@@ -8,7 +8,13 @@ int MMseqsMPI::numProc = -1;
 
 #ifdef HAVE_MPI
 void MMseqsMPI::init(int argc, const char **argv) {
-    MPI_Init(&argc, const_cast<char ***>(&argv));
+    // only the thread that initialized MPI calls it, also from inside of OpenMP parallel regions
+    int provided;
+    MPI_Init_thread(&argc, const_cast<char ***>(&argv), MPI_THREAD_FUNNELED, &provided);
+    if (provided < MPI_THREAD_FUNNELED) {
+        Debug(Debug::ERROR) << "MPI library does not support MPI_THREAD_FUNNELED!\n";
+        EXIT(EXIT_FAILURE);
+    }
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &numProc);
 
@@ -0,0 +1,118 @@
+#include "MPIScheduler.h"
+
+#include <algorithm>
+
+#ifdef HAVE_MPI
+static const int TAG_REQUEST = 4201;
+static const int TAG_ANSWER = 4202;
+static const int TAG_GATHER = 4203;
+#endif
+
+MPIScheduler::MPIScheduler(size_t from, size_t size, size_t chunkSize, bool prefetch)
+        : position(from), end(from + size), chunkSize(std::max(chunkSize, static_cast<size_t>(1))), prefetch(prefetch),
+          distributed(false) {
+#ifdef HAVE_MPI
+    distributed = MMseqsMPI::active && MMseqsMPI::numProc > 1;
+    finishedWorkers = 0;
+    waiting = false;
+    finished = false;
+    request = MMseqsMPI::rank;
+#endif
+}
+
+bool MPIScheduler::next(size_t *chunkFrom, size_t *chunkCount) {
+#ifdef HAVE_MPI
+    if (distributed && MMseqsMPI::isMaster() == false) {
+        if (finished) {
+            return false;
+        }
+        if (waiting == false) {
+            sendRequests();
+        }
+        MPI_Wait(&sendRequest, MPI_STATUS_IGNORE);
+        MPI_Wait(&receiveRequest, MPI_STATUS_IGNORE);
+        waiting = false;
+        if (answer[1] == 0) {
+            finished = true;
+            return false;
+        }
+        *chunkFrom = static_cast<size_t>(answer[0]);
+        *chunkCount = static_cast<size_t>(answer[1]);
+        // the next chunk is requested while this one is computed
+        if (prefetch) {
+            sendRequests();
+        }
+        return true;
+    }
+    serve();
+#endif
+    if (position < end) {
+        *chunkFrom = position;
+        *chunkCount = std::min(chunkSize, end - position);
+        position += *chunkCount;
+        return true;
+    }
+#ifdef HAVE_MPI
+    if (distributed && finishedWorkers < MMseqsMPI::numProc - 1) {
+        answerRequests(true);
+    }
+#endif
+    return false;
+}
+
+#ifdef HAVE_MPI
+void MPIScheduler::answerRequests(bool wait) {
+    while (finishedWorkers < MMseqsMPI::numProc - 1) {
+        MPI_Status status;
+        if (wait == false) {
+            int hasRequest = 0;
+            MPI_Iprobe(MPI_ANY_SOURCE, TAG_REQUEST, MPI_COMM_WORLD, &hasRequest, &status);
+            if (hasRequest == 0) {
+                return;
+            }
+        }
+        int worker;
+        MPI_Recv(&worker, 1, MPI_INT, wait ? MPI_ANY_SOURCE : status.MPI_SOURCE, TAG_REQUEST, MPI_COMM_WORLD, &status);
+        unsigned long long chunk[2] = { position, 0 };
+        if (position < end) {
+            chunk[1] = std::min(chunkSize, end - position);
+            position += chunk[1];
+        } else {
+            finishedWorkers++;
+        }
+        MPI_Send(chunk, 2, MPI_UNSIGNED_LONG_LONG, status.MPI_SOURCE, TAG_ANSWER, MPI_COMM_WORLD);
+    }
+}
+
+void MPIScheduler::sendRequests() {
+    MPI_Irecv(answer, 2, MPI_UNSIGNED_LONG_LONG, MMseqsMPI::MASTER, TAG_ANSWER, MPI_COMM_WORLD, &receiveRequest);
+    MPI_Isend(&request, 1, MPI_INT, MMseqsMPI::MASTER, TAG_REQUEST, MPI_COMM_WORLD, &sendRequest);
+    waiting = true;
+}
+#endif
+
+std::vector<size_t> MPIScheduler::gather(const std::vector<size_t> &values) {
+#ifdef HAVE_MPI
+    if (MMseqsMPI::active && MMseqsMPI::numProc > 1) {
+        std::vector<size_t> result;
+        if (MMseqsMPI::isMaster() == false) {
+            std::vector<unsigned long long> buffer(values.begin(), values.end());
+            MPI_Send(buffer.empty() ? NULL : &buffer[0], static_cast<int>(buffer.size()), MPI_UNSIGNED_LONG_LONG,
+                     MMseqsMPI::MASTER, TAG_GATHER, MPI_COMM_WORLD);
+            return result;
+        }
+        result = values;
+        for (int proc = 1; proc < MMseqsMPI::numProc; proc++) {
+            MPI_Status status;
+            MPI_Probe(proc, TAG_GATHER, MPI_COMM_WORLD, &status);
+            int count = 0;
+            MPI_Get_count(&status, MPI_UNSIGNED_LONG_LONG, &count);
+            std::vector<unsigned long long> buffer(count);
+            MPI_Recv(buffer.empty() ? NULL : &buffer[0], count, MPI_UNSIGNED_LONG_LONG, proc, TAG_GATHER, MPI_COMM_WORLD, &status);
+            result.insert(result.end(), buffer.begin(), buffer.end());
+        }
+        return result;
+    }
+#endif
+    return values;
+}
@@ -0,0 +1,68 @@
+#ifndef MMSEQS_MPISCHEDULER_H
+#define MMSEQS_MPISCHEDULER_H
+
+// Hands out chunks of a range of entries (queries, splits) to the MPI processes on demand.
+//
+// The master (rank 0) owns the range. Workers request their next chunk with a point-to-point
+// message. With prefetch they keep one request in flight while they compute, so they do not wait
+// for an answer between chunks. Large chunks like whole database splits should be handed out
+// without prefetch, otherwise a worker holds a split back that an idle process could compute.
+// The master computes chunks itself and answers the requests whenever it asks for its next chunk
+// or calls serve() from the thread that initialized MPI. Without MPI or with a single process,
+// the chunks are handed out in order.
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+#include "MMseqsMPI.h"
+
+class MPIScheduler {
+public:
+    MPIScheduler(size_t from, size_t size, size_t chunkSize, bool prefetch = true);
+
+    // next chunk of this process, false once the range is exhausted. On the master it returns
+    // false only after every worker was told that there is no work left.
+    bool next(size_t *chunkFrom, size_t *chunkSize);
+
+    // size of the chunks handed out from now on
+    void setChunkSize(size_t size) {
+        chunkSize = std::max(size, static_cast<size_t>(1));
+    }
+
+    // answers the pending requests of the workers, cheap if there is none
+    inline void serve() {
+#ifdef HAVE_MPI
+        if (distributed && MMseqsMPI::isMaster() && finishedWorkers < MMseqsMPI::numProc - 1) {
+            answerRequests(false);
+        }
+#endif
+    }
+
+    // collects the values of all processes on the master, workers get an empty list
+    static std::vector<size_t> gather(const std::vector<size_t> &values);
+
+private:
+    size_t position;
+    size_t end;
+    size_t chunkSize;
+    bool prefetch;
+    bool distributed;
+
+#ifdef HAVE_MPI
+    // master
+    int finishedWorkers;
+    void answerRequests(bool wait);
+
+    // worker
+    bool waiting;
+    bool finished;
+    int request;
+    unsigned long long answer[2];
+    MPI_Request sendRequest;
+    MPI_Request receiveRequest;
+    void sendRequests();
+#endif
+};
+
+#endif
@@ -0,0 +1,387 @@
+#include "Metrics.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+std::vector<Metrics::Report *> Metrics::reports;
+std::string Metrics::childrenFile;
+std::string Metrics::parentFile;
+
+namespace {
+struct Usage {
+    double wall;
+    double user;
+    double system;
+    long minorFaults;
+    long majorFaults;
+    size_t peakRss;
+    // bytes of read/write calls and bytes that went to storage, from /proc/self/io
+    size_t readBytes;
+    size_t writeBytes;
+    size_t storageReadBytes;
+    size_t storageWriteBytes;
+};
+
+struct PhaseTime {
+    std::string name;
+    size_t calls;
+    double wall;
+    double cpu;
+    long minorFaults;
+    long majorFaults;
+};
+
+double wallSeconds() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec + 1e-6 * now.tv_usec;
+}
+
+double toSeconds(const struct timeval &time) {
+    return time.tv_sec + 1e-6 * time.tv_usec;
+}
+
+Usage currentUsage(int who) {
+    Usage usage;
+    memset(&usage, 0, sizeof(Usage));
+    usage.wall = wallSeconds();
+    struct rusage resources;
+    if (getrusage(who, &resources) == 0) {
+        usage.user = toSeconds(resources.ru_utime);
+        usage.system = toSeconds(resources.ru_stime);
+        usage.minorFaults = resources.ru_minflt;
+        usage.majorFaults = resources.ru_majflt;
+        // kilobytes on Linux
+        usage.peakRss = static_cast<size_t>(resources.ru_maxrss) * 1024;
+    }
+    if (who != RUSAGE_SELF) {
+        return usage;
+    }
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    size_t value;
+    while (io >> key >> value) {
+        if (key == "rchar:") {
+            usage.readBytes = value;
+        } else if (key == "wchar:") {
+            usage.writeBytes = value;
+        } else if (key == "read_bytes:") {
+            usage.storageReadBytes = value;
+        } else if (key == "write_bytes:") {
+            usage.storageWriteBytes = value;
+        }
+    }
+    return usage;
+}
+
+std::string jsonString(const std::string &value) {
+    std::string out = "\"";
+    for (size_t i = 0; i < value.size(); i++) {
+        const unsigned char c = value[i];
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (c < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out.append(buffer);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+    return out;
+}
+
+std::string jsonNumber(double value) {
+    char buffer[64];
+    if (value == static_cast<double>(static_cast<long long>(value))) {
+        snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+    } else {
+        snprintf(buffer, sizeof(buffer), "%.6f", value);
+    }
+    return buffer;
+}
+
+void appendField(std::string &json, const char *name, double value) {
+    json.append(",\"").append(name).append("\":").append(jsonNumber(value));
+}
+
+// CPU time of every thread of the process, from /proc/self/task/<tid>/stat
+std::string threadTimes() {
+    std::string json = "[";
+    DIR *tasks = opendir("/proc/self/task");
+    if (tasks == NULL) {
+        return json + "]";
+    }
+    const double ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+    bool first = true;
+    struct dirent *entry;
+    while ((entry = readdir(tasks)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::ifstream statFile((std::string("/proc/self/task/") + entry->d_name + "/stat").c_str());
+        std::string stat;
+        std::getline(statFile, stat);
+        // the fields after the command name, starting with the state (field 3)
+        const size_t end = stat.rfind(')');
+        if (end == std::string::npos) {
+            continue;
+        }
+        std::vector<std::string> fields = Util::split(stat.substr(end + 2), " ");
+        if (fields.size() < 13) {
+            continue;
+        }
+        const double user = strtod(fields[11].c_str(), NULL) / ticks;
+        const double system = strtod(fields[12].c_str(), NULL) / ticks;
+        json.append(first ? "" : ",");
+        json.append("{\"tid\":").append(entry->d_name);
+        appendField(json, "userSeconds", user);
+        appendField(json, "systemSeconds", system);
+        json.append("}");
+        first = false;
+    }
+    closedir(tasks);
+    return json + "]";
+}
+
+void addTo(std::vector<std::pair<std::string, double> > &counters, const std::string &name, double value, bool set) {
+    for (size_t i = 0; i < counters.size(); i++) {
+        if (counters[i].first == name) {
+            counters[i].second = set ? value : counters[i].second + value;
+            return;
+        }
+    }
+    counters.push_back(std::make_pair(name, value));
+}
+}
+
+struct Metrics::Report {
+    std::string module;
+    std::vector<std::string> args;
+    Usage start;
+    Usage childrenStart;
+    std::vector<PhaseTime> phases;
+    std::vector<std::pair<std::string, double> > counters;
+    std::vector<std::string> children;
+
+    // adds the report of a child and sums up its counters, which come before its own children
+    void addChild(const std::string &json) {
+        children.push_back(json);
+        size_t pos = json.find("\"counters\":{");
+        if (pos == std::string::npos) {
+            return;
+        }
+        pos += strlen("\"counters\":{");
+        while (pos < json.size() && json[pos] == '"') {
+            const size_t end = json.find('"', pos + 1);
+            if (end == std::string::npos || end + 1 >= json.size() || json[end + 1] != ':') {
+                return;
+            }
+            const std::string name = json.substr(pos + 1, end - pos - 1);
+            char *next;
+            const double value = strtod(json.c_str() + end + 2, &next);
+            addTo(counters, name, value, false);
+            pos = next - json.c_str();
+            if (pos < json.size() && json[pos] == ',') {
+                pos++;
+            }
+        }
+    }
+
+    std::string toJson(int status, bool process) const {
+        const Usage end = currentUsage(RUSAGE_SELF);
+        const Usage childrenEnd = currentUsage(RUSAGE_CHILDREN);
+        std::string json = "{\"module\":" + jsonString(module) + ",\"args\":[";
+        for (size_t i = 0; i < args.size(); i++) {
+            json.append(i > 0 ? "," : "").append(jsonString(args[i]));
+        }
+        json.append("]");
+        appendField(json, "pid", getpid());
+        appendField(json, "status", status);
+        appendField(json, "wallSeconds", end.wall - start.wall);
+        appendField(json, "userSeconds", end.user - start.user);
+        appendField(json, "systemSeconds", end.system - start.system);
+        appendField(json, "peakRssBytes", end.peakRss);
+        appendField(json, "minorPageFaults", end.minorFaults - start.minorFaults);
+        appendField(json, "majorPageFaults", end.majorFaults - start.majorFaults);
+        appendField(json, "readBytes", end.readBytes - start.readBytes);
+        appendField(json, "writeBytes", end.writeBytes - start.writeBytes);
+        appendField(json, "storageReadBytes", end.storageReadBytes - start.storageReadBytes);
+        appendField(json, "storageWriteBytes", end.storageWriteBytes - start.storageWriteBytes);
+        if (process) {
+            // includes everything the workflow scripts run, not only mmseqs modules
+            appendField(json, "childrenUserSeconds", childrenEnd.user - childrenStart.user);
+            appendField(json, "childrenSystemSeconds", childrenEnd.system - childrenStart.system);
+            appendField(json, "childrenPeakRssBytes", childrenEnd.peakRss);
+            json.append(",\"threads\":").append(threadTimes());
+        }
+        json.append(",\"phases\":[");
+        for (size_t i = 0; i < phases.size(); i++) {
+            json.append(i > 0 ? "," : "").append("{\"name\":").append(jsonString(phases[i].name));
+            appendField(json, "calls", phases[i].calls);
+            appendField(json, "wallSeconds", phases[i].wall);
+            appendField(json, "cpuSeconds", phases[i].cpu);
+            appendField(json, "minorPageFaults", phases[i].minorFaults);
+            appendField(json, "majorPageFaults", phases[i].majorFaults);
+            json.append("}");
+        }
+        json.append("],\"counters\":{");
+        for (size_t i = 0; i < counters.size(); i++) {
+            json.append(i > 0 ? "," : "").append(jsonString(counters[i].first)).append(":").append(jsonNumber(counters[i].second));
+        }
+        json.append("},\"children\":[");
+        for (size_t i = 0; i < children.size(); i++) {
+            json.append(i > 0 ? "," : "").append(children[i]);
+        }
+        json.append("]}");
+        return json;
+    }
+};
+
+bool Metrics::isEnabled() {
+    return reports.empty() == false;
+}
+
+void Metrics::beginModule(const std::string &module, int argc, const char **argv) {
+    if (reports.empty()) {
+        const char *file = getenv("MMSEQS_METRICS");
+        if (file == NULL || *file == '\0') {
+            return;
+        }
+    }
+    Report *report = new Report;
+    report->module = module;
+    for (int i = 0; i < argc; i++) {
+        report->args.push_back(argv[i]);
+    }
+    report->start = currentUsage(RUSAGE_SELF);
+    report->childrenStart = currentUsage(RUSAGE_CHILDREN);
+    reports.push_back(report);
+}
+
+void Metrics::endModule(int status) {
+    if (reports.empty()) {
+        return;
+    }
+    Report *report = reports.back();
+    reports.pop_back();
+    const std::string json = report->toJson(status, reports.empty());
+    delete report;
+    if (reports.empty() == false) {
+        reports.back()->addChild(json);
+        return;
+    }
+
+    const char *file = getenv("MMSEQS_METRICS");
+    if (file == NULL) {
+        return;
+    }
+    const std::string line = json + "\n";
+    // a single appending write, modules of a workflow might finish at the same time
+    int fd = open(file, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd < 0 || write(fd, line.c_str(), line.size()) != static_cast<ssize_t>(line.size())) {
+        Debug(Debug::WARNING) << "Could not write performance report to " << file << "\n";
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void Metrics::beginChildren() {
+    if (reports.empty()) {
+        return;
+    }
+    const char *file = getenv("MMSEQS_METRICS");
+    parentFile = (file != NULL) ? file : "";
+    childrenFile = parentFile + "." + SSTR(getpid()) + ".children";
+    if (FileUtil::fileExists(childrenFile.c_str())) {
+        FileUtil::deleteFile(childrenFile);
+    }
+    setenv("MMSEQS_METRICS", childrenFile.c_str(), true);
+}
+
+void Metrics::endChildren() {
+    if (reports.empty() || childrenFile.empty()) {
+        return;
+    }
+    setenv("MMSEQS_METRICS", parentFile.c_str(), true);
+    if (FileUtil::fileExists(childrenFile.c_str()) == false) {
+        return;
+    }
+    std::ifstream children(childrenFile.c_str());
+    std::string line;
+    while (std::getline(children, line)) {
+        if (line.empty() == false) {
+            reports.back()->addChild(line);
+        }
+    }
+    children.close();
+    FileUtil::deleteFile(childrenFile);
+    childrenFile.clear();
+}
+
+void Metrics::addCounter(const std::string &name, double value) {
+    if (reports.empty()) {
+        return;
+    }
+#pragma omp critical(Metrics)
+    addTo(reports.back()->counters, name, value, false);
+}
+
+void Metrics::setCounter(const std::string &name, double value) {
+    if (reports.empty()) {
+        return;
+    }
+#pragma omp critical(Metrics)
+    addTo(reports.back()->counters, name, value, true);
+}
+
+Metrics::Phase::Phase(const char *name) : name(name), active(Metrics::isEnabled()) {
+    if (active == false) {
+        return;
+    }
+    struct rusage resources;
+    getrusage(RUSAGE_SELF, &resources);
+    wall = wallSeconds();
+    cpu = toSeconds(resources.ru_utime) + toSeconds(resources.ru_stime);
+    minorFaults = resources.ru_minflt;
+    majorFaults = resources.ru_majflt;
+}
+
+Metrics::Phase::~Phase() {
+    if (active == false || reports.empty()) {
+        return;
+    }
+    struct rusage resources;
+    getrusage(RUSAGE_SELF, &resources);
+    const double now = wallSeconds();
+#pragma omp critical(Metrics)
+    {
+        std::vector<PhaseTime> &phases = reports.back()->phases;
+        size_t i = 0;
+        while (i < phases.size() && phases[i].name != name) {
+            i++;
+        }
+        if (i == phases.size()) {
+            PhaseTime phase = {name, 0, 0.0, 0.0, 0, 0};
+            phases.push_back(phase);
+        }
+        phases[i].calls++;
+        phases[i].wall += now - wall;
+        phases[i].cpu += toSeconds(resources.ru_utime) + toSeconds(resources.ru_stime) - cpu;
+        phases[i].minorFaults += resources.ru_minflt - minorFaults;
+        phases[i].majorFaults += resources.ru_majflt - majorFaults;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef MMSEQS_METRICS_H
+#define MMSEQS_METRICS_H
+
+// Structured performance report of a module run.
+//
+// If the environment variable MMSEQS_METRICS names a file, every module appends one JSON object
+// in a single line to it when it finishes: wall and CPU time, peak RSS, page faults and I/O of the
+// process, the CPU time of each thread, the time of the phases the module marks and its counters.
+// A workflow runs its script as child process instead of replacing itself with it, lets the
+// modules of the script report into a side file and embeds their reports as "children" into its
+// own, with their counters summed up. Modules that a workflow runs in-process are nested the
+// same way.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class Metrics {
+public:
+    static bool isEnabled();
+
+    // starts the report of module, nested into the module that is running already
+    static void beginModule(const std::string &module, int argc, const char **argv);
+
+    // finishes the current module, the outermost one writes its report to the file
+    static void endModule(int status);
+
+    // child processes started between these calls report into the current module
+    static void beginChildren();
+    static void endChildren();
+
+    static void addCounter(const std::string &name, double value);
+    static void setCounter(const std::string &name, double value);
+
+    // times a phase of the current module until it goes out of scope,
+    // the calls of a phase with the same name are summed up
+    class Phase {
+    public:
+        Phase(const char *name);
+        ~Phase();
+
+    private:
+        const char *name;
+        bool active;
+        double wall;
+        double cpu;
+        long minorFaults;
+        long majorFaults;
+    };
+
+private:
+    struct Report;
+
+    static std::vector<Report *> reports;
+    static std::string childrenFile;
+    static std::string parentFile;
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include "Util.h"
 #include "DistanceCalculator.h"
 #include "Debug.h"
+#include "FileUtil.h"
 
 #include <iomanip>
 #include <regex.h>
@@ -64,6 +65,10 @@ Parameters::Parameters():
         PARAM_MIN_SEQ_ID(PARAM_MIN_SEQ_ID_ID,"--min-seq-id", "Seq. Id Threshold","list matches above this sequence identity (for clustering) [0.0,1.0]",typeid(float), (void *) &seqIdThr, "^0(\\.[0-9]+)?|1(\\.0+)?$", MMseqsParameter::COMMAND_ALIGN),
 	    PARAM_SCORE_BIAS(PARAM_SCORE_BIAS_ID,"--score-bias", "Score bias", "Score bias when computing the SW alignment (in bits)",typeid(float), (void *) &scoreBias, "^-?[0-9]*(\\.[0-9]+)?$", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
         PARAM_ALT_ALIGNMENT(PARAM_ALT_ALIGNMENT_ID,"--alt-ali", "Alternative alignments","Show up to this many alternative alignments",typeid(int), (void *) &altAlignment, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN),
+        PARAM_BAND_WIDTH(PARAM_BAND_WIDTH_ID,"--band-width", "Band width","0: full Smith-Waterman; >0: banded alignment around the prefilter diagonal with this initial band half-width, widened adaptively (protein only)",typeid(int), (void *) &bandWidth, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_UNGAPPED_PRESCORE(PARAM_UNGAPPED_PRESCORE_ID,"--ungapped-prescore", "Ungapped prescore","reject hits whose ungapped score on the prefilter diagonal does not reach the E-value threshold before computing the gapped alignment (protein targets from a precomputed index only)",typeid(bool), (void *) &ungappedPrescore, "", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_FAST_IDENTITY(PARAM_FAST_IDENTITY_ID,"--fast-identity", "Fast identity","reject pairs whose shared 4-mers can not reach --min-seq-id at the required coverage and accept pairs whose ungapped alignment on the prefilter diagonal passes all thresholds, both without gapped alignment (protein only)",typeid(bool), (void *) &fastIdentity, "", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_GREEDY_CLUSTERING(PARAM_GREEDY_CLUSTERING_ID,"--greedy-clustering", "Greedy clustering","align each sequence, from long to short, only with the longer representatives among its prefilter hits and write the greedy incremental clustering of clust --cluster-mode 2 instead of the alignments (same query and target database only)",typeid(bool), (void *) &greedyClustering, "", MMseqsParameter::COMMAND_ALIGN|MMseqsParameter::COMMAND_EXPERT),
         PARAM_GAP_OPEN(PARAM_GAP_OPEN_ID,"--gap-open", "Gap open cost","Gap open cost",typeid(int), (void *) &gapOpen, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN),
         PARAM_GAP_EXTEND(PARAM_GAP_EXTEND_ID,"--gap-extend", "Gap extension cost","Gap extension cost",typeid(int), (void *) &gapExtend, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN),
 
@@ -74,8 +79,15 @@ Parameters::Parameters():
         // affinity clustering
         PARAM_MAXITERATIONS(PARAM_MAXITERATIONS_ID,"--max-iterations", "Max depth connected component", "maximum depth of breadth first search in connected component",typeid(int), (void *) &maxIteration,  "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_CLUST|MMseqsParameter::COMMAND_EXPERT),
         PARAM_SIMILARITYSCORE(PARAM_SIMILARITYSCORE_ID,"--similarity-type", "Similarity type", "type of score used for clustering [1:2]. 1=alignment score. 2=sequence identity ",typeid(int),(void *) &similarityScoreType,  "^[1-2]{1}$", MMseqsParameter::COMMAND_CLUST|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_PARALLEL_SET_COVER(PARAM_PARALLEL_SET_COVER_ID,"--parallel-set-cover", "Parallel set cover", "select the representatives of cluster mode 0 in parallel rounds. The result does not depend on the number of threads, but can differ from the serial set cover",typeid(bool),(void *) &parallelSetCover, "", MMseqsParameter::COMMAND_CLUST|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_SET_COVER_EPS(PARAM_SET_COVER_EPS_ID,"--set-cover-eps", "Set cover epsilon", "parallel set cover selects all sets with size >= largest size / (1 + eps) in one round. 0 keeps the greedy order by size",typeid(float),(void *) &setCoverEps,  "^[0-9]*(\\.[0-9]+)?$", MMseqsParameter::COMMAND_CLUST|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_UNION_FIND(PARAM_UNION_FIND_ID,"--union-find", "Union find connected component", "compute cluster mode 1 with a parallel union find directly on the alignment database instead of the breadth first search. Needs no symmetric graph in memory, but ignores --max-iterations",typeid(bool),(void *) &unionFind, "", MMseqsParameter::COMMAND_CLUST|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_GRAPH_CACHE(PARAM_GRAPH_CACHE_ID,"--graph-cache", "Graph cache", "binary file with the symmetrized alignment graph. It is read if it exists and written otherwise, so clustering modes can be tried without parsing the alignment database again",typeid(std::string),(void *) &graphCache, "", MMseqsParameter::COMMAND_CLUST|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_CLUSTER_MEMORY_LIMIT(PARAM_CLUSTER_MEMORY_LIMIT_ID,"--cluster-memory-limit", "Cluster memory limit", "build the symmetrized alignment graph on disk within this many megabyte and cluster on the mapped file. The clustering itself still keeps a few arrays per sequence in memory. Defaults (0) to building the graph in memory",typeid(int),(void *) &clusterMemoryLimit, "^(0|[1-9]{1}[0-9]*)$", MMseqsParameter::COMMAND_CLUST|MMseqsParameter::COMMAND_EXPERT),
         // logging
         PARAM_V(PARAM_V_ID,"-v", "Verbosity","verbosity level: 0=nothing, 1: +errors, 2: +warnings, 3: +info",typeid(int), (void *) &verbosity, "^[0-3]{1}$", MMseqsParameter::COMMAND_COMMON),
+        PARAM_PERF_COUNTERS(PARAM_PERF_COUNTERS_ID,"--perf-counters", "Performance counters", "measure cycles, instructions, cache and TLB misses of the k-mer matching and alignment kernels with perf_event_open and print them per kernel and thread",typeid(bool), (void *) &perfCounters, "", MMseqsParameter::COMMAND_EXPERT),
+        PARAM_CHECKPOINT_INTERVAL(PARAM_CHECKPOINT_INTERVAL_ID,"--checkpoint-interval", "Checkpoint interval", "save the finished queries to disk every n seconds. A run that was interrupted resumes from the last checkpoint if it is started again with the same parameters (0: no checkpoints)",typeid(int), (void *) &checkpointInterval, "^(0|[1-9]{1}[0-9]*)$", MMseqsParameter::COMMAND_EXPERT),
         // create profile (HMM)
         PARAM_PROFILE_TYPE(PARAM_PROFILE_TYPE_ID,"--profile-type", "Profile type", "0: HMM (HHsuite) 1: PSSM or 2: HMMER3",typeid(int),(void *) &profileMode,  "^[0-2]{1}$"),
         // convertalignments
@@ -84,6 +96,7 @@ Parameters::Parameters():
         PARAM_DB_OUTPUT(PARAM_DB_OUTPUT_ID, "--db-output", "Database Output", "Output a result db instead of a text file", typeid(bool), (void*) &dbOut, ""),
         // rescorediagonal
         PARAM_RESCORE_MODE(PARAM_RESCORE_MODE_ID,"--rescore-mode", "Rescore mode", "Rescore diagonal with: 0: Hamming distance, 1: local alignment (score only) or 2: local alignment", typeid(int), (void *) &rescoreMode, "^[0-2]{1}$"),
+        PARAM_RESCORE_XDROP(PARAM_RESCORE_XDROP_ID,"--rescore-xdrop", "Rescore X-drop", "Stop the ungapped extension of rescore mode 1 and 2 once the score falls this far below the best score (0: scan the whole diagonal)", typeid(int), (void *) &rescoreXDrop, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_EXPERT),
         PARAM_FILTER_HITS(PARAM_FILTER_HITS_ID,"--filter-hits", "Remove hits by seq.id. and coverage", "filter hits by seq.id. and coverage", typeid(bool), (void *) &filterHits, "", MMseqsParameter::COMMAND_EXPERT),
         PARAM_GLOBAL_ALIGNMENT(PARAM_GLOBAL_ALIGNMENT_ID,"--global-alignment", "In substitution scoring mode, performs global alignment along the diagonal", "Rescore the complete diagonal", typeid(bool), (void *) &globalAlignment, "", MMseqsParameter::COMMAND_EXPERT),
         PARAM_SORT_RESULTS(PARAM_SORT_RESULTS_ID, "--sort-results", "Sort results", "Sort results: 0: no sorting, 1: sort by evalue (Alignment) or seq.id. (Hamming)", typeid(int), (void *) &sortResults, "^[0-1]{1}$", MMseqsParameter::COMMAND_EXPERT),
@@ -127,8 +140,13 @@ Parameters::Parameters():
         PARAM_INCLUDE_ONLY_EXTENDABLE(PARAM_INCLUDE_ONLY_EXTENDABLE_ID, "--include-only-extendable", "Include only extendable", "Include only extendable", typeid(bool), (void*) &includeOnlyExtendable, "", MMseqsParameter::COMMAND_CLUSTLINEAR),
         PARAM_SKIP_N_REPEAT_KMER(PARAM_SKIP_N_REPEAT_KMER_ID, "--skip-n-repeat-kmer", "Skip sequence with n repeating k-mers", "Skip sequence with >= n exact repeating k-mers", typeid(int), (void*) &skipNRepeatKmer, "^[0-9]{1}[0-9]*", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
         PARAM_HASH_SHIFT(PARAM_HASH_SHIFT_ID, "--hash-shift", "Shift hash", "Shift k-mer hash", typeid(int), (void*) &hashShift, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_KMER_SELECTION_MODE(PARAM_KMER_SELECTION_MODE_ID, "--kmer-selection-mode", "K-mer selection mode", "0: lowest hashes of all k-mers, 1: minimizers, 2: open syncmers. Mode 1 and 2 keep the lowest hashes of the selected k-mers. The minimizer window grows with the sequence length to leave about --kmer-per-seq k-mers", typeid(int), (void*) &kmerSelectionMode, "^[0-2]{1}$", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_COMPACT_KMER_TABLE(PARAM_COMPACT_KMER_TABLE_ID, "--compact-kmer-table", "Compact k-mer table", "Store k-mers in 12 instead of 16 bytes, sequence lengths are looked up in the database", typeid(bool), (void*) &compactKmerTable, "", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_KMER_TABLE_IN(PARAM_KMER_TABLE_IN_ID, "--kmer-table-in", "Input k-mer table", "Match the sequences against the representative k-mer table of a previous run instead of clustering them", typeid(std::string), (void*) &kmerTableIn, "", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
+        PARAM_KMER_TABLE_OUT(PARAM_KMER_TABLE_OUT_ID, "--kmer-table-out", "Output k-mer table", "Only write the representative k-mer table of the sequences (merged into --kmer-table-in if given), the result database stays empty", typeid(std::string), (void*) &kmerTableOut, "", MMseqsParameter::COMMAND_CLUSTLINEAR|MMseqsParameter::COMMAND_EXPERT),
         // workflow
         PARAM_RUNNER(PARAM_RUNNER_ID, "--mpi-runner", "Sets the MPI runner","use MPI on compute grid with this MPI command (e.g. \"mpirun -np 42\")",typeid(std::string),(void *) &runner, "", MMseqsParameter::COMMAND_EXPERT),
+        PARAM_IN_PROCESS(PARAM_IN_PROCESS_ID, "--in-process", "Run workflow in process","run the workflow steps in this process instead of a shell script that starts mmseqs for every step, prefilter and align share the open database and matrices",typeid(bool),(void *) &inProcess, "", MMseqsParameter::COMMAND_EXPERT),
         // search workflow
         PARAM_NUM_ITERATIONS(PARAM_NUM_ITERATIONS_ID, "--num-iterations", "Number search iterations","Search iterations",typeid(int),(void *) &numIterations, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_PROFILE),
         PARAM_START_SENS(PARAM_START_SENS_ID, "--start-sens", "Start sensitivity","start sensitivity",typeid(float),(void *) &startSens, "^[0-9]*(\\.[0-9]+)?$"),
@@ -136,6 +154,7 @@ Parameters::Parameters():
         PARAM_SLICE_SEARCH(PARAM_SLICE_SEARCH_ID, "--slice-search", "Run a seq-profile search in slice mode", "For bigger profile DB, run iteratively the search by greedily swapping the search results.", typeid(bool),(void *) &sliceSearch, ""),
         // easysearch
         PARAM_GREEDY_BEST_HITS(PARAM_GREEDY_BEST_HITS_ID, "--greedy-best-hits", "Greedy best hits", "Choose the best hits greedily to cover the query.", typeid(bool), (void*)&greedyBestHits, ""),
+        PARAM_STREAM_RESULTS(PARAM_STREAM_RESULTS_ID, "--stream-results", "Stream results", "hand the search results to the following modules through named pipes instead of writing them to the tmp folder. Each following module holds the full result in memory before it starts", typeid(bool), (void*)&streamResults, "", MMseqsParameter::COMMAND_EXPERT),
         // Orfs
         PARAM_ORF_MIN_LENGTH(PARAM_ORF_MIN_LENGTH_ID, "--min-length", "Min codons in orf", "minimum codon number in open reading frames",typeid(int),(void *) &orfMinLength, "^[1-9]{1}[0-9]*$"),
         PARAM_ORF_MAX_LENGTH(PARAM_ORF_MAX_LENGTH_ID, "--max-length", "Max codons in length", "maximum codon number in open reading frames",typeid(int),(void *) &orfMaxLength, "^[1-9]{1}[0-9]*$"),
@@ -204,6 +223,7 @@ Parameters::Parameters():
         // convertkb
         PARAM_KB_COLUMNS(PARAM_KB_COLUMNS_ID, "--kb-columns", "UniprotKB Columns", "list of indices of UniprotKB columns to be extracted", typeid(std::string), (void *) &kbColumns, ""),
         PARAM_RECOVER_DELETED(PARAM_RECOVER_DELETED_ID, "--recover-deleted", "Recover Deleted", "Indicates if sequences are allowed to be be removed during updating", typeid(bool), (void*) &recoverDeleted, ""),
+        PARAM_USE_KMER_TABLE(PARAM_USE_KMER_TABLE_ID, "--kmer-table", "Use k-mer table", "Assign new sequences to clusters through the representative k-mer table <i:oldClusteringDB>.kmertable of a previous update instead of a search, the search is used if it is missing. The table of the new clustering is written to <o:newClusteringDB>.kmertable", typeid(bool), (void*) &useKmerTable, ""),
         // lca
         PARAM_TAXON_LIST(PARAM_TAXON_LIST_ID, "--taxon-list", "Selected taxons", "taxonomy ID, possibly multiple separated by ','", typeid(std::string), (void*) &taxonList, ""),
         PARAM_INVERT_SELECTION(PARAM_INVERT_SELECTION_ID, "--invert", "Invert selection", "Invert selection", typeid(bool), (void*)&invertSelection, ""),
@@ -229,6 +249,10 @@ Parameters::Parameters():
     align.push_back(PARAM_MIN_SEQ_ID);
     align.push_back(PARAM_SEQ_ID_MODE);
     align.push_back(PARAM_ALT_ALIGNMENT);
+    align.push_back(PARAM_BAND_WIDTH);
+    align.push_back(PARAM_UNGAPPED_PRESCORE);
+    align.push_back(PARAM_FAST_IDENTITY);
+    align.push_back(PARAM_GREEDY_CLUSTERING);
     align.push_back(PARAM_C);
     align.push_back(PARAM_COV_MODE);
     align.push_back(PARAM_MAX_SEQ_LEN);
@@ -244,6 +268,8 @@ Parameters::Parameters():
     align.push_back(PARAM_SCORE_BIAS);
     align.push_back(PARAM_GAP_OPEN);
     align.push_back(PARAM_GAP_EXTEND);
+    align.push_back(PARAM_PERF_COUNTERS);
+    align.push_back(PARAM_CHECKPOINT_INTERVAL);
     align.push_back(PARAM_THREADS);
     align.push_back(PARAM_V);
 
@@ -272,6 +298,8 @@ Parameters::Parameters():
     prefilter.push_back(PARAM_PCA);
     prefilter.push_back(PARAM_PCB);
     prefilter.push_back(PARAM_SPACED_KMER_PATTERN);
+    prefilter.push_back(PARAM_PERF_COUNTERS);
+    prefilter.push_back(PARAM_CHECKPOINT_INTERVAL);
     prefilter.push_back(PARAM_THREADS);
     prefilter.push_back(PARAM_V);
 
@@ -289,6 +317,11 @@ Parameters::Parameters():
     clust.push_back(PARAM_CLUSTER_MODE);
     clust.push_back(PARAM_MAXITERATIONS);
     clust.push_back(PARAM_SIMILARITYSCORE);
+    clust.push_back(PARAM_PARALLEL_SET_COVER);
+    clust.push_back(PARAM_SET_COVER_EPS);
+    clust.push_back(PARAM_UNION_FIND);
+    clust.push_back(PARAM_GRAPH_CACHE);
+    clust.push_back(PARAM_CLUSTER_MEMORY_LIMIT);
     clust.push_back(PARAM_THREADS);
     clust.push_back(PARAM_V);
 
@@ -298,6 +331,7 @@ Parameters::Parameters():
     // rescorediagonal
     rescorediagonal.push_back(PARAM_SUB_MAT);
     rescorediagonal.push_back(PARAM_RESCORE_MODE);
+    rescorediagonal.push_back(PARAM_RESCORE_XDROP);
     rescorediagonal.push_back(PARAM_FILTER_HITS);
     rescorediagonal.push_back(PARAM_E);
     rescorediagonal.push_back(PARAM_C);
@@ -634,6 +668,10 @@ Parameters::Parameters():
     kmermatcher.push_back(PARAM_SPLIT_MEMORY_LIMIT);
     kmermatcher.push_back(PARAM_INCLUDE_ONLY_EXTENDABLE);
     kmermatcher.push_back(PARAM_SKIP_N_REPEAT_KMER);
+    kmermatcher.push_back(PARAM_KMER_SELECTION_MODE);
+    kmermatcher.push_back(PARAM_COMPACT_KMER_TABLE);
+    kmermatcher.push_back(PARAM_KMER_TABLE_IN);
+    kmermatcher.push_back(PARAM_KMER_TABLE_OUT);
     kmermatcher.push_back(PARAM_THREADS);
     kmermatcher.push_back(PARAM_V);
 
@@ -750,6 +788,7 @@ Parameters::Parameters():
     easysearchworkflow = combineList(searchworkflow, convertalignments);
     easysearchworkflow = combineList(easysearchworkflow, summarizeresult);
     easysearchworkflow.push_back(PARAM_GREEDY_BEST_HITS);
+    easysearchworkflow.push_back(PARAM_STREAM_RESULTS);
 
     // createindex workflow
     createindex = combineList(indexdb, extractorfs);
@@ -771,6 +810,7 @@ Parameters::Parameters():
     clusteringWorkflow.push_back(PARAM_CLUSTER_STEPS);
     clusteringWorkflow.push_back(PARAM_REMOVE_TMP_FILES);
     clusteringWorkflow.push_back(PARAM_RUNNER);
+    clusteringWorkflow.push_back(PARAM_IN_PROCESS);
     clusteringWorkflow = combineList(clusteringWorkflow, linclustworkflow);
 
     // taxonomy
@@ -793,6 +833,7 @@ Parameters::Parameters():
     clusterUpdate = combineList(clusterUpdateSearch, clusterUpdateClust);
     clusterUpdate.push_back(PARAM_USESEQID);
     clusterUpdate.push_back(PARAM_RECOVER_DELETED);
+    clusterUpdate.push_back(PARAM_USE_KMER_TABLE);
 
     mapworkflow = combineList(prefilter, rescorediagonal);
     mapworkflow = combineList(mapworkflow, extractorfs);
@@ -1245,6 +1286,7 @@ void Parameters::setDefaults() {
     sliceSearch = false;
 
     greedyBestHits = false;
+    streamResults = false;
 
     threads = 1;
 #ifdef OPENMP
@@ -1271,6 +1313,10 @@ void Parameters::setDefaults() {
     maxAccept   = INT_MAX;
     seqIdThr = 0.0;
     altAlignment = 0;
+    bandWidth = 0;
+    ungappedPrescore = false;
+    fastIdentity = false;
+    greedyClustering = false;
     gapOpen = 11;
     gapExtend = 1;
     addBacktrace = false;
@@ -1285,6 +1331,11 @@ void Parameters::setDefaults() {
     // affinity clustering
     maxIteration=1000;
     similarityScoreType=APC_SEQID;
+    parallelSetCover = false;
+    setCoverEps = 0.0;
+    unionFind = false;
+    graphCache = "";
+    clusterMemoryLimit = 0;
 
     // workflow
     const char *runnerEnv = getenv("RUNNER");
@@ -1293,6 +1344,7 @@ void Parameters::setDefaults() {
     } else {
         runner = "";
     }
+    inProcess = false;
 
     // Clustering workflow
     removeTmpFiles = false;
@@ -1351,6 +1403,8 @@ void Parameters::setDefaults() {
 
     // logging
     verbosity = Debug::INFO;
+    perfCounters = false;
+    checkpointInterval = 600;
 
     //extractorfs
     orfMinLength = 1;
@@ -1383,6 +1437,7 @@ void Parameters::setDefaults() {
 
     // rescorediagonal
     rescoreMode = Parameters::RESCORE_MODE_HAMMING;
+    rescoreXDrop = 0;
     filterHits = false;
     sortResults = false;
 
@@ -1431,11 +1486,18 @@ void Parameters::setDefaults() {
     // convertkb
     kbColumns = "";
 
+    // clusterupdate
+    useKmerTable = false;
+
     // linearcluster
     kmersPerSequence = 21;
     includeOnlyExtendable = false;
     skipNRepeatKmer = 0;
     hashShift = 5;
+    kmerSelectionMode = KMER_SELECTION_LOWEST_HASH;
+    compactKmerTable = false;
+    kmerTableIn = "";
+    kmerTableOut = "";
 
     // result2stats
     stat = "";
@@ -1486,7 +1548,7 @@ std::vector<MMseqsParameter> Parameters::combineList(const std::vector<MMseqsPar
     return retVec;
 }
 
-size_t Parameters::hashParameter(const std::vector<std::string> &filenames, const std::vector<MMseqsParameter> &par){
+size_t Parameters::hashParameter(const std::vector<std::string> &filenames, const std::vector<MMseqsParameter> &par) const {
     std::string hashString;
     hashString.reserve(1024);
     for (size_t i = 0; i < filenames.size(); ++i){
@@ -1501,7 +1563,31 @@ size_t Parameters::hashParameter(const std::vector<std::string> &filenames, cons
     return Util::hash(hashString.c_str(), hashString.size());
 }
 
-std::string Parameters::createParameterString(const std::vector<MMseqsParameter> &par, bool wasSet) {
+size_t Parameters::hashCheckpoint(const std::vector<MMseqsParameter> &par, const std::string &extra) const {
+    // a run with more threads or another verbosity can resume the same checkpoint
+    std::vector<MMseqsParameter> resultParameters;
+    for (size_t i = 0; i < par.size(); ++i) {
+        const int id = par[i].uniqid;
+        if (id == PARAM_THREADS_ID || id == PARAM_V_ID || id == PARAM_PERF_COUNTERS_ID
+            || id == PARAM_CHECKPOINT_INTERVAL_ID || id == PARAM_PRELOAD_MODE_ID) {
+            continue;
+        }
+        resultParameters.push_back(par[i]);
+    }
+    std::string hashString = SSTR(hashParameter(filenames, resultParameters));
+    // the last file name is the result database
+    for (size_t i = 0; i + 1 < filenames.size(); ++i) {
+        const std::string files[2] = { filenames[i], filenames[i] + ".index" };
+        for (size_t j = 0; j < 2; ++j) {
+            hashString.append(" ").append(SSTR(FileUtil::getFileSize(files[j])));
+            hashString.append(" ").append(SSTR(FileUtil::getModificationTime(files[j])));
+        }
+    }
+    hashString.append(extra);
+    return Util::hash(hashString.c_str(), hashString.size());
+}
+
+std::string Parameters::createParameterString(const std::vector<MMseqsParameter> &par, bool wasSet) const {
     std::ostringstream ss;
     for (size_t i = 0; i < par.size(); ++i) {
         // Never pass the MPI parameters along, they are passed by the environment
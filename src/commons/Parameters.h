@@ -146,6 +146,11 @@ public:
     static const int CLUST_LINEAR_DEFAULT_K = 0;
     static const int CLUST_LINEAR_KMER_PER_SEQ = 0;
 
+    // linclust k-mer selection
+    static const int KMER_SELECTION_LOWEST_HASH = 0;
+    static const int KMER_SELECTION_MINIMIZER = 1;
+    static const int KMER_SELECTION_SYNCMER = 2;
+
 
     // cov mode
     static const int COV_MODE_BIDIRECTIONAL  = 0;
@@ -214,6 +219,8 @@ public:
     size_t maxSeqLen;                    // sequence length
     size_t maxResListLen;                // Maximal result list length per query
     int    verbosity;                    // log level
+    bool   perfCounters;                 // measure hardware performance counters of the hot kernels
+    int    checkpointInterval;           // seconds between checkpoints of prefilter and align, 0 disables them
 //    int    querySeqType;                 // Query sequence type (PROFILE, AMINOACIDE, NUCLEOTIDE)
 //    int    targetSeqType;                // Target sequence type (PROFILE, AMINOACIDE, NUCLEOTIDE)
     int    threads;                      // Amounts of threads
@@ -255,6 +262,10 @@ public:
     int    maxRejected;                  // after n sequences that are above eval stop
     int    maxAccept;                    // after n accepted sequences stop
     int    altAlignment;                 // show up to this many alternative alignments
+    int    bandWidth;                    // initial half band width around the prefilter diagonal (0 = full SW)
+    bool   ungappedPrescore;             // reject hits by their ungapped diagonal score before the gapped alignment
+    bool   fastIdentity;                 // decide high seq. id. pairs by shared k-mers and ungapped alignment
+    bool   greedyClustering;             // cluster greedy incremental while aligning
     float  seqIdThr;                     // sequence identity threshold for acceptance
     bool   addBacktrace;                 // store backtrace string (M=Match, D=deletion, I=insertion)
     bool   realign;                      // realign hit with more conservative score
@@ -263,6 +274,7 @@ public:
 
     // workflow
     std::string runner;
+    bool inProcess;
 
     // CLUSTERING
     int    clusteringMode;
@@ -277,10 +289,16 @@ public:
 
     // easysearch
     bool greedyBestHits;
+    bool streamResults;
 
     //CLUSTERING
     int maxIteration;                   // Maximum depth of breadth first search in connected component
     int similarityScoreType;            // Type of score to use for reassignment 1=alignment score. 2=coverage 3=sequence identity 4=E-value 5= Score per Column
+    bool parallelSetCover;
+    float setCoverEps;
+    bool unionFind;
+    std::string graphCache;
+    int clusterMemoryLimit;
 
     //extractorfs
     int orfMinLength;
@@ -303,6 +321,7 @@ public:
 
     // rescorediagonal
     int rescoreMode;
+    int rescoreXDrop;
     bool filterHits;
     bool globalAlignment;
     int sortResults;
@@ -353,6 +372,10 @@ public:
     bool includeOnlyExtendable;
     int skipNRepeatKmer;
     int hashShift;
+    int kmerSelectionMode;
+    bool compactKmerTable;
+    std::string kmerTableIn;
+    std::string kmerTableOut;
 
     // indexdb
     bool includeHeader;
@@ -427,6 +450,7 @@ public:
 
     // clusterUpdate;
     bool recoverDeleted;
+    bool useKmerTable;
 
     // summarize headers
     int headerType;
@@ -514,6 +538,10 @@ public:
     PARAMETER(PARAM_MIN_SEQ_ID)
     PARAMETER(PARAM_SCORE_BIAS)
     PARAMETER(PARAM_ALT_ALIGNMENT)
+    PARAMETER(PARAM_BAND_WIDTH)
+    PARAMETER(PARAM_UNGAPPED_PRESCORE)
+    PARAMETER(PARAM_FAST_IDENTITY)
+    PARAMETER(PARAM_GREEDY_CLUSTERING)
     PARAMETER(PARAM_GAP_OPEN)
     PARAMETER(PARAM_GAP_EXTEND)
     std::vector<MMseqsParameter> align;
@@ -526,9 +554,16 @@ public:
     // affinity clustering
     PARAMETER(PARAM_MAXITERATIONS)
     PARAMETER(PARAM_SIMILARITYSCORE)
+    PARAMETER(PARAM_PARALLEL_SET_COVER)
+    PARAMETER(PARAM_SET_COVER_EPS)
+    PARAMETER(PARAM_UNION_FIND)
+    PARAMETER(PARAM_GRAPH_CACHE)
+    PARAMETER(PARAM_CLUSTER_MEMORY_LIMIT)
 
     // logging
     PARAMETER(PARAM_V)
+    PARAMETER(PARAM_PERF_COUNTERS)
+    PARAMETER(PARAM_CHECKPOINT_INTERVAL)
     std::vector<MMseqsParameter> clust;
 
     // create profile (HMM, PSSM)
@@ -541,6 +576,7 @@ public:
 
     // rescoremode
     PARAMETER(PARAM_RESCORE_MODE)
+    PARAMETER(PARAM_RESCORE_XDROP)
     PARAMETER(PARAM_FILTER_HITS)
     PARAMETER(PARAM_GLOBAL_ALIGNMENT)
     PARAMETER(PARAM_SORT_RESULTS)
@@ -591,9 +627,14 @@ public:
     PARAMETER(PARAM_INCLUDE_ONLY_EXTENDABLE)
     PARAMETER(PARAM_SKIP_N_REPEAT_KMER)
     PARAMETER(PARAM_HASH_SHIFT)
+    PARAMETER(PARAM_KMER_SELECTION_MODE)
+    PARAMETER(PARAM_COMPACT_KMER_TABLE)
+    PARAMETER(PARAM_KMER_TABLE_IN)
+    PARAMETER(PARAM_KMER_TABLE_OUT)
 
     // workflow
     PARAMETER(PARAM_RUNNER)
+    PARAMETER(PARAM_IN_PROCESS)
 
     // search workflow
     PARAMETER(PARAM_NUM_ITERATIONS)
@@ -603,6 +644,7 @@ public:
 
     // easysearch
     PARAMETER(PARAM_GREEDY_BEST_HITS)
+    PARAMETER(PARAM_STREAM_RESULTS)
 
     // extractorfs
     PARAMETER(PARAM_ORF_MIN_LENGTH)
@@ -691,6 +733,7 @@ public:
 
     // clusterupdate
     PARAMETER(PARAM_RECOVER_DELETED)
+    PARAMETER(PARAM_USE_KMER_TABLE)
 
     // filtertaxdb
     PARAMETER(PARAM_TAXON_LIST)
@@ -776,9 +819,13 @@ public:
     std::vector<MMseqsParameter> combineList(const std::vector<MMseqsParameter> &par1,
                                              const std::vector<MMseqsParameter> &par2);
 
-    size_t hashParameter(const std::vector<std::string> &filenames, const std::vector<MMseqsParameter> &par);
+    size_t hashParameter(const std::vector<std::string> &filenames, const std::vector<MMseqsParameter> &par) const;
+
+    // identifies the run of a module a checkpoint belongs to, parameters that do not change the result are left out.
+    // The size and modification time of the input databases are included, so a rebuilt input starts a new run
+    size_t hashCheckpoint(const std::vector<MMseqsParameter> &par, const std::string &extra = "") const;
 
-    std::string createParameterString(const std::vector<MMseqsParameter> &vector, bool wasSet = false);
+    std::string createParameterString(const std::vector<MMseqsParameter> &vector, bool wasSet = false) const;
 
     void overrideParameterDescription(Command& command, int uid, const char* description, const char* regex = NULL, int category = 0);
 
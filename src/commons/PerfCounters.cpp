@@ -0,0 +1,247 @@
+#include "PerfCounters.h"
+#include "Metrics.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+bool PerfCounters::enabled = false;
+
+static const char *REGION_NAMES[PerfCounters::REGION_COUNT] = {
+        "index table fill", "query match", "diagonal counting", "ungapped alignment", "Smith-Waterman"
+};
+static const char *REGION_KEYS[PerfCounters::REGION_COUNT] = {
+        "indexTableFill", "queryMatch", "diagonalCounting", "ungappedAlignment", "smithWaterman"
+};
+static const char *EVENT_KEYS[PerfCounters::EVENT_COUNT] = {
+        "cycles", "instructions", "llcMisses", "dtlbMisses", "taskClockNs"
+};
+
+struct PerfThread {
+    int thread;
+    // group leader, -1 if no event could be opened
+    int fd;
+    size_t eventCount;
+    // event of each value in the group read
+    int events[PerfCounters::EVENT_COUNT];
+    int depth[PerfCounters::REGION_COUNT];
+    size_t calls[PerfCounters::REGION_COUNT];
+    uint64_t counts[PerfCounters::REGION_COUNT][PerfCounters::EVENT_COUNT];
+};
+
+static std::vector<PerfThread *> perfThreads;
+static bool eventAvailable[PerfCounters::EVENT_COUNT];
+static __thread PerfThread *localThread = NULL;
+
+#ifdef __linux__
+static int openEvent(int event, int groupFd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    switch (event) {
+        case PerfCounters::CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfCounters::INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfCounters::LLC_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PerfCounters::DTLB_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        default:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_TASK_CLOCK;
+            break;
+    }
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // user space only, allowed with the default perf_event_paranoid setting
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // the calling thread on any CPU
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+#endif
+
+static PerfThread *threadCounters() {
+    if (localThread != NULL) {
+        return localThread;
+    }
+    PerfThread *thread = new PerfThread;
+    memset(thread, 0, sizeof(PerfThread));
+    thread->fd = -1;
+#ifdef OPENMP
+    thread->thread = omp_get_thread_num();
+#endif
+#ifdef __linux__
+    // hardware events first, the first event that can be opened leads the group
+    for (int event = 0; event < PerfCounters::EVENT_COUNT; event++) {
+        int fd = openEvent(event, thread->fd);
+        if (fd < 0) {
+            continue;
+        }
+        if (thread->fd < 0) {
+            thread->fd = fd;
+        }
+        thread->events[thread->eventCount++] = event;
+    }
+#endif
+#pragma omp critical(PerfCounters)
+    {
+        perfThreads.push_back(thread);
+        for (size_t i = 0; i < thread->eventCount; i++) {
+            eventAvailable[thread->events[i]] = true;
+        }
+    }
+    localThread = thread;
+    return thread;
+}
+
+static bool readCounts(const PerfThread *thread, uint64_t *counts) {
+    uint64_t buffer[3 + PerfCounters::EVENT_COUNT];
+    const ssize_t size = read(thread->fd, buffer, sizeof(buffer));
+    if (size < static_cast<ssize_t>((3 + thread->eventCount) * sizeof(uint64_t))) {
+        return false;
+    }
+    // the group was multiplexed with other counters for part of the time
+    const double scale = (buffer[2] > 0 && buffer[2] < buffer[1]) ? static_cast<double>(buffer[1]) / buffer[2] : 1.0;
+    for (size_t i = 0; i < thread->eventCount; i++) {
+        counts[thread->events[i]] = static_cast<uint64_t>(buffer[3 + i] * scale);
+    }
+    return true;
+}
+
+void PerfCounters::init(bool enable) {
+    enabled = false;
+    if (enable == false) {
+        return;
+    }
+#ifdef __linux__
+    if (threadCounters()->fd < 0) {
+        Debug(Debug::WARNING) << "Performance counters are not available, check /proc/sys/kernel/perf_event_paranoid\n";
+        return;
+    }
+    if (eventAvailable[CYCLES] == false) {
+        Debug(Debug::WARNING) << "Hardware performance counters are not available, only the CPU time is measured\n";
+    }
+    enabled = true;
+#else
+    Debug(Debug::WARNING) << "Performance counters are only supported on Linux\n";
+#endif
+}
+
+void PerfCounters::Scope::begin() {
+    thread = threadCounters();
+    if (thread->fd < 0) {
+        thread = NULL;
+        return;
+    }
+    outermost = thread->depth[region]++ == 0;
+    if (outermost) {
+        memset(start, 0, sizeof(start));
+        readCounts(thread, start);
+    }
+}
+
+void PerfCounters::Scope::end() {
+    thread->depth[region]--;
+    if (outermost == false) {
+        return;
+    }
+    uint64_t now[EVENT_COUNT];
+    memset(now, 0, sizeof(now));
+    if (readCounts(thread, now) == false) {
+        return;
+    }
+    thread->calls[region]++;
+    for (int event = 0; event < EVENT_COUNT; event++) {
+        thread->counts[region][event] += now[event] - start[event];
+    }
+}
+
+static std::string countsLine(const std::string &region, const std::string &thread, size_t calls, const uint64_t *counts) {
+    std::ostringstream line;
+    line << std::left << std::setw(20) << region << std::right << std::setw(7) << thread << std::setw(12) << calls;
+    for (int event = 0; event < PerfCounters::EVENT_COUNT; event++) {
+        if (event == PerfCounters::LLC_MISSES) {
+            // instructions per cycle
+            if (eventAvailable[PerfCounters::CYCLES] && eventAvailable[PerfCounters::INSTRUCTIONS] && counts[PerfCounters::CYCLES] > 0) {
+                line << std::setw(7) << std::fixed << std::setprecision(2)
+                     << static_cast<double>(counts[PerfCounters::INSTRUCTIONS]) / counts[PerfCounters::CYCLES];
+            } else {
+                line << std::setw(7) << "n/a";
+            }
+        }
+        if (event == PerfCounters::TASK_CLOCK) {
+            line << std::setw(12) << std::fixed << std::setprecision(3) << counts[event] / 1e9;
+        } else if (eventAvailable[event]) {
+            line << std::setw(16) << counts[event];
+        } else {
+            line << std::setw(16) << "n/a";
+        }
+    }
+    return line.str();
+}
+
+void PerfCounters::print() {
+    if (enabled == false) {
+        return;
+    }
+    Debug(Debug::INFO) << "\nPerformance counters (nested regions are included):\n";
+    std::ostringstream header;
+    header << std::left << std::setw(20) << "region" << std::right << std::setw(7) << "thread" << std::setw(12) << "calls"
+           << std::setw(16) << "cycles" << std::setw(16) << "instructions" << std::setw(7) << "IPC"
+           << std::setw(16) << "LLC misses" << std::setw(16) << "dTLB misses" << std::setw(12) << "CPU s";
+    Debug(Debug::INFO) << header.str() << "\n";
+    for (int region = 0; region < REGION_COUNT; region++) {
+        size_t calls = 0;
+        uint64_t total[EVENT_COUNT];
+        memset(total, 0, sizeof(total));
+        for (size_t i = 0; i < perfThreads.size(); i++) {
+            calls += perfThreads[i]->calls[region];
+            for (int event = 0; event < EVENT_COUNT; event++) {
+                total[event] += perfThreads[i]->counts[region][event];
+            }
+        }
+        if (calls == 0) {
+            continue;
+        }
+        Debug(Debug::INFO) << countsLine(REGION_NAMES[region], "all", calls, total) << "\n";
+        for (size_t i = 0; perfThreads.size() > 1 && i < perfThreads.size(); i++) {
+            if (perfThreads[i]->calls[region] > 0) {
+                Debug(Debug::INFO) << countsLine("", SSTR(perfThreads[i]->thread), perfThreads[i]->calls[region],
+                                                 perfThreads[i]->counts[region]) << "\n";
+            }
+        }
+        for (int event = 0; event < EVENT_COUNT; event++) {
+            if (eventAvailable[event]) {
+                Metrics::addCounter(std::string("perf.") + REGION_KEYS[region] + "." + EVENT_KEYS[event], total[event]);
+            }
+        }
+    }
+    // a workflow running modules in-process prints each module on its own
+    for (size_t i = 0; i < perfThreads.size(); i++) {
+        memset(perfThreads[i]->calls, 0, sizeof(perfThreads[i]->calls));
+        memset(perfThreads[i]->counts, 0, sizeof(perfThreads[i]->counts));
+    }
+}
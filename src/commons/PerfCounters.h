@@ -0,0 +1,75 @@
+#ifndef MMSEQS_PERFCOUNTERS_H
+#define MMSEQS_PERFCOUNTERS_H
+
+// Hardware performance counters of the hot kernels, enabled with --perf-counters.
+//
+// Every thread opens one Linux perf_event_open counter group the first time it enters a region and
+// reads it at the begin and end of the region. Cycles, instructions, last level cache and dTLB
+// misses are summed per region and thread. Regions can be nested, the counts of a region include
+// the regions called from it, a region nested into itself is counted once. Events the kernel or
+// the machine does not provide are left out, the CPU time of the regions is always measured.
+// Disabled, a region costs one branch.
+
+#include <cstddef>
+#include <stdint.h>
+
+struct PerfThread;
+
+class PerfCounters {
+public:
+    enum Region {
+        INDEX_TABLE_FILL,
+        QUERY_MATCH,
+        DIAGONAL_COUNTING,
+        UNGAPPED_ALIGNMENT,
+        SMITH_WATERMAN,
+        REGION_COUNT
+    };
+
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        DTLB_MISSES,
+        TASK_CLOCK,
+        EVENT_COUNT
+    };
+
+    static void init(bool enable);
+
+    static inline bool isEnabled() {
+        return enabled;
+    }
+
+    // prints the counts per region and thread and adds them to the performance report
+    static void print();
+
+    class Scope {
+    public:
+        Scope(Region region) : region(region), thread(NULL) {
+            if (__builtin_expect(enabled, 0)) {
+                begin();
+            }
+        }
+
+        ~Scope() {
+            if (__builtin_expect(thread != NULL, 0)) {
+                end();
+            }
+        }
+
+    private:
+        Region region;
+        PerfThread *thread;
+        bool outermost;
+        uint64_t start[EVENT_COUNT];
+
+        void begin();
+        void end();
+    };
+
+private:
+    static bool enabled;
+};
+
+#endif
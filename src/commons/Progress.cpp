@@ -0,0 +1,183 @@
+#include "Progress.h"
+#include "Debug.h"
+#include "Util.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <sys/time.h>
+#include <unistd.h>
+
+static double wallSeconds() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return now.tv_sec + 1e-6 * now.tv_usec;
+}
+
+static std::string formatCount(double value, const char *unit) {
+    const char *prefixes[] = {"", "K", "M", "G", "T"};
+    size_t prefix = 0;
+    while (value >= 1000.0 && prefix < 4) {
+        value /= 1000.0;
+        prefix++;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(prefix == 0 ? 0 : 1) << value << prefixes[prefix] << unit;
+    return ss.str();
+}
+
+static std::string formatDuration(double seconds) {
+    const size_t sec = static_cast<size_t>(seconds);
+    std::ostringstream ss;
+    ss << (sec / 3600) << "h " << (sec % 3600 / 60) << "m " << (sec % 60) << "s";
+    return ss.str();
+}
+
+Progress::Progress(const std::string &name, size_t totalEntries)
+        : name(name), totalEntries(totalEntries), counters(NULL), threadCount(1),
+          terminal(false), interval(60), start(wallSeconds()), lastLine(start), stopped(false) {
+    const char *file = getenv("MMSEQS_PROGRESS_FILE");
+    if (file != NULL) {
+        statusFile = file;
+    }
+    if (Debug::debugLevel < Debug::INFO && statusFile.empty()) {
+        return;
+    }
+    terminal = isatty(fileno(stdout)) != 0;
+    const char *seconds = getenv("MMSEQS_PROGRESS_INTERVAL");
+    if (seconds != NULL) {
+        interval = atoi(seconds);
+    }
+
+#ifdef OPENMP
+    threadCount = static_cast<unsigned int>(std::max(omp_get_max_threads(), 1));
+#endif
+    counters = static_cast<Counter *>(mem_align(64, threadCount * sizeof(Counter)));
+    memset(counters, 0, threadCount * sizeof(Counter));
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&wakeup, NULL);
+    if (pthread_create(&timer, NULL, run, this) != 0) {
+        Debug(Debug::WARNING) << "Could not start the progress reporter: " << strerror(errno) << "\n";
+        pthread_cond_destroy(&wakeup);
+        pthread_mutex_destroy(&mutex);
+        free(counters);
+        counters = NULL;
+    }
+}
+
+Progress::~Progress() {
+    finish();
+}
+
+void Progress::finish() {
+    if (counters == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&mutex);
+    stopped = true;
+    pthread_cond_signal(&wakeup);
+    pthread_mutex_unlock(&mutex);
+    pthread_join(timer, NULL);
+    report(true);
+
+    pthread_cond_destroy(&wakeup);
+    pthread_mutex_destroy(&mutex);
+    free(counters);
+    counters = NULL;
+}
+
+void *Progress::run(void *data) {
+    Progress *progress = static_cast<Progress *>(data);
+    pthread_mutex_lock(&progress->mutex);
+    while (progress->stopped == false) {
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        struct timespec timeout;
+        timeout.tv_sec = now.tv_sec + 1;
+        timeout.tv_nsec = now.tv_usec * 1000;
+        pthread_cond_timedwait(&progress->wakeup, &progress->mutex, &timeout);
+        if (progress->stopped == false) {
+            progress->report(false);
+        }
+    }
+    pthread_mutex_unlock(&progress->mutex);
+    return NULL;
+}
+
+void Progress::report(bool finished) {
+    size_t entries = 0;
+    size_t residues = 0;
+    for (unsigned int i = 0; i < threadCount; i++) {
+        entries += __atomic_load_n(&counters[i].entries, __ATOMIC_RELAXED);
+        residues += __atomic_load_n(&counters[i].residues, __ATOMIC_RELAXED);
+    }
+    const double now = wallSeconds();
+    const double elapsed = std::max(now - start, 1e-6);
+    const double entryRate = entries / elapsed;
+    const double residueRate = residues / elapsed;
+    const double eta = (finished == false && entries > 0 && entries < totalEntries) ? (totalEntries - entries) / entryRate : 0.0;
+    const size_t rss = Util::getResidentMemory();
+
+    if (statusFile.empty() == false) {
+        std::ostringstream json;
+        json << std::fixed << std::setprecision(3)
+             << "{\"name\":\"" << name << "\",\"pid\":" << getpid()
+             << ",\"state\":\"" << (finished ? "finished" : "running") << "\""
+             << ",\"entries\":" << entries << ",\"totalEntries\":" << totalEntries << ",\"residues\":" << residues
+             << ",\"elapsedSeconds\":" << elapsed << ",\"entriesPerSecond\":" << entryRate
+             << ",\"residuesPerSecond\":" << residueRate << ",\"etaSeconds\":" << eta
+             << ",\"rssBytes\":" << rss << ",\"updated\":" << static_cast<long>(time(NULL)) << "}\n";
+        // replaced atomically, a reader never sees a partial file
+        const std::string tmpFile = statusFile + "." + SSTR(getpid()) + ".tmp";
+        FILE *file = fopen(tmpFile.c_str(), "w");
+        if (file != NULL) {
+            const std::string content = json.str();
+            const bool written = fwrite(content.c_str(), 1, content.size(), file) == content.size();
+            if (fclose(file) == 0 && written) {
+                rename(tmpFile.c_str(), statusFile.c_str());
+            } else {
+                unlink(tmpFile.c_str());
+            }
+        }
+    }
+
+    if (Debug::debugLevel < Debug::INFO) {
+        return;
+    }
+    std::ostringstream line;
+    const double percent = totalEntries > 0 ? 100.0 * entries / totalEntries : 100.0;
+    if (terminal) {
+        line << "\r" << name << ": " << entries << "/" << totalEntries
+             << " (" << std::fixed << std::setprecision(1) << percent << "%) "
+             << formatCount(entryRate, " entries/s");
+        if (residues > 0) {
+            line << " " << formatCount(residueRate, " residues/s");
+        }
+        if (finished) {
+            line << " in " << formatDuration(elapsed);
+        } else {
+            line << " ETA " << formatDuration(eta);
+        }
+        line << " RSS " << Util::formatBytes(rss) << "\033[K";
+        if (finished) {
+            line << "\n";
+        }
+    } else if (finished || (interval > 0 && now - lastLine >= interval)) {
+        lastLine = now;
+        line << std::fixed << std::setprecision(1)
+             << "progress name=" << name << " state=" << (finished ? "finished" : "running")
+             << " entries=" << entries << " total=" << totalEntries << " percent=" << percent
+             << " entriesPerSecond=" << entryRate << " residuesPerSecond=" << residueRate
+             << " etaSeconds=" << eta << " elapsedSeconds=" << elapsed << " rssBytes=" << rss << "\n";
+    } else {
+        return;
+    }
+    Debug(Debug::INFO) << line.str();
+}
@@ -0,0 +1,69 @@
+#ifndef MMSEQS_PROGRESS_H
+#define MMSEQS_PROGRESS_H
+
+// Live progress of the main parallel loop of a module.
+//
+// Every thread counts the entries and residues it finished in its own cache line, a timer thread
+// sums them up once per second and reports entries/s, residues/s, the ETA and the resident memory.
+// On a terminal the report is updated in place, otherwise a line is printed every
+// MMSEQS_PROGRESS_INTERVAL seconds (default 60). If MMSEQS_PROGRESS_FILE names a file, the current
+// state is written to it as JSON object on every tick, so a scheduler can poll it.
+
+#include <cstddef>
+#include <string>
+#include <pthread.h>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+class Progress {
+public:
+    Progress(const std::string &name, size_t totalEntries);
+    ~Progress();
+
+    // stops the reporting and prints the final rates, called by the destructor if not before
+    void finish();
+
+    // called by the thread that works on the entries
+    inline void update(size_t entries, size_t residues) {
+        if (counters == NULL) {
+            return;
+        }
+        unsigned int thread = 0;
+#ifdef OPENMP
+        thread = static_cast<unsigned int>(omp_get_thread_num()) % threadCount;
+#endif
+        // only contended if a nested team has more threads than the outer one
+        __atomic_fetch_add(&counters[thread].entries, entries, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&counters[thread].residues, residues, __ATOMIC_RELAXED);
+    }
+
+private:
+    struct Counter {
+        size_t entries;
+        size_t residues;
+        char padding[64 - 2 * sizeof(size_t)];
+    };
+
+    std::string name;
+    size_t totalEntries;
+    Counter *counters;
+    unsigned int threadCount;
+
+    bool terminal;
+    int interval;
+    std::string statusFile;
+    double start;
+    double lastLine;
+
+    pthread_t timer;
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+    bool stopped;
+
+    static void *run(void *progress);
+    void report(bool finished);
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef MMSEQS_RADIXSORT_H
+#define MMSEQS_RADIXSORT_H
+
+// In-place MSD radix sort (American flag sort) on composite keys.
+//
+// The key of an element is a sequence of keyLength bytes, most significant byte first,
+// returned by keyByte(element, level). Elements with equal keys have to compare equal with cmp,
+// which is only used to finish small buckets.
+// The first non constant byte level is distributed with a parallel histogram and the resulting
+// 256 buckets are sorted independently by all OpenMP threads. No scratch memory is needed.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+namespace RadixSort {
+    const size_t BUCKETS = 256;
+    const size_t SMALL_BUCKET = 64;
+
+    template <typename T, typename KeyByte>
+    void histogram(const T *data, size_t n, const KeyByte &keyByte, unsigned int level, size_t *counts) {
+        memset(counts, 0, sizeof(size_t) * BUCKETS);
+        for (size_t i = 0; i < n; i++) {
+            counts[keyByte(data[i], level)]++;
+        }
+    }
+
+    // permutes data into the buckets of the given byte level, bucketStart gets BUCKETS + 1 offsets
+    template <typename T, typename KeyByte>
+    void distribute(T *data, const size_t *counts, const KeyByte &keyByte, unsigned int level, size_t *bucketStart) {
+        size_t heads[BUCKETS];
+        size_t tails[BUCKETS];
+        size_t offset = 0;
+        for (size_t b = 0; b < BUCKETS; b++) {
+            bucketStart[b] = offset;
+            heads[b] = offset;
+            offset += counts[b];
+            tails[b] = offset;
+        }
+        bucketStart[BUCKETS] = offset;
+        for (size_t b = 0; b < BUCKETS; b++) {
+            while (heads[b] < tails[b]) {
+                T value = data[heads[b]];
+                size_t target = keyByte(value, level);
+                // follow the cycle until an element for bucket b comes back
+                while (target != b) {
+                    std::swap(value, data[heads[target]++]);
+                    target = keyByte(value, level);
+                }
+                data[heads[b]++] = value;
+            }
+        }
+    }
+
+    template <typename T, typename KeyByte, typename Compare>
+    void sortSequential(T *data, size_t n, const KeyByte &keyByte, unsigned int level, unsigned int keyLength,
+                        Compare cmp) {
+        size_t counts[BUCKETS];
+        while (level < keyLength) {
+            if (n <= SMALL_BUCKET) {
+                std::sort(data, data + n, cmp);
+                return;
+            }
+            histogram(data, n, keyByte, level, counts);
+            // skip levels on which all elements agree
+            if (counts[keyByte(data[0], level)] == n) {
+                level++;
+                continue;
+            }
+            size_t bucketStart[BUCKETS + 1];
+            distribute(data, counts, keyByte, level, bucketStart);
+            for (size_t b = 0; b < BUCKETS; b++) {
+                const size_t size = bucketStart[b + 1] - bucketStart[b];
+                if (size > 1) {
+                    sortSequential(data + bucketStart[b], size, keyByte, level + 1, keyLength, cmp);
+                }
+            }
+            return;
+        }
+    }
+
+    template <typename T, typename KeyByte, typename Compare>
+    void sort(T *data, size_t n, const KeyByte &keyByte, unsigned int keyLength, Compare cmp) {
+        if (n <= SMALL_BUCKET) {
+            std::sort(data, data + n, cmp);
+            return;
+        }
+        unsigned int level = 0;
+        size_t counts[BUCKETS];
+        while (level < keyLength) {
+            memset(counts, 0, sizeof(size_t) * BUCKETS);
+#pragma omp parallel
+            {
+                size_t localCounts[BUCKETS];
+                memset(localCounts, 0, sizeof(size_t) * BUCKETS);
+#pragma omp for schedule(static)
+                for (size_t i = 0; i < n; i++) {
+                    localCounts[keyByte(data[i], level)]++;
+                }
+#pragma omp critical
+                {
+                    for (size_t b = 0; b < BUCKETS; b++) {
+                        counts[b] += localCounts[b];
+                    }
+                }
+            }
+            if (counts[keyByte(data[0], level)] != n) {
+                break;
+            }
+            level++;
+        }
+        if (level == keyLength) {
+            return;
+        }
+
+        size_t bucketStart[BUCKETS + 1];
+        distribute(data, counts, keyByte, level, bucketStart);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t b = 0; b < BUCKETS; b++) {
+            const size_t size = bucketStart[b + 1] - bucketStart[b];
+            if (size > 1) {
+                sortSequential(data + bucketStart[b], size, keyByte, level + 1, keyLength, cmp);
+            }
+        }
+    }
+}
+
+#endif
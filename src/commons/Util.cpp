@@ -15,6 +15,8 @@
 #include <sys/sysctl.h>
 #endif
 
+#include <cctype>
+#include <iomanip>
 #include <fstream>
 #include <algorithm>
 #include "MemoryMapped.h"
@@ -405,16 +407,142 @@ size_t Util::getTotalMemoryPages() {
     return phys_pages;
 }
 
+struct CgroupMemory {
+    size_t limit;
+    size_t usage;
+    // page cache that is reclaimed before the cgroup runs out of memory
+    size_t reclaimable;
+};
+
+static bool readSize(const std::string &file, size_t *value) {
+    std::ifstream in(file.c_str());
+    std::string content;
+    if (!(in >> content) || content.empty() || !isdigit(content[0])) {
+        // v2 writes "max" if there is no limit
+        return false;
+    }
+    *value = strtoull(content.c_str(), NULL, 10);
+    return true;
+}
+
+static size_t readStat(const std::string &file, const std::string &key) {
+    std::ifstream in(file.c_str());
+    std::string name;
+    size_t value;
+    while (in >> name >> value) {
+        if (name == key) {
+            return value;
+        }
+    }
+    return 0;
+}
+
+// the tightest memory limit of the cgroup of the process and its parents, the maximal size_t without any
+static CgroupMemory getCgroupMemory() {
+    CgroupMemory memory;
+    memory.limit = std::numeric_limits<size_t>::max();
+    memory.usage = 0;
+    memory.reclaimable = 0;
+    std::ifstream cgroups("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(cgroups, line)) {
+        // hierarchy-ID:controllers:path
+        size_t first = line.find(':');
+        size_t second = line.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos) {
+            continue;
+        }
+        const std::string controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+        std::string path = line.substr(second + 1);
+        const bool v2 = line.compare(0, first, "0") == 0 && controllers == ",,";
+        if (v2 == false && controllers.find(",memory,") == std::string::npos) {
+            continue;
+        }
+        const std::string root = v2 ? "/sys/fs/cgroup" : "/sys/fs/cgroup/memory";
+        const char *limitFile = v2 ? "/memory.max" : "/memory.limit_in_bytes";
+        const char *usageFile = v2 ? "/memory.current" : "/memory.usage_in_bytes";
+        const char *inactiveFile = v2 ? "inactive_file" : "total_inactive_file";
+        // inside a container the cgroup of the process is the root of the mount
+        while (true) {
+            const std::string dir = root + (path == "/" ? "" : path);
+            size_t limit;
+            size_t usage;
+            if (readSize(dir + limitFile, &limit) && limit < memory.limit && readSize(dir + usageFile, &usage)) {
+                memory.limit = limit;
+                memory.usage = usage;
+                memory.reclaimable = readStat(dir + "/memory.stat", inactiveFile);
+            }
+            if (path.empty() || path == "/") {
+                break;
+            }
+            size_t slash = path.rfind('/');
+            path = (slash == 0 || slash == std::string::npos) ? "/" : path.substr(0, slash);
+        }
+    }
+    return memory;
+}
+
 size_t Util::getTotalSystemMemory() // in bytes
 {
     // check for real physical memory
     long pages = getTotalMemoryPages();
     long page_size = getPageSize();
     uint64_t sysMemory = pages * page_size;
-    // check for ulimit
-//    struct rlimit limit;
-//    getrlimit(RLIMIT_MEMLOCK, &limit);
-    return sysMemory;
+    // v1 reports a page aligned maximal value if there is no limit
+    return std::min(static_cast<size_t>(sysMemory), getCgroupMemory().limit);
+}
+
+size_t Util::getAvailableMemory() {
+    size_t available = getTotalSystemMemory();
+#ifdef __linux__
+    // kilobytes, includes the page cache that can be dropped
+    size_t memAvailable = readStat("/proc/meminfo", "MemAvailable:");
+    if (memAvailable > 0) {
+        available = std::min(available, memAvailable * 1024);
+    }
+#endif
+    CgroupMemory cgroup = getCgroupMemory();
+    if (cgroup.limit != std::numeric_limits<size_t>::max()) {
+        size_t used = cgroup.usage - std::min(cgroup.usage, cgroup.reclaimable);
+        available = std::min(available, cgroup.limit - std::min(cgroup.limit, used));
+    }
+    return available;
+}
+
+size_t Util::getResidentMemory() {
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0;
+    size_t resident = 0;
+    if (statm >> size >> resident) {
+        return resident * getPageSize();
+    }
+    return getPeakResidentMemory();
+}
+
+std::string Util::formatBytes(size_t bytes) {
+    const char *units[] = {"B", "K", "M", "G", "T"};
+    double value = bytes;
+    size_t unit = 0;
+    while (value >= 1024.0 && unit < 4) {
+        value /= 1024.0;
+        unit++;
+    }
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << value << units[unit];
+    return ss.str();
+}
+
+size_t Util::getPeakResidentMemory() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    // bytes on macOS, kilobytes elsewhere
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
 }
 
 char Util::touchMemory(char *memory, size_t size) {
@@ -72,7 +72,15 @@ public:
     template <typename T>
     static void decomposeDomainByAminoAcid(size_t aaSize, T seqSizes, size_t count,
                                            size_t worldRank, size_t worldSize, size_t *start, size_t *end);
+    // physical memory, limited by the memory cgroup (v1 or v2) of the process
     static size_t getTotalSystemMemory();
+    // memory that can still be allocated: available system memory (including reclaimable page cache)
+    // and what is left of the cgroup limit, whichever is smaller
+    static size_t getAvailableMemory();
+    static size_t getResidentMemory();
+    static size_t getPeakResidentMemory();
+    // bytes with binary unit suffix, e.g. 1.5G
+    static std::string formatBytes(size_t bytes);
     static size_t getPageSize();
     static size_t getTotalMemoryPages();
     static char touchMemory(char* memory, size_t size);
@@ -0,0 +1,87 @@
+#include "WorkflowResources.h"
+#include "BaseMatrix.h"
+#include "ScoreMatrix.h"
+#include "SequenceLookup.h"
+#include "Debug.h"
+
+WorkflowResources::~WorkflowResources() {
+    for (std::map<std::string, SequenceDb>::iterator it = sequenceDbs.begin(); it != sequenceDbs.end(); ++it) {
+        it->second.reader->close();
+        delete it->second.reader;
+    }
+    for (std::map<std::string, SequenceLookup *>::iterator it = sequenceLookups.begin(); it != sequenceLookups.end(); ++it) {
+        delete it->second;
+    }
+    for (std::map<std::string, ScoreMatrix *>::iterator it = scoreMatrices.begin(); it != scoreMatrices.end(); ++it) {
+        ScoreMatrix::cleanup(it->second);
+    }
+    for (std::map<std::string, BaseMatrix *>::iterator it = matrices.begin(); it != matrices.end(); ++it) {
+        delete it->second;
+    }
+}
+
+DBReader<unsigned int> *WorkflowResources::getSequenceDb(const std::string &db, const std::string &dbIndex, bool touch) {
+    std::map<std::string, SequenceDb>::iterator it = sequenceDbs.find(db);
+    if (it == sequenceDbs.end()) {
+        SequenceDb entry;
+        entry.reader = new DBReader<unsigned int>(db.c_str(), dbIndex.c_str());
+        entry.reader->open(DBReader<unsigned int>::NOSORT);
+        entry.touched = false;
+        it = sequenceDbs.insert(std::make_pair(db, entry)).first;
+    } else {
+        Debug(Debug::INFO) << "Use open database " << db << "\n";
+    }
+    if (touch && it->second.touched == false) {
+        it->second.reader->readMmapedDataInMemory();
+        it->second.reader->mlock();
+        it->second.touched = true;
+    }
+    return it->second.reader;
+}
+
+BaseMatrix *WorkflowResources::getMatrix(const std::string &key) const {
+    std::map<std::string, BaseMatrix *>::const_iterator it = matrices.find(key);
+    return (it != matrices.end()) ? it->second : NULL;
+}
+
+void WorkflowResources::addMatrix(const std::string &key, BaseMatrix *matrix) {
+    matrices[key] = matrix;
+}
+
+ScoreMatrix *WorkflowResources::getScoreMatrix(const std::string &key) const {
+    std::map<std::string, ScoreMatrix *>::const_iterator it = scoreMatrices.find(key);
+    return (it != scoreMatrices.end()) ? it->second : NULL;
+}
+
+void WorkflowResources::addScoreMatrix(const std::string &key, ScoreMatrix *matrix) {
+    scoreMatrices[key] = matrix;
+}
+
+SequenceLookup *WorkflowResources::getSequenceLookup(const std::string &db) const {
+    std::map<std::string, SequenceLookup *>::const_iterator it = sequenceLookups.find(db);
+    return (it != sequenceLookups.end()) ? it->second : NULL;
+}
+
+void WorkflowResources::addSequenceLookup(const std::string &db, SequenceLookup *lookup) {
+    std::map<std::string, SequenceLookup *>::iterator it = sequenceLookups.find(db);
+    if (it != sequenceLookups.end()) {
+        delete it->second;
+        it->second = lookup;
+    } else {
+        sequenceLookups.insert(std::make_pair(db, lookup));
+    }
+}
+
+void WorkflowResources::release(const std::string &db) {
+    std::map<std::string, SequenceLookup *>::iterator lookup = sequenceLookups.find(db);
+    if (lookup != sequenceLookups.end()) {
+        delete lookup->second;
+        sequenceLookups.erase(lookup);
+    }
+    std::map<std::string, SequenceDb>::iterator it = sequenceDbs.find(db);
+    if (it != sequenceDbs.end()) {
+        it->second.reader->close();
+        delete it->second.reader;
+        sequenceDbs.erase(it);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef MMSEQS_WORKFLOWRESOURCES_H
+#define MMSEQS_WORKFLOWRESOURCES_H
+
+// Objects that the modules of an in-process workflow hand on to each other instead of opening
+// or computing them again: the sequence databases, the substitution matrices, the k-mer score
+// matrices of the prefilter and the unmasked sequence lookup the prefilter builds for the
+// alignment. The resources own everything that is added to them, modules only borrow it.
+
+#include <map>
+#include <string>
+
+#include "DBReader.h"
+
+class BaseMatrix;
+class SequenceLookup;
+struct ScoreMatrix;
+
+class WorkflowResources {
+public:
+    ~WorkflowResources();
+
+    // opens db with data in NOSORT order on first use, touch reads it into memory and locks it
+    DBReader<unsigned int> *getSequenceDb(const std::string &db, const std::string &dbIndex, bool touch);
+
+    // NULL if nothing was added with this key yet, the key has to describe how the object was made
+    BaseMatrix *getMatrix(const std::string &key) const;
+    void addMatrix(const std::string &key, BaseMatrix *matrix);
+
+    ScoreMatrix *getScoreMatrix(const std::string &key) const;
+    void addScoreMatrix(const std::string &key, ScoreMatrix *matrix);
+
+    // sequences of the whole database db in its NOSORT order, mapped with the full amino acid alphabet
+    SequenceLookup *getSequenceLookup(const std::string &db) const;
+    void addSequenceLookup(const std::string &db, SequenceLookup *lookup);
+
+    // closes db and drops its sequence lookup once no later step reads it, the matrices stay
+    void release(const std::string &db);
+
+private:
+    struct SequenceDb {
+        DBReader<unsigned int> *reader;
+        bool touched;
+    };
+
+    std::map<std::string, SequenceDb> sequenceDbs;
+    std::map<std::string, BaseMatrix *> matrices;
+    std::map<std::string, ScoreMatrix *> scoreMatrices;
+    std::map<std::string, SequenceLookup *> sequenceLookups;
+};
+
+#endif
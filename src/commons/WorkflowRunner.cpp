@@ -0,0 +1,142 @@
+#include "WorkflowRunner.h"
+#include "Command.h"
+#include "Parameters.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Util.h"
+#include "Timer.h"
+#include "Metrics.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+extern std::vector<struct Command> commands;
+
+WorkflowRunner::WorkflowRunner(const std::string &runner) : runner(runner) {
+    const char *binary = getenv("MMSEQS");
+    mmseqs = (binary != NULL) ? binary : "mmseqs";
+}
+
+std::vector<std::string> WorkflowRunner::splitParameters(const std::string &parameters) {
+    std::vector<std::string> args;
+    std::istringstream stream(parameters);
+    std::string arg;
+    while (stream >> arg) {
+        args.push_back(arg);
+    }
+    return args;
+}
+
+bool WorkflowRunner::run(const std::string &module, const std::vector<std::string> &args, const std::string &output,
+                         bool useRunner, bool separateProcess) {
+    return runStep(module, NULL, args, output, useRunner, separateProcess);
+}
+
+bool WorkflowRunner::run(const std::string &module, SharingCommandFunction function, const std::vector<std::string> &args,
+                         const std::string &output, bool useRunner) {
+    return runStep(module, function, args, output, useRunner, false);
+}
+
+void WorkflowRunner::release(const std::string &db) {
+    resources.release(db);
+}
+
+bool WorkflowRunner::runStep(const std::string &module, SharingCommandFunction function, const std::vector<std::string> &args,
+                             const std::string &output, bool useRunner, bool separateProcess) {
+    if (FileUtil::fileExists(output.c_str())) {
+        Debug(Debug::INFO) << "Skip " << module << ", " << output << " exists already\n";
+        return false;
+    }
+    const Command *command = NULL;
+    for (size_t i = 0; i < commands.size(); i++) {
+        if (module == commands[i].cmd) {
+            command = &commands[i];
+            break;
+        }
+    }
+    if (command == NULL) {
+        Debug(Debug::ERROR) << "Unknown module " << module << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const bool mpiStep = useRunner;
+    useRunner = useRunner && runner.empty() == false;
+#ifdef HAVE_MPI
+    // MPI can only be initialized once per process
+    separateProcess = separateProcess || mpiStep;
+#else
+    (void) mpiStep;
+#endif
+    if (separateProcess || useRunner) {
+        runProcess(module, args, useRunner);
+    } else {
+        runInProcess(*command, function, args);
+    }
+    return true;
+}
+
+void WorkflowRunner::runInProcess(const Command &command, SharingCommandFunction function, const std::vector<std::string> &args) {
+    Parameters &par = Parameters::getInstance();
+    // start from the same state as a new process
+    par.setDefaults();
+    if (command.params != NULL) {
+        for (size_t i = 0; i < command.params->size(); i++) {
+            command.params->at(i).wasSet = false;
+        }
+    }
+    std::vector<const char *> argv;
+    for (size_t i = 0; i < args.size(); i++) {
+        argv.push_back(args[i].c_str());
+    }
+    argv.push_back(NULL);
+
+    Debug(Debug::INFO) << command.cmd;
+    for (size_t i = 0; i < args.size(); i++) {
+        Debug(Debug::INFO) << " " << args[i];
+    }
+    Debug(Debug::INFO) << "\n";
+    Timer timer;
+    Metrics::beginModule(command.cmd, static_cast<int>(args.size()), argv.data());
+    const int status = (function != NULL) ? function(static_cast<int>(args.size()), argv.data(), command, &resources)
+                                          : command.commandFunction(static_cast<int>(args.size()), argv.data(), command);
+    Metrics::endModule(status);
+    if (status != EXIT_SUCCESS) {
+        Debug(Debug::ERROR) << command.cmd << " died\n";
+        EXIT(EXIT_FAILURE);
+    }
+    Debug(Debug::INFO) << "Time for processing: " << timer.lap() << "\n";
+}
+
+static std::string quoteArgument(const std::string &arg) {
+    std::string quoted = "'";
+    for (size_t i = 0; i < arg.size(); i++) {
+        if (arg[i] == '\'') {
+            quoted.append("'\\''");
+        } else {
+            quoted.push_back(arg[i]);
+        }
+    }
+    quoted.push_back('\'');
+    return quoted;
+}
+
+void WorkflowRunner::runProcess(const std::string &module, const std::vector<std::string> &args, bool useRunner) {
+    std::string commandLine;
+    if (useRunner) {
+        // the runner is a command prefix with its own arguments, e.g. "mpirun -np 42"
+        commandLine.append(runner).push_back(' ');
+    }
+    commandLine.append(quoteArgument(mmseqs)).push_back(' ');
+    commandLine.append(module);
+    for (size_t i = 0; i < args.size(); i++) {
+        commandLine.push_back(' ');
+        commandLine.append(quoteArgument(args[i]));
+    }
+    Metrics::beginChildren();
+    const int status = system(commandLine.c_str());
+    Metrics::endChildren();
+    if (status != EXIT_SUCCESS) {
+        Debug(Debug::ERROR) << module << " died\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef MMSEQS_WORKFLOWRUNNER_H
+#define MMSEQS_WORKFLOWRUNNER_H
+
+// Runs the modules of a workflow one after another in the calling process, instead of a
+// workflow shell script that starts a new mmseqs process for every step.
+//
+// Like notExists in the scripts, a step is skipped if its output exists already, so an
+// interrupted workflow continues where it stopped. Modules that are workflows themselves
+// and steps that have to be started through the MPI runner prefix run as separate process.
+// Modules that run in-process can share their databases and matrices through the resources
+// of the runner.
+
+#include <string>
+#include <vector>
+
+#include "WorkflowResources.h"
+
+struct Command;
+
+// module function that borrows what it finds in resources instead of opening or computing it
+typedef int (*SharingCommandFunction)(int argc, const char **argv, const Command &command, WorkflowResources *resources);
+
+class WorkflowRunner {
+public:
+    WorkflowRunner(const std::string &runner);
+
+    // runs module with args unless output exists, returns false if the step was skipped.
+    // useRunner marks the steps that use MPI, they are prefixed with the MPI runner if one is set
+    bool run(const std::string &module, const std::vector<std::string> &args, const std::string &output,
+             bool useRunner = false, bool separateProcess = false);
+
+    // same, but an in-process step runs function with the resources of the runner
+    bool run(const std::string &module, SharingCommandFunction function, const std::vector<std::string> &args,
+             const std::string &output, bool useRunner = false);
+
+    // closes the shared database db, the later steps do not read it anymore
+    void release(const std::string &db);
+
+    // splits a string of Parameters::createParameterString into arguments
+    static std::vector<std::string> splitParameters(const std::string &parameters);
+
+private:
+    std::string runner;
+    std::string mmseqs;
+    WorkflowResources resources;
+
+    bool runStep(const std::string &module, SharingCommandFunction function, const std::vector<std::string> &args,
+                 const std::string &output, bool useRunner, bool separateProcess);
+
+    void runInProcess(const Command &command, SharingCommandFunction function, const std::vector<std::string> &args);
+
+    void runProcess(const std::string &module, const std::vector<std::string> &args, bool useRunner);
+};
+
+#endif
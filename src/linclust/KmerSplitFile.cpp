@@ -0,0 +1,175 @@
+#include "KmerSplitFile.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+
+static inline void writeVarint(std::vector<unsigned char> &buffer, size_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<unsigned char>(value));
+}
+
+static inline size_t readVarint(const unsigned char *&pos) {
+    size_t value = 0;
+    unsigned int shift = 0;
+    while (*pos & 0x80) {
+        value |= static_cast<size_t>(*pos & 0x7F) << shift;
+        shift += 7;
+        pos++;
+    }
+    value |= static_cast<size_t>(*pos) << shift;
+    pos++;
+    return value;
+}
+
+static inline unsigned int zigzagEncode(short value) {
+    return (static_cast<unsigned int>(value) << 1) ^ static_cast<unsigned int>(static_cast<int>(value) >> 15);
+}
+
+static inline short zigzagDecode(unsigned int value) {
+    return static_cast<short>((value >> 1) ^ -static_cast<int>(value & 1));
+}
+
+KmerSplitWriter::KmerSplitWriter(const std::string &fileName) : fileName(fileName), offset(0) {
+    file = FileUtil::openFileOrDie(fileName.c_str(), "wb", false);
+    block.reserve(BLOCK_SIZE + 1024);
+    current.entries = 0;
+}
+
+KmerSplitWriter::~KmerSplitWriter() {
+    if (file != NULL) {
+        close();
+    }
+}
+
+void KmerSplitWriter::writeGroup(unsigned int repSeq, const KmerEntry *members, size_t count) {
+    if (block.empty()) {
+        current.firstRep = repSeq;
+        current.lastRep = repSeq;
+        current.entries = 0;
+    }
+    writeVarint(block, repSeq - current.lastRep);
+    writeVarint(block, count);
+    unsigned int prevId = 0;
+    for (size_t i = 0; i < count; i++) {
+        writeVarint(block, members[i].seqId - prevId);
+        writeVarint(block, zigzagEncode(members[i].diagonal));
+        prevId = members[i].seqId;
+    }
+    current.lastRep = repSeq;
+    current.entries += count;
+    if (block.size() >= BLOCK_SIZE) {
+        flushBlock();
+    }
+}
+
+void KmerSplitWriter::flushBlock() {
+    if (block.empty()) {
+        return;
+    }
+    if (fwrite(block.data(), sizeof(unsigned char), block.size(), file) != block.size()) {
+        Debug(Debug::ERROR) << "Could not write to " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    current.offset = offset;
+    current.size = block.size();
+    blocks.push_back(current);
+    offset += block.size();
+    block.clear();
+}
+
+void KmerSplitWriter::close() {
+    flushBlock();
+    const size_t blockCount = blocks.size();
+    if (blockCount > 0 && fwrite(blocks.data(), sizeof(KmerSplitBlock), blockCount, file) != blockCount) {
+        Debug(Debug::ERROR) << "Could not write to " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fwrite(&blockCount, sizeof(size_t), 1, file) != 1) {
+        Debug(Debug::ERROR) << "Could not write to " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(file) != 0) {
+        Debug(Debug::ERROR) << "Could not close " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    file = NULL;
+}
+
+KmerSplitFile::KmerSplitFile(const std::string &fileName) : fileName(fileName) {
+    file = FileUtil::openFileOrDie(fileName.c_str(), "r", true);
+    data = static_cast<const unsigned char *>(FileUtil::mmapFile(file, &dataSize));
+    size_t blockCount = 0;
+    if (dataSize < sizeof(size_t)) {
+        Debug(Debug::ERROR) << "Split file " << fileName << " is truncated\n";
+        EXIT(EXIT_FAILURE);
+    }
+    memcpy(&blockCount, data + dataSize - sizeof(size_t), sizeof(size_t));
+    const size_t indexSize = blockCount * sizeof(KmerSplitBlock);
+    if (indexSize + sizeof(size_t) > dataSize) {
+        Debug(Debug::ERROR) << "Split file " << fileName << " is truncated\n";
+        EXIT(EXIT_FAILURE);
+    }
+    blocks.resize(blockCount);
+    if (blockCount > 0) {
+        memcpy(blocks.data(), data + dataSize - sizeof(size_t) - indexSize, indexSize);
+    }
+    madvise((void *) data, dataSize, MADV_SEQUENTIAL);
+}
+
+KmerSplitFile::~KmerSplitFile() {
+    if (munmap((void *) data, dataSize) < 0) {
+        Debug(Debug::ERROR) << "Failed to munmap memory dataSize=" << dataSize << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    fclose(file);
+}
+
+static bool compareBlockByLastRep(const KmerSplitBlock &block, unsigned int rep) {
+    return block.lastRep < rep;
+}
+
+KmerSplitFile::Cursor::Cursor(const KmerSplitFile &file, unsigned int fromRep) : file(file), pos(NULL), end(NULL), rep(0), valid(false) {
+    const std::vector<KmerSplitBlock> &blocks = file.blocks;
+    blockIdx = std::lower_bound(blocks.begin(), blocks.end(), fromRep, compareBlockByLastRep) - blocks.begin();
+    openBlock(blockIdx);
+    next();
+    while (valid && rep < fromRep) {
+        next();
+    }
+}
+
+void KmerSplitFile::Cursor::openBlock(size_t idx) {
+    blockIdx = idx;
+    if (blockIdx < file.blocks.size()) {
+        pos = file.data + file.blocks[blockIdx].offset;
+        end = pos + file.blocks[blockIdx].size;
+        rep = file.blocks[blockIdx].firstRep;
+    }
+}
+
+void KmerSplitFile::Cursor::next() {
+    if (pos == end) {
+        openBlock(blockIdx + 1);
+    }
+    if (blockIdx >= file.blocks.size()) {
+        valid = false;
+        return;
+    }
+    rep += static_cast<unsigned int>(readVarint(pos));
+    const size_t count = readVarint(pos);
+    groupMembers.resize(count);
+    unsigned int prevId = 0;
+    for (size_t i = 0; i < count; i++) {
+        groupMembers[i].seqId = prevId + static_cast<unsigned int>(readVarint(pos));
+        groupMembers[i].diagonal = zigzagDecode(static_cast<unsigned int>(readVarint(pos)));
+        prevId = groupMembers[i].seqId;
+    }
+    valid = true;
+}
@@ -0,0 +1,101 @@
+#ifndef MMSEQS_KMERSPLITFILE_H
+#define MMSEQS_KMERSPLITFILE_H
+
+// Split files of the k-mer matcher.
+//
+// A split file holds the rep. sequence groups of one split sorted by rep. sequence id.
+// Groups are stored in blocks of about BLOCK_SIZE bytes: the rep. sequence id as delta to the previous
+// group, the member count and the members as id delta and zigzag coded diagonal, all as varints.
+// The block index (first and last rep. sequence, offset, size, entries) and the block count follow the blocks,
+// so that a reader can start at any rep. sequence id.
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct __attribute__((__packed__)) KmerEntry {
+    unsigned int seqId;
+    short diagonal;
+};
+
+struct KmerSplitBlock {
+    unsigned int firstRep;
+    unsigned int lastRep;
+    size_t offset;
+    size_t size;
+    size_t entries;
+};
+
+class KmerSplitWriter {
+public:
+    KmerSplitWriter(const std::string &fileName);
+    ~KmerSplitWriter();
+
+    // members have to be sorted by seqId, groups by repSeq
+    void writeGroup(unsigned int repSeq, const KmerEntry *members, size_t count);
+
+    void close();
+
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+private:
+    std::string fileName;
+    FILE *file;
+    std::vector<unsigned char> block;
+    std::vector<KmerSplitBlock> blocks;
+    KmerSplitBlock current;
+    size_t offset;
+
+    void flushBlock();
+};
+
+class KmerSplitFile {
+public:
+    KmerSplitFile(const std::string &fileName);
+    ~KmerSplitFile();
+
+    const std::vector<KmerSplitBlock> &getBlocks() const {
+        return blocks;
+    }
+
+    // iterates over the groups with rep. sequence id >= fromRep
+    class Cursor {
+    public:
+        Cursor(const KmerSplitFile &file, unsigned int fromRep);
+
+        bool hasGroup() const {
+            return valid;
+        }
+
+        unsigned int repSeq() const {
+            return rep;
+        }
+
+        const std::vector<KmerEntry> &members() const {
+            return groupMembers;
+        }
+
+        void next();
+
+    private:
+        const KmerSplitFile &file;
+        size_t blockIdx;
+        const unsigned char *pos;
+        const unsigned char *end;
+        unsigned int rep;
+        bool valid;
+        std::vector<KmerEntry> groupMembers;
+
+        void openBlock(size_t idx);
+    };
+
+private:
+    std::string fileName;
+    FILE *file;
+    const unsigned char *data;
+    size_t dataSize;
+    std::vector<KmerSplitBlock> blocks;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "KmerTable.h"
+#include "Parameters.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <sys/mman.h>
+
+static const char KMER_TABLE_MAGIC[4] = {'K', 'M', 'T', 'B'};
+
+KmerTableHeader::KmerTableHeader() : version(VERSION), dbType(0), kmerSize(0), alphabetSize(0),
+                                     kmerSelectionMode(0), hashShift(0), maskMode(0), entries(0) {
+    memcpy(magic, KMER_TABLE_MAGIC, sizeof(magic));
+}
+
+KmerTableHeader::KmerTableHeader(const Parameters &par, int dbType, size_t entries)
+        : version(VERSION), dbType(dbType), kmerSize(par.kmerSize), alphabetSize(par.alphabetSize),
+          kmerSelectionMode(par.kmerSelectionMode), hashShift(par.hashShift), maskMode(par.maskMode),
+          entries(entries) {
+    memcpy(magic, KMER_TABLE_MAGIC, sizeof(magic));
+}
+
+void KmerTableHeader::applyParameters(Parameters &par) const {
+    par.kmerSize = kmerSize;
+    par.alphabetSize = alphabetSize;
+    par.kmerSelectionMode = kmerSelectionMode;
+    par.hashShift = hashShift;
+    par.maskMode = maskMode;
+}
+
+void writeKmerTable(const std::string &fileName, const KmerTableHeader &header,
+                    const KmerTableEntry *entries, size_t count) {
+    // write next to the target first, the old table might still be mapped
+    std::string tmpFileName = fileName + ".tmp";
+    FILE *file = FileUtil::openFileOrDie(tmpFileName.c_str(), "wb", false);
+    if (fwrite(&header, sizeof(KmerTableHeader), 1, file) != 1
+        || (count > 0 && fwrite(entries, sizeof(KmerTableEntry), count, file) != count)) {
+        Debug(Debug::ERROR) << "Could not write to " << tmpFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(file) != 0) {
+        Debug(Debug::ERROR) << "Could not close " << tmpFileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+        Debug(Debug::ERROR) << "Could not move " << tmpFileName << " to " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+KmerTableFile::KmerTableFile(const std::string &fileName) : fileName(fileName) {
+    file = FileUtil::openFileOrDie(fileName.c_str(), "r", true);
+    data = static_cast<char *>(FileUtil::mmapFile(file, &dataSize));
+    if (dataSize < sizeof(KmerTableHeader)) {
+        Debug(Debug::ERROR) << "K-mer table " << fileName << " is truncated\n";
+        EXIT(EXIT_FAILURE);
+    }
+    memcpy(&header, data, sizeof(KmerTableHeader));
+    if (memcmp(header.magic, KMER_TABLE_MAGIC, sizeof(header.magic)) != 0 || header.version != KmerTableHeader::VERSION) {
+        Debug(Debug::ERROR) << fileName << " is not a k-mer table of this MMseqs2 version\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (sizeof(KmerTableHeader) + header.entries * sizeof(KmerTableEntry) != dataSize) {
+        Debug(Debug::ERROR) << "K-mer table " << fileName << " is truncated\n";
+        EXIT(EXIT_FAILURE);
+    }
+    entries = reinterpret_cast<const KmerTableEntry *>(data + sizeof(KmerTableHeader));
+}
+
+KmerTableFile::~KmerTableFile() {
+    if (munmap(data, dataSize) < 0) {
+        Debug(Debug::ERROR) << "Failed to munmap memory dataSize=" << dataSize << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    fclose(file);
+}
+
+const KmerTableEntry *KmerTableFile::find(size_t kmer) const {
+    KmerTableEntry key;
+    key.kmer = kmer;
+    const KmerTableEntry *end = entries + header.entries;
+    const KmerTableEntry *it = std::lower_bound(entries, end, key, KmerTableEntry::compareByKmer);
+    if (it == end || it->kmer != kmer) {
+        return NULL;
+    }
+    return it;
+}
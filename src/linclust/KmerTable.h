@@ -0,0 +1,81 @@
+#ifndef MMSEQS_KMERTABLE_H
+#define MMSEQS_KMERTABLE_H
+
+// Persistent representative k-mer table for incremental clustering.
+//
+// The table maps every k-mer selected by linclust from a set of representative sequences to the
+// longest representative containing it (database key, k-mer position and length), sorted by k-mer.
+// New sequences are matched against it with kmermatcher --kmer-table-in, new representatives are
+// merged into it with --kmer-table-out, which only writes the table. The header stores the k-mer parameters the table was built
+// with, since lookups only work with the same k-mer selection.
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+class Parameters;
+
+struct __attribute__((__packed__)) KmerTableEntry {
+    size_t kmer;
+    unsigned int repKey;
+    short pos;
+    unsigned short seqLen;
+
+    static bool compareByKmer(const KmerTableEntry &first, const KmerTableEntry &second) {
+        return first.kmer < second.kmer;
+    }
+};
+
+struct KmerTableHeader {
+    static const unsigned int VERSION = 1;
+
+    char magic[4];
+    unsigned int version;
+    int dbType;
+    int kmerSize;
+    int alphabetSize;
+    int kmerSelectionMode;
+    int hashShift;
+    int maskMode;
+    size_t entries;
+
+    KmerTableHeader();
+    KmerTableHeader(const Parameters &par, int dbType, size_t entries);
+
+    // sets the k-mer parameters of par to the ones of the table
+    void applyParameters(Parameters &par) const;
+};
+
+void writeKmerTable(const std::string &fileName, const KmerTableHeader &header,
+                    const KmerTableEntry *entries, size_t count);
+
+class KmerTableFile {
+public:
+    KmerTableFile(const std::string &fileName);
+    ~KmerTableFile();
+
+    const KmerTableHeader &getHeader() const {
+        return header;
+    }
+
+    const KmerTableEntry *getEntries() const {
+        return entries;
+    }
+
+    size_t size() const {
+        return header.entries;
+    }
+
+    // entry of kmer or NULL if the table does not contain it
+    const KmerTableEntry *find(size_t kmer) const;
+
+private:
+    std::string fileName;
+    FILE *file;
+    char *data;
+    size_t dataSize;
+    KmerTableHeader header;
+    const KmerTableEntry *entries;
+};
+
+#endif
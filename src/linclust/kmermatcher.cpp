@@ -8,7 +8,7 @@
 #include "Matcher.h"
 #include "Debug.h"
 #include "DBReader.h"
-#include "omptl/omptl_algorithm"
+#include "RadixSort.h"
 #include "MathUtil.h"
 #include "FileUtil.h"
 #include "NucleotideMatrix.h"
@@ -16,14 +16,16 @@
 #include "FileUtil.h"
 #include "Timer.h"
 #include "tantan.h"
+#include "KmerSplitFile.h"
+#include "KmerTable.h"
+#include "Progress.h"
+#include "MPIScheduler.h"
 
 #include <limits>
 #include <string>
 #include <vector>
 #include <iomanip>
 #include <algorithm>
-#include <queue>
-#include <sys/mman.h>
 #ifdef OPENMP
 #include <omp.h>
 #endif
@@ -54,43 +56,343 @@ unsigned circ_hash_next(const int * x, unsigned length, int x_first, short unsig
 }
 #undef RoL
 
-size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int> &seqDbr,
+KmerSelectionBuffer::KmerSelectionBuffer(size_t maxSeqLen) {
+    window = new unsigned int[maxSeqLen + 1];
+    smerHashes = new unsigned short[maxSeqLen + 1];
+    isSyncmer = new unsigned char[maxSeqLen + 1];
+}
+
+KmerSelectionBuffer::~KmerSelectionBuffer() {
+    delete [] window;
+    delete [] smerHashes;
+    delete [] isSyncmer;
+}
+
+size_t selectMinimizers(SequencePosition *kmers, size_t count, size_t kmersPerSequence, KmerSelectionBuffer &buffer) {
+    if (count <= 1 || kmersPerSequence == 0) {
+        return count;
+    }
+    // a window of w k-mers selects about 2 / (w + 1) of them, so the window depends on the sequence length
+    // and long sequences are not sampled more densely than short ones
+    const size_t windowSize = std::max(static_cast<size_t>(1), (2 * count) / kmersPerSequence);
+    if (windowSize == 1) {
+        return count;
+    }
+    // sliding window minimum, the window buffer holds candidate indices with increasing hashes.
+    // A selected k-mer is never in front of the write position of the following ones, so kmers is compacted in place.
+    unsigned int *window = buffer.window;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t selected = 0;
+    size_t lastSelected = SIZE_T_MAX;
+    const size_t firstWindowEnd = std::min(windowSize, count) - 1;
+    for (size_t i = 0; i < count; i++) {
+        // equal k-mers: the later one wins so that the minimizer moves forward
+        while (tail > head && SequencePosition::compareByScore(kmers[window[tail - 1]], kmers[i]) == false) {
+            tail--;
+        }
+        window[tail++] = static_cast<unsigned int>(i);
+        if (window[head] + windowSize <= i) {
+            head++;
+        }
+        if (i >= firstWindowEnd && window[head] != lastSelected) {
+            lastSelected = window[head];
+            kmers[selected++] = kmers[lastSelected];
+        }
+    }
+    return selected;
+}
+
+size_t selectOpenSyncmers(SequencePosition *kmers, size_t count, const int *sequence, int seqLen,
+                          size_t KMER_SIZE, int hashShift, KmerSelectionBuffer &buffer) {
+    // a k-mer is an open syncmer if its first s-mer has the smallest hash of all its s-mers
+    const int smerSize = std::max(1, static_cast<int>(KMER_SIZE / 2));
+    const int smerCount = seqLen - smerSize + 1;
+    const int smersPerKmer = static_cast<int>(KMER_SIZE) - smerSize + 1;
+    if (smerCount < smersPerKmer) {
+        return 0;
+    }
+    unsigned short *hashes = buffer.smerHashes;
+    hashes[0] = circ_hash(sequence, smerSize, hashShift);
+    for (int i = 1; i < smerCount; i++) {
+        hashes[i] = circ_hash_next(sequence + i, smerSize, sequence[i - 1], hashes[i - 1], hashShift);
+    }
+    unsigned int *window = buffer.window;
+    size_t head = 0;
+    size_t tail = 0;
+    for (int i = 0; i < smerCount; i++) {
+        // equal hashes: the earlier s-mer stays the minimum
+        while (tail > head && hashes[window[tail - 1]] > hashes[i]) {
+            tail--;
+        }
+        window[tail++] = static_cast<unsigned int>(i);
+        const int kmerPos = i - smersPerKmer + 1;
+        if (kmerPos < 0) {
+            continue;
+        }
+        if (static_cast<int>(window[head]) < kmerPos) {
+            head++;
+        }
+        buffer.isSyncmer[kmerPos] = (static_cast<int>(window[head]) == kmerPos);
+    }
+    size_t selected = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (buffer.isSyncmer[kmers[i].pos]) {
+            kmers[selected++] = kmers[i];
+        }
+    }
+    return selected;
+}
+
+int selectSequenceKmers(Sequence &seq, Indexer &idxer, BaseMatrix *subMat, size_t KMER_SIZE, size_t chooseTopKmer,
+                        int hashShift, int selectionMode, SequencePosition *kmers, KmerSelectionBuffer *buffer) {
+    int seqKmerCount = 0;
+    unsigned short prevHash = 0;
+    unsigned int prevFirstRes = 0;
+    seq.resetCurrPos();
+    if (seq.hasNextKmer()) {
+        const int *kmer = seq.nextKmer();
+        prevHash = circ_hash(kmer, KMER_SIZE, hashShift);
+        prevFirstRes = kmer[0];
+    }
+    while (seq.hasNextKmer()) {
+        const int *kmer = seq.nextKmer();
+        //float kmerScore = 1.0;
+        prevHash = circ_hash_next(kmer, KMER_SIZE, prevFirstRes, prevHash, hashShift);
+        prevFirstRes = kmer[0];
+        size_t xCount = 0;
+        for (size_t kpos = 0; kpos < KMER_SIZE; kpos++) {
+            xCount += (kmer[kpos] == subMat->aa2int[(int) 'X']);
+        }
+        if (xCount > 0) {
+            continue;
+        }
+        (kmers + seqKmerCount)->score = prevHash;
+        size_t kmerIdx = idxer.int2index(kmer, 0, KMER_SIZE);
+        (kmers + seqKmerCount)->kmer = kmerIdx;
+        (kmers + seqKmerCount)->pos = seq.getCurrentPosition();
+        seqKmerCount++;
+    }
+    if (selectionMode == Parameters::KMER_SELECTION_MINIMIZER) {
+        seqKmerCount = selectMinimizers(kmers, seqKmerCount, chooseTopKmer - 1, *buffer);
+    } else if (selectionMode == Parameters::KMER_SELECTION_SYNCMER) {
+        seqKmerCount = selectOpenSyncmers(kmers, seqKmerCount, seq.int_sequence, seq.L, KMER_SIZE, hashShift, *buffer);
+    }
+    // the lowest hashes are used if more k-mers are left than a sequence may contribute,
+    // their order does not matter since the k-mer array is sorted later
+    const size_t kmersUsed = chooseTopKmer - 1;
+    if (chooseTopKmer > 0 && static_cast<size_t>(seqKmerCount) > kmersUsed) {
+        std::nth_element(kmers, kmers + kmersUsed, kmers + seqKmerCount, SequencePosition::compareByScoreAndPos);
+    }
+    return seqKmerCount;
+}
+
+// shared k-mer array of doComputation<KmerPosition>, threads append blocks of BUFFER_SIZE entries
+struct KmerPositionArray {
+    KmerPosition *entries;
+    size_t kmerCount;
+
+    KmerPositionArray(KmerPosition *entries) : entries(entries), kmerCount(0) {}
+
+    class Writer {
+    public:
+        Writer(KmerPositionArray &table) : table(table), bufferPos(0) {
+            buffer = new KmerPosition[BUFFER_SIZE];
+        }
+
+        ~Writer() {
+            delete [] buffer;
+        }
+
+        void add(size_t kmer, unsigned int id, short pos, unsigned short seqLen) {
+            buffer[bufferPos].kmer = kmer;
+            buffer[bufferPos].id = id;
+            buffer[bufferPos].pos = pos;
+            buffer[bufferPos].seqLen = seqLen;
+            bufferPos++;
+            if (bufferPos >= BUFFER_SIZE) {
+                flush();
+            }
+        }
+
+        void flush() {
+            if (bufferPos > 0) {
+                size_t writeOffset = __sync_fetch_and_add(&table.kmerCount, bufferPos);
+                memcpy(table.entries + writeOffset, buffer, sizeof(KmerPosition) * bufferPos);
+                bufferPos = 0;
+            }
+        }
+
+    private:
+        static const size_t BUFFER_SIZE = 1024;
+        KmerPositionArray &table;
+        KmerPosition *buffer;
+        size_t bufferPos;
+    };
+};
+
+CompactKmerTable::CompactKmerTable(size_t maxKmerCount, size_t threads, unsigned int partitionBits)
+        : usedChunks(0), kmerCount(0), partitionBits(partitionBits) {
+    // every thread leaves at most one partially filled chunk per partition
+    chunkCapacity = (maxKmerCount + CHUNK_SIZE - 1) / CHUNK_SIZE + threads * partitions();
+    entries = new(std::nothrow) KmerPositionCompact[chunkCapacity * CHUNK_SIZE + 1];
+    Util::checkAllocation(entries, "Could not allocate memory");
+    chunkPartition.resize(chunkCapacity);
+}
+
+CompactKmerTable::~CompactKmerTable() {
+    if (entries != NULL) {
+        delete [] entries;
+    }
+}
+
+unsigned int CompactKmerTable::partitionBitsNeeded(size_t maxKmer) {
+    for (unsigned int bits = MIN_PARTITION_BITS; bits <= MAX_PARTITION_BITS; bits++) {
+        if ((maxKmer >> bits) < KmerPositionCompact::EMPTY_KMER) {
+            return bits;
+        }
+    }
+    return 0;
+}
+
+CompactKmerTable::Writer::Writer(CompactKmerTable &table)
+        : table(table), partitionMask(table.partitions() - 1), added(0) {
+    buffer = new KmerPositionCompact[table.partitions() * CHUNK_SIZE];
+    bufferPos = new size_t[table.partitions()];
+    memset(bufferPos, 0, sizeof(size_t) * table.partitions());
+}
+
+CompactKmerTable::Writer::~Writer() {
+    delete [] buffer;
+    delete [] bufferPos;
+}
+
+void CompactKmerTable::Writer::add(size_t kmer, unsigned int id, short pos, unsigned short) {
+    const size_t partition = kmer & partitionMask;
+    KmerPositionCompact &entry = buffer[partition * CHUNK_SIZE + bufferPos[partition]];
+    entry.kmer = kmer >> table.partitionBits;
+    entry.id = id;
+    entry.pos = pos;
+    bufferPos[partition]++;
+    added++;
+    if (bufferPos[partition] >= CHUNK_SIZE) {
+        flushPartition(partition);
+    }
+}
+
+void CompactKmerTable::Writer::flushPartition(size_t partition) {
+    if (bufferPos[partition] == 0) {
+        return;
+    }
+    KmerPositionCompact *chunk = buffer + partition * CHUNK_SIZE;
+    // pad the chunk, empty entries are sorted to the end of the partition
+    for (size_t i = bufferPos[partition]; i < CHUNK_SIZE; i++) {
+        chunk[i].kmer = KmerPositionCompact::EMPTY_KMER;
+        chunk[i].id = UINT_MAX;
+        chunk[i].pos = 0;
+    }
+    const size_t chunkIdx = __sync_fetch_and_add(&table.usedChunks, 1);
+    if (chunkIdx >= table.chunkCapacity) {
+        Debug(Debug::ERROR) << "Compact k-mer table is too small\n";
+        EXIT(EXIT_FAILURE);
+    }
+    memcpy(table.entries + chunkIdx * CHUNK_SIZE, chunk, sizeof(KmerPositionCompact) * CHUNK_SIZE);
+    table.chunkPartition[chunkIdx] = static_cast<unsigned short>(partition);
+    bufferPos[partition] = 0;
+}
+
+void CompactKmerTable::Writer::flush() {
+    for (size_t partition = 0; partition < table.partitions(); partition++) {
+        flushPartition(partition);
+    }
+    __sync_fetch_and_add(&table.kmerCount, added);
+    added = 0;
+}
+
+size_t computeMaxKmer(size_t alphabetSize, size_t KMER_SIZE) {
+    size_t kmerIndexCount = 1;
+    for (size_t i = 0; i < KMER_SIZE; i++) {
+        if (kmerIndexCount > SIZE_T_MAX / alphabetSize) {
+            return SIZE_T_MAX;
+        }
+        kmerIndexCount *= alphabetSize;
+    }
+    // the identity k-mer is a 32 bit sequence hash placed above the highest k-mer index
+    if (kmerIndexCount - 1 > SIZE_T_MAX - UINT_MAX) {
+        return SIZE_T_MAX;
+    }
+    return (kmerIndexCount - 1) + UINT_MAX;
+}
+
+// masks seq if requested and selects its k-mers into kmers, returns how many of them linclust uses
+static size_t maskAndSelectKmers(Sequence &seq, Indexer &idxer, Parameters &par, BaseMatrix *subMat,
+                                 ProbabilityMatrix *probMatrix, char *charSequence,
+                                 size_t KMER_SIZE, size_t chooseTopKmer,
+                                 SequencePosition *kmers, KmerSelectionBuffer *selectionBuffer) {
+    // mask using tantan
+    if (par.maskMode == 1) {
+        for (int i = 0; i < seq.L; i++) {
+            charSequence[i] = (char) seq.int_sequence[i];
+        }
+        tantan::maskSequences(charSequence,
+                              charSequence + seq.L,
+                              50 /*options.maxCycleLength*/,
+                              probMatrix->probMatrixPointers,
+                              0.005 /*options.repeatProb*/,
+                              0.05 /*options.repeatEndProb*/,
+                              0.5 /*options.repeatOffsetProbDecay*/,
+                              0, 0,
+                              0.9 /*options.minMaskProb*/, probMatrix->hardMaskTable);
+        for (int i = 0; i < seq.L; i++) {
+            seq.int_sequence[i] = charSequence[i];
+        }
+    }
+
+    int seqKmerCount = selectSequenceKmers(seq, idxer, subMat, KMER_SIZE, chooseTopKmer, par.hashShift,
+                                           par.kmerSelectionMode, kmers, selectionBuffer);
+    size_t kmerConsidered = std::min(static_cast<int>(chooseTopKmer - 1), seqKmerCount);
+    if(par.skipNRepeatKmer > 0 ){
+        // repeated k-mers are counted as neighbours in hash order
+        std::sort(kmers, kmers + seqKmerCount, SequencePosition::compareByScoreAndPos);
+        size_t prevKmer = SIZE_T_MAX;
+        kmers[seqKmerCount].kmer=SIZE_T_MAX;
+        int repeatKmerCnt = 0;
+        for (int topKmer = 0; topKmer < seqKmerCount; topKmer++) {
+            repeatKmerCnt += (
+                    (kmers + topKmer)->kmer == (kmers + topKmer + 1)->kmer ||
+                    (kmers + topKmer)->kmer == prevKmer);
+            prevKmer = (kmers + topKmer)->kmer;
+        }
+        if(repeatKmerCnt >= par.skipNRepeatKmer){
+            kmerConsidered = 0;
+        }
+    }
+    return kmerConsidered;
+}
+
+template <typename T>
+size_t fillKmerPositionArray(T &table, DBReader<unsigned int> &seqDbr,
                              Parameters & par, BaseMatrix * subMat,
                              size_t KMER_SIZE, size_t chooseTopKmer,
                              size_t splits, size_t split){
-    size_t offset = 0;
     int querySeqType  =  seqDbr.getDbtype();
     ProbabilityMatrix *probMatrix = NULL;
     if (par.maskMode == 1) {
         probMatrix = new ProbabilityMatrix(*subMat);
     }
 
-    struct SequencePosition{
-        short score;
-        size_t kmer;
-        unsigned int pos;
-        static bool compareByScore(const SequencePosition &first, const SequencePosition &second){
-            if(first.score < second.score)
-                return true;
-            if(second.score < first.score)
-                return false;
-            if(first.kmer < second.kmer)
-                return true;
-            if(second.kmer < first.kmer)
-                return false;
-
-            return false;
-        }
-    };
+    Progress progress("kmermatcher", seqDbr.getSize());
 #pragma omp parallel
     {
         Sequence seq(par.maxSeqLen, querySeqType, subMat, KMER_SIZE, false, false);
         Indexer idxer(subMat->alphabetSize, KMER_SIZE);
         char * charSequence = new char[par.maxSeqLen];
-        const unsigned int BUFFER_SIZE = 1024;
-        size_t bufferPos = 0;
-        KmerPosition * threadKmerBuffer = new KmerPosition[BUFFER_SIZE];
+        typename T::Writer writer(table);
         SequencePosition * kmers = new SequencePosition[par.maxSeqLen+1];
+        KmerSelectionBuffer *selectionBuffer = NULL;
+        if (par.kmerSelectionMode != Parameters::KMER_SELECTION_LOWEST_HASH) {
+            selectionBuffer = new KmerSelectionBuffer(par.maxSeqLen);
+        }
         int highestSeq[32];
         for(size_t i = 0; i<KMER_SIZE;i++){
             highestSeq[i]=subMat->alphabetSize-1;
@@ -104,88 +406,17 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
 
 #pragma omp for schedule(dynamic, 100)
             for (size_t id = start; id < (start + bucketSize); id++) {
-                Debug::printProgress(id);
                 seq.mapSequence(id, id, seqDbr.getData(id));
+                progress.update(1, seq.L);
                 size_t seqHash = highestPossibleIndex + static_cast<unsigned int>(Util::hash(seq.int_sequence, seq.L));
 
-                // mask using tantan
-                if (par.maskMode == 1) {
-                    for (int i = 0; i < seq.L; i++) {
-                        charSequence[i] = (char) seq.int_sequence[i];
-                    }
-                    tantan::maskSequences(charSequence,
-                                          charSequence + seq.L,
-                                          50 /*options.maxCycleLength*/,
-                                          probMatrix->probMatrixPointers,
-                                          0.005 /*options.repeatProb*/,
-                                          0.05 /*options.repeatEndProb*/,
-                                          0.5 /*options.repeatOffsetProbDecay*/,
-                                          0, 0,
-                                          0.9 /*options.minMaskProb*/, probMatrix->hardMaskTable);
-                    for (int i = 0; i < seq.L; i++) {
-                        seq.int_sequence[i] = charSequence[i];
-                    }
-                };
-
-
-                int seqKmerCount = 0;
                 unsigned int seqId = seq.getId();
-                unsigned short prevHash = 0;
-                unsigned int prevFirstRes = 0;
-                if (seq.hasNextKmer()) {
-                    const int *kmer = seq.nextKmer();
-                    prevHash = circ_hash(kmer, KMER_SIZE, par.hashShift);
-                    prevFirstRes = kmer[0];
-                }
-                while (seq.hasNextKmer()) {
-                    const int *kmer = seq.nextKmer();
-                    //float kmerScore = 1.0;
-                    prevHash = circ_hash_next(kmer, KMER_SIZE, prevFirstRes, prevHash, par.hashShift);
-                    prevFirstRes = kmer[0];
-                    size_t xCount = 0;
-                    for (size_t kpos = 0; kpos < KMER_SIZE; kpos++) {
-                        xCount += (kmer[kpos] == subMat->aa2int[(int) 'X']);
-                    }
-                    if (xCount > 0) {
-                        continue;
-                    }
-                    (kmers + seqKmerCount)->score = prevHash;
-                    size_t kmerIdx = idxer.int2index(kmer, 0, KMER_SIZE);
-                    (kmers + seqKmerCount)->kmer = kmerIdx;
-                    (kmers + seqKmerCount)->pos = seq.getCurrentPosition();
-                    seqKmerCount++;
-                }
-                if (seqKmerCount > 1) {
-                    std::stable_sort(kmers, kmers + seqKmerCount, SequencePosition::compareByScore);
-                }
-                size_t kmerConsidered = std::min(static_cast<int>(chooseTopKmer - 1), seqKmerCount);
-                if(par.skipNRepeatKmer > 0 ){
-                    size_t prevKmer = SIZE_T_MAX;
-                    kmers[seqKmerCount].kmer=SIZE_T_MAX;
-                    int repeatKmerCnt = 0;
-                    for (int topKmer = 0; topKmer < seqKmerCount; topKmer++) {
-                        repeatKmerCnt += (
-                                (kmers + topKmer)->kmer == (kmers + topKmer + 1)->kmer ||
-                                (kmers + topKmer)->kmer == prevKmer);
-                        prevKmer = threadKmerBuffer[bufferPos].kmer;
-                    }
-                    if(repeatKmerCnt >= par.skipNRepeatKmer){
-                        kmerConsidered = 0;
-                    }
-                }
+                size_t kmerConsidered = maskAndSelectKmers(seq, idxer, par, subMat, probMatrix, charSequence,
+                                                           KMER_SIZE, chooseTopKmer, kmers, selectionBuffer);
 
                 // add k-mer to represent the identity
                 if (seqHash%splits == split) {
-                    threadKmerBuffer[bufferPos].kmer = seqHash;
-                    threadKmerBuffer[bufferPos].id = seqId;
-                    threadKmerBuffer[bufferPos].pos = 0;
-                    threadKmerBuffer[bufferPos].seqLen = seq.L;
-                    bufferPos++;
-                    if (bufferPos >= BUFFER_SIZE) {
-                        size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
-                        memcpy(hashSeqPair + writeOffset, threadKmerBuffer, sizeof(KmerPosition) * bufferPos);
-                        bufferPos = 0;
-                    }
+                    writer.add(seqHash, seqId, 0, seq.L);
                 }
                 for (size_t topKmer = 0; topKmer < kmerConsidered; topKmer++) {
                     size_t splitIdx = (kmers + topKmer)->kmer % splits;
@@ -193,16 +424,7 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
                         continue;
                     }
 
-                    threadKmerBuffer[bufferPos].kmer = (kmers + topKmer)->kmer;
-                    threadKmerBuffer[bufferPos].id = seqId;
-                    threadKmerBuffer[bufferPos].pos = (kmers + topKmer)->pos;
-                    threadKmerBuffer[bufferPos].seqLen = seq.L;
-                    bufferPos++;
-                    if (bufferPos >= BUFFER_SIZE) {
-                        size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
-                        memcpy(hashSeqPair + writeOffset, threadKmerBuffer, sizeof(KmerPosition) * bufferPos);
-                        bufferPos = 0;
-                    }
+                    writer.add((kmers + topKmer)->kmer, seqId, (kmers + topKmer)->pos, seq.L);
                 }
             }
 #pragma omp barrier
@@ -216,24 +438,69 @@ size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int>
 #pragma omp barrier
         }
 
-        if(bufferPos > 0){
-            size_t writeOffset = __sync_fetch_and_add(&offset, bufferPos);
-            memcpy(hashSeqPair+writeOffset, threadKmerBuffer, sizeof(KmerPosition) * bufferPos);
-        }
+        writer.flush();
         delete [] kmers;
         delete [] charSequence;
-        delete [] threadKmerBuffer;
+        if (selectionBuffer != NULL) {
+            delete selectionBuffer;
+        }
     }
+    progress.finish();
 
     if (probMatrix != NULL) {
         delete probMatrix;
     }
-    return offset;
+    return table.kmerCount;
 }
 
-KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
-                             DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
-                             size_t KMER_SIZE, size_t chooseTopKmer) {
+// the radix key only needs as many kmer bytes as the largest kmer (or rep. sequence id) has
+template <typename T>
+unsigned int kmerBytesNeeded(const T *kmers, size_t count) {
+    size_t maxKmer = 0;
+#pragma omp parallel
+    {
+        size_t localMax = 0;
+#pragma omp for schedule(static)
+        for (size_t i = 0; i < count; i++) {
+            const size_t kmer = kmers[i].kmer;
+            localMax = std::max(localMax, kmer);
+        }
+#pragma omp critical
+        {
+            maxKmer = std::max(maxKmer, localMax);
+        }
+    }
+    return KmerPositionRadixKey::bytesNeeded(maxKmer);
+}
+
+void sortKmerPositions(KmerPosition *kmers, size_t count, bool byRepSequence) {
+    const unsigned int kmerBytes = kmerBytesNeeded(kmers, count);
+    if (byRepSequence) {
+        KmerPositionKeyRepSequenceAndIdAndDiag key(kmerBytes);
+        RadixSort::sort(kmers, count, key, key.keyLength(), KmerPosition::compareRepSequenceAndIdAndDiag);
+    } else {
+        KmerPositionKeyRepSequenceAndIdAndPos key(kmerBytes);
+        RadixSort::sort(kmers, count, key, key.keyLength(), KmerPosition::compareRepSequenceAndIdAndPos);
+    }
+}
+
+void sortCompactKmerPositions(KmerPositionCompact *kmers, size_t count) {
+    KmerPositionCompactKey key(kmerBytesNeeded(kmers, count));
+    RadixSort::sort(kmers, count, key, key.keyLength(), KmerPositionCompact::compareKmerAndIdAndPos);
+}
+
+static unsigned short kmerSeqLen(const KmerPosition &kmer, DBReader<unsigned int> &) {
+    return kmer.seqLen;
+}
+
+static unsigned short kmerSeqLen(const KmerPositionCompact &kmer, DBReader<unsigned int> &seqDbr) {
+    return static_cast<unsigned short>(seqDbr.getSeqLens(kmer.id) - 2);
+}
+
+template <>
+KmerPosition * doComputation<KmerPosition>(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
+                                           DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
+                                           size_t KMER_SIZE, size_t chooseTopKmer) {
 
     Debug(Debug::INFO) << "Generate k-mers list " << split <<"\n";
 
@@ -247,7 +514,8 @@ KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std
     }
 
     Timer timer;
-    size_t elementsToSort = fillKmerPositionArray(hashSeqPair, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer, splits, split);
+    KmerPositionArray table(hashSeqPair);
+    size_t elementsToSort = fillKmerPositionArray(table, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer, splits, split);
     Debug(Debug::INFO) << "\nTime for fill: " << timer.lap() << "\n";
     if(splits == 1){
         seqDbr.unmapData();
@@ -255,8 +523,7 @@ KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std
     Debug(Debug::INFO) << "Done." << "\n";
     Debug(Debug::INFO) << "Sort kmer ... ";
     timer.reset();
-    omptl::sort(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition::compareRepSequenceAndIdAndPos);
-    //kx::radix_sort(hashSeqPair, hashSeqPair + elementsToSort, KmerComparision());
+    sortKmerPositions(hashSeqPair, elementsToSort, false);
     Debug(Debug::INFO) << "Done." << "\n";
     Debug(Debug::INFO) << "Time for sort: " << timer.lap() << "\n";
     // assign rep. sequence to same kmer members
@@ -305,11 +572,138 @@ KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std
     // sort by rep. sequence (stored in kmer) and sequence id
     Debug(Debug::INFO) << "Sort by rep. sequence ... ";
     timer.reset();
-    omptl::sort(hashSeqPair, hashSeqPair + writePos, KmerPosition::compareRepSequenceAndIdAndDiag);
-    //kx::radix_sort(hashSeqPair, hashSeqPair + elementsToSort, SequenceComparision());
+    sortKmerPositions(hashSeqPair, writePos, true);
+    Debug(Debug::INFO) << "Done\n";
+    Debug(Debug::INFO) << "Time for sort: " << timer.lap() << "\n";
+
+    if(splits > 1){
+        writeKmersToDisk(splitFile, hashSeqPair, writePos + 1);
+        delete [] hashSeqPair;
+        hashSeqPair = NULL;
+    }
+    return hashSeqPair;
+}
+
+// groups the chunks of the compact table by partition, returns the first chunk of every partition
+std::vector<size_t> groupChunksByPartition(CompactKmerTable &table) {
+    const size_t partitions = table.partitions();
+    const size_t chunkSize = CompactKmerTable::CHUNK_SIZE;
+    std::vector<size_t> partitionStart(partitions + 1, 0);
+    for (size_t chunk = 0; chunk < table.usedChunks; chunk++) {
+        partitionStart[table.chunkPartition[chunk] + 1]++;
+    }
+    for (size_t partition = 0; partition < partitions; partition++) {
+        partitionStart[partition + 1] += partitionStart[partition];
+    }
+    std::vector<size_t> heads(partitionStart.begin(), partitionStart.end() - 1);
+    KmerPositionCompact *chunkBuffer = new KmerPositionCompact[chunkSize];
+    for (size_t partition = 0; partition < partitions; partition++) {
+        while (heads[partition] < partitionStart[partition + 1]) {
+            const size_t chunk = heads[partition];
+            size_t target = table.chunkPartition[chunk];
+            if (target != partition) {
+                // follow the cycle until a chunk of this partition comes back
+                memcpy(chunkBuffer, table.entries + chunk * chunkSize, sizeof(KmerPositionCompact) * chunkSize);
+                while (target != partition) {
+                    const size_t dest = heads[target]++;
+                    std::swap_ranges(chunkBuffer, chunkBuffer + chunkSize, table.entries + dest * chunkSize);
+                    const size_t destPartition = table.chunkPartition[dest];
+                    table.chunkPartition[dest] = static_cast<unsigned short>(target);
+                    target = destPartition;
+                }
+                memcpy(table.entries + chunk * chunkSize, chunkBuffer, sizeof(KmerPositionCompact) * chunkSize);
+                table.chunkPartition[chunk] = static_cast<unsigned short>(partition);
+            }
+            heads[partition]++;
+        }
+    }
+    delete [] chunkBuffer;
+    return partitionStart;
+}
+
+template <>
+KmerPositionCompact * doComputation<KmerPositionCompact>(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
+                                                         DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
+                                                         size_t KMER_SIZE, size_t chooseTopKmer) {
+    Debug(Debug::INFO) << "Generate k-mers list " << split <<"\n";
+
+    size_t splitKmerCount = (splits > 1) ? static_cast<size_t >(static_cast<double>(totalKmers/splits) * 1.2) : totalKmers;
+    const unsigned int partitionBits = CompactKmerTable::partitionBitsNeeded(computeMaxKmer(subMat->alphabetSize, KMER_SIZE));
+    CompactKmerTable table(splitKmerCount, static_cast<size_t>(par.threads), partitionBits);
+
+    Timer timer;
+    fillKmerPositionArray(table, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer, splits, split);
+    Debug(Debug::INFO) << "\nTime for fill: " << timer.lap() << "\n";
+    if(splits == 1){
+        seqDbr.unmapData();
+    }
+    Debug(Debug::INFO) << "Done." << "\n";
+
+    // every partition is sorted on its own and the rep. sequences of its k-mers are assigned right after,
+    // the results are written to the front of the table which only holds already processed partitions
+    Debug(Debug::INFO) << "Sort kmer ... ";
+    timer.reset();
+    std::vector<size_t> partitionStart = groupChunksByPartition(table);
+    const size_t chunkSize = CompactKmerTable::CHUNK_SIZE;
+    KmerPositionCompact *hashSeqPair = table.entries;
+    size_t writePos = 0;
+    for (size_t partition = 0; partition < table.partitions(); partition++) {
+        KmerPositionCompact *kmers = hashSeqPair + partitionStart[partition] * chunkSize;
+        const size_t partitionSize = (partitionStart[partition + 1] - partitionStart[partition]) * chunkSize;
+        sortCompactKmerPositions(kmers, partitionSize);
+        size_t groupStart = 0;
+        while (groupStart < partitionSize && kmers[groupStart].kmer != KmerPositionCompact::EMPTY_KMER) {
+            size_t groupEnd = groupStart + 1;
+            while (groupEnd < partitionSize && kmers[groupEnd].kmer == kmers[groupStart].kmer) {
+                groupEnd++;
+            }
+            // remove singletones from set
+            if (groupEnd - groupStart > 1) {
+                // the longest sequence is the rep. sequence, the lowest id and position break ties
+                size_t repIdx = groupStart;
+                size_t queryLen = kmerSeqLen(kmers[groupStart], seqDbr);
+                for (size_t i = groupStart + 1; i < groupEnd; i++) {
+                    const size_t seqLen = kmerSeqLen(kmers[i], seqDbr);
+                    if (seqLen > queryLen) {
+                        repIdx = i;
+                        queryLen = seqLen;
+                    }
+                }
+                const size_t repSeqId = kmers[repIdx].id;
+                const unsigned int repSeq_i_pos = kmers[repIdx].pos;
+                for (size_t i = groupStart; i < groupEnd; i++) {
+                    const unsigned int id = kmers[i].id;
+                    const unsigned short seqLen = kmerSeqLen(kmers[i], seqDbr);
+                    short diagonal = repSeq_i_pos - kmers[i].pos;
+                    bool canBeExtended = diagonal < 0 || (static_cast<int>(diagonal) > static_cast<int>(queryLen - seqLen));
+                    if(par.includeOnlyExtendable == false || (canBeExtended && par.includeOnlyExtendable ==true )){
+                        hashSeqPair[writePos].kmer = repSeqId;
+                        hashSeqPair[writePos].pos = diagonal;
+                        hashSeqPair[writePos].id = id;
+                        writePos++;
+                    }
+                }
+            }
+            groupStart = groupEnd;
+        }
+    }
+    const size_t tableSize = table.chunkCapacity * chunkSize + 1;
+#pragma omp parallel for
+    for (size_t i = writePos; i < tableSize; i++) {
+        hashSeqPair[i].kmer = KmerPositionCompact::EMPTY_KMER;
+    }
+    Debug(Debug::INFO) << "Done." << "\n";
+    Debug(Debug::INFO) << "Time for sort: " << timer.lap() << "\n";
+
+    // sort by rep. sequence (stored in kmer) and sequence id
+    Debug(Debug::INFO) << "Sort by rep. sequence ... ";
+    timer.reset();
+    sortCompactKmerPositions(hashSeqPair, writePos);
     Debug(Debug::INFO) << "Done\n";
     Debug(Debug::INFO) << "Time for sort: " << timer.lap() << "\n";
 
+    // the caller takes ownership of the entries
+    table.entries = NULL;
     if(splits > 1){
         writeKmersToDisk(splitFile, hashSeqPair, writePos + 1);
         delete [] hashSeqPair;
@@ -337,52 +731,23 @@ size_t computeKmerCount(DBReader<unsigned int> &reader, size_t KMER_SIZE, size_t
     return totalKmers;
 }
 
+template <typename T>
 size_t computeMemoryNeededLinearfilter(size_t totalKmer) {
-    return sizeof(KmerPosition) * totalKmer;
+    return sizeof(T) * totalKmer;
 }
 
-
-int kmermatcher(int argc, const char **argv, const Command &command) {
-    MMseqsMPI::init(argc, argv);
-
-    Parameters &par = Parameters::getInstance();
-    setLinearFilterDefault(&par);
-    par.parseParameters(argc, argv, command, 2, false, 0, MMseqsParameter::COMMAND_CLUSTLINEAR);
-
-    DBReader<unsigned int> seqDbr(par.db1.c_str(), par.db1Index.c_str());
-    seqDbr.open(DBReader<unsigned int>::NOSORT);
-    int querySeqType  =  seqDbr.getDbtype();
-
-    setKmerLengthAndAlphabet(par, seqDbr.getAminoAcidDBSize(), querySeqType);
-    std::vector<MMseqsParameter>* params = command.params;
-    par.printParameters(command.cmd, argc, argv, *params);
-    Debug(Debug::INFO) << "Database type: " << seqDbr.getDbTypeName() << "\n";
-
-    BaseMatrix *subMat;
-    if (querySeqType == Sequence::NUCLEOTIDES) {
-        subMat = new NucleotideMatrix(par.scoringMatrixFile.c_str(), 1.0, 0.0);
-    }else {
-        if (par.alphabetSize == 21) {
-            subMat = new SubstitutionMatrix(par.scoringMatrixFile.c_str(), 2.0, 0.0);
-        } else {
-            SubstitutionMatrix sMat(par.scoringMatrixFile.c_str(), 2.0, 0.0);
-            subMat = new ReducedMatrix(sMat.probMatrix, sMat.subMatrixPseudoCounts, sMat.aa2int, sMat.int2aa, sMat.alphabetSize, par.alphabetSize, 2.0);
-        }
-    }
-
-    //seqDbr.readMmapedDataInMemory();
-    const size_t KMER_SIZE = par.kmerSize;
-    size_t chooseTopKmer = par.kmersPerSequence;
-
+template <typename T>
+void runKmerMatcher(Parameters &par, DBReader<unsigned int> &seqDbr, BaseMatrix *subMat,
+                    size_t KMER_SIZE, size_t chooseTopKmer) {
     size_t memoryLimit;
     if (par.splitMemoryLimit > 0) {
-        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024;
+        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024 * 1024;
     } else {
         memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
     }
     Debug(Debug::INFO) << "\n";
     size_t totalKmers = computeKmerCount(seqDbr, KMER_SIZE, chooseTopKmer);
-    size_t totalSizeNeeded = computeMemoryNeededLinearfilter(totalKmers);
+    size_t totalSizeNeeded = computeMemoryNeededLinearfilter<T>(totalKmers);
     Debug(Debug::INFO) << "Needed memory (" << totalSizeNeeded << " byte) of total memory (" << memoryLimit << " byte)\n";
     // compute splits
     size_t splits = static_cast<size_t>(std::ceil(static_cast<float>(totalSizeNeeded) / memoryLimit));
@@ -393,32 +758,24 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
 
     Debug(Debug::INFO) << "Process file into " << splits << " parts\n";
     std::vector<std::string> splitFiles;
-    KmerPosition *hashSeqPair = NULL;
+    T *hashSeqPair = NULL;
 
     size_t mpiRank = 0;
 #ifdef HAVE_MPI
     splits = std::max(static_cast<size_t>(MMseqsMPI::numProc), splits);
-    size_t fromSplit = 0;
-    size_t splitCount = 1;
     mpiRank = MMseqsMPI::rank;
-    // if split size is great than nodes than we have to
-    // distribute all splits equally over all nodes
-    unsigned int * splitCntPerProc = new unsigned int[MMseqsMPI::numProc];
-    memset(splitCntPerProc, 0, sizeof(unsigned int) * MMseqsMPI::numProc);
-    for(size_t i = 0; i < splits; i++){
-        splitCntPerProc[i % MMseqsMPI::numProc] += 1;
-    }
-    for(int i = 0; i < MMseqsMPI::rank; i++){
-        fromSplit += splitCntPerProc[i];
-    }
-    splitCount = splitCntPerProc[MMseqsMPI::rank];
-    delete[] splitCntPerProc;
-
-    for(size_t split = fromSplit; split < fromSplit+splitCount; split++) {
-        std::string splitFileName = par.db2 + "_split_" +SSTR(split);
-        hashSeqPair = doComputation(totalKmers, split, splits, splitFileName, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer);
+    // the splits are handed out one at a time, a process asks for the next as soon as it is done
+    MPIScheduler scheduler(0, splits, 1, false);
+    std::vector<size_t> computedSplits;
+    size_t fromSplit;
+    size_t splitCount;
+    while (scheduler.next(&fromSplit, &splitCount)) {
+        std::string splitFileName = par.db2 + "_split_" +SSTR(fromSplit);
+        hashSeqPair = doComputation<T>(totalKmers, fromSplit, splits, splitFileName, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer);
+        computedSplits.push_back(fromSplit);
     }
-    MPI_Barrier(MPI_COMM_WORLD);
+    // returns on the master once every process finished its splits
+    computedSplits = MPIScheduler::gather(computedSplits);
     if(mpiRank == 0){
         for(size_t split = 0; split < splits; split++) {
             std::string splitFileName = par.db2 + "_split_" +SSTR(split);
@@ -428,7 +785,7 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
 #else
     for(size_t split = 0; split < splits; split++) {
         std::string splitFileName = par.db2 + "_split_" +SSTR(split);
-        hashSeqPair = doComputation(totalKmers, split, splits, splitFileName, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer);
+        hashSeqPair = doComputation<T>(totalKmers, split, splits, splitFileName, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer);
         splitFiles.push_back(splitFileName);
     }
 #endif
@@ -443,7 +800,7 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
         if(splits > 1) {
             std::cout << "How many splits: " << splits<<std::endl;
             seqDbr.unmapData();
-            mergeKmerFilesAndOutput(seqDbr, dbw, splitFiles, repSequence, par.covMode, par.cov);
+            mergeKmerFilesAndOutput(seqDbr, dbw, splitFiles, repSequence, par.covMode, par.cov, par.threads);
         } else {
             writeKmerMatcherResult(seqDbr, dbw, hashSeqPair, totalKmers, repSequence, par.covMode, par.cov, par.threads);
         }
@@ -471,18 +828,270 @@ int kmermatcher(int argc, const char **argv, const Command &command) {
         dbw.close();
 
     }
-    // free memory
-    delete subMat;
     if(hashSeqPair){
         delete [] hashSeqPair;
     }
+}
+
+struct KmerTableHit {
+    unsigned int repKey;
+    short diagonal;
+
+    static bool compareByRepKeyAndDiagonal(const KmerTableHit &first, const KmerTableHit &second) {
+        if (first.repKey != second.repKey) {
+            return first.repKey < second.repKey;
+        }
+        return first.diagonal < second.diagonal;
+    }
+};
+
+static bool compareHitsByScoreAndId(const hit_t &first, const hit_t &second) {
+    if (first.pScore != second.pScore) {
+        return first.pScore > second.pScore;
+    }
+    return first.seqId < second.seqId;
+}
+
+// matches the k-mers of every sequence against the representative k-mer table and writes one result
+// per sequence: the representatives sharing k-mers, scored by the number of shared k-mers,
+// with the diagonal most of them agree on
+void searchKmerTable(Parameters &par, DBReader<unsigned int> &seqDbr, BaseMatrix *subMat,
+                     size_t KMER_SIZE, size_t chooseTopKmer, const KmerTableFile &kmerTable) {
+    Debug(Debug::INFO) << "Match k-mers against table with " << kmerTable.size() << " entries\n";
+    DBWriter dbw(par.db2.c_str(), par.db2Index.c_str(), par.threads);
+    dbw.open();
+    const int querySeqType = seqDbr.getDbtype();
+    ProbabilityMatrix *probMatrix = NULL;
+    if (par.maskMode == 1) {
+        probMatrix = new ProbabilityMatrix(*subMat);
+    }
+    Progress progress("kmersearch", seqDbr.getSize());
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        Sequence seq(par.maxSeqLen, querySeqType, subMat, KMER_SIZE, false, false);
+        Indexer idxer(subMat->alphabetSize, KMER_SIZE);
+        char *charSequence = new char[par.maxSeqLen];
+        SequencePosition *kmers = new SequencePosition[par.maxSeqLen + 1];
+        KmerSelectionBuffer *selectionBuffer = NULL;
+        if (par.kmerSelectionMode != Parameters::KMER_SELECTION_LOWEST_HASH) {
+            selectionBuffer = new KmerSelectionBuffer(par.maxSeqLen);
+        }
+        int highestSeq[32];
+        for (size_t i = 0; i < KMER_SIZE; i++) {
+            highestSeq[i] = subMat->alphabetSize - 1;
+        }
+        const size_t highestPossibleIndex = idxer.int2index(highestSeq);
+        std::vector<KmerTableHit> kmerHits;
+        std::vector<hit_t> hits;
+        std::string resultBuffer;
+        char buffer[100];
+
+#pragma omp for schedule(dynamic, 100)
+        for (size_t id = 0; id < seqDbr.getSize(); id++) {
+            seq.mapSequence(id, id, seqDbr.getData(id));
+            progress.update(1, seq.L);
+            const unsigned int queryLen = seq.L;
+            const size_t seqHash = highestPossibleIndex + static_cast<unsigned int>(Util::hash(seq.int_sequence, seq.L));
+            const size_t kmerConsidered = maskAndSelectKmers(seq, idxer, par, subMat, probMatrix, charSequence,
+                                                             KMER_SIZE, chooseTopKmer, kmers, selectionBuffer);
+            kmerHits.clear();
+            for (size_t i = 0; i <= kmerConsidered; i++) {
+                // the last lookup is the k-mer representing the identity
+                const size_t kmer = (i < kmerConsidered) ? kmers[i].kmer : seqHash;
+                const int pos = (i < kmerConsidered) ? static_cast<int>(kmers[i].pos) : 0;
+                const KmerTableEntry *entry = kmerTable.find(kmer);
+                if (entry == NULL || Util::canBeCovered(par.covThr, par.covMode, static_cast<float>(queryLen),
+                                                        static_cast<float>(entry->seqLen)) == false) {
+                    continue;
+                }
+                KmerTableHit hit;
+                hit.repKey = entry->repKey;
+                hit.diagonal = static_cast<short>(pos - entry->pos);
+                kmerHits.push_back(hit);
+            }
+            std::sort(kmerHits.begin(), kmerHits.end(), KmerTableHit::compareByRepKeyAndDiagonal);
+
+            hits.clear();
+            for (size_t start = 0; start < kmerHits.size();) {
+                size_t end = start;
+                size_t bestDiagonalStart = start;
+                size_t bestDiagonalCount = 0;
+                while (end < kmerHits.size() && kmerHits[end].repKey == kmerHits[start].repKey) {
+                    size_t diagonalEnd = end;
+                    while (diagonalEnd < kmerHits.size() && kmerHits[diagonalEnd].repKey == kmerHits[start].repKey
+                           && kmerHits[diagonalEnd].diagonal == kmerHits[end].diagonal) {
+                        diagonalEnd++;
+                    }
+                    if (diagonalEnd - end > bestDiagonalCount) {
+                        bestDiagonalCount = diagonalEnd - end;
+                        bestDiagonalStart = end;
+                    }
+                    end = diagonalEnd;
+                }
+                hit_t h;
+                h.seqId = kmerHits[start].repKey;
+                h.pScore = static_cast<float>(end - start);
+                h.diagonal = static_cast<unsigned short>(kmerHits[bestDiagonalStart].diagonal);
+                hits.push_back(h);
+                start = end;
+            }
+            std::sort(hits.begin(), hits.end(), compareHitsByScoreAndId);
+
+            resultBuffer.clear();
+            for (size_t i = 0; i < hits.size(); i++) {
+                const size_t len = QueryMatcher::prefilterHitToBuffer(buffer, hits[i]);
+                resultBuffer.append(buffer, len);
+            }
+            dbw.writeData(resultBuffer.c_str(), resultBuffer.length(), seqDbr.getDbKey(id), thread_idx);
+        }
+
+        delete [] kmers;
+        delete [] charSequence;
+        if (selectionBuffer != NULL) {
+            delete selectionBuffer;
+        }
+    }
+    progress.finish();
+    if (probMatrix != NULL) {
+        delete probMatrix;
+    }
+    dbw.close();
+}
+
+// writes the representative k-mer table of seqDbr to par.kmerTableOut: every selected k-mer with the
+// longest sequence containing it. K-mers already in previousTable keep their representative.
+void writeRepKmerTable(Parameters &par, DBReader<unsigned int> &seqDbr, BaseMatrix *subMat,
+                       size_t KMER_SIZE, size_t chooseTopKmer, const KmerTableFile *previousTable) {
+    Debug(Debug::INFO) << "Write k-mer table " << par.kmerTableOut << "\n";
+    seqDbr.remapData();
+    // every sequence adds one more k-mer to represent the identity
+    const size_t maxKmerCount = computeKmerCount(seqDbr, KMER_SIZE, chooseTopKmer) + seqDbr.getSize();
+    KmerPosition *kmers = new(std::nothrow) KmerPosition[maxKmerCount];
+    Util::checkAllocation(kmers, "Could not allocate memory");
+    KmerPositionArray table(kmers);
+    const size_t kmerCount = fillKmerPositionArray(table, seqDbr, par, subMat, KMER_SIZE, chooseTopKmer, 1, 0);
+    // sorted by kmer, the longest sequence first
+    sortKmerPositions(kmers, kmerCount, false);
+
+    std::vector<KmerTableEntry> entries;
+    for (size_t i = 0; i < kmerCount; i++) {
+        if (i > 0 && kmers[i].kmer == kmers[i - 1].kmer) {
+            continue;
+        }
+        KmerTableEntry entry;
+        entry.kmer = kmers[i].kmer;
+        entry.repKey = seqDbr.getDbKey(kmers[i].id);
+        entry.pos = kmers[i].pos;
+        entry.seqLen = kmers[i].seqLen;
+        entries.push_back(entry);
+    }
+    delete [] kmers;
+
+    if (previousTable != NULL) {
+        const KmerTableEntry *previous = previousTable->getEntries();
+        const size_t previousCount = previousTable->size();
+        std::vector<KmerTableEntry> merged;
+        merged.reserve(previousCount + entries.size());
+        size_t i = 0;
+        size_t j = 0;
+        while (i < previousCount || j < entries.size()) {
+            if (j == entries.size() || (i < previousCount && previous[i].kmer <= entries[j].kmer)) {
+                if (j < entries.size() && previous[i].kmer == entries[j].kmer) {
+                    j++;
+                }
+                merged.push_back(previous[i++]);
+            } else {
+                merged.push_back(entries[j++]);
+            }
+        }
+        Debug(Debug::INFO) << "Added " << (merged.size() - previousCount) << " k-mers to the " << previousCount << " of the previous table\n";
+        entries.swap(merged);
+    }
+
+    KmerTableHeader header(par, seqDbr.getDbtype(), entries.size());
+    writeKmerTable(par.kmerTableOut, header, entries.data(), entries.size());
+    Debug(Debug::INFO) << "K-mer table with " << entries.size() << " entries written\n";
+}
+
+int kmermatcher(int argc, const char **argv, const Command &command) {
+    MMseqsMPI::init(argc, argv);
+
+    Parameters &par = Parameters::getInstance();
+    setLinearFilterDefault(&par);
+    par.parseParameters(argc, argv, command, 2, false, 0, MMseqsParameter::COMMAND_CLUSTLINEAR);
+
+    DBReader<unsigned int> seqDbr(par.db1.c_str(), par.db1Index.c_str());
+    seqDbr.open(DBReader<unsigned int>::NOSORT);
+    int querySeqType  =  seqDbr.getDbtype();
+
+    setKmerLengthAndAlphabet(par, seqDbr.getAminoAcidDBSize(), querySeqType);
+    KmerTableFile *kmerTable = NULL;
+    if (par.kmerTableIn.empty() == false) {
+        kmerTable = new KmerTableFile(par.kmerTableIn);
+        if (kmerTable->getHeader().dbType != querySeqType) {
+            Debug(Debug::ERROR) << "K-mer table " << par.kmerTableIn << " was built for a different database type\n";
+            EXIT(EXIT_FAILURE);
+        }
+        // k-mers only match if they are selected the same way as in the table
+        kmerTable->getHeader().applyParameters(par);
+    }
+    std::vector<MMseqsParameter>* params = command.params;
+    par.printParameters(command.cmd, argc, argv, *params);
+    Debug(Debug::INFO) << "Database type: " << seqDbr.getDbTypeName() << "\n";
+
+    BaseMatrix *subMat;
+    if (querySeqType == Sequence::NUCLEOTIDES) {
+        subMat = new NucleotideMatrix(par.scoringMatrixFile.c_str(), 1.0, 0.0);
+    }else {
+        if (par.alphabetSize == 21) {
+            subMat = new SubstitutionMatrix(par.scoringMatrixFile.c_str(), 2.0, 0.0);
+        } else {
+            SubstitutionMatrix sMat(par.scoringMatrixFile.c_str(), 2.0, 0.0);
+            subMat = new ReducedMatrix(sMat.probMatrix, sMat.subMatrixPseudoCounts, sMat.aa2int, sMat.int2aa, sMat.alphabetSize, par.alphabetSize, 2.0);
+        }
+    }
+
+    //seqDbr.readMmapedDataInMemory();
+    const size_t KMER_SIZE = par.kmerSize;
+    size_t chooseTopKmer = par.kmersPerSequence;
+
+    if (par.compactKmerTable) {
+        if (CompactKmerTable::partitionBitsNeeded(computeMaxKmer(subMat->alphabetSize, KMER_SIZE)) == 0) {
+            Debug(Debug::WARNING) << "k-mers are too long for the compact k-mer table\n";
+            par.compactKmerTable = false;
+        }
+    }
+    if (par.kmerTableOut.empty() == false) {
+        // only the table is built, the result database stays empty
+        DBWriter dbw(par.db2.c_str(), par.db2Index.c_str(), 1);
+        dbw.open();
+        dbw.close();
+        writeRepKmerTable(par, seqDbr, subMat, KMER_SIZE, chooseTopKmer, kmerTable);
+    } else if (kmerTable != NULL) {
+        searchKmerTable(par, seqDbr, subMat, KMER_SIZE, chooseTopKmer, *kmerTable);
+    } else if (par.compactKmerTable) {
+        runKmerMatcher<KmerPositionCompact>(par, seqDbr, subMat, KMER_SIZE, chooseTopKmer);
+    } else {
+        runKmerMatcher<KmerPosition>(par, seqDbr, subMat, KMER_SIZE, chooseTopKmer);
+    }
+    if (kmerTable != NULL) {
+        delete kmerTable;
+    }
+
+    // free memory
+    delete subMat;
     seqDbr.close();
 
     return EXIT_SUCCESS;
 }
 
+template <typename T>
 void writeKmerMatcherResult(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
-                            KmerPosition *hashSeqPair, size_t totalKmers,
+                            T *hashSeqPair, size_t totalKmers,
                             std::vector<char> &repSequence, int covMode, float covThr,
                             size_t threads) {
     std::vector<size_t> threadOffsets;
@@ -508,7 +1117,7 @@ void writeKmerMatcherResult(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
         unsigned int queryLength = 0;
         size_t kmerPos=0;
         size_t repSeqId = SIZE_T_MAX;
-        for(kmerPos = threadOffsets[thread]; kmerPos < threadOffsets[thread+1] && hashSeqPair[kmerPos].kmer != SIZE_T_MAX; kmerPos++){
+        for(kmerPos = threadOffsets[thread]; kmerPos < threadOffsets[thread+1] && hashSeqPair[kmerPos].kmer != T::EMPTY_KMER; kmerPos++){
             if(repSeqId != hashSeqPair[kmerPos].kmer) {
                 if (writeSets > 0) {
                     repSequence[repSeqId] = true;
@@ -521,7 +1130,7 @@ void writeKmerMatcherResult(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
                 lastTargetId = SIZE_T_MAX;
                 prefResultsOutString.clear();
                 repSeqId = hashSeqPair[kmerPos].kmer;
-                queryLength = hashSeqPair[kmerPos].seqLen;
+                queryLength = kmerSeqLen(hashSeqPair[kmerPos], seqDbr);
                 hit_t h;
                 h.seqId = seqDbr.getDbKey(repSeqId);
                 h.pScore = 0;
@@ -531,7 +1140,7 @@ void writeKmerMatcherResult(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
                 prefResultsOutString.append(buffer, len);
             }
             unsigned int targetId = hashSeqPair[kmerPos].id;
-            unsigned int targetLength = hashSeqPair[kmerPos].seqLen;
+            unsigned int targetLength = kmerSeqLen(hashSeqPair[kmerPos], seqDbr);
             unsigned short diagonal = hashSeqPair[kmerPos].pos;
             // remove similar double sequence hit
             if(targetId != repSeqId && lastTargetId != targetId ){
@@ -566,179 +1175,153 @@ void writeKmerMatcherResult(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
 }
 
 
-typedef std::priority_queue<FileKmerPosition, std::vector<FileKmerPosition>, CompareResultBySeqId> KmerPositionQueue;
-
-size_t queueNextEntry(KmerPositionQueue &queue, int file, size_t offsetPos, KmerEntry *entries, size_t entrySize) {
-    if(offsetPos + 1 >= entrySize){
-        return offsetPos;
-    }
-    unsigned int repSeqId = entries[offsetPos].seqId;
-    size_t pos = 0;
-    while(entries[offsetPos + pos].seqId != UINT_MAX){
-        queue.push(FileKmerPosition(repSeqId, entries[offsetPos+pos].seqId,  entries[offsetPos+pos].diagonal, file));
-        pos++;
-    }
-    queue.push(FileKmerPosition(repSeqId, UINT_MAX, 0, file));
-    pos++;
-    return offsetPos+pos;
+static bool compareKmerEntryByIdAndDiagonal(const KmerEntry &first, const KmerEntry &second) {
+    if (first.seqId < second.seqId)
+        return true;
+    if (second.seqId < first.seqId)
+        return false;
+    if (first.diagonal < second.diagonal)
+        return true;
+    return false;
 }
 
 void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
                              std::vector<std::string> tmpFiles, std::vector<char> &repSequence,
-                             int covMode, float covThr) {
+                             int covMode, float covThr, size_t threads) {
     Debug(Debug::INFO) << "Merge splits ... ";
 
-    const int fileCnt = tmpFiles.size();
-    FILE ** files       = new FILE*[fileCnt];
-    KmerEntry **entries = new KmerEntry*[fileCnt];
-    size_t * entrySizes = new size_t[fileCnt];
-    size_t * offsetPos  = new size_t[fileCnt];
-    size_t * dataSizes  = new size_t[fileCnt];
-    // init structures
-    for(size_t file = 0; file < tmpFiles.size(); file++){
-        files[file] = FileUtil::openFileOrDie(tmpFiles[file].c_str(),"r",true);
-        size_t dataSize;
-        entries[file]    = (KmerEntry*)FileUtil::mmapFile(files[file], &dataSize);
-        dataSizes[file]  = dataSize;
-        entrySizes[file] = dataSize/sizeof(KmerEntry);
-    }
-    KmerPositionQueue queue;
-    // read one entry for each file
-    for(int file = 0; file < fileCnt; file++ ){
-        offsetPos[file]=queueNextEntry(queue, file, 0, entries[file], entrySizes[file]);
-    }
-    std::string prefResultsOutString;
-    prefResultsOutString.reserve(100000000);
-    char buffer[100];
-    FileKmerPosition filePrevsKmerPos;
-    filePrevsKmerPos.id = UINT_MAX;
-    FileKmerPosition res;
-    size_t queryLength;
-    if(queue.empty() == false){
-        res = queue.top();
-        hit_t h;
-        h.seqId = seqDbr.getDbKey(res.repSeq);
-        h.pScore = 0;
-        h.diagonal = 0;
-        int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
-        prefResultsOutString.append(buffer, len);
-        queryLength = seqDbr.getSeqLens(res.repSeq);
-    }
-    while(queue.empty() == false) {
-        res = queue.top();
-        queue.pop();
-        if(res.id==UINT_MAX){
-            offsetPos[res.file] = queueNextEntry(queue, res.file, offsetPos[res.file],
-                                                 entries[res.file], entrySizes[res.file]);
-            dbw.writeData(prefResultsOutString.c_str(), prefResultsOutString.length(), seqDbr.getDbKey(res.repSeq), 0);
-            repSequence[res.repSeq]=true;
-            prefResultsOutString.clear();
-            // skipe UINT MAX entries
-            while(queue.empty() == false && queue.top().id==UINT_MAX){
-                res = queue.top();
-                queue.pop();
-                offsetPos[res.file] = queueNextEntry(queue, res.file, offsetPos[res.file],
-                                                     entries[res.file], entrySizes[res.file]);
+    std::vector<KmerSplitFile *> files;
+    for (size_t file = 0; file < tmpFiles.size(); file++) {
+        files.push_back(new KmerSplitFile(tmpFiles[file]));
+    }
+
+    // cut the rep. sequence ids into ranges with about the same number of entries,
+    // the ranges are merged independently and written by the thread that merged them
+    std::vector<std::pair<unsigned int, size_t> > blockStarts;
+    size_t totalEntries = 0;
+    for (size_t file = 0; file < files.size(); file++) {
+        const std::vector<KmerSplitBlock> &blocks = files[file]->getBlocks();
+        for (size_t i = 0; i < blocks.size(); i++) {
+            blockStarts.push_back(std::make_pair(blocks[i].firstRep, blocks[i].entries));
+            totalEntries += blocks[i].entries;
+        }
+    }
+    std::sort(blockStarts.begin(), blockStarts.end());
+    const size_t rangeCount = threads * 16;
+    std::vector<unsigned int> rangeStart;
+    rangeStart.push_back(0);
+    size_t entries = 0;
+    for (size_t i = 0; i < blockStarts.size(); i++) {
+        if (entries >= (totalEntries * rangeStart.size()) / rangeCount && blockStarts[i].first > rangeStart.back()) {
+            rangeStart.push_back(blockStarts[i].first);
+        }
+        entries += blockStarts[i].second;
+    }
+    rangeStart.push_back(UINT_MAX);
+
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        std::string prefResultsOutString;
+        char buffer[100];
+        std::vector<KmerEntry> members;
+
+#pragma omp for schedule(dynamic, 1)
+        for (size_t range = 0; range < rangeStart.size() - 1; range++) {
+            const unsigned int toRep = rangeStart[range + 1];
+            std::vector<KmerSplitFile::Cursor> cursors;
+            cursors.reserve(files.size());
+            for (size_t file = 0; file < files.size(); file++) {
+                cursors.push_back(KmerSplitFile::Cursor(*files[file], rangeStart[range]));
             }
-            if(queue.empty() == false){
-                res = queue.top();
+            while (true) {
+                unsigned int repSeq = UINT_MAX;
+                for (size_t file = 0; file < cursors.size(); file++) {
+                    if (cursors[file].hasGroup() && cursors[file].repSeq() < toRep) {
+                        repSeq = std::min(repSeq, cursors[file].repSeq());
+                    }
+                }
+                if (repSeq == UINT_MAX) {
+                    break;
+                }
+                members.clear();
+                for (size_t file = 0; file < cursors.size(); file++) {
+                    if (cursors[file].hasGroup() && cursors[file].repSeq() == repSeq) {
+                        members.insert(members.end(), cursors[file].members().begin(), cursors[file].members().end());
+                        cursors[file].next();
+                    }
+                }
+                std::sort(members.begin(), members.end(), compareKmerEntryByIdAndDiagonal);
+
                 hit_t h;
-                h.seqId = seqDbr.getDbKey(res.repSeq);
+                h.seqId = seqDbr.getDbKey(repSeq);
                 h.pScore = 0;
                 h.diagonal = 0;
                 int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
                 prefResultsOutString.append(buffer, len);
-                queryLength = seqDbr.getSeqLens(res.repSeq);
-            }
-        }
-        // if its not a duplicate
-        if(filePrevsKmerPos.id != res.id && res.repSeq != res.id && res.id!=UINT_MAX){
-            unsigned int targetLength = seqDbr.getSeqLens(res.id);
-            if(Util::canBeCovered(covThr, covMode,
-                                  static_cast<float>(queryLength),
-                                  static_cast<float>(targetLength)) == true){
-                hit_t h;
-                h.seqId = seqDbr.getDbKey(res.id);
-                h.pScore = 0;
-                h.diagonal = res.pos;
-                int len = QueryMatcher::prefilterHitToBuffer(buffer, h);
-                prefResultsOutString.append(buffer, len);
+                const size_t queryLength = seqDbr.getSeqLens(repSeq);
+                unsigned int prevId = UINT_MAX;
+                for (size_t i = 0; i < members.size(); i++) {
+                    // if its not a duplicate
+                    if (prevId != members[i].seqId && members[i].seqId != repSeq) {
+                        unsigned int targetLength = seqDbr.getSeqLens(members[i].seqId);
+                        if(Util::canBeCovered(covThr, covMode,
+                                              static_cast<float>(queryLength),
+                                              static_cast<float>(targetLength)) == true){
+                            h.seqId = seqDbr.getDbKey(members[i].seqId);
+                            h.pScore = 0;
+                            h.diagonal = members[i].diagonal;
+                            len = QueryMatcher::prefilterHitToBuffer(buffer, h);
+                            prefResultsOutString.append(buffer, len);
+                        }
+                    }
+                    prevId = members[i].seqId;
+                }
+                dbw.writeData(prefResultsOutString.c_str(), prefResultsOutString.length(), seqDbr.getDbKey(repSeq), thread_idx);
+                repSequence[repSeq] = true;
+                prefResultsOutString.clear();
             }
         }
-        filePrevsKmerPos = res;
     }
-    for(size_t file = 0; file < tmpFiles.size(); file++) {
-        fclose(files[file]);
-        if(munmap((void*)entries[file], dataSizes[file]) < 0){
-            Debug(Debug::ERROR) << "Failed to munmap memory dataSize=" << dataSizes[file] <<"\n";
-            EXIT(EXIT_FAILURE);
-        }
+
+    for (size_t file = 0; file < files.size(); file++) {
+        delete files[file];
     }
     Debug(Debug::INFO) << "Done\n";
-
-    delete [] dataSizes;
-    delete [] offsetPos;
-    delete [] entries;
-    delete [] entrySizes;
-    delete [] files;
 }
 
-
-
-void writeKmersToDisk(std::string tmpFile, KmerPosition *hashSeqPair, size_t totalKmers) {
+template <typename T>
+void writeKmersToDisk(std::string tmpFile, T *hashSeqPair, size_t totalKmers) {
+    KmerSplitWriter writer(tmpFile);
+    std::vector<KmerEntry> members;
     size_t repSeqId = SIZE_T_MAX;
     size_t lastTargetId = SIZE_T_MAX;
-    FILE* filePtr = fopen(tmpFile.c_str(), "wb");
-    if(filePtr == NULL) { perror(tmpFile.c_str()); EXIT(EXIT_FAILURE); }
-    unsigned int writeSets = 0;
-    const size_t BUFFER_SIZE = 2048;
-    size_t bufferPos = 0;
-    size_t elemenetCnt = 0;
-    KmerEntry writeBuffer[BUFFER_SIZE];
-    KmerEntry nullEntry;
-    nullEntry.seqId=UINT_MAX;
-    nullEntry.diagonal=0;
-    for(size_t kmerPos = 0; kmerPos < totalKmers && hashSeqPair[kmerPos].kmer != SIZE_T_MAX; kmerPos++){
+    for(size_t kmerPos = 0; kmerPos < totalKmers && hashSeqPair[kmerPos].kmer != T::EMPTY_KMER; kmerPos++){
         if(repSeqId != hashSeqPair[kmerPos].kmer) {
-            if (writeSets > 0 && elemenetCnt > 0) {
-                if(bufferPos > 0){
-                    fwrite(writeBuffer, sizeof(KmerEntry), bufferPos, filePtr);
-                }
-                fwrite(&nullEntry, sizeof(KmerEntry), 1, filePtr);
+            if (members.empty() == false) {
+                writer.writeGroup(repSeqId, members.data(), members.size());
+                members.clear();
             }
             lastTargetId = SIZE_T_MAX;
-            bufferPos=0;
-            elemenetCnt=0;
             repSeqId = hashSeqPair[kmerPos].kmer;
-            writeBuffer[bufferPos].seqId = repSeqId;
-            writeBuffer[bufferPos].diagonal = 0;
-            bufferPos++;
         }
         unsigned int targetId = hashSeqPair[kmerPos].id;
-        unsigned short diagonal = hashSeqPair[kmerPos].pos;
         // remove similar double sequence hit
         if(targetId != repSeqId && lastTargetId != targetId ){
-            ;
-        }else{
-            lastTargetId = targetId;
-            continue;
-        }
-        elemenetCnt++;
-        writeBuffer[bufferPos].seqId = targetId;
-        writeBuffer[bufferPos].diagonal = diagonal;
-        bufferPos++;
-        if(bufferPos >= BUFFER_SIZE){
-            fwrite(writeBuffer, sizeof(KmerEntry), bufferPos, filePtr);
-            bufferPos=0;
+            KmerEntry entry;
+            entry.seqId = targetId;
+            entry.diagonal = hashSeqPair[kmerPos].pos;
+            members.push_back(entry);
         }
         lastTargetId = targetId;
-        writeSets++;
     }
-    if (writeSets > 0 && elemenetCnt > 0 && bufferPos > 0) {
-        fwrite(writeBuffer, sizeof(KmerEntry), bufferPos, filePtr);
-        fwrite(&nullEntry,  sizeof(KmerEntry), 1, filePtr);
+    if (members.empty() == false) {
+        writer.writeGroup(repSeqId, members.data(), members.size());
     }
-    fclose(filePtr);
+    writer.close();
 }
 
 void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqTyp) {
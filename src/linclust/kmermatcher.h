@@ -4,8 +4,11 @@
 #include "DBReader.h"
 #include "Parameters.h"
 #include "BaseMatrix.h"
+#include "Sequence.h"
+#include "Indexer.h"
 
 struct KmerPosition {
+    static const size_t EMPTY_KMER = static_cast<size_t>(-1);
     size_t kmer;
     unsigned int id;
     unsigned short seqLen;
@@ -53,73 +56,248 @@ struct KmerPosition {
     }
 };
 
-struct __attribute__((__packed__)) KmerEntry {
-    unsigned int seqId;
-    short diagonal;
+// radix keys matching the comparators of KmerPosition, most significant byte first
+// only the lowest kmerBytes bytes of the kmer field take part in the key
+struct KmerPositionRadixKey {
+    unsigned int kmerBytes;
+    KmerPositionRadixKey(unsigned int kmerBytes) : kmerBytes(kmerBytes) {}
+
+    template <typename T>
+    unsigned char kmerByte(const T &kmer, unsigned int level) const {
+        return static_cast<unsigned char>(kmer.kmer >> (8 * (kmerBytes - 1 - level)));
+    }
+
+    static unsigned int bytesNeeded(size_t maxValue) {
+        unsigned int bytes = 1;
+        while (bytes < sizeof(size_t) && (maxValue >> (8 * bytes)) != 0) {
+            bytes++;
+        }
+        return bytes;
+    }
 };
 
-void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
-                             std::vector<std::string> tmpFiles, std::vector<char> &repSequence,
-                             int covMode, float covThr) ;
+// kmer, seqLen descending, id, pos
+struct KmerPositionKeyRepSequenceAndIdAndPos : public KmerPositionRadixKey {
+    KmerPositionKeyRepSequenceAndIdAndPos(unsigned int kmerBytes) : KmerPositionRadixKey(kmerBytes) {}
 
-void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqType);
+    unsigned int keyLength() const {
+        return kmerBytes + 8;
+    }
 
-void writeKmersToDisk(std::string tmpFile, KmerPosition *kmers, size_t totalKmers);
+    unsigned char operator()(const KmerPosition &kmer, unsigned int level) const {
+        if (level < kmerBytes) {
+            return kmerByte(kmer, level);
+        }
+        level -= kmerBytes;
+        if (level < 2) {
+            const unsigned short seqLen = 0xFFFF - kmer.seqLen;
+            return static_cast<unsigned char>(seqLen >> (8 * (1 - level)));
+        }
+        level -= 2;
+        if (level < 4) {
+            return static_cast<unsigned char>(kmer.id >> (8 * (3 - level)));
+        }
+        level -= 4;
+        const unsigned short pos = static_cast<unsigned short>(kmer.pos) ^ 0x8000;
+        return static_cast<unsigned char>(pos >> (8 * (1 - level)));
+    }
+};
 
-void writeKmerMatcherResult(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
-                            KmerPosition *hashSeqPair, size_t totalKmers,
-                            std::vector<char> &repSequence, int covMode, float covThr,
-                            size_t threads);
+// kmer (rep. sequence), id, pos
+struct KmerPositionKeyRepSequenceAndIdAndDiag : public KmerPositionRadixKey {
+    KmerPositionKeyRepSequenceAndIdAndDiag(unsigned int kmerBytes) : KmerPositionRadixKey(kmerBytes) {}
 
-KmerPosition * doComputation(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
-                             DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
-                             size_t KMER_SIZE, size_t chooseTopKmer);
+    unsigned int keyLength() const {
+        return kmerBytes + 6;
+    }
 
-size_t fillKmerPositionArray(KmerPosition * hashSeqPair, DBReader<unsigned int> &seqDbr,
-                             Parameters & par, BaseMatrix * subMat,
-                             size_t KMER_SIZE, size_t chooseTopKmer,
-                             size_t splits, size_t split);
+    unsigned char operator()(const KmerPosition &kmer, unsigned int level) const {
+        if (level < kmerBytes) {
+            return kmerByte(kmer, level);
+        }
+        level -= kmerBytes;
+        if (level < 4) {
+            return static_cast<unsigned char>(kmer.id >> (8 * (3 - level)));
+        }
+        level -= 4;
+        const unsigned short pos = static_cast<unsigned short>(kmer.pos) ^ 0x8000;
+        return static_cast<unsigned char>(pos >> (8 * (1 - level)));
+    }
+};
 
-size_t computeMemoryNeededLinearfilter(size_t totalKmer);
+void sortKmerPositions(KmerPosition *kmers, size_t count, bool byRepSequence);
 
-size_t computeKmerCount(DBReader<unsigned int> &reader, size_t KMER_SIZE, size_t chooseTopKmer);
+// 12 byte entry of the compact k-mer table (--compact-kmer-table)
+// The sequence length is looked up in the sequence database and the k-mer only keeps the bits above
+// the hash partition it was assigned to. After the rep. sequence assignment kmer holds the rep. sequence id.
+struct __attribute__((__packed__)) KmerPositionCompact {
+    static const size_t KMER_BITS = 48;
+    static const size_t EMPTY_KMER = (1ull << KMER_BITS) - 1;
+    size_t kmer : 48;
+    unsigned int id;
+    short pos;
 
-size_t computeMemoryNeededLinearfilter(size_t totalKmer);
+    static bool compareKmerAndIdAndPos(const KmerPositionCompact &first, const KmerPositionCompact &second){
+        if(first.kmer < second.kmer)
+            return true;
+        if(second.kmer < first.kmer)
+            return false;
+        if(first.id < second.id)
+            return true;
+        if(second.id < first.id)
+            return false;
+        if(first.pos < second.pos)
+            return true;
+        if(second.pos < first.pos)
+            return false;
+        return false;
+    }
+};
 
-unsigned circ_hash(const int * x, unsigned length, const unsigned rol);
+// kmer, id, pos
+struct KmerPositionCompactKey : public KmerPositionRadixKey {
+    KmerPositionCompactKey(unsigned int kmerBytes) : KmerPositionRadixKey(kmerBytes) {}
 
-unsigned circ_hash_next(const int * x, unsigned length, int x_first, short unsigned h, const unsigned rol);
+    unsigned int keyLength() const {
+        return kmerBytes + 6;
+    }
 
-struct FileKmerPosition {
-    size_t repSeq;
-    unsigned int id;
-    short pos;
-    unsigned int file;
-    FileKmerPosition(){}
-    FileKmerPosition(size_t repSeq, unsigned int id,short pos, unsigned int file):
-            repSeq(repSeq), id(id), pos(pos), file(file) {}
+    unsigned char operator()(const KmerPositionCompact &kmer, unsigned int level) const {
+        if (level < kmerBytes) {
+            return kmerByte(kmer, level);
+        }
+        level -= kmerBytes;
+        if (level < 4) {
+            return static_cast<unsigned char>(kmer.id >> (8 * (3 - level)));
+        }
+        level -= 4;
+        const unsigned short pos = static_cast<unsigned short>(kmer.pos) ^ 0x8000;
+        return static_cast<unsigned char>(pos >> (8 * (1 - level)));
+    }
 };
 
-class CompareResultBySeqId {
-public:
-    bool operator() (FileKmerPosition & first, FileKmerPosition & second) {
-        //return (first.eval < second.eval);
-        if(first.repSeq > second.repSeq )
+// The compact table is filled in chunks of CHUNK_SIZE entries, each chunk holds entries of one hash partition.
+// The chunks are grouped by partition afterwards, so that every partition can be sorted on its own.
+struct CompactKmerTable {
+    static const size_t CHUNK_SIZE = 1024;
+    static const unsigned int MIN_PARTITION_BITS = 4;
+    static const unsigned int MAX_PARTITION_BITS = 8;
+
+    KmerPositionCompact *entries;
+    size_t chunkCapacity;
+    size_t usedChunks;
+    size_t kmerCount;
+    unsigned int partitionBits;
+    std::vector<unsigned short> chunkPartition;
+
+    CompactKmerTable(size_t kmerCount, size_t threads, unsigned int partitionBits);
+    ~CompactKmerTable();
+
+    size_t partitions() const {
+        return static_cast<size_t>(1) << partitionBits;
+    }
+
+    // number of partition bits needed to store kmers up to maxKmer, 0 if they do not fit
+    static unsigned int partitionBitsNeeded(size_t maxKmer);
+
+    class Writer {
+    public:
+        Writer(CompactKmerTable &table);
+        ~Writer();
+        void add(size_t kmer, unsigned int id, short pos, unsigned short seqLen);
+        void flush();
+
+    private:
+        CompactKmerTable &table;
+        size_t partitionMask;
+        KmerPositionCompact *buffer;
+        size_t *bufferPos;
+        size_t added;
+        void flushPartition(size_t partition);
+    };
+};
+
+// largest kmer value (including the identity k-mer) used by linclust for the given alphabet and k-mer size
+size_t computeMaxKmer(size_t alphabetSize, size_t KMER_SIZE);
+
+void mergeKmerFilesAndOutput(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
+                             std::vector<std::string> tmpFiles, std::vector<char> &repSequence,
+                             int covMode, float covThr, size_t threads);
+
+void setKmerLengthAndAlphabet(Parameters &parameters, size_t aaDbSize, int seqType);
+
+struct SequencePosition{
+    short score;
+    size_t kmer;
+    unsigned int pos;
+    static bool compareByScore(const SequencePosition &first, const SequencePosition &second){
+        if(first.score < second.score)
             return true;
-        if(second.repSeq > first.repSeq )
+        if(second.score < first.score)
             return false;
-        if(first.id > second.id )
+        if(first.kmer < second.kmer)
             return true;
-        if(second.id > first.id )
+        if(second.kmer < first.kmer)
             return false;
-        if(first.pos > second.pos )
+
+        return false;
+    }
+    // compareByScore with ties by position, the k-mers of a sequence are collected in position order
+    // so this picks the same k-mers as a stable sort by score
+    static bool compareByScoreAndPos(const SequencePosition &first, const SequencePosition &second){
+        if(compareByScore(first, second))
             return true;
-        if(second.pos > first.pos )
+        if(compareByScore(second, first))
             return false;
-        return false;
+        return first.pos < second.pos;
     }
 };
 
+// scratch memory of the minimizer and syncmer k-mer selection
+struct KmerSelectionBuffer {
+    unsigned int *window;
+    unsigned short *smerHashes;
+    unsigned char *isSyncmer;
+
+    KmerSelectionBuffer(size_t maxSeqLen);
+    ~KmerSelectionBuffer();
+};
+
+// keeps the minimizers of windows sized to leave about kmersPerSequence k-mers, returns their count.
+// The window is 2 * count / kmersPerSequence k-mers wide, so it grows with the sequence length
+size_t selectMinimizers(SequencePosition *kmers, size_t count, size_t kmersPerSequence, KmerSelectionBuffer &buffer);
+
+// keeps the open syncmers (smallest s-mer hash at the first position, s = k / 2), returns their count
+size_t selectOpenSyncmers(SequencePosition *kmers, size_t count, const int *sequence, int seqLen,
+                          size_t KMER_SIZE, int hashShift, KmerSelectionBuffer &buffer);
+
+// collects the k-mers of seq without X and selects them according to selectionMode.
+// The chooseTopKmer - 1 lowest hashes are moved to the front in no particular order
+int selectSequenceKmers(Sequence &seq, Indexer &idxer, BaseMatrix *subMat, size_t KMER_SIZE, size_t chooseTopKmer,
+                        int hashShift, int selectionMode, SequencePosition *kmers, KmerSelectionBuffer *buffer);
+
+template <typename T>
+void writeKmersToDisk(std::string tmpFile, T *kmers, size_t totalKmers);
+
+template <typename T>
+void writeKmerMatcherResult(DBReader<unsigned int> & seqDbr, DBWriter & dbw,
+                            T *hashSeqPair, size_t totalKmers,
+                            std::vector<char> &repSequence, int covMode, float covThr,
+                            size_t threads);
+
+template <typename T>
+T * doComputation(size_t totalKmers, size_t split, size_t splits, std::string splitFile,
+                  DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat,
+                  size_t KMER_SIZE, size_t chooseTopKmer);
+
+template <typename T>
+size_t computeMemoryNeededLinearfilter(size_t totalKmer);
+
+size_t computeKmerCount(DBReader<unsigned int> &reader, size_t KMER_SIZE, size_t chooseTopKmer);
+
+unsigned circ_hash(const int * x, unsigned length, const unsigned rol);
+
+unsigned circ_hash_next(const int * x, unsigned length, int x_first, short unsigned h, const unsigned rol);
 
 #undef SIZE_T_MAX
 
@@ -1,5 +1,6 @@
 #include "IndexBuilder.h"
 #include "tantan.h"
+#include "PerfCounters.h"
 
 char* getScoreLookup(BaseMatrix &matrix) {
     char *idScoreLookup = NULL;
@@ -56,6 +57,8 @@ public:
 void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedLookup, SequenceLookup **unmaskedLookup,
                                 BaseMatrix &subMat, Sequence *seq,
                                 DBReader<unsigned int> *dbr, size_t dbFrom, size_t dbTo, int kmerThr) {
+    // the counters are per thread, the parallel regions open the scope again on their threads
+    PerfCounters::Scope perfScope(PerfCounters::INDEX_TABLE_FILL);
     Debug(Debug::INFO) << "Index table: counting k-mers...\n";
 
     const bool isProfile = seq->getSeqType() == Sequence::HMM_PROFILE;
@@ -93,6 +96,7 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
     size_t totalKmerCount = 0;
     #pragma omp parallel
     {
+        PerfCounters::Scope threadPerfScope(PerfCounters::INDEX_TABLE_FILL);
         Indexer idxer(static_cast<unsigned int>(indexTable->getAlphabetSize()), seq->getKmerSize());
         Sequence s(seq->getMaxLen(), seq->getSeqType(), &subMat, seq->getKmerSize(), seq->isSpaced(), false, true, seq->getSpacedKmerPattern());
 
@@ -198,6 +202,7 @@ void IndexBuilder::fillDatabase(IndexTable *indexTable, SequenceLookup **maskedL
     Debug(Debug::INFO) << "Index table: fill...\n";
     #pragma omp parallel
     {
+        PerfCounters::Scope threadPerfScope(PerfCounters::INDEX_TABLE_FILL);
         Sequence s(seq->getMaxLen(), seq->getSeqType(), &subMat, seq->getKmerSize(), seq->isSpaced(), false, true, seq->getSpacedKmerPattern());
         Indexer idxer(static_cast<unsigned int>(indexTable->getAlphabetSize()), seq->getKmerSize());
         IndexEntryLocalTmp *buffer = new IndexEntryLocalTmp[seq->getMaxLen()];
@@ -15,6 +15,7 @@
 #include "SequenceLookup.h"
 #include "MathUtil.h"
 #include "KmerGenerator.h"
+#include "PerfCounters.h"
 
 #include <algorithm>
 #include <new>
@@ -185,11 +186,15 @@ public:
     }
 
     void sortDBSeqLists() {
-        #pragma omp parallel for
-        for (size_t i = 0; i < getTableSize(); i++) {
-            size_t entrySize;
-            IndexEntryLocal *entries = getDBSeqList(i, &entrySize);
-            std::sort(entries, entries + entrySize, IndexEntryLocal::comapreByIdAndPos);
+        #pragma omp parallel
+        {
+            PerfCounters::Scope perfScope(PerfCounters::INDEX_TABLE_FILL);
+            #pragma omp for
+            for (size_t i = 0; i < getTableSize(); i++) {
+                size_t entrySize;
+                IndexEntryLocal *entries = getDBSeqList(i, &entrySize);
+                std::sort(entries, entries + entrySize, IndexEntryLocal::comapreByIdAndPos);
+            }
         }
     }
 
@@ -4,6 +4,8 @@
 #include "Parameters.h"
 #include "MMseqsMPI.h"
 #include "Timer.h"
+#include "PerfCounters.h"
+#include "WorkflowResources.h"
 
 #include <iostream>
 #include <string>
@@ -12,11 +14,12 @@
 #include <omp.h>
 #endif
 
-int prefilter(int argc, const char **argv, const Command& command) {
+int prefilter(int argc, const char **argv, const Command& command, WorkflowResources *resources) {
     MMseqsMPI::init(argc, argv);
 
     Parameters& par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, 3, true, 0, MMseqsParameter::COMMAND_PREFILTER);
+    PerfCounters::init(par.perfCounters);
 
 #ifdef OPENMP
     omp_set_num_threads(par.threads);
@@ -42,7 +45,7 @@ int prefilter(int argc, const char **argv, const Command& command) {
         queryDbType = Sequence::PROFILE_STATE_PROFILE;
     }
 
-    Prefiltering pref(par.db2, par.db2Index, queryDbType, targetDbType, par);
+    Prefiltering pref(par.db2, par.db2Index, queryDbType, targetDbType, par, resources);
     Debug(Debug::INFO) << "Time for init: " << timer.lap() << "\n";
 
 #ifdef HAVE_MPI
@@ -50,6 +53,11 @@ int prefilter(int argc, const char **argv, const Command& command) {
 #else
     pref.runAllSplits(par.db1, par.db1Index, par.db3, par.db3Index);
 #endif
+    PerfCounters::print();
 
     return EXIT_SUCCESS;
 }
+
+int prefilter(int argc, const char **argv, const Command& command) {
+    return prefilter(argc, argv, command, NULL);
+}
@@ -7,6 +7,13 @@
 #include "FileUtil.h"
 #include "IndexBuilder.h"
 #include "Timer.h"
+#include "Metrics.h"
+#include "Progress.h"
+#include "MPIScheduler.h"
+#include "Checkpoint.h"
+#include "WorkflowResources.h"
+
+#include <algorithm>
 
 namespace prefilter {
 #include "ExpOpt3_8_polished.cs32.lib.h"
@@ -19,9 +26,13 @@ namespace prefilter {
 Prefiltering::Prefiltering(const std::string &targetDB,
                            const std::string &targetDBIndex,
                            int querySeqType, int targetSeqType_,
-                           const Parameters &par) :
+                           const Parameters &par,
+                           WorkflowResources *resources) :
         targetDB(targetDB),
         targetDBIndex(targetDBIndex),
+        resources(resources),
+        sharedTargetDb(false),
+        sharedSequenceLookup(false),
         _2merSubMatrix(NULL),
         _3merSubMatrix(NULL),
         splits(par.split),
@@ -101,38 +112,22 @@ Prefiltering::Prefiltering(const std::string &targetDB,
         }
     } else {
         Debug(Debug::INFO) << "Could not find precomputed index. Compute index.\n";
-        tdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str());
-        tdbr->open(DBReader<unsigned int>::NOSORT);
-
-        if (par.preloadMode != Parameters::PRELOAD_MODE_MMAP) {
-            tdbr->readMmapedDataInMemory();
-            tdbr->mlock();
-        }
-
+        openTargetDb(par.preloadMode);
         templateDBIsIndex = false;
     }
 
     // init the substitution matrices
-    switch (querySeqType) {
-        case Sequence::NUCLEOTIDES:
-            subMat = new NucleotideMatrix(scoringMatrixFile.c_str(), 1.0, 0.0);
-            alphabetSize = subMat->alphabetSize;
-            break;
-        case Sequence::AMINO_ACIDS:
-            subMat = getSubstitutionMatrix(scoringMatrixFile, alphabetSize, 8.0, false);
-            alphabetSize = subMat->alphabetSize;
-            break;
-        case Sequence::HMM_PROFILE:
-            // needed for Background distributions
-            subMat = getSubstitutionMatrix(scoringMatrixFile, alphabetSize, 8.0, false);
-            break;
-        case Sequence::PROFILE_STATE_PROFILE:
-            subMat = getSubstitutionMatrix(scoringMatrixFile, alphabetSize, 8.0, true);
-            alphabetSize = subMat->alphabetSize;
-            break;
-        default:
-            Debug(Debug::ERROR) << "Query sequence type not implemented!\n";
-            EXIT(EXIT_FAILURE);
+    subMatKey = "prefilter " + SSTR(querySeqType) + " " + scoringMatrixFile + " " + SSTR(alphabetSize);
+    subMat = (resources != NULL) ? resources->getMatrix(subMatKey) : NULL;
+    if (subMat == NULL) {
+        subMat = createSubstitutionMatrix(querySeqType, scoringMatrixFile, alphabetSize);
+        if (resources != NULL) {
+            resources->addMatrix(subMatKey, subMat);
+        }
+    }
+    // the profiles only need the background distribution of the matrix
+    if (querySeqType != Sequence::HMM_PROFILE) {
+        alphabetSize = subMat->alphabetSize;
     }
 
     // investigate if it makes sense to mask the profile consensus sequence
@@ -145,19 +140,24 @@ Prefiltering::Prefiltering(const std::string &targetDB,
                        (targetSeqType == Sequence::NUCLEOTIDES && querySeqType == Sequence::NUCLEOTIDES);
 
     int originalSplits = splits;
-    size_t memoryLimit;
-    if (par.splitMemoryLimit > 0) {
-        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024;
-    } else {
-        memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
+    scheduler = NULL;
+    memoryLimit = getMemoryBudget(par.splitMemoryLimit);
+    int plannedThreads = static_cast<int>(threads);
+    memoryPlan = setupSplit(*tdbr, alphabetSize - 1, querySeqType,
+                            &plannedThreads, templateDBIsIndex, maxResListLen,
+                            memoryLimit, &kmerSize, &splits, &splitMode);
+    if (plannedThreads != static_cast<int>(threads)) {
+        threads = static_cast<unsigned int>(plannedThreads);
+#ifdef OPENMP
+        omp_set_num_threads(threads);
+#endif
     }
-    setupSplit(*tdbr, alphabetSize - 1, querySeqType,
-               threads, templateDBIsIndex, maxResListLen,
-               memoryLimit, &kmerSize, &splits, &splitMode);
 
     if(targetSeqType != Sequence::NUCLEOTIDES){
         kmerThr = getKmerThreshold(sensitivity, querySeqType, kmerScore, kmerSize);
     }
+    checkpointInterval = par.checkpointInterval;
+    checkpointSignature = par.hashCheckpoint(par.prefilter, " " + SSTR(splits) + " " + SSTR(splitMode) + " " + SSTR(kmerSize));
     if (templateDBIsIndex == true) {
         if (splits != originalSplits) {
             Debug(Debug::WARNING) << "Required split count does not match index table split count. Recomputing index table!\n";
@@ -198,26 +198,47 @@ Prefiltering::~Prefiltering() {
         delete indexTable;
     }
 
-    if (sequenceLookup != NULL) {
+    if (sequenceLookup != NULL && sharedSequenceLookup == false) {
         delete sequenceLookup;
     }
 
-    tdbr->close();
-    delete tdbr;
+    if (sharedTargetDb == false) {
+        tdbr->close();
+        delete tdbr;
+    }
 
     if (templateDBIsIndex == true) {
         tidxdbr->close();
         delete tidxdbr;
     }
 
-    delete subMat;
+    if (resources == NULL) {
+        delete subMat;
 
-    if (_2merSubMatrix != NULL && templateDBIsIndex == false) {
-        ScoreMatrix::cleanup(_2merSubMatrix);
+        if (_2merSubMatrix != NULL && templateDBIsIndex == false) {
+            ScoreMatrix::cleanup(_2merSubMatrix);
+        }
+        if (_3merSubMatrix != NULL && templateDBIsIndex == false) {
+            ScoreMatrix::cleanup(_3merSubMatrix);
+        }
     }
-    if (_3merSubMatrix != NULL && templateDBIsIndex == false) {
-        ScoreMatrix::cleanup(_3merSubMatrix);
+}
+
+void Prefiltering::openTargetDb(int preloadMode) {
+    const bool touch = preloadMode != Parameters::PRELOAD_MODE_MMAP;
+    if (resources != NULL) {
+        tdbr = resources->getSequenceDb(targetDB, targetDBIndex, touch);
+        sharedTargetDb = true;
+        return;
+    }
+
+    tdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str());
+    tdbr->open(DBReader<unsigned int>::NOSORT);
+    if (touch) {
+        tdbr->readMmapedDataInMemory();
+        tdbr->mlock();
     }
+    sharedTargetDb = false;
 }
 
 void Prefiltering::reopenTargetDb() {
@@ -227,34 +248,46 @@ void Prefiltering::reopenTargetDb() {
         tidxdbr = NULL;
     }
 
-    tdbr->close();
-    delete tdbr;
+    if (sharedTargetDb == false) {
+        tdbr->close();
+        delete tdbr;
+    }
 
     Debug(Debug::INFO) << "Index table not compatible with chosen settings. Compute index.\n";
-    tdbr = new DBReader<unsigned int>(targetDB.c_str(), targetDBIndex.c_str());
-    tdbr->open(DBReader<unsigned int>::NOSORT);
+    openTargetDb(preloadMode);
+    templateDBIsIndex = false;
+}
 
-    if (preloadMode != Parameters::PRELOAD_MODE_MMAP) {
-        tdbr->readMmapedDataInMemory();
-        tdbr->mlock();
+size_t Prefiltering::getMemoryBudget(int splitMemoryLimit) {
+    if (splitMemoryLimit > 0) {
+        return static_cast<size_t>(splitMemoryLimit) * 1024 * 1024;
     }
-
-    templateDBIsIndex = false;
+    // the target database might be in memory already
+    size_t usable = std::min(Util::getTotalSystemMemory(), Util::getAvailableMemory() + Util::getResidentMemory());
+    return static_cast<size_t>(usable * 0.9);
 }
 
-void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqTyp, const int threads,
-                              const bool templateDBIsIndex, const size_t maxResListLen, const size_t memoryLimit,
-                              int *kmerSize, int *split, int *splitMode) {
+prefilter_memory_t Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqTyp,
+                                            int *threads, const bool templateDBIsIndex, const size_t maxResListLen,
+                                            const size_t memoryLimit, int *kmerSize, int *split, int *splitMode) {
     size_t neededSize = estimateMemoryConsumption(1,
-                                                  dbr.getSize(), dbr.getAminoAcidDBSize(),  maxResListLen, alphabetSize,
+                                                  dbr.getSize(), dbr.getAminoAcidDBSize(), dbr.getDataSize(), maxResListLen, alphabetSize,
                                                   *kmerSize == 0 ? // if auto detect kmerSize
                                                   IndexTable::computeKmerSize(dbr.getAminoAcidDBSize()) : *kmerSize, querySeqTyp,
-                                                  threads);
+                                                  *threads).total();
     if (neededSize > 0.9 * memoryLimit) {
         // memory is not enough to compute everything at once
         //TODO add PROFILE_STATE (just 6-mers)
         std::pair<int, int> splitSettings = Prefiltering::optimizeSplit(memoryLimit, &dbr,
-                                                                        alphabetSize, *kmerSize, querySeqTyp, threads);
+                                                                        alphabetSize, *kmerSize, querySeqTyp, *threads);
+        // the buffers of each thread need memory independent of the split size
+        while (splitSettings.second == -1 && *threads > 1) {
+            *threads = *threads / 2;
+            splitSettings = Prefiltering::optimizeSplit(memoryLimit, &dbr, alphabetSize, *kmerSize, querySeqTyp, *threads);
+            if (splitSettings.second != -1) {
+                Debug(Debug::WARNING) << "Reducing the number of threads to " << *threads << " to fit into memory.\n";
+            }
+        }
         if (splitSettings.second == -1) {
             Debug(Debug::ERROR) << "Can not fit databased into " << memoryLimit
                                 << " byte. Please use a computer with more main memory.\n";
@@ -299,10 +332,19 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSiz
 
     Debug(Debug::INFO) << "Use kmer size " << *kmerSize << " and split "
                        << *split << " using " << Parameters::getSplitModeName(*splitMode) << " split mode.\n";
-    neededSize = estimateMemoryConsumption((*splitMode == Parameters::TARGET_DB_SPLIT) ? *split : 1, dbr.getSize(),
-                                           dbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, *kmerSize, querySeqTyp, threads);
-    Debug(Debug::INFO) << "Needed memory (" << neededSize << " byte) of total memory (" << memoryLimit
-                       << " byte)\n";
+    prefilter_memory_t plan = estimateMemoryConsumption((*splitMode == Parameters::TARGET_DB_SPLIT) ? *split : 1, dbr.getSize(),
+                                                        dbr.getAminoAcidDBSize(), dbr.getDataSize(), maxResListLen,
+                                                        alphabetSize, *kmerSize, querySeqTyp, *threads);
+    neededSize = plan.total();
+    Debug(Debug::INFO) << "Needed memory " << Util::formatBytes(neededSize) << " of " << Util::formatBytes(memoryLimit) << ": "
+                       << "index table " << Util::formatBytes(plan.indexTable) << ", "
+                       << "sequence lookup " << Util::formatBytes(plan.sequenceLookup) << ", "
+                       << "target database " << Util::formatBytes(plan.targetDb) << ", "
+                       << "k-mer matrices " << Util::formatBytes(plan.matrices) << ", "
+                       << "buffers of " << plan.threads << " threads " << Util::formatBytes(plan.threadBuffers) << ", "
+                       << "write buffers " << Util::formatBytes(plan.writerBuffers) << "\n";
+    Metrics::setCounter("memoryBudgetBytes", memoryLimit);
+    Metrics::setCounter("memoryPlannedBytes", neededSize);
     if (neededSize > 0.9 * memoryLimit) {
         Debug(Debug::WARNING) << "WARNING: MMseqs processes needs more main memory than available."
                 "Increase the size of --split or set it to 0 to automatically optimize target database split.\n";
@@ -310,11 +352,22 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& dbr, const int alphabetSiz
             Debug(Debug::WARNING) << "WARNING: Split has to be computed by createindex if precomputed index is used.\n";
         }
     }
+    return plan;
+}
+
+void Prefiltering::printMemoryUsage() {
+    const size_t peak = Util::getPeakResidentMemory();
+    Debug(Debug::INFO) << "Peak memory " << Util::formatBytes(peak) << " (planned " << Util::formatBytes(memoryPlan.total())
+                       << " of " << Util::formatBytes(memoryLimit) << ")\n";
+    if (peak > memoryLimit) {
+        Debug(Debug::WARNING) << "The peak memory exceeded the memory limit, consider a higher --split.\n";
+    }
 }
 
 void Prefiltering::mergeOutput(const std::string &outDB, const std::string &outDBIndex,
                                const std::vector<std::pair<std::string, std::string>> &filenames) {
     Timer timer;
+    Metrics::Phase phase("mergeOutput");
     if (filenames.size() < 2) {
         std::rename(filenames[0].first.c_str(), outDB.c_str());
         std::rename(filenames[0].second.c_str(), outDBIndex.c_str());
@@ -416,6 +469,15 @@ ScoreMatrix *Prefiltering::getScoreMatrix(const BaseMatrix& matrix, const size_t
     if (result != NULL) {
         return result;
     }
+    if (resources != NULL) {
+        const std::string key = subMatKey + " " + SSTR(kmerSize) + "-mer";
+        result = resources->getScoreMatrix(key);
+        if (result == NULL) {
+            result = ExtendedSubstitutionMatrix::calcScoreMatrix(matrix, kmerSize);
+            resources->addScoreMatrix(key, result);
+        }
+        return result;
+    }
     return ExtendedSubstitutionMatrix::calcScoreMatrix(matrix, kmerSize);
 
 }
@@ -432,6 +494,7 @@ void Prefiltering::getIndexTable(int /*split*/, size_t dbFrom, size_t dbSize) {
         }
     } else {
         Timer timer;
+        Metrics::Phase phase("indexTable");
 
         Sequence tseq(maxSeqLen, targetSeqType, subMat, kmerSize, spacedKmer, aaBiasCorrection, true, spacedKmerPattern);
         int localKmerThr = (querySeqType == Sequence::HMM_PROFILE ||
@@ -443,19 +506,39 @@ void Prefiltering::getIndexTable(int /*split*/, size_t dbFrom, size_t dbSize) {
         int adjustAlphabetSize = (targetSeqType == Sequence::NUCLEOTIDES || targetSeqType == Sequence::AMINO_ACIDS)
                            ? alphabetSize -1 : alphabetSize;
         indexTable = new IndexTable(adjustAlphabetSize, kmerSize, false);
-        SequenceLookup **maskedLookup   = maskMode == 1 ? &sequenceLookup : NULL;
-        SequenceLookup **unmaskedLookup = maskMode == 0 ? &sequenceLookup : NULL;
+        // the alignment of an in-process workflow reads the targets from the unmasked lookup of the whole
+        // database, a reduced alphabet would map the sequences differently than the alignment does
+        const bool shareLookup = resources != NULL && dbFrom == 0 && dbSize == tdbr->getSize()
+                                 && querySeqType == Sequence::AMINO_ACIDS && targetSeqType == Sequence::AMINO_ACIDS
+                                 && alphabetSize == 21;
+        SequenceLookup *unmaskedLookup = NULL;
+        SequenceLookup **maskedLookupOut   = maskMode == 1 ? &sequenceLookup : NULL;
+        SequenceLookup **unmaskedLookupOut = (maskMode == 0 || shareLookup) ? &unmaskedLookup : NULL;
 
         Debug(Debug::INFO) << "Index table k-mer threshold: " << localKmerThr << "\n";
-        IndexBuilder::fillDatabase(indexTable, maskedLookup, unmaskedLookup, *subMat,  &tseq, tdbr, dbFrom, dbFrom + dbSize, localKmerThr);
+        IndexBuilder::fillDatabase(indexTable, maskedLookupOut, unmaskedLookupOut, *subMat,  &tseq, tdbr, dbFrom, dbFrom + dbSize, localKmerThr);
+        if (maskMode == 0) {
+            sequenceLookup = unmaskedLookup;
+        }
+        sharedSequenceLookup = false;
+        if (shareLookup) {
+            resources->addSequenceLookup(targetDB, unmaskedLookup);
+            sharedSequenceLookup = (maskMode == 0);
+        }
 
         if (diagonalScoring == false) {
-            delete sequenceLookup;
+            if (sharedSequenceLookup == false) {
+                delete sequenceLookup;
+            }
             sequenceLookup = NULL;
+            sharedSequenceLookup = false;
         }
 
         indexTable->printStatistics(subMat->int2aa);
-        tdbr->remapData();
+        // the next step of a workflow reads the shared database again
+        if (sharedTargetDb == false) {
+            tdbr->remapData();
+        }
         Debug(Debug::INFO) << "Time for index table init: " << timer.lap() << "\n";
     }
 
@@ -472,11 +555,11 @@ void Prefiltering::getIndexTable(int /*split*/, size_t dbFrom, size_t dbSize) {
         case Sequence::PROFILE_STATE_PROFILE:
         case Sequence::NUCLEOTIDES:
         default:
-            if (_2merSubMatrix != NULL && templateDBIsIndex == false) {
+            if (_2merSubMatrix != NULL && templateDBIsIndex == false && resources == NULL) {
                 delete _2merSubMatrix;
             }
 
-            if (_3merSubMatrix != NULL && templateDBIsIndex == false) {
+            if (_3merSubMatrix != NULL && templateDBIsIndex == false && resources == NULL) {
                 delete _3merSubMatrix;
             }
             _2merSubMatrix = NULL;
@@ -502,6 +585,7 @@ bool Prefiltering::isSameQTDB(const std::string &queryDB) {
 void Prefiltering::runAllSplits(const std::string &queryDB, const std::string &queryDBIndex,
                                 const std::string &resultDB, const std::string &resultDBIndex) {
     runSplits(queryDB, queryDBIndex, resultDB, resultDBIndex, 0, splits);
+    printMemoryUsage();
 }
 
 #ifdef HAVE_MPI
@@ -509,40 +593,29 @@ void Prefiltering::runMpiSplits(const std::string &queryDB, const std::string &q
                                 const std::string &resultDB, const std::string &resultDBIndex) {
 
     splits = std::max(MMseqsMPI::numProc, splits);
-    size_t fromSplit = 0;
-    size_t splitCount = 1;
-    // if split size is great than nodes than we have to
-    // distribute all splits equally over all nodes
-    unsigned int * splitCntPerProc = new unsigned int[MMseqsMPI::numProc];
-    memset(splitCntPerProc, 0, sizeof(unsigned int) * MMseqsMPI::numProc);
-    for(int i = 0; i < splits; i++){
-        splitCntPerProc[i % MMseqsMPI::numProc] += 1;
-    }
-    for(int i = 0; i < MMseqsMPI::rank; i++){
-        fromSplit += splitCntPerProc[i];
-    }
-
-    splitCount = splitCntPerProc[MMseqsMPI::rank];
-    delete[] splitCntPerProc;
-
-    std::pair<std::string, std::string> result = Util::createTmpFileNames(resultDB, resultDBIndex, MMseqsMPI::rank);
-    int hasResult = runSplits(queryDB, queryDBIndex, result.first, result.second, fromSplit, splitCount) == true ? 1 : 0;
-
-    int *results = NULL;
-    if (MMseqsMPI::isMaster()) {
-        results = new int[MMseqsMPI::numProc]();
+    // a restarted process would not know which splits the others finished
+    checkpointInterval = 0;
+
+    // the splits are handed out one at a time, a process asks for the next as soon as it is done
+    MPIScheduler splitScheduler(0, splits, 1, false);
+    scheduler = &splitScheduler;
+    std::vector<size_t> computedSplits;
+    size_t split;
+    size_t splitCount;
+    while (splitScheduler.next(&split, &splitCount)) {
+        std::pair<std::string, std::string> result = Util::createTmpFileNames(resultDB, resultDBIndex, split);
+        if (runSplits(queryDB, queryDBIndex, result.first, result.second, split, 1)) {
+            computedSplits.push_back(split);
+        }
     }
+    scheduler = NULL;
 
-    MPI_Gather(&hasResult, 1, MPI_INT, results, 1, MPI_INT, MMseqsMPI::MASTER, MPI_COMM_WORLD);
+    computedSplits = MPIScheduler::gather(computedSplits);
     if (MMseqsMPI::isMaster()) {
-        // gather does not write the result of the master into the array
-        results[MMseqsMPI::MASTER] = hasResult;
-
+        std::sort(computedSplits.begin(), computedSplits.end());
         std::vector<std::pair<std::string, std::string>> splitFiles;
-        for (int i = 0; i < MMseqsMPI::numProc; ++i) {
-            if (results[i] == 1) {
-                splitFiles.push_back(Util::createTmpFileNames(resultDB, resultDBIndex, i));
-            }
+        for (size_t i = 0; i < computedSplits.size(); ++i) {
+            splitFiles.push_back(Util::createTmpFileNames(resultDB, resultDBIndex, computedSplits[i]));
         }
 
         if (splitFiles.size() > 0) {
@@ -552,10 +625,8 @@ void Prefiltering::runMpiSplits(const std::string &queryDB, const std::string &q
             Debug(Debug::ERROR) << "Aborting. No results were computed!\n";
             EXIT(EXIT_FAILURE);
         }
-
-        delete results;
     }
-
+    printMemoryUsage();
 }
 #endif
 
@@ -592,18 +663,40 @@ bool Prefiltering::runSplits(const std::string &queryDB, const std::string &quer
     if (splitProcessCount > 1) {
         // splits template database into x sequence steps
         std::vector<std::pair<std::string, std::string> > splitFiles;
+        // the splits an interrupted run finished, and if they had results
+        Checkpoint finishedSplits(resultDB + ".splits.checkpoint", checkpointSignature);
+        std::vector<std::string> finished;
+        if (checkpointInterval > 0 && finishedSplits.load()) {
+            finished = finishedSplits.getAll("split");
+        }
         for (size_t i = fromSplit; i < (fromSplit + splitProcessCount) && i < totalSplits; i++) {
             std::pair<std::string, std::string> filenamePair = Util::createTmpFileNames(resultDB, resultDBIndex, i);
-            if (runSplit(qdbr, filenamePair.first.c_str(), filenamePair.second.c_str(), i, totalSplits, sameQTDB)) {
+            if (std::find(finished.begin(), finished.end(), SSTR(i) + "\t0") != finished.end()) {
+                continue;
+            }
+            if (std::find(finished.begin(), finished.end(), SSTR(i) + "\t1") != finished.end()
+                && FileUtil::fileExists(filenamePair.first.c_str()) && FileUtil::fileExists(filenamePair.second.c_str())) {
+                Debug(Debug::INFO) << "Prefiltering step " << (i + 1) << " of " << totalSplits << " was finished before\n";
                 splitFiles.push_back(filenamePair);
-
+                continue;
+            }
+            const bool splitHasResult = runSplit(qdbr, filenamePair.first.c_str(), filenamePair.second.c_str(), i, totalSplits, sameQTDB);
+            if (splitHasResult) {
+                splitFiles.push_back(filenamePair);
+            }
+            if (checkpointInterval > 0) {
+                finishedSplits.add("split", SSTR(i) + (splitHasResult ? "\t1" : "\t0"));
+                finishedSplits.save();
             }
         }
         if (splitFiles.size() > 0) {
             mergeFiles(resultDB, resultDBIndex, splitFiles);
             hasResult = true;
         }
-    } else if (splitProcessCount == 1) {
+        if (checkpointInterval > 0) {
+            finishedSplits.remove();
+        }
+    } else if (splitProcessCount == 1 && fromSplit < totalSplits) {
         if (runSplit(qdbr, resultDB.c_str(), resultDBIndex.c_str(), fromSplit, totalSplits, sameQTDB)) {
             hasResult = true;
         }
@@ -647,7 +740,9 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
         }
 
         if (sequenceLookup != NULL) {
-            delete sequenceLookup;
+            if (sharedSequenceLookup == false) {
+                delete sequenceLookup;
+            }
             sequenceLookup = NULL;
         }
 
@@ -678,6 +773,7 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
     Debug(Debug::INFO) << "k-mer match probability: " << kmerMatchProb << "\n\n";
 
     Timer timer;
+    Metrics::Phase phase("prefilter");
 
     size_t kmersPerPos = 0;
     size_t dbMatches = 0;
@@ -700,7 +796,26 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
     }
 
     DBWriter tmpDbw(resultDB.c_str(), resultDBIndex.c_str(), localThreads);
+    // the queries before resumeFrom were searched by an interrupted run
+    size_t resumeFrom = queryFrom;
+    const std::string state = tmpDbw.enableCheckpoints(checkpointSignature, checkpointInterval);
+    if (state.empty() == false) {
+        resumeFrom = strtoull(state.c_str(), NULL, 10);
+        if (resumeFrom < queryFrom || resumeFrom > queryFrom + querySize) {
+            Debug(Debug::ERROR) << "Invalid checkpoint state " << state << " of " << resultDB << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        Debug(Debug::INFO) << "Continuing with query " << resumeFrom << " of " << (queryFrom + querySize) << "\n";
+    }
     tmpDbw.open();
+    // a checkpoint can only be taken between two chunks of queries. The first chunk measures the speed,
+    // the next ones are sized to end when the next checkpoint is due
+    const size_t queryEnd = queryFrom + querySize;
+    const size_t minChunkSize = std::max(static_cast<size_t>(localThreads) * 256, static_cast<size_t>(1));
+    size_t chunkEnd = queryEnd;
+    if (tmpDbw.hasCheckpoints()) {
+        chunkEnd = std::min(resumeFrom + minChunkSize, queryEnd);
+    }
 
     // init all thread-specific data structures
     char *notEmpty = new char[querySize];
@@ -721,6 +836,12 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
     Debug(Debug::INFO) << "Target db start  " << (dbFrom + 1) << " to " << dbFrom + dbSize << "\n";
     EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), subMat);
 
+    // statistics of the queries searched by this run
+    const size_t searchedQueries = queryFrom + querySize - resumeFrom;
+    if (searchedQueries > 0) {
+        totalQueryDBSize = searchedQueries;
+    }
+    Progress progress("prefilter", searchedQueries);
 #pragma omp parallel num_threads(localThreads)
     {
         unsigned int thread_idx = 0;
@@ -739,42 +860,70 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
             matcher.setSubstitutionMatrix(_3merSubMatrix, _2merSubMatrix);
         }
 
+        size_t chunkFrom = resumeFrom;
+        while (chunkFrom < queryEnd) {
+            // chunkEnd is only changed after the barrier at the end of the loop over the chunk
+            const size_t currentEnd = chunkEnd;
 #pragma omp for schedule(dynamic, 10) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow)
-        for (size_t id = queryFrom; id < queryFrom + querySize; id++) {
-            Debug::printProgress(id);
-            // get query sequence
-            char *seqData = qdbr->getData(id);
-            unsigned int qKey = qdbr->getDbKey(id);
-            seq.mapSequence(id, qKey, seqData);
-            // only the corresponding split should include the id (hack for the hack)
-            size_t targetSeqId = UINT_MAX;
-            if (id >= dbFrom && id < (dbFrom + dbSize) && (sameQTDB || includeIdentical)) {
-                targetSeqId = tdbr->getId(seq.getDbKey());
-                if (targetSeqId != UINT_MAX) {
-                    targetSeqId = targetSeqId - dbFrom;
+            for (size_t id = chunkFrom; id < currentEnd; id++) {
+                if (thread_idx == 0 && scheduler != NULL) {
+                    // the other processes ask for their next split while this one is computed
+                    scheduler->serve();
+                }
+                // get query sequence
+                char *seqData = qdbr->getData(id);
+                unsigned int qKey = qdbr->getDbKey(id);
+                seq.mapSequence(id, qKey, seqData);
+                progress.update(1, seq.L);
+                // only the corresponding split should include the id (hack for the hack)
+                size_t targetSeqId = UINT_MAX;
+                if (id >= dbFrom && id < (dbFrom + dbSize) && (sameQTDB || includeIdentical)) {
+                    targetSeqId = tdbr->getId(seq.getDbKey());
+                    if (targetSeqId != UINT_MAX) {
+                        targetSeqId = targetSeqId - dbFrom;
+                    }
+                }
+                // calculate prefiltering results
+                std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId);
+                size_t resultSize = prefResults.second;
+                // write
+                writePrefilterOutput(qdbr, &tmpDbw, thread_idx, id, prefResults, dbFrom, resListOffset, maxResults);
+
+                // update statistics counters
+                if (resultSize != 0) {
+                    notEmpty[id - queryFrom] = 1;
                 }
-            }
-            // calculate prefiltering results
-            std::pair<hit_t *, size_t> prefResults = matcher.matchQuery(&seq, targetSeqId);
-            size_t resultSize = prefResults.second;
-            // write
-            writePrefilterOutput(qdbr, &tmpDbw, thread_idx, id, prefResults, dbFrom, resListOffset, maxResults);
-
-            // update statistics counters
-            if (resultSize != 0) {
-                notEmpty[id - queryFrom] = 1;
-            }
 
-            kmersPerPos += (size_t) matcher.getStatistics()->kmersPerPos;
-            dbMatches += matcher.getStatistics()->dbMatches;
-            doubleMatches += matcher.getStatistics()->doubleMatches;
-            querySeqLenSum += seq.L;
-            diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
-            resSize += resultSize;
-            realResSize += std::min(resultSize, maxResults);
-            reslens[thread_idx]->emplace_back(resultSize);
-        } // step end
+                kmersPerPos += (size_t) matcher.getStatistics()->kmersPerPos;
+                dbMatches += matcher.getStatistics()->dbMatches;
+                doubleMatches += matcher.getStatistics()->doubleMatches;
+                querySeqLenSum += seq.L;
+                diagonalOverflow += matcher.getStatistics()->diagonalOverflow;
+                resSize += resultSize;
+                realResSize += std::min(resultSize, maxResults);
+                reslens[thread_idx]->emplace_back(resultSize);
+            } // step end
+#pragma omp single
+            {
+                tmpDbw.checkpoint(SSTR(currentEnd));
+                if (currentEnd < queryEnd) {
+                    chunkEnd = currentEnd + std::min(tmpDbw.checkpointChunkSize(currentEnd - resumeFrom, minChunkSize), queryEnd - currentEnd);
+                }
+            }
+            chunkFrom = currentEnd;
+        }
     }
+    progress.finish();
+
+    // totals, the k-mers per position are summed over the queries
+    Metrics::addCounter("prefilterQueries", searchedQueries);
+    Metrics::addCounter("prefilterQueryResidues", querySeqLenSum);
+    Metrics::addCounter("kmersPerPosSum", kmersPerPos);
+    Metrics::addCounter("dbMatches", dbMatches);
+    Metrics::addCounter("doubleMatches", doubleMatches);
+    Metrics::addCounter("diagonalOverflow", diagonalOverflow);
+    Metrics::addCounter("prefilterResults", resSize);
+    Metrics::addCounter("prefilterResultsWritten", realResSize);
 
     if (Debug::debugLevel >= Debug::INFO) {
         statistics_t stats(kmersPerPos / totalQueryDBSize,
@@ -784,7 +933,7 @@ bool Prefiltering::runSplit(DBReader<unsigned int>* qdbr, const std::string &res
                            resSize / totalQueryDBSize);
 
         size_t empty = 0;
-        for (size_t id = 0; id < querySize; id++) {
+        for (size_t id = resumeFrom - queryFrom; id < querySize; id++) {
             if (notEmpty[id] == 0) {
                 empty++;
             }
@@ -888,6 +1037,23 @@ void Prefiltering::printStatistics(const statistics_t &stats, std::list<int> **r
     Debug(Debug::INFO) << empty << " sequences with 0 size result lists.\n";
 }
 
+BaseMatrix *Prefiltering::createSubstitutionMatrix(int querySeqType, const std::string &scoringMatrixFile, size_t alphabetSize) {
+    switch (querySeqType) {
+        case Sequence::NUCLEOTIDES:
+            return new NucleotideMatrix(scoringMatrixFile.c_str(), 1.0, 0.0);
+        case Sequence::AMINO_ACIDS:
+            return getSubstitutionMatrix(scoringMatrixFile, alphabetSize, 8.0, false);
+        case Sequence::HMM_PROFILE:
+            // needed for Background distributions
+            return getSubstitutionMatrix(scoringMatrixFile, alphabetSize, 8.0, false);
+        case Sequence::PROFILE_STATE_PROFILE:
+            return getSubstitutionMatrix(scoringMatrixFile, alphabetSize, 8.0, true);
+        default:
+            Debug(Debug::ERROR) << "Query sequence type not implemented!\n";
+            EXIT(EXIT_FAILURE);
+    }
+}
+
 BaseMatrix *Prefiltering::getSubstitutionMatrix(const std::string &scoringMatrixFile, size_t alphabetSize, float bitFactor, bool profileState) {
     Debug(Debug::INFO) << "Substitution matrices...\n";
     BaseMatrix *subMat;
@@ -1014,34 +1180,40 @@ int Prefiltering::getKmerThreshold(const float sensitivity, const int querySeqTy
     return static_cast<int>(kmerThrBest);
 }
 
-size_t Prefiltering::estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
-                                               size_t maxHitsPerQuery,
-                                               int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                               int threads) {
-    // for each residue in the database we need 7 byte
+prefilter_memory_t Prefiltering::estimateMemoryConsumption(int split, size_t dbSize, size_t resSize, size_t dataSize,
+                                                           size_t maxHitsPerQuery,
+                                                           int alphabetSize, int kmerSize, unsigned int querySeqType,
+                                                           int threads) {
+    prefilter_memory_t memory;
     size_t dbSizeSplit = (dbSize) / split;
-    size_t residueSize = (resSize / split * 7);
-    // 21^7 * pointer size is needed for the index
-    size_t indexTableSize = static_cast<size_t>(pow(alphabetSize, kmerSize)) * sizeof(size_t *);
-    // memory needed for the threads
-    // This memory is an approx. for Countint32Array and QueryTemplateLocalFast
-    size_t threadSize = threads * (
-            (dbSizeSplit * 2 * sizeof(IndexEntryLocal)) // databaseHits in QueryMatcher
-            + (dbSizeSplit * sizeof(CounterResult)) // databaseHits in QueryMatcher
-            + (maxHitsPerQuery * sizeof(hit_t))
-            + (dbSizeSplit * 2 * sizeof(CounterResult) * 2) // BINS * binSize, (binSize = dbSize * 2 / BINS)
-            // 2 is a security factor the size can increase during run
-    );
+    size_t residueSplit = resSize / split;
+    // alphabetSize^kmerSize offsets and one entry per residue
+    memory.indexTable = static_cast<size_t>(pow(alphabetSize, kmerSize)) * sizeof(size_t)
+                        + residueSplit * sizeof(IndexEntryLocal);
+    memory.sequenceLookup = residueSplit + (dbSizeSplit + 1) * sizeof(size_t);
+    // the whole target database is kept in memory, the index needs about 22 byte per entry
+    memory.targetDb = dataSize + dbSize * 22;
 
     // extended matrix
-    size_t extendedMatrix = 0;
+    memory.matrices = 0;
     if(querySeqType == Sequence::AMINO_ACIDS){
-        extendedMatrix = sizeof(std::pair<short, unsigned int>) * static_cast<size_t>(pow(pow(alphabetSize, 3), 2));
-        extendedMatrix += sizeof(std::pair<short, unsigned int>) * pow(pow(alphabetSize, 2), 2);
+        memory.matrices = sizeof(std::pair<short, unsigned int>) * static_cast<size_t>(pow(pow(alphabetSize, 3), 2));
+        memory.matrices += sizeof(std::pair<short, unsigned int>) * pow(pow(alphabetSize, 2), 2);
     }
-    // some memory needed to keep the index, ....
-    size_t background = dbSize * 22;
-    return residueSize + indexTableSize + threadSize + background + extendedMatrix;
+
+    // QueryMatcher allocates for at least 1 Mio. target sequences
+    size_t matcherSize = std::max(static_cast<size_t>(1000000), dbSizeSplit);
+    memory.threadBuffers = threads * (
+            (matcherSize * 2 * sizeof(IndexEntryLocal)) // databaseHits
+            + (matcherSize * sizeof(CounterResult)) // foundDiagonals
+            + (matcherSize * 2 * sizeof(CounterResult) * 2) // bins of the diagonal counting, rounded up to a power of 2
+            + (dbSizeSplit * sizeof(float)) // seqLens
+            + (maxHitsPerQuery * sizeof(hit_t))
+    );
+    // default buffer of DBWriter::open, filled by the results of each thread
+    memory.writerBuffers = threads * static_cast<size_t>(64 * 1024 * 1024);
+    memory.threads = threads;
+    return memory;
 }
 
 size_t Prefiltering::estimateHDDMemoryConsumption(size_t dbSize, size_t maxResListLen) {
@@ -1058,7 +1230,8 @@ std::pair<int, int> Prefiltering::optimizeSplit(size_t totalMemoryInByte, DBRead
                 size_t aaUpperBoundForKmerSize = IndexTable::getUpperBoundAACountForKmerSize(optKmerSize);
                 if ((tdbr->getAminoAcidDBSize() / optSplit) < aaUpperBoundForKmerSize) {
                     size_t neededSize = estimateMemoryConsumption(optSplit, tdbr->getSize(), tdbr->getAminoAcidDBSize(),
-                                                                  0, alphabetSize, optKmerSize, querySeqType, threads);
+                                                                  tdbr->getDataSize(), 0, alphabetSize, optKmerSize,
+                                                                  querySeqType, threads).total();
                     if (neededSize < 0.9 * totalMemoryInByte) {
                         return std::make_pair(optKmerSize, optSplit);
                     }
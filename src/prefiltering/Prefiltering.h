@@ -14,6 +14,23 @@
 #include <list>
 #include <utility>
 
+// memory of the prefilter by allocation for one split
+struct prefilter_memory_t {
+    size_t indexTable;     // k-mer offsets and entries
+    size_t sequenceLookup; // target sequences
+    size_t targetDb;       // target database index and data
+    size_t matrices;       // extended 2-mer and 3-mer substitution matrices
+    size_t threadBuffers;  // QueryMatcher buffers of all threads
+    size_t writerBuffers;  // DBWriter buffers of all threads
+    int threads;
+
+    size_t total() const {
+        return indexTable + sequenceLookup + targetDb + matrices + threadBuffers + writerBuffers;
+    }
+};
+
+class MPIScheduler;
+class WorkflowResources;
 
 class Prefiltering {
 public:
@@ -21,7 +38,8 @@ public:
             const std::string &targetDB,
             const std::string &targetDBIndex,
             int querySeqType, int targetSeqType,
-            const Parameters &par);
+            const Parameters &par,
+            WorkflowResources *resources = NULL);
 
     ~Prefiltering();
 
@@ -41,12 +59,20 @@ public:
     void mergeFiles(const std::string &outDb, const std::string &outDBIndex,
                     const std::vector<std::pair<std::string, std::string>> &splitFiles);
 
+    // substitution matrix of the query sequence type
+    static BaseMatrix *createSubstitutionMatrix(int querySeqType, const std::string &scoringMatrixFile, size_t alphabetSize);
+
     // get substitution matrix
     static BaseMatrix *getSubstitutionMatrix(const std::string &scoringMatrixFile, size_t alphabetSize, float bitFactor, bool profileState);
 
-    static void setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqType, const int threads,
-                           const bool templateDBIsIndex, const size_t maxResListLen, const size_t memoryLimit,
-                           int *kmerSize, int *split, int *splitMode);
+    // memory the prefilter may use: the split memory limit (in megabyte) if set, otherwise what the process holds
+    // already and what the system and its cgroup can still give it
+    static size_t getMemoryBudget(int splitMemoryLimit);
+
+    // picks k-mer size, split count, split mode and thread count that fit into memoryLimit and returns the plan
+    static prefilter_memory_t setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqType,
+                                         int *threads, const bool templateDBIsIndex, const size_t maxResListLen,
+                                         const size_t memoryLimit, int *kmerSize, int *split, int *splitMode);
 
     static int getKmerThreshold(const float sensitivity, const int querySeqType,
                                 const int kmerScore, const int kmerSize);
@@ -59,6 +85,13 @@ private:
     DBReader<unsigned int> *tdbr;
     DBReader<unsigned int> *tidxdbr;
 
+    // an in-process workflow lends the target database and the matrices to the prefilter
+    // and gets the unmasked sequence lookup for the alignment
+    WorkflowResources *resources;
+    bool sharedTargetDb;
+    bool sharedSequenceLookup;
+    std::string subMatKey;
+
     BaseMatrix *subMat;
     ScoreMatrix *_2merSubMatrix;
     ScoreMatrix *_3merSubMatrix;
@@ -93,7 +126,17 @@ private:
     const int covMode;
     const bool includeIdentical;
     int preloadMode;
-    const unsigned int threads;
+    unsigned int threads;
+
+    size_t memoryLimit;
+    prefilter_memory_t memoryPlan;
+
+    // hands out the splits to the MPI processes, NULL outside of runMpiSplits
+    MPIScheduler *scheduler;
+
+    // identifies the run for resuming it from a checkpoint, includes the split setup
+    size_t checkpointSignature;
+    int checkpointInterval;
 
     bool runSplit(DBReader<unsigned int> *qdbr, const std::string &resultDB, const std::string &resultDBIndex,
                   size_t split, size_t splitCount, bool sameQTDB);
@@ -103,10 +146,13 @@ private:
                                              unsigned int querySeqType, unsigned int threads);
 
     // estimates memory consumption while runtime
-    static size_t estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
-                                            size_t maxHitsPerQuery,
-                                            int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                            int threads);
+    static prefilter_memory_t estimateMemoryConsumption(int split, size_t dbSize, size_t resSize, size_t dataSize,
+                                                        size_t maxHitsPerQuery,
+                                                        int alphabetSize, int kmerSize, unsigned int querySeqType,
+                                                        int threads);
+
+    // compares the planned with the peak memory usage
+    void printMemoryUsage();
 
     static size_t estimateHDDMemoryConsumption(size_t dbSize, size_t maxResListLen);
 
@@ -135,6 +181,8 @@ private:
 
     bool isSameQTDB(const std::string &queryDB);
 
+    void openTargetDb(int preloadMode);
+
     void reopenTargetDb();
 
 };
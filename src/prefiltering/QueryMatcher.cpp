@@ -7,6 +7,7 @@
 #include "SubstitutionMatrix.h"
 #include "QueryMatcher.h"
 #include "Util.h"
+#include "PerfCounters.h"
 
 #define FE_1(WHAT, X) WHAT(X)
 #define FE_2(WHAT, X, ...) WHAT(X)FE_1(WHAT, __VA_ARGS__)
@@ -113,6 +114,7 @@ size_t QueryMatcher::evaluateBins(IndexEntryLocal **hitsByIndex,
                                   unsigned short indexFrom,
                                   unsigned short indexTo,
                                   bool computeTotalScore) {
+    PerfCounters::Scope perfScope(PerfCounters::DIAGONAL_COUNTING);
     size_t localResultSize = 0;
 #define COUNT_CASE(x) case x: localResultSize += cachedOperation##x->countElements(hitsByIndex, output, outputSize, indexFrom, indexTo, computeTotalScore); break;
     switch (activeCounter){
@@ -198,6 +200,7 @@ std::pair<hit_t *, size_t> QueryMatcher::matchQuery (Sequence * querySeq, unsign
 }
 
 size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
+    PerfCounters::Scope perfScope(PerfCounters::QUERY_MATCH);
     // go through the query sequence
     size_t kmerListLen = 0;
     size_t numMatches = 0;
@@ -2,6 +2,7 @@
 // Created by mad on 12/15/15.
 
 #include "UngappedAlignment.h"
+#include "PerfCounters.h"
 
 UngappedAlignment::UngappedAlignment(const unsigned int maxSeqLen,
                                      BaseMatrix *substitutionMatrix, SequenceLookup *sequenceLookup)
@@ -28,6 +29,7 @@ void UngappedAlignment::processQuery(Sequence *seq,
                                    float *biasCorrection,
                                    CounterResult *results,
                                    size_t resultSize) {
+    PerfCounters::Scope perfScope(PerfCounters::UNGAPPED_ALIGNMENT);
     short bias = createProfile(seq, biasCorrection, subMatrix->subMatrix2Bit, subMatrix->alphabetSize);
     this->bias = bias;
     queryLen = seq->L;
@@ -0,0 +1,44 @@
+#ifndef MMSEQS_CLUSTERTESTUTIL_H
+#define MMSEQS_CLUSTERTESTUTIL_H
+
+// helpers shared by the clustering tests
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "DBReader.h"
+#include "FileUtil.h"
+#include "Util.h"
+#include "Debug.h"
+
+// path of a test database in the directory below the build tree, TEST_TMP_DIR is set by mmseqs_setup_test
+inline std::string testTmpPath(const std::string &name) {
+    if (FileUtil::directoryExists(TEST_TMP_DIR) == false && FileUtil::makeDir(TEST_TMP_DIR) == false) {
+        Debug(Debug::ERROR) << "Can not create directory " << TEST_TMP_DIR << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    return std::string(TEST_TMP_DIR) + "/" + name;
+}
+
+// the clusters as sorted lists of member keys, in a sorted order
+inline std::vector<std::vector<unsigned int> > readClusters(const std::string &cluDb) {
+    DBReader<unsigned int> reader(cluDb.c_str(), (cluDb + ".index").c_str());
+    reader.open(DBReader<unsigned int>::NOSORT);
+    std::vector<std::vector<unsigned int> > clusters;
+    for (size_t i = 0; i < reader.getSize(); i++) {
+        std::vector<unsigned int> members;
+        char *data = reader.getData(i);
+        while (*data != '\0') {
+            members.push_back(static_cast<unsigned int>(strtoul(data, NULL, 10)));
+            data = Util::skipLine(data);
+        }
+        std::sort(members.begin() + 1, members.end());
+        clusters.push_back(members);
+    }
+    reader.close();
+    std::sort(clusters.begin(), clusters.end());
+    return clusters;
+}
+
+#endif
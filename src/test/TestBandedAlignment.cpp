@@ -0,0 +1,119 @@
+// Compares the diagonal banded Smith-Waterman against the full striped alignment
+// on randomly mutated sequence pairs.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "StripedSmithWaterman.h"
+#include "SubstitutionMatrix.h"
+#include "EvalueComputation.h"
+#include "Sequence.h"
+#include "Parameters.h"
+#include "Matcher.h"
+#include "Timer.h"
+
+const char* binary_name = "test_bandedalignment";
+
+std::string randomSequence(SubstitutionMatrix &subMat, size_t length) {
+    std::string seq;
+    for (size_t i = 0; i < length; i++) {
+        seq.push_back(subMat.int2aa[rand() % 20]);
+    }
+    return seq;
+}
+
+std::string mutate(SubstitutionMatrix &subMat, const std::string &seq, float subRate, float indelRate) {
+    std::string result;
+    for (size_t i = 0; i < seq.size(); i++) {
+        float r = static_cast<float>(rand()) / RAND_MAX;
+        if (r < indelRate / 2) {
+            // deletion
+            continue;
+        } else if (r < indelRate) {
+            // insertion of up to 3 residues
+            int len = 1 + rand() % 3;
+            for (int j = 0; j < len; j++) {
+                result.push_back(subMat.int2aa[rand() % 20]);
+            }
+        }
+        if (static_cast<float>(rand()) / RAND_MAX < subRate) {
+            result.push_back(subMat.int2aa[rand() % 20]);
+        } else {
+            result.push_back(seq[i]);
+        }
+    }
+    return result;
+}
+
+int main (int, const char**) {
+    srand(1);
+    SubstitutionMatrix subMat("blosum62.out", 2.0, 0.0);
+    int8_t * tinySubMat = new int8_t[subMat.alphabetSize * subMat.alphabetSize];
+    for (int i = 0; i < subMat.alphabetSize; i++) {
+        for (int j = 0; j < subMat.alphabetSize; j++) {
+            tinySubMat[i * subMat.alphabetSize + j] = (int8_t) subMat.subMatrix[i][j];
+        }
+    }
+    const int gapOpen = 11;
+    const int gapExtend = 1;
+    EvalueComputation evaluer(100000, &subMat, gapOpen, gapExtend);
+    SmithWaterman aligner(10000, subMat.alphabetSize, true);
+    Sequence query(10000, Sequence::AMINO_ACIDS, &subMat, 0, false, false);
+    Sequence target(10000, Sequence::AMINO_ACIDS, &subMat, 0, false, false);
+
+    const int tests = 1000;
+    std::vector<std::string> querySeqs;
+    std::vector<std::string> targetSeqs;
+    std::vector<int> diagonals;
+    for (int t = 0; t < tests; t++) {
+        std::string core = randomSequence(subMat, 100 + rand() % 400);
+        size_t prefix = rand() % 50;
+        querySeqs.push_back(randomSequence(subMat, rand() % 50) + core);
+        targetSeqs.push_back(randomSequence(subMat, prefix) + mutate(subMat, core, 0.4, 0.04));
+        // prefilter diagonal is qPos - tPos of the k-mer match, allow it to be slightly off
+        diagonals.push_back(static_cast<int>(querySeqs[t].size() - core.size()) - static_cast<int>(prefix) + (rand() % 5 - 2));
+    }
+
+    std::vector<s_align> full(tests);
+    std::vector<s_align> banded(tests);
+    for (int mode = 0; mode < 2; mode++) {
+        Timer timer;
+        for (int t = 0; t < tests; t++) {
+            query.mapSequence(0, 0, querySeqs[t].c_str());
+            target.mapSequence(1, 1, targetSeqs[t].c_str());
+            aligner.ssw_init(&query, tinySubMat, &subMat, subMat.alphabetSize, 2);
+            int32_t maskLen = query.L / 2;
+            if (mode == 0) {
+                full[t] = aligner.ssw_align(target.int_sequence, target.L, gapOpen, gapExtend,
+                                            Matcher::SCORE_COV_SEQID, 10000, &evaluer, 0, 0.0, maskLen);
+            } else {
+                banded[t] = aligner.ssw_align_banded(target.int_sequence, target.L, diagonals[t], 16, gapOpen, gapExtend,
+                                                     Matcher::SCORE_COV_SEQID, 10000, &evaluer, 0, 0.0, maskLen);
+            }
+        }
+        std::cout << ((mode == 0) ? "Full: " : "Banded: ") << timer.lap() << std::endl;
+    }
+
+    int scoreMismatch = 0;
+    int startEndMismatch = 0;
+    for (int t = 0; t < tests; t++) {
+        if (full[t].score1 != banded[t].score1) {
+            scoreMismatch++;
+            std::cout << "Score " << t << ": " << full[t].score1 << " " << banded[t].score1 << std::endl;
+        } else if (full[t].qEndPos1 != banded[t].qEndPos1 || full[t].dbEndPos1 != banded[t].dbEndPos1
+                   || full[t].qStartPos1 != banded[t].qStartPos1 || full[t].dbStartPos1 != banded[t].dbStartPos1) {
+            startEndMismatch++;
+        }
+        if (full[t].cigar) {
+            delete [] full[t].cigar;
+        }
+        if (banded[t].cigar) {
+            delete [] banded[t].cigar;
+        }
+    }
+    std::cout << "Tests: " << tests << " score mismatches: " << scoreMismatch
+              << " start/end differences: " << startEndMismatch << std::endl;
+    delete [] tinySubMat;
+    return EXIT_SUCCESS;
+}
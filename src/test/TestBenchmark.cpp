@@ -0,0 +1,796 @@
+// Reproducible benchmarks of the hot kernels and of the main modules on synthetic data.
+//
+//   test_benchmark generate <out.fasta> [--seqs N] [--mean-length L] [--length-sd S] [--min-length L]
+//                  [--max-length L] [--redundancy R] [--mutation M] [--seed S]
+//   test_benchmark run <results.json> [--mmseqs BINARY] [--tmp DIR] [--repeats N] [--scale F]
+//                  [--baseline BASELINE.json] [--max-slowdown F]
+//   test_benchmark compare <baseline.json> <results.json> [--max-slowdown F]
+//
+// Sequence lengths are drawn from a log-normal distribution, a fraction of the sequences (redundancy)
+// are mutated copies of earlier ones. Random numbers come from a fixed generator, so the same seed
+// produces the same data everywhere. "run" writes one JSON object per benchmark with the median
+// time of the repeats. Without --mmseqs only the kernels are measured. "compare" reports every
+// benchmark that became slower than the baseline by more than max-slowdown and then fails.
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+#include "ExtendedSubstitutionMatrix.h"
+#include "KmerGenerator.h"
+#include "CacheFriendlyOperations.h"
+#include "UngappedAlignment.h"
+#include "SequenceLookup.h"
+#include "StripedSmithWaterman.h"
+#include "EvalueComputation.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Parameters.h"
+#include "Debug.h"
+#include "Util.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_benchmark";
+
+// xorshift64*, identical on every platform unlike the std distributions
+class Random {
+public:
+    Random(unsigned long long seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    unsigned long long next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+
+    double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    double normal() {
+        const double u = std::max(uniform(), 1e-300);
+        return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * uniform());
+    }
+
+private:
+    unsigned long long state;
+};
+
+struct GeneratorOptions {
+    size_t seqs;
+    double meanLength;
+    double lengthSd;
+    size_t minLength;
+    size_t maxLength;
+    double redundancy;
+    double mutation;
+    unsigned long long seed;
+
+    GeneratorOptions() : seqs(10000), meanLength(350), lengthSd(250), minLength(30), maxLength(5000),
+                         redundancy(0.5), mutation(0.3), seed(1) {}
+};
+
+// amino acid background frequencies (Robinson & Robinson)
+static const char AMINO_ACIDS[] = "ARNDCQEGHILKMFPSTWYV";
+static const double AMINO_ACID_FREQUENCIES[] = {
+        0.07805, 0.05129, 0.04487, 0.05364, 0.01925, 0.04264, 0.06295, 0.07377, 0.02199, 0.05142,
+        0.09019, 0.05744, 0.02243, 0.03856, 0.05203, 0.07120, 0.05841, 0.01330, 0.03216, 0.06441
+};
+
+char randomAminoAcid(Random &random) {
+    double r = random.uniform() * 0.99999;
+    for (size_t i = 0; i < 19; i++) {
+        r -= AMINO_ACID_FREQUENCIES[i];
+        if (r < 0) {
+            return AMINO_ACIDS[i];
+        }
+    }
+    return AMINO_ACIDS[19];
+}
+
+// copy of a sequence with substitutions and a few short indels
+std::string mutate(const std::string &seq, double rate, Random &random) {
+    std::string out;
+    out.reserve(seq.size() + 16);
+    for (size_t i = 0; i < seq.size(); i++) {
+        const double r = random.uniform();
+        if (r < rate * 0.05) {
+            continue;
+        } else if (r < rate * 0.1) {
+            out.push_back(randomAminoAcid(random));
+        }
+        out.push_back(random.uniform() < rate ? randomAminoAcid(random) : seq[i]);
+    }
+    return out;
+}
+
+std::vector<std::string> generateSequences(const GeneratorOptions &options) {
+    Random random(options.seed);
+    // parameters of the log-normal distribution with the given mean and standard deviation
+    const double variance = log(1.0 + (options.lengthSd * options.lengthSd) / (options.meanLength * options.meanLength));
+    const double mu = log(options.meanLength) - variance / 2.0;
+    const double sigma = sqrt(variance);
+
+    std::vector<std::string> seqs;
+    seqs.reserve(options.seqs);
+    for (size_t i = 0; i < options.seqs; i++) {
+        if (i > 0 && random.uniform() < options.redundancy) {
+            seqs.push_back(mutate(seqs[random.next() % seqs.size()], options.mutation, random));
+            continue;
+        }
+        double length = exp(mu + sigma * random.normal());
+        length = std::min(std::max(length, static_cast<double>(options.minLength)), static_cast<double>(options.maxLength));
+        std::string seq;
+        for (size_t pos = 0; pos < static_cast<size_t>(length); pos++) {
+            seq.push_back(randomAminoAcid(random));
+        }
+        seqs.push_back(seq);
+    }
+    return seqs;
+}
+
+void writeFasta(const std::string &fileName, const std::vector<std::string> &seqs) {
+    FILE *file = FileUtil::openFileOrDie(fileName.c_str(), "w", false);
+    for (size_t i = 0; i < seqs.size(); i++) {
+        fprintf(file, ">seq%zu\n", i);
+        for (size_t pos = 0; pos < seqs[i].size(); pos += 80) {
+            fprintf(file, "%s\n", seqs[i].substr(pos, 80).c_str());
+        }
+    }
+    fclose(file);
+}
+
+double now() {
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + 1e-6 * time.tv_usec;
+}
+
+struct Result {
+    std::string name;
+    std::string kind;
+    double seconds;
+    double minSeconds;
+    double maxSeconds;
+    double work;
+    std::string unit;
+    double cpuSeconds;
+    size_t peakRss;
+};
+
+std::string toJson(const Result &result) {
+    char buffer[1024];
+    int length = snprintf(buffer, sizeof(buffer),
+             "{\"name\":\"%s\",\"kind\":\"%s\",\"seconds\":%.6f,\"minSeconds\":%.6f,\"maxSeconds\":%.6f,"
+             "\"work\":%.0f,\"unit\":\"%s\",\"perSecond\":%.2f,\"cpuSeconds\":%.6f",
+             result.name.c_str(), result.kind.c_str(), result.seconds, result.minSeconds, result.maxSeconds,
+             result.work, result.unit.c_str(), result.seconds > 0 ? result.work / result.seconds : 0.0,
+             result.cpuSeconds);
+    // the peak RSS of a child includes the one of this process at the fork, so modules have none
+    if (result.kind != "module") {
+        length += snprintf(buffer + length, sizeof(buffer) - length, ",\"peakRssBytes\":%zu", result.peakRss);
+    }
+    snprintf(buffer + length, sizeof(buffer) - length, "}");
+    return buffer;
+}
+
+class Benchmark {
+public:
+    virtual ~Benchmark() {}
+
+    // returns the amount of work done, e.g. the number of alignments
+    virtual double run() = 0;
+
+    // undone between repeats without being timed
+    virtual void reset() {}
+};
+
+Result measure(const std::string &name, const std::string &kind, const std::string &unit, Benchmark &benchmark,
+               int repeats) {
+    std::vector<double> times;
+    double work = 0;
+    double cpu = 0;
+    size_t peakRss = 0;
+    for (int i = 0; i < repeats; i++) {
+        benchmark.reset();
+        struct rusage before, after;
+        getrusage(kind == "module" ? RUSAGE_CHILDREN : RUSAGE_SELF, &before);
+        const double start = now();
+        work = benchmark.run();
+        times.push_back(now() - start);
+        getrusage(kind == "module" ? RUSAGE_CHILDREN : RUSAGE_SELF, &after);
+        cpu += (after.ru_utime.tv_sec - before.ru_utime.tv_sec) + 1e-6 * (after.ru_utime.tv_usec - before.ru_utime.tv_usec)
+               + (after.ru_stime.tv_sec - before.ru_stime.tv_sec) + 1e-6 * (after.ru_stime.tv_usec - before.ru_stime.tv_usec);
+        peakRss = static_cast<size_t>(after.ru_maxrss) * 1024;
+    }
+    std::sort(times.begin(), times.end());
+    Result result;
+    result.name = name;
+    result.kind = kind;
+    result.seconds = times[times.size() / 2];
+    result.minSeconds = times.front();
+    result.maxSeconds = times.back();
+    result.work = work;
+    result.unit = unit;
+    result.cpuSeconds = cpu / repeats;
+    result.peakRss = peakRss;
+    std::cout << name << ": " << result.seconds << "s (" << work << " " << unit << ")" << std::endl;
+    return result;
+}
+
+class KmerGeneration : public Benchmark {
+public:
+    KmerGeneration(SubstitutionMatrix &subMat, const std::vector<std::string> &seqs)
+            : subMat(subMat), seqs(seqs), seq(32000, Sequence::AMINO_ACIDS, &subMat, KMER_SIZE, false, false),
+              generator(KMER_SIZE, subMat.alphabetSize, 105) {
+        two = ExtendedSubstitutionMatrix::calcScoreMatrix(subMat, 2);
+        three = ExtendedSubstitutionMatrix::calcScoreMatrix(subMat, 3);
+        generator.setDivideStrategy(three, two);
+    }
+
+    ~KmerGeneration() {
+        ScoreMatrix::cleanup(two);
+        ScoreMatrix::cleanup(three);
+    }
+
+    double run() {
+        size_t kmers = 0;
+        for (size_t i = 0; i < seqs.size(); i++) {
+            seq.mapSequence(i, i, seqs[i].c_str());
+            while (seq.hasNextKmer()) {
+                kmers += generator.generateKmerList(seq.nextKmer()).elementSize;
+            }
+        }
+        return kmers;
+    }
+
+private:
+    static const size_t KMER_SIZE = 6;
+    SubstitutionMatrix &subMat;
+    const std::vector<std::string> &seqs;
+    Sequence seq;
+    KmerGenerator generator;
+    ScoreMatrix *two;
+    ScoreMatrix *three;
+};
+
+// k-mer hits of a query to random database positions, in the layout of the index table lists
+class DiagonalCounting : public Benchmark {
+public:
+    DiagonalCounting(size_t queries, size_t queryLength, size_t hitsPerPos, size_t dbSize)
+            : queries(queries), queryLength(queryLength), counter(dbSize, queryLength * hitsPerPos / 256 + 1) {
+        Random random(3);
+        entries.resize(queryLength * hitsPerPos);
+        for (size_t i = 0; i < entries.size(); i++) {
+            entries[i].seqId = random.next() % dbSize;
+            entries[i].position_j = random.next() % 1000;
+        }
+        for (size_t pos = 0; pos <= queryLength; pos++) {
+            lists.push_back(entries.data() + pos * hitsPerPos);
+        }
+        output.resize(entries.size());
+    }
+
+    double run() {
+        size_t counted = 0;
+        for (size_t i = 0; i < queries; i++) {
+            counter.countElements(lists.data(), output.data(), output.size(), 0, queryLength, false);
+            counted += entries.size();
+        }
+        return counted;
+    }
+
+private:
+    size_t queries;
+    size_t queryLength;
+    CacheFriendlyOperations<256> counter;
+    std::vector<IndexEntryLocal> entries;
+    std::vector<IndexEntryLocal *> lists;
+    std::vector<CounterResult> output;
+};
+
+class Ungapped : public Benchmark {
+public:
+    Ungapped(SubstitutionMatrix &subMat, const std::vector<std::string> &queries, const std::vector<std::string> &targets)
+            : queries(queries), seq(32000, Sequence::AMINO_ACIDS, &subMat, 6, false, false),
+              lookup(targets.size(), residues(targets)), aligner(NULL) {
+        size_t maxLength = 0;
+        for (size_t i = 0; i < targets.size(); i++) {
+            seq.mapSequence(i, i, targets[i].c_str());
+            lookup.addSequence(&seq);
+            maxLength = std::max(maxLength, targets[i].size());
+        }
+        for (size_t i = 0; i < queries.size(); i++) {
+            maxLength = std::max(maxLength, queries[i].size());
+        }
+        aligner = new UngappedAlignment(maxLength, &subMat, &lookup);
+        bias.resize(maxLength + 1, 0.0f);
+        Random random(4);
+        for (size_t i = 0; i < targets.size(); i++) {
+            CounterResult hit;
+            hit.id = i;
+            hit.diagonal = random.next() % 200;
+            hit.count = 0;
+            hits.push_back(hit);
+        }
+    }
+
+    ~Ungapped() {
+        delete aligner;
+    }
+
+    static size_t residues(const std::vector<std::string> &seqs) {
+        size_t residues = 0;
+        for (size_t i = 0; i < seqs.size(); i++) {
+            residues += seqs[i].size();
+        }
+        return residues;
+    }
+
+    double run() {
+        for (size_t i = 0; i < queries.size(); i++) {
+            seq.mapSequence(i, i, queries[i].c_str());
+            aligner->processQuery(&seq, bias.data(), hits.data(), hits.size());
+        }
+        return static_cast<double>(queries.size()) * hits.size();
+    }
+
+private:
+    const std::vector<std::string> &queries;
+    Sequence seq;
+    SequenceLookup lookup;
+    UngappedAlignment *aligner;
+    std::vector<float> bias;
+    std::vector<CounterResult> hits;
+};
+
+// gapped alignment of pairs, profileSize is the score_size of ssw_init (0 byte, 1 word, 2 both)
+class SmithWatermanAlignment : public Benchmark {
+public:
+    SmithWatermanAlignment(SubstitutionMatrix &subMat, const std::vector<std::pair<std::string, std::string> > &pairs,
+                           int profileSize, unsigned int alignmentMode)
+            : subMat(subMat), pairs(pairs), profileSize(profileSize), alignmentMode(alignmentMode),
+              query(32000, Sequence::AMINO_ACIDS, &subMat, 6, false, false),
+              target(32000, Sequence::AMINO_ACIDS, &subMat, 6, false, false),
+              aligner(32000, subMat.alphabetSize, false), evaluer(100000000, &subMat, 11, 1) {
+        matrix.resize(subMat.alphabetSize * subMat.alphabetSize);
+        for (int i = 0; i < subMat.alphabetSize; i++) {
+            for (int j = 0; j < subMat.alphabetSize; j++) {
+                matrix[i * subMat.alphabetSize + j] = subMat.subMatrix[i][j];
+            }
+        }
+    }
+
+    double run() {
+        double cells = 0;
+        for (size_t i = 0; i < pairs.size(); i++) {
+            query.mapSequence(0, 0, pairs[i].first.c_str());
+            target.mapSequence(1, 1, pairs[i].second.c_str());
+            aligner.ssw_init(&query, matrix.data(), &subMat, subMat.alphabetSize, profileSize);
+            s_align alignment = aligner.ssw_align(target.int_sequence, target.L, 11, 1, alignmentMode,
+                                                  1000.0, &evaluer, 0, 0.0, query.L / 2);
+            if (alignment.cigar != NULL) {
+                free(alignment.cigar);
+            }
+            cells += static_cast<double>(query.L) * target.L;
+        }
+        return cells;
+    }
+
+private:
+    SubstitutionMatrix &subMat;
+    const std::vector<std::pair<std::string, std::string> > &pairs;
+    int profileSize;
+    unsigned int alignmentMode;
+    Sequence query;
+    Sequence target;
+    SmithWaterman aligner;
+    EvalueComputation evaluer;
+    std::vector<int8_t> matrix;
+};
+
+// writes entries from all threads and merges the thread files
+class DBWrite : public Benchmark {
+public:
+    DBWrite(const std::string &db, const std::vector<std::string> &entries, int threads)
+            : db(db), entries(entries), threads(threads) {}
+
+    double run() {
+        DBWriter writer(db.c_str(), (db + ".index").c_str(), threads);
+        writer.open();
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < entries.size(); i++) {
+            unsigned int thread = 0;
+#ifdef OPENMP
+            thread = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+            writer.writeData(entries[i].c_str(), entries[i].size(), i, thread);
+        }
+        writer.close();
+        return entries.size();
+    }
+
+private:
+    std::string db;
+    const std::vector<std::string> &entries;
+    int threads;
+};
+
+class DBMerge : public Benchmark {
+public:
+    DBMerge(const std::string &db, size_t parts) : db(db), parts(parts) {}
+
+    // splits the lines of every entry into parts, like the results of a target split prefilter
+    void reset() {
+        DBReader<unsigned int> reader(db.c_str(), (db + ".index").c_str());
+        reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+        files.clear();
+        for (size_t part = 0; part < parts; part++) {
+            const std::string name = db + "_part" + SSTR(part);
+            DBWriter writer(name.c_str(), (name + ".index").c_str(), 1);
+            writer.open();
+            for (size_t i = 0; i < reader.getSize(); i++) {
+                std::string entry;
+                char *data = reader.getData(i);
+                for (size_t line = 0; *data != '\0'; line++) {
+                    char *next = Util::skipLine(data);
+                    if (line % parts == part) {
+                        entry.append(data, next - data);
+                    }
+                    data = next;
+                }
+                writer.writeData(entry.c_str(), entry.size(), reader.getDbKey(i), 0);
+            }
+            writer.close();
+            files.push_back(std::make_pair(name, name + ".index"));
+        }
+        entries = reader.getSize();
+        reader.close();
+    }
+
+    double run() {
+        const std::string merged = db + "_merged";
+        DBWriter writer(merged.c_str(), (merged + ".index").c_str(), 1);
+        writer.open();
+        writer.mergeFilePair(files);
+        writer.close();
+        return entries;
+    }
+
+private:
+    std::string db;
+    size_t parts;
+    size_t entries;
+    std::vector<std::pair<std::string, std::string> > files;
+};
+
+class DBRead : public Benchmark {
+public:
+    DBRead(const std::string &db) : db(db) {}
+
+    double run() {
+        DBReader<unsigned int> reader(db.c_str(), (db + ".index").c_str());
+        reader.open(DBReader<unsigned int>::NOSORT);
+        size_t lines = 0;
+        for (size_t i = 0; i < reader.getSize(); i++) {
+            const char *data = reader.getData(i);
+            while (*data != '\0') {
+                lines += (*data == '\n');
+                data++;
+            }
+        }
+        const size_t entries = reader.getSize();
+        reader.close();
+        return lines > 0 ? entries : 0;
+    }
+
+private:
+    std::string db;
+};
+
+// one mmseqs call, its outputs are removed before every repeat
+class Module : public Benchmark {
+public:
+    Module(const std::string &command, const std::vector<std::string> &outputs, double work)
+            : command(command), outputs(outputs), work(work) {}
+
+    void reset() {
+        for (size_t i = 0; i < outputs.size(); i++) {
+            const std::string remove = "rm -rf '" + outputs[i] + "' '" + outputs[i] + ".index' '" + outputs[i] + ".dbtype'";
+            if (system(remove.c_str()) != 0) {
+                Debug(Debug::WARNING) << "Could not remove " << outputs[i] << "\n";
+            }
+        }
+    }
+
+    double run() {
+        if (system((command + " >/dev/null 2>&1").c_str()) != 0) {
+            Debug(Debug::ERROR) << "Benchmark command failed: " << command << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        return work;
+    }
+
+private:
+    std::string command;
+    std::vector<std::string> outputs;
+    double work;
+};
+
+std::map<std::string, std::string> parseOptions(int argc, const char **argv, int first) {
+    std::map<std::string, std::string> options;
+    for (int i = first; i + 1 < argc; i += 2) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            Debug(Debug::ERROR) << "Unknown argument " << argv[i] << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        options[argv[i] + 2] = argv[i + 1];
+    }
+    return options;
+}
+
+double option(const std::map<std::string, std::string> &options, const std::string &name, double value) {
+    std::map<std::string, std::string>::const_iterator it = options.find(name);
+    return (it == options.end()) ? value : strtod(it->second.c_str(), NULL);
+}
+
+std::string option(const std::map<std::string, std::string> &options, const std::string &name, const std::string &value) {
+    std::map<std::string, std::string>::const_iterator it = options.find(name);
+    return (it == options.end()) ? value : it->second;
+}
+
+GeneratorOptions generatorOptions(const std::map<std::string, std::string> &options) {
+    GeneratorOptions generator;
+    generator.seqs = option(options, "seqs", generator.seqs);
+    generator.meanLength = option(options, "mean-length", generator.meanLength);
+    generator.lengthSd = option(options, "length-sd", generator.lengthSd);
+    generator.minLength = option(options, "min-length", generator.minLength);
+    generator.maxLength = option(options, "max-length", generator.maxLength);
+    generator.redundancy = option(options, "redundancy", generator.redundancy);
+    generator.mutation = option(options, "mutation", generator.mutation);
+    generator.seed = option(options, "seed", generator.seed);
+    return generator;
+}
+
+std::vector<Result> runKernels(const std::string &tmp, int repeats, double scale, int threads) {
+    std::vector<Result> results;
+    Parameters &par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.c_str(), 2.0, 0.0);
+    SubstitutionMatrix kmerSubMat(par.scoringMatrixFile.c_str(), 8.0, -0.2f);
+
+    GeneratorOptions options;
+    options.redundancy = 0.0;
+    options.seqs = std::max(static_cast<size_t>(2000 * scale), static_cast<size_t>(100));
+    const std::vector<std::string> seqs = generateSequences(options);
+    const std::vector<std::string> queries(seqs.begin(), seqs.begin() + std::max(seqs.size() / 10, static_cast<size_t>(1)));
+
+    {
+        KmerGeneration benchmark(kmerSubMat, seqs);
+        results.push_back(measure("kmer_generation", "kernel", "kmers", benchmark, repeats));
+    }
+    {
+        DiagonalCounting benchmark(std::max(static_cast<size_t>(2000 * scale), static_cast<size_t>(1)), 350, 100, 1000000);
+        results.push_back(measure("diagonal_counting", "kernel", "hits", benchmark, repeats));
+    }
+    {
+        Ungapped benchmark(subMat, queries, seqs);
+        results.push_back(measure("ungapped", "kernel", "alignments", benchmark, repeats));
+    }
+
+    // unrelated pairs for the score only kernels, homologous pairs for the traceback
+    std::vector<std::pair<std::string, std::string> > unrelated;
+    std::vector<std::pair<std::string, std::string> > related;
+    Random random(5);
+    const size_t pairs = std::max(static_cast<size_t>(2000 * scale), static_cast<size_t>(10));
+    for (size_t i = 0; i < pairs; i++) {
+        const std::string &seq = seqs[random.next() % seqs.size()];
+        unrelated.push_back(std::make_pair(seq, seqs[random.next() % seqs.size()]));
+        related.push_back(std::make_pair(seq, mutate(seq, 0.3, random)));
+    }
+    {
+        SmithWatermanAlignment benchmark(subMat, unrelated, 0, 0);
+        results.push_back(measure("sw_byte", "kernel", "cells", benchmark, repeats));
+    }
+    {
+        SmithWatermanAlignment benchmark(subMat, unrelated, 1, 0);
+        results.push_back(measure("sw_word", "kernel", "cells", benchmark, repeats));
+    }
+    {
+        SmithWatermanAlignment benchmark(subMat, related, 2, 2);
+        results.push_back(measure("sw_traceback", "kernel", "cells", benchmark, repeats));
+    }
+
+    // prefilter-like result entries
+    std::vector<std::string> entries;
+    const size_t entryCount = std::max(static_cast<size_t>(200000 * scale), static_cast<size_t>(1000));
+    for (size_t i = 0; i < entryCount; i++) {
+        std::string entry;
+        const size_t hits = 1 + random.next() % 20;
+        for (size_t hit = 0; hit < hits; hit++) {
+            entry.append(SSTR(random.next() % 1000000)).append("\t").append(SSTR(random.next() % 100)).append("\t0\n");
+        }
+        entries.push_back(entry);
+    }
+    const std::string db = tmp + "/kernel_db";
+    {
+        DBWrite benchmark(db, entries, threads);
+        results.push_back(measure("db_write", "kernel", "entries", benchmark, repeats));
+    }
+    {
+        DBRead benchmark(db);
+        results.push_back(measure("db_read", "kernel", "entries", benchmark, repeats));
+    }
+    {
+        DBMerge benchmark(db, 8);
+        results.push_back(measure("db_merge", "kernel", "entries", benchmark, repeats));
+    }
+    return results;
+}
+
+std::vector<Result> runModules(const std::string &mmseqs, const std::string &tmp, int repeats, double scale, int threads) {
+    std::vector<Result> results;
+    GeneratorOptions options;
+    options.seqs = std::max(static_cast<size_t>(10000 * scale), static_cast<size_t>(100));
+    const std::string fasta = tmp + "/seqs.fasta";
+    writeFasta(fasta, generateSequences(options));
+
+    const std::string binary = "'" + mmseqs + "' ";
+    const std::string threadsParam = " --threads " + SSTR(threads);
+    const std::string db = tmp + "/db";
+    Module createdb(binary + "createdb '" + fasta + "' '" + db + "'", std::vector<std::string>(1, db), options.seqs);
+    createdb.reset();
+    createdb.run();
+
+    const std::string pref = tmp + "/pref";
+    const std::string aln = tmp + "/aln";
+    const std::string clu = tmp + "/clu";
+    const std::string linclu = tmp + "/linclu";
+    {
+        Module benchmark(binary + "prefilter '" + db + "' '" + db + "' '" + pref + "'" + threadsParam,
+                         std::vector<std::string>(1, pref), options.seqs);
+        results.push_back(measure("prefilter", "module", "queries", benchmark, repeats));
+    }
+    {
+        Module benchmark(binary + "align '" + db + "' '" + db + "' '" + pref + "' '" + aln + "'" + threadsParam,
+                         std::vector<std::string>(1, aln), options.seqs);
+        results.push_back(measure("align", "module", "queries", benchmark, repeats));
+    }
+    {
+        Module benchmark(binary + "clust '" + db + "' '" + aln + "' '" + clu + "'" + threadsParam,
+                         std::vector<std::string>(1, clu), options.seqs);
+        results.push_back(measure("clust", "module", "sequences", benchmark, repeats));
+    }
+    {
+        std::vector<std::string> outputs;
+        outputs.push_back(linclu);
+        outputs.push_back(tmp + "/linclust_tmp");
+        Module benchmark(binary + "linclust '" + db + "' '" + linclu + "' '" + tmp + "/linclust_tmp'" + threadsParam,
+                         outputs, options.seqs);
+        results.push_back(measure("linclust", "module", "sequences", benchmark, repeats));
+    }
+    return results;
+}
+
+std::map<std::string, double> readResults(const std::string &fileName) {
+    std::map<std::string, double> results;
+    std::ifstream file(fileName.c_str());
+    if (file.good() == false) {
+        Debug(Debug::ERROR) << "Could not open " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t name = line.find("\"name\":\"");
+        const size_t seconds = line.find("\"seconds\":");
+        if (name == std::string::npos || seconds == std::string::npos) {
+            continue;
+        }
+        const size_t nameStart = name + strlen("\"name\":\"");
+        results[line.substr(nameStart, line.find('"', nameStart) - nameStart)]
+                = strtod(line.c_str() + seconds + strlen("\"seconds\":"), NULL);
+    }
+    return results;
+}
+
+int compare(const std::string &baselineFile, const std::string &resultFile, double maxSlowdown) {
+    std::map<std::string, double> baseline = readResults(baselineFile);
+    std::map<std::string, double> current = readResults(resultFile);
+    size_t regressions = 0;
+    printf("%-20s %12s %12s %8s\n", "benchmark", "baseline", "current", "ratio");
+    for (std::map<std::string, double>::const_iterator it = baseline.begin(); it != baseline.end(); ++it) {
+        std::map<std::string, double>::const_iterator result = current.find(it->first);
+        if (result == current.end()) {
+            printf("%-20s %12.4f %12s %8s  MISSING\n", it->first.c_str(), it->second, "-", "-");
+            continue;
+        }
+        const double ratio = (it->second > 0) ? result->second / it->second : 1.0;
+        const bool regression = ratio > 1.0 + maxSlowdown;
+        regressions += regression;
+        printf("%-20s %12.4f %12.4f %8.3f%s\n", it->first.c_str(), it->second, result->second, ratio,
+               regression ? "  REGRESSION" : "");
+    }
+    if (regressions > 0) {
+        printf("%zu benchmarks are more than %.0f%% slower than the baseline\n", regressions, maxSlowdown * 100);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: test_benchmark generate <out.fasta> [options]\n"
+                     "       test_benchmark run <results.json> [--mmseqs BINARY] [--tmp DIR] [--repeats N] [--scale F]"
+                     " [--baseline BASELINE.json] [--max-slowdown F]\n"
+                     "       test_benchmark compare <baseline.json> <results.json> [--max-slowdown F]\n";
+        return EXIT_FAILURE;
+    }
+    const std::string mode = argv[1];
+    if (mode == "generate") {
+        std::map<std::string, std::string> options = parseOptions(argc, argv, 3);
+        writeFasta(argv[2], generateSequences(generatorOptions(options)));
+        return EXIT_SUCCESS;
+    } else if (mode == "compare") {
+        if (argc < 4) {
+            std::cerr << "compare needs a baseline and a result file\n";
+            return EXIT_FAILURE;
+        }
+        std::map<std::string, std::string> options = parseOptions(argc, argv, 4);
+        return compare(argv[2], argv[3], option(options, "max-slowdown", 0.1));
+    } else if (mode != "run") {
+        std::cerr << "Unknown mode " << mode << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::map<std::string, std::string> options = parseOptions(argc, argv, 3);
+    const std::string resultFile = argv[2];
+    const std::string tmp = option(options, "tmp", std::string("benchmark_tmp"));
+    const int repeats = std::max(static_cast<int>(option(options, "repeats", 5)), 1);
+    const double scale = option(options, "scale", 1.0);
+    int threads = 1;
+#ifdef OPENMP
+    threads = omp_get_max_threads();
+#endif
+    if (FileUtil::directoryExists(tmp.c_str()) == false && FileUtil::makeDir(tmp.c_str()) == false) {
+        Debug(Debug::ERROR) << "Could not create " << tmp << "\n";
+        return EXIT_FAILURE;
+    }
+    Debug::setDebugLevel(Debug::WARNING);
+
+    std::vector<Result> results = runKernels(tmp, repeats, scale, threads);
+    const std::string mmseqs = option(options, "mmseqs", std::string());
+    if (mmseqs.empty() == false) {
+        std::vector<Result> modules = runModules(mmseqs, tmp, repeats, scale, threads);
+        results.insert(results.end(), modules.begin(), modules.end());
+    }
+    std::ofstream out(resultFile.c_str());
+    for (size_t i = 0; i < results.size(); i++) {
+        out << toJson(results[i]) << "\n";
+    }
+    out.close();
+    std::cout << "Results written to " << resultFile << std::endl;
+
+    const std::string baseline = option(options, "baseline", std::string());
+    if (baseline.empty() == false) {
+        if (FileUtil::fileExists(baseline.c_str()) == false) {
+            std::cout << "No baseline " << baseline << " to compare with, store one with make benchmark_baseline" << std::endl;
+            return EXIT_SUCCESS;
+        }
+        return compare(baseline, resultFile, option(options, "max-slowdown", 0.1));
+    }
+    return EXIT_SUCCESS;
+}
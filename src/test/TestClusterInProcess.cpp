@@ -0,0 +1,81 @@
+// Clusters a database with the workflow scripts and with --in-process, single step and cascaded,
+// and checks that the clusterings are the same. Call with the mmseqs binary to test.
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ClusterTestUtil.h"
+#include "SubstitutionMatrix.h"
+#include "Parameters.h"
+#include "FileUtil.h"
+#include "Util.h"
+#include "Debug.h"
+
+const char* binary_name = "test_clusterinprocess";
+
+void run(const std::string &command, const std::string &log) {
+    if (system((command + " >>" + log + " 2>&1").c_str()) != 0) {
+        Debug(Debug::ERROR) << "Failed: " << command << ", see " << log << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+int main (int argc, const char** argv) {
+    if (argc < 2) {
+        Debug(Debug::ERROR) << "Usage: test_clusterinprocess <mmseqs binary>\n";
+        return EXIT_FAILURE;
+    }
+    const std::string mmseqs = argv[1];
+    srand(1);
+    Parameters& par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.c_str(), 2.0, 0.0);
+
+    const std::string dir = testTmpPath("clusterinprocess");
+    if (system(("rm -rf " + dir).c_str()) != 0 || FileUtil::makeDir(dir.c_str()) == false) {
+        Debug(Debug::ERROR) << "Can not create directory " << dir << "\n";
+        return EXIT_FAILURE;
+    }
+    const std::string log = dir + "/log";
+
+    // random sequences and copies of them with every tenth residue changed on average
+    std::vector<std::string> seqs;
+    for (size_t i = 0; i < 300; i++) {
+        std::string seq;
+        const size_t length = 100 + rand() % 400;
+        for (size_t pos = 0; pos < length; pos++) {
+            seq.push_back(subMat.int2aa[rand() % 20]);
+        }
+        seqs.push_back(seq);
+    }
+    for (size_t i = 0; i < 200; i++) {
+        std::string seq = seqs[rand() % 300];
+        for (size_t pos = 0; pos < seq.size(); pos++) {
+            if (rand() % 10 == 0) {
+                seq[pos] = subMat.int2aa[rand() % 20];
+            }
+        }
+        seqs.push_back(seq);
+    }
+    std::ofstream fasta((dir + "/seqs.fasta").c_str());
+    for (size_t i = 0; i < seqs.size(); i++) {
+        fasta << ">seq_" << i << "\n" << seqs[i] << "\n";
+    }
+    fasta.close();
+    run(mmseqs + " createdb " + dir + "/seqs.fasta " + dir + "/seqs", log);
+
+    bool same = true;
+    const char *names[] = {"single", "cascaded"};
+    const char *modes[] = {" --single-step-clustering", " --min-seq-id 0.5"};
+    for (size_t mode = 0; mode < 2; mode++) {
+        const std::string script = dir + "/clu_" + names[mode] + "_script";
+        const std::string inProcess = dir + "/clu_" + names[mode] + "_inprocess";
+        run(mmseqs + " cluster " + dir + "/seqs " + script + " " + dir + "/tmp" + modes[mode], log);
+        run(mmseqs + " cluster " + dir + "/seqs " + inProcess + " " + dir + "/tmp" + modes[mode] + " --in-process", log);
+        const bool sameMode = readClusters(script) == readClusters(inProcess);
+        std::cout << names[mode] << ": " << (sameMode ? "same clustering" : "different clustering") << " in process" << std::endl;
+        same &= sameMode;
+    }
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,117 @@
+// Updates a clustering twice, with and without --kmer-table, and checks that the clusterings are the same.
+// The first update has no table yet and searches, the second one looks the new sequences up in the table
+// the first one wrote. Call with the mmseqs binary to test.
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ClusterTestUtil.h"
+#include "SubstitutionMatrix.h"
+#include "Parameters.h"
+#include "FileUtil.h"
+#include "Util.h"
+#include "Debug.h"
+
+const char* binary_name = "test_clusterupdate";
+
+std::string mutate(SubstitutionMatrix &subMat, const std::string &seq, float seqId) {
+    std::string result;
+    for (size_t i = 0; i < seq.size(); i++) {
+        if (static_cast<float>(rand()) / RAND_MAX > seqId) {
+            result.push_back(subMat.int2aa[rand() % 20]);
+        } else {
+            result.push_back(seq[i]);
+        }
+    }
+    return result;
+}
+
+std::string randomSequence(SubstitutionMatrix &subMat) {
+    std::string seq;
+    const size_t length = 100 + rand() % 400;
+    for (size_t pos = 0; pos < length; pos++) {
+        seq.push_back(subMat.int2aa[rand() % 20]);
+    }
+    return seq;
+}
+
+// adds close copies of random sequences of seqs and unrelated sequences
+void addSequences(SubstitutionMatrix &subMat, std::vector<std::string> &seqs, size_t mutated, size_t unrelated) {
+    const size_t count = seqs.size();
+    for (size_t i = 0; i < mutated; i++) {
+        seqs.push_back(mutate(subMat, seqs[rand() % count], 0.99f));
+    }
+    for (size_t i = 0; i < unrelated; i++) {
+        seqs.push_back(randomSequence(subMat));
+    }
+}
+
+void writeFasta(const std::string &fileName, const std::vector<std::string> &seqs) {
+    std::ofstream out(fileName.c_str());
+    for (size_t i = 0; i < seqs.size(); i++) {
+        out << ">seq_" << i << "\n" << seqs[i] << "\n";
+    }
+}
+
+void run(const std::string &command, const std::string &log) {
+    if (system((command + " >>" + log + " 2>&1").c_str()) != 0) {
+        Debug(Debug::ERROR) << "Failed: " << command << ", see " << log << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+int main (int argc, const char** argv) {
+    if (argc < 2) {
+        Debug(Debug::ERROR) << "Usage: test_clusterupdate <mmseqs binary>\n";
+        return EXIT_FAILURE;
+    }
+    const std::string mmseqs = argv[1];
+    srand(1);
+    Parameters& par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.c_str(), 2.0, 0.0);
+
+    const std::string dir = testTmpPath("clusterupdate");
+    if (system(("rm -rf " + dir).c_str()) != 0 || FileUtil::makeDir(dir.c_str()) == false) {
+        Debug(Debug::ERROR) << "Can not create directory " << dir << "\n";
+        return EXIT_FAILURE;
+    }
+    const std::string log = dir + "/log";
+
+    // three generations of a database, every one keeps the sequences of the previous one
+    std::vector<std::string> seqs;
+    addSequences(subMat, seqs, 0, 300);
+    writeFasta(dir + "/seqs0.fasta", seqs);
+    addSequences(subMat, seqs, 100, 20);
+    writeFasta(dir + "/seqs1.fasta", seqs);
+    addSequences(subMat, seqs, 100, 20);
+    writeFasta(dir + "/seqs2.fasta", seqs);
+    for (size_t i = 0; i < 3; i++) {
+        const std::string name = dir + "/seqs" + SSTR(i);
+        run(mmseqs + " createdb " + name + ".fasta " + name, log);
+    }
+    run(mmseqs + " cluster " + dir + "/seqs0 " + dir + "/clu0 " + dir + "/tmp", log);
+
+    bool same = true;
+    const char *modes[] = {"search", "table"};
+    for (size_t update = 1; update < 3; update++) {
+        for (size_t mode = 0; mode < 2; mode++) {
+            // the first generation is the same for both, later ones build on the clustering of the same mode
+            const std::string previous = (update == 1) ? "0" : SSTR(update - 1) + modes[mode];
+            const std::string oldDb = (update == 1) ? dir + "/seqs0" : dir + "/mapped" + previous;
+            const std::string current = SSTR(update) + modes[mode];
+            run(mmseqs + " clusterupdate " + oldDb + " " + dir + "/seqs" + SSTR(update) + " " + dir + "/clu" + previous + " "
+                + dir + "/mapped" + current + " " + dir + "/clu" + current + " " + dir + "/tmp" + current
+                + (mode == 1 ? " --kmer-table" : ""), log);
+        }
+        if (FileUtil::fileExists((dir + "/clu" + SSTR(update) + "table.kmertable").c_str()) == false) {
+            Debug(Debug::ERROR) << "Update " << update << " wrote no k-mer table\n";
+            return EXIT_FAILURE;
+        }
+        const bool sameUpdate = readClusters(dir + "/clu" + SSTR(update) + "search") == readClusters(dir + "/clu" + SSTR(update) + "table");
+        std::cout << "Update " << update << ": " << (sameUpdate ? "same clustering" : "different clustering") << " with the k-mer table" << std::endl;
+        same &= sameUpdate;
+    }
+    return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+// Compares the vectorized ungapped diagonal scoring of the DistanceCalculator
+// against the scalar recurrence and reports the runtime of both.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "DistanceCalculator.h"
+#include "SubstitutionMatrix.h"
+#include "Parameters.h"
+#include "Timer.h"
+
+const char* binary_name = "test_distancecalculatorperformance";
+
+DistanceCalculator::LocalAlignment scalarAlignment(const char *seq1, const char *seq2, unsigned int length, const char **subMat) {
+    int maxScore = 0;
+    int maxEndPos = 0;
+    int maxStartPos = 0;
+    int minPos = -1;
+    int score = 0;
+    for (unsigned int pos = 0; pos < length; pos++) {
+        score += subMat[static_cast<int>(seq1[pos])][static_cast<int>(seq2[pos])];
+        const bool isMinScore = (score <= 0);
+        score = (isMinScore) ? 0 : score;
+        minPos = (isMinScore) ? pos : minPos;
+        const bool isNewMaxScore = (score > maxScore);
+        maxEndPos = (isNewMaxScore) ? pos : maxEndPos;
+        maxStartPos = (isNewMaxScore) ? minPos + 1 : maxStartPos;
+        maxScore = (isNewMaxScore) ? score : maxScore;
+    }
+    return DistanceCalculator::LocalAlignment(maxStartPos, maxEndPos, maxScore);
+}
+
+int main (int, const char**) {
+    srand(1);
+    Parameters& par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.c_str(), 2.0, 0.0);
+    SubstitutionMatrix::FastMatrix fastMatrix = SubstitutionMatrix::createAsciiSubMat(subMat);
+
+    // pairs with 90% identity as linclust sees them, the last third is unrelated to give the X-drop something to cut
+    const size_t pairs = 20000;
+    std::vector<std::string> seqs1;
+    std::vector<std::string> seqs2;
+    for (size_t i = 0; i < pairs; i++) {
+        const size_t length = 1 + rand() % 2000;
+        std::string seq1;
+        std::string seq2;
+        for (size_t pos = 0; pos < length; pos++) {
+            const char aa = subMat.int2aa[rand() % 20];
+            seq1.push_back(aa);
+            const bool unrelated = pos > (2 * length) / 3;
+            seq2.push_back((unrelated || rand() % 10 == 0) ? subMat.int2aa[rand() % 20] : aa);
+        }
+        seqs1.push_back(seq1);
+        seqs2.push_back(seq2);
+    }
+
+    const int rounds = 10;
+    std::vector<DistanceCalculator::LocalAlignment> scalar(pairs);
+    std::vector<DistanceCalculator::LocalAlignment> simd(pairs);
+    std::vector<DistanceCalculator::LocalAlignment> xdrop(pairs);
+    Timer timer;
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < pairs; i++) {
+            scalar[i] = scalarAlignment(seqs1[i].c_str(), seqs2[i].c_str(), seqs1[i].size(), fastMatrix.matrix);
+        }
+    }
+    std::cout << "Scalar: " << timer.lap() << std::endl;
+    timer.reset();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < pairs; i++) {
+            simd[i] = DistanceCalculator::computeSubstitutionStartEndDistance(seqs1[i].c_str(), seqs2[i].c_str(),
+                                                                              seqs1[i].size(), fastMatrix.matrix);
+        }
+    }
+    std::cout << "SIMD: " << timer.lap() << std::endl;
+    timer.reset();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < pairs; i++) {
+            xdrop[i] = DistanceCalculator::computeSubstitutionStartEndDistance(seqs1[i].c_str(), seqs2[i].c_str(),
+                                                                               seqs1[i].size(), fastMatrix.matrix, 40);
+        }
+    }
+    std::cout << "SIMD X-drop 40: " << timer.lap() << std::endl;
+
+    size_t mismatches = 0;
+    size_t xdropLower = 0;
+    for (size_t i = 0; i < pairs; i++) {
+        if (scalar[i].score != simd[i].score || scalar[i].startPos != simd[i].startPos || scalar[i].endPos != simd[i].endPos) {
+            mismatches++;
+            if (mismatches < 10) {
+                std::cout << "Mismatch " << i << ": " << scalar[i].score << " " << scalar[i].startPos << "-" << scalar[i].endPos
+                          << " vs " << simd[i].score << " " << simd[i].startPos << "-" << simd[i].endPos << std::endl;
+            }
+        }
+        xdropLower += (xdrop[i].score < scalar[i].score);
+    }
+    std::cout << "Pairs: " << pairs << " mismatches: " << mismatches
+              << " lower score with X-drop: " << xdropLower << std::endl;
+
+    delete [] fastMatrix.matrix;
+    delete [] fastMatrix.matrixData;
+    return EXIT_SUCCESS;
+}
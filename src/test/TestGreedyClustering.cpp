@@ -0,0 +1,179 @@
+// Clusters mutated sequence families with align --greedy-clustering and checks that the
+// clustering is the one of align + clust --cluster-mode 2, for one and for several threads.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "ClusterTestUtil.h"
+#include "Alignment.h"
+#include "Matcher.h"
+#include "Clustering.h"
+#include "SubstitutionMatrix.h"
+#include "Sequence.h"
+#include "Parameters.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Util.h"
+#include "Debug.h"
+#include "Timer.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_greedyclustering";
+
+std::string mutate(SubstitutionMatrix &subMat, const std::string &seq, float seqId) {
+    std::string result;
+    for (size_t i = 0; i < seq.size(); i++) {
+        const float r = static_cast<float>(rand()) / RAND_MAX;
+        if (r < (1.0f - seqId) * 0.05f) {
+            // deletion
+            continue;
+        }
+        if (r < (1.0f - seqId) * 0.1f) {
+            // insertion
+            result.push_back(subMat.int2aa[rand() % 20]);
+        }
+        if (static_cast<float>(rand()) / RAND_MAX > seqId) {
+            result.push_back(subMat.int2aa[rand() % 20]);
+        } else {
+            result.push_back(seq[i]);
+        }
+    }
+    return result;
+}
+
+// families of mutated and truncated copies of a random sequence. The prefilter lists the family
+// members in random order, misses some of them and has some random hits
+void writeFamilies(SubstitutionMatrix &subMat, const std::string &seqDb, const std::string &prefDb, size_t sequences) {
+    std::vector<std::string> seqs;
+    std::vector<std::vector<unsigned int> > hits;
+    while (seqs.size() < sequences) {
+        std::string root;
+        const size_t length = 100 + rand() % 400;
+        for (size_t pos = 0; pos < length; pos++) {
+            root.push_back(subMat.int2aa[rand() % 20]);
+        }
+        const size_t familyStart = seqs.size();
+        const size_t familySize = std::min(sequences - familyStart, static_cast<size_t>(1 + rand() % 30));
+        for (size_t i = 0; i < familySize; i++) {
+            std::string seq = mutate(subMat, root, 0.4f + 0.6f * static_cast<float>(rand()) / RAND_MAX);
+            seq = seq.substr(0, seq.size() - rand() % (seq.size() / 3 + 1));
+            seqs.push_back(seq);
+        }
+        for (size_t i = familyStart; i < seqs.size(); i++) {
+            std::vector<unsigned int> list(1, i);
+            for (size_t j = familyStart; j < seqs.size(); j++) {
+                if (j != i && rand() % 10 != 0) {
+                    list.push_back(j);
+                }
+            }
+            for (size_t j = 0; j < 3; j++) {
+                list.push_back(rand() % sequences);
+            }
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+            std::random_shuffle(list.begin(), list.end());
+            hits.push_back(list);
+        }
+    }
+
+    DBWriter seqWriter(seqDb.c_str(), (seqDb + ".index").c_str(), 1);
+    seqWriter.open();
+    DBWriter prefWriter(prefDb.c_str(), (prefDb + ".index").c_str(), 1);
+    prefWriter.open();
+    std::string result;
+    for (size_t i = 0; i < sequences; i++) {
+        const std::string seq = seqs[i] + "\n";
+        seqWriter.writeData(seq.c_str(), seq.length(), i);
+        for (size_t j = 0; j < hits[i].size(); j++) {
+            if (hits[i][j] < sequences) {
+                result.append(SSTR(hits[i][j]) + "\t" + SSTR(100 - j) + "\t0\n");
+            }
+        }
+        prefWriter.writeData(result.c_str(), result.length(), i);
+        result.clear();
+    }
+    seqWriter.close(Sequence::AMINO_ACIDS);
+    prefWriter.close();
+}
+
+// orders the hits of each query like the greedy clustering does, by E-value, score and target key.
+// align breaks ties in E-value and score by the order of its sort, the greedy clustering by target key
+void sortAlignments(const std::string &alnDb, const std::string &sortedDb) {
+    DBReader<unsigned int> reader(alnDb.c_str(), (alnDb + ".index").c_str());
+    reader.open(DBReader<unsigned int>::NOSORT);
+    DBWriter writer(sortedDb.c_str(), (sortedDb + ".index").c_str(), 1);
+    writer.open();
+    std::vector<Matcher::result_t> results;
+    char buffer[1024 + 32768];
+    for (size_t i = 0; i < reader.getSize(); i++) {
+        Matcher::readAlignmentResults(results, reader.getData(i));
+        std::sort(results.begin(), results.end(), Matcher::compareHitsAndId);
+        writer.writeStart(0);
+        for (size_t j = 0; j < results.size(); j++) {
+            const size_t length = Matcher::resultToBuffer(buffer, results[j], false);
+            writer.writeAdd(buffer, length, 0);
+        }
+        writer.writeEnd(reader.getDbKey(i), 0);
+        results.clear();
+    }
+    writer.close();
+    reader.close();
+}
+
+void runAlignment(Parameters &par, const std::string &seqDb, const std::string &prefDb, const std::string &outDb,
+                  bool greedyClustering, int threads) {
+#ifdef OPENMP
+    omp_set_num_threads(threads);
+#endif
+    par.threads = threads;
+    par.greedyClustering = greedyClustering;
+    Timer timer;
+    Alignment aln(seqDb, seqDb + ".index", seqDb, seqDb + ".index", prefDb, prefDb + ".index",
+                  outDb, outDb + ".index", par);
+    aln.run(par.maxAccept, par.maxRejected);
+    std::cout << (greedyClustering ? "Greedy clustering" : "Alignment") << " (" << threads << " threads): "
+              << timer.lap() << std::endl;
+}
+
+int main (int argc, const char * argv[]) {
+    srand(1);
+    const size_t sequences = (argc > 1) ? strtoull(argv[1], NULL, 10) : 5000;
+    int threads = 1;
+#ifdef OPENMP
+    threads = omp_get_max_threads();
+#endif
+    threads = std::max(threads, 4);
+
+    Parameters& par = Parameters::getInstance();
+    par.covThr = 0.5;
+    par.checkpointInterval = 0;
+    SubstitutionMatrix subMat(par.scoringMatrixFile.c_str(), 2.0, 0.0);
+    const std::string seqDb = testTmpPath("test_greedyclustering_seq");
+    const std::string prefDb = testTmpPath("test_greedyclustering_pref");
+    const std::string alnDb = testTmpPath("test_greedyclustering_aln");
+    const std::string sortedDb = testTmpPath("test_greedyclustering_sorted");
+    const std::string cluDb = testTmpPath("test_greedyclustering_clust");
+    writeFamilies(subMat, seqDb, prefDb, sequences);
+
+    Debug::setDebugLevel(Debug::WARNING);
+    runAlignment(par, seqDb, prefDb, alnDb, false, threads);
+    sortAlignments(alnDb, sortedDb);
+    Clustering clustering(seqDb, seqDb + ".index", sortedDb, sortedDb + ".index", cluDb, cluDb + ".index",
+                          par.maxIteration, par.similarityScoreType, threads);
+    clustering.run(Parameters::GREEDY);
+    runAlignment(par, seqDb, prefDb, testTmpPath("test_greedyclustering_single"), true, 1);
+    runAlignment(par, seqDb, prefDb, testTmpPath("test_greedyclustering_multi"), true, threads);
+
+    const std::vector<std::vector<unsigned int> > clust = readClusters(cluDb);
+    const bool single = readClusters(testTmpPath("test_greedyclustering_single")) == clust;
+    const bool multi = readClusters(testTmpPath("test_greedyclustering_multi")) == clust;
+    std::cout << "Clusters: " << clust.size() << std::endl;
+    std::cout << "Greedy clustering with 1 thread " << (single ? "identical" : "different")
+              << ", with " << threads << " threads " << (multi ? "identical" : "different") << std::endl;
+    return (single && multi) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,57 @@
+// Compares the radix sort of the linclust k-mer array against omptl::sort
+// for both sort orders and reports the runtime of each.
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "kmermatcher.h"
+#include "omptl/omptl_algorithm"
+#include "Timer.h"
+
+const char* binary_name = "test_kmerpositionsort";
+
+bool equalKmerPositions(const std::vector<KmerPosition> &a, const std::vector<KmerPosition> &b) {
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].kmer != b[i].kmer || a[i].id != b[i].id || a[i].seqLen != b[i].seqLen || a[i].pos != b[i].pos) {
+            std::cout << "Mismatch at " << i << ": " << a[i].kmer << " " << a[i].id << " " << a[i].seqLen << " " << a[i].pos
+                      << " vs " << b[i].kmer << " " << b[i].id << " " << b[i].seqLen << " " << b[i].pos << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main (int argc, const char * argv[]) {
+    srand(1);
+    const size_t count = (argc > 1) ? strtoull(argv[1], NULL, 10) : 20000000;
+    const size_t sequences = count / 100;
+
+    // hashed k-mers spread over the full range, few members per k-mer as in linclust
+    std::vector<KmerPosition> kmers(count);
+    for (size_t i = 0; i < count; i++) {
+        const size_t kmer = ((static_cast<size_t>(rand()) << 31) ^ rand()) % (count / 4);
+        const unsigned int id = rand() % sequences;
+        kmers[i] = KmerPosition(kmer, id, static_cast<unsigned short>(id % 3000), static_cast<short>(rand() % 4000 - 2000));
+    }
+
+    bool ok = true;
+    for (int order = 0; order < 2; order++) {
+        const bool byRepSequence = (order == 1);
+        std::vector<KmerPosition> reference(kmers);
+        std::vector<KmerPosition> radix(kmers);
+        Timer timer;
+        if (byRepSequence) {
+            omptl::sort(reference.begin(), reference.end(), KmerPosition::compareRepSequenceAndIdAndDiag);
+        } else {
+            omptl::sort(reference.begin(), reference.end(), KmerPosition::compareRepSequenceAndIdAndPos);
+        }
+        std::cout << (byRepSequence ? "RepSequenceAndIdAndDiag" : "RepSequenceAndIdAndPos") << std::endl;
+        std::cout << "omptl::sort: " << timer.lap() << std::endl;
+        timer.reset();
+        sortKmerPositions(radix.data(), radix.size(), byRepSequence);
+        std::cout << "Radix sort: " << timer.lap() << std::endl;
+        ok = ok && equalKmerPositions(reference, radix);
+    }
+    std::cout << "Elements: " << count << " " << (ok ? "identical" : "different") << std::endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,102 @@
+// Compares the linclust k-mer selection modes: how many mutated sequence pairs
+// still share a selected k-mer and how long the selection takes.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "kmermatcher.h"
+#include "SubstitutionMatrix.h"
+#include "ReducedMatrix.h"
+#include "Indexer.h"
+#include "Sequence.h"
+#include "Parameters.h"
+#include "Timer.h"
+
+const char* binary_name = "test_kmerselection";
+
+std::string mutate(SubstitutionMatrix &subMat, const std::string &seq, float seqId) {
+    std::string result;
+    for (size_t i = 0; i < seq.size(); i++) {
+        const float r = static_cast<float>(rand()) / RAND_MAX;
+        if (r < (1.0f - seqId) * 0.05f) {
+            // deletion
+            continue;
+        }
+        if (r < (1.0f - seqId) * 0.1f) {
+            // insertion
+            result.push_back(subMat.int2aa[rand() % 20]);
+        }
+        if (static_cast<float>(rand()) / RAND_MAX > seqId) {
+            result.push_back(subMat.int2aa[rand() % 20]);
+        } else {
+            result.push_back(seq[i]);
+        }
+    }
+    return result;
+}
+
+int main (int, const char**) {
+    srand(1);
+    Parameters& par = Parameters::getInstance();
+    SubstitutionMatrix sMat(par.scoringMatrixFile.c_str(), 2.0, 0.0);
+    ReducedMatrix subMat(sMat.probMatrix, sMat.subMatrixPseudoCounts, sMat.aa2int, sMat.int2aa, sMat.alphabetSize, 13, 2.0);
+    const size_t KMER_SIZE = 10;
+    const size_t chooseTopKmer = 20;
+    const int maxSeqLen = 10000;
+
+    const float seqIds[] = {0.95f, 0.9f, 0.8f, 0.7f};
+    const size_t pairs = 5000;
+    std::vector<std::string> seqs;
+    for (size_t i = 0; i < pairs; i++) {
+        std::string seq;
+        const size_t length = 100 + rand() % 500;
+        for (size_t pos = 0; pos < length; pos++) {
+            seq.push_back(sMat.int2aa[rand() % 20]);
+        }
+        seqs.push_back(seq);
+    }
+
+    Sequence seq(maxSeqLen, Sequence::AMINO_ACIDS, &subMat, KMER_SIZE, false, false);
+    Indexer idxer(subMat.alphabetSize, KMER_SIZE);
+    SequencePosition *kmers = new SequencePosition[maxSeqLen + 1];
+    KmerSelectionBuffer buffer(maxSeqLen);
+    const char *modeNames[] = {"lowest hash", "minimizer", "open syncmer"};
+    for (size_t s = 0; s < sizeof(seqIds) / sizeof(seqIds[0]); s++) {
+        std::vector<std::string> targets;
+        for (size_t i = 0; i < pairs; i++) {
+            targets.push_back(mutate(sMat, seqs[i], seqIds[s]));
+        }
+        std::cout << "Seq. id " << seqIds[s] << std::endl;
+        for (int mode = Parameters::KMER_SELECTION_LOWEST_HASH; mode <= Parameters::KMER_SELECTION_SYNCMER; mode++) {
+            std::vector<std::vector<size_t> > selected(2 * pairs);
+            Timer timer;
+            for (size_t i = 0; i < 2 * pairs; i++) {
+                seq.mapSequence(i, i, (i < pairs) ? seqs[i].c_str() : targets[i - pairs].c_str());
+                const int count = selectSequenceKmers(seq, idxer, &subMat, KMER_SIZE, chooseTopKmer, par.hashShift,
+                                                      mode, kmers, &buffer);
+                const int considered = std::min(static_cast<int>(chooseTopKmer - 1), count);
+                for (int k = 0; k < considered; k++) {
+                    selected[i].push_back(kmers[k].kmer);
+                }
+            }
+            const std::string time = timer.lap();
+            size_t shared = 0;
+            size_t kmerCount = 0;
+            for (size_t i = 0; i < pairs; i++) {
+                bool found = false;
+                for (size_t k = 0; k < selected[pairs + i].size(); k++) {
+                    found |= std::find(selected[i].begin(), selected[i].end(), selected[pairs + i][k]) != selected[i].end();
+                }
+                shared += found;
+                kmerCount += selected[i].size() + selected[pairs + i].size();
+            }
+            std::cout << "  " << modeNames[mode] << ": pairs sharing a k-mer " << shared << "/" << pairs
+                      << ", k-mers per sequence " << static_cast<double>(kmerCount) / (2 * pairs)
+                      << ", time " << time << std::endl;
+        }
+    }
+    delete [] kmers;
+    return EXIT_SUCCESS;
+}
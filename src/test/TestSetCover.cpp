@@ -0,0 +1,105 @@
+// Clusters a random alignment graph with the serial and the parallel set cover,
+// checks that the parallel result does not depend on the number of threads
+// and compares the number of clusters and the runtime.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+#include "ClusterTestUtil.h"
+#include "Clustering.h"
+#include "Parameters.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Util.h"
+#include "Debug.h"
+#include "Timer.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_setcover";
+
+// families of similar sequences with random edges inside and some noise edges between them
+void writeGraph(const std::string &seqDb, const std::string &alnDb, size_t nodes) {
+    std::vector<std::set<unsigned int> > edges(nodes);
+    size_t start = 0;
+    while (start < nodes) {
+        const size_t familySize = std::min(nodes - start, static_cast<size_t>(1 + rand() % 50));
+        for (size_t i = start; i < start + familySize; i++) {
+            for (size_t j = i + 1; j < start + familySize; j++) {
+                if (rand() % 3 == 0) {
+                    edges[i].insert(j);
+                    edges[j].insert(i);
+                }
+            }
+        }
+        start += familySize;
+    }
+    for (size_t i = 0; i < nodes / 10; i++) {
+        const unsigned int a = rand() % nodes;
+        const unsigned int b = rand() % nodes;
+        edges[a].insert(b);
+        edges[b].insert(a);
+    }
+
+    DBWriter seqWriter(seqDb.c_str(), (seqDb + ".index").c_str(), 1);
+    seqWriter.open();
+    DBWriter alnWriter(alnDb.c_str(), (alnDb + ".index").c_str(), 1);
+    alnWriter.open();
+    std::string result;
+    for (size_t i = 0; i < nodes; i++) {
+        std::string seq(50 + rand() % 500, 'A');
+        seq.push_back('\n');
+        seqWriter.writeData(seq.c_str(), seq.length(), i);
+        result = SSTR(i) + "\t100\t1.000\n";
+        for (std::set<unsigned int>::const_iterator it = edges[i].begin(); it != edges[i].end(); ++it) {
+            if (*it != i) {
+                result.append(SSTR(*it) + "\t50\t0." + SSTR(500 + rand() % 500) + "\n");
+            }
+        }
+        alnWriter.writeData(result.c_str(), result.length(), i);
+    }
+    seqWriter.close();
+    alnWriter.close();
+}
+
+size_t runClustering(const std::string &seqDb, const std::string &alnDb, const std::string &cluDb,
+                     bool parallelSetCover, float eps, int threads) {
+#ifdef OPENMP
+    omp_set_num_threads(threads);
+#endif
+    Timer timer;
+    Clustering clustering(seqDb, seqDb + ".index", alnDb, alnDb + ".index", cluDb, cluDb + ".index",
+                          1000, Parameters::APC_SEQID, threads, parallelSetCover, eps);
+    clustering.run(Parameters::SET_COVER);
+    std::cout << (parallelSetCover ? "Parallel set cover (eps " + SSTR(eps) + ", " + SSTR(threads) + " threads)" : std::string("Serial set cover"))
+              << ": " << timer.lap() << std::endl;
+    return readClusters(cluDb).size();
+}
+
+int main (int argc, const char * argv[]) {
+    srand(1);
+    const size_t nodes = (argc > 1) ? strtoull(argv[1], NULL, 10) : 100000;
+    int threads = 1;
+#ifdef OPENMP
+    threads = omp_get_max_threads();
+#endif
+    const std::string seqDb = testTmpPath("test_setcover_seq");
+    const std::string alnDb = testTmpPath("test_setcover_aln");
+    writeGraph(seqDb, alnDb, nodes);
+
+    Debug::setDebugLevel(Debug::WARNING);
+    const size_t serial = runClustering(seqDb, alnDb, testTmpPath("test_setcover_serial"), false, 0.0, threads);
+    const size_t single = runClustering(seqDb, alnDb, testTmpPath("test_setcover_single"), true, 0.0, 1);
+    const size_t multi = runClustering(seqDb, alnDb, testTmpPath("test_setcover_multi"), true, 0.0, std::max(threads, 4));
+    const size_t relaxed = runClustering(seqDb, alnDb, testTmpPath("test_setcover_relaxed"), true, 0.5, std::max(threads, 4));
+    const bool deterministic = readClusters(testTmpPath("test_setcover_single")) == readClusters(testTmpPath("test_setcover_multi"));
+
+    std::cout << "Clusters serial: " << serial << ", parallel: " << multi << ", parallel eps 0.5: " << relaxed << std::endl;
+    std::cout << "Parallel result " << (deterministic ? "identical" : "different") << " for 1 and " << std::max(threads, 4) << " threads" << std::endl;
+    return (deterministic && single == multi) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -8,6 +8,7 @@
 #include "FileUtil.h"
 #include "TranslateNucl.h"
 #include "Orf.h"
+#include "Progress.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -250,6 +251,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
     Debug(Debug::INFO) << "Start writing file to " << par.db4 << "\n";
     bool isDb = par.dbOut;
 
+    Progress progress("convertalis", alnDbr.getSize());
 #pragma omp parallel num_threads(localThreads)
     {
         Sequence *querySeq;
@@ -277,7 +279,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
 
 #pragma omp  for schedule(dynamic, 10)
         for (size_t i = 0; i < alnDbr.getSize(); i++) {
-            Debug::printProgress(i);
+            progress.update(1, 0);
 
             unsigned int queryKey = alnDbr.getDbKey(i);
             char *data = alnDbr.getData(i);
@@ -538,6 +540,7 @@ int convertalignments(int argc, const char **argv, const Command &command) {
         }
         delete [] translatedSeq;
     }
+    progress.finish();
     resultWriter.close();
 
     // tsv output
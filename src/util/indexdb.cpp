@@ -36,13 +36,9 @@ int indexdb(int argc, const char **argv, const Command &command) {
     int split = 1;
     int splitMode = Parameters::TARGET_DB_SPLIT;
 
-    size_t memoryLimit;
-    if (par.splitMemoryLimit > 0) {
-        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024;
-    } else {
-        memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
-    }
-    Prefiltering::setupSplit(dbr, subMat->alphabetSize, dbr.getDbtype(), par.threads, false, par.maxResListLen, memoryLimit, &kmerSize, &split, &splitMode);
+    size_t memoryLimit = Prefiltering::getMemoryBudget(par.splitMemoryLimit);
+    int threads = par.threads;
+    Prefiltering::setupSplit(dbr, subMat->alphabetSize, dbr.getDbtype(), &threads, false, par.maxResListLen, memoryLimit, &kmerSize, &split, &splitMode);
 
     bool kScoreSet = false;
     for (size_t i = 0; i < par.indexdb.size(); i++) {
@@ -9,6 +9,7 @@
 #include "Util.h"
 #include "PrefilteringIndexReader.h"
 #include "FileUtil.h"
+#include "Progress.h"
 
 #include <string>
 #include <vector>
@@ -143,6 +144,7 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
     const bool isFiltering = par.filterMsa != 0;
     int xAmioAcid = subMat.aa2int[(int)'X'];
 
+    Progress progress("result2profile", dbSize);
 #pragma omp parallel
     {
         Matcher matcher(qDbr->getDbtype(), maxSequenceLength, &subMat, &evalueComputation, par.compBiasCorrection, par.gapOpen, par.gapExtend);
@@ -161,8 +163,6 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
 
 #pragma omp for schedule(dynamic, 10)
         for (size_t id = dbFrom; id < (dbFrom + dbSize); id++) {
-            Debug::printProgress(id);
-
             // Get the sequence from the queryDB
             unsigned int queryKey = resultReader.getDbKey(id);
 
@@ -183,6 +183,7 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
                 }
                 centerSequence.mapSequence(0, queryKey, dbSeqData);
             }
+            progress.update(1, centerSequence.L);
 
             char *results = resultReader.getData(id);
             std::vector<Matcher::result_t> alnResults;
@@ -314,6 +315,7 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
         }
         delete [] charSequence;
     }
+    progress.finish();
 
     // cleanup
     if (consensusWriter != NULL) {
@@ -158,7 +158,7 @@ int doswap(Parameters& par, bool isGeneralMode) {
 
     size_t memoryLimit;
     if (par.splitMemoryLimit > 0) {
-        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024;
+        memoryLimit = static_cast<size_t>(par.splitMemoryLimit) * 1024 * 1024;
     } else {
         memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
     }
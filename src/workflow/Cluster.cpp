@@ -2,6 +2,8 @@
 #include "Util.h"
 #include "DBWriter.h"
 #include "CommandCaller.h"
+#include "WorkflowRunner.h"
+#include "CommandDeclarations.h"
 #include "Debug.h"
 #include "FileUtil.h"
 
@@ -9,6 +11,7 @@
 #include "clustering.sh.h"
 
 #include <cassert>
+#include <cstdio>
 
 void setWorkflowDefaults(Parameters *p) {
     p->spacedKmer = true;
@@ -38,6 +41,146 @@ int setAutomaticIterations(float sens){
     }
 }
 
+static std::vector<std::string> stepArgs(const std::string &db1, const std::string &db2, const std::string &db3,
+                                         const std::string &db4, const std::string &parameters) {
+    std::vector<std::string> args;
+    args.push_back(db1);
+    args.push_back(db2);
+    args.push_back(db3);
+    if (db4.empty() == false) {
+        args.push_back(db4);
+    }
+    std::vector<std::string> parameterArgs = WorkflowRunner::splitParameters(parameters);
+    args.insert(args.end(), parameterArgs.begin(), parameterArgs.end());
+    return args;
+}
+
+static void removeDb(const std::string &db) {
+    if (FileUtil::fileExists(db.c_str())) {
+        FileUtil::deleteFile(db);
+    }
+    if (FileUtil::fileExists((db + ".index").c_str())) {
+        FileUtil::deleteFile(db + ".index");
+    }
+}
+
+// align borrows the input database and the sequence lookup of the prefilter, rescorediagonal opens its own
+static void runAlignment(WorkflowRunner &runner, const std::string &alignModule, const std::vector<std::string> &args,
+                         const std::string &output, bool useRunner) {
+    if (alignModule == "align") {
+        runner.run(alignModule, align, args, output, useRunner);
+    } else {
+        runner.run(alignModule, args, output, useRunner);
+    }
+}
+
+// same steps as cascaded_clustering.sh
+static void runCascadedClustering(WorkflowRunner &runner, const std::string &source, const std::string &output,
+                                  const std::string &tmpDir, const std::string &alignModule,
+                                  const std::string &linclustPar, const std::vector<std::string> &prefilterPar,
+                                  const std::vector<std::string> &alignPar, const std::vector<std::string> &clusterPar,
+                                  bool removeTmp) {
+    const std::string linclustDir = tmpDir + "/linclust";
+    if (FileUtil::directoryExists(linclustDir.c_str()) == false && FileUtil::makeDir(linclustDir.c_str()) == false) {
+        Debug(Debug::ERROR) << "Could not create tmp folder " << linclustDir << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // linclust is a workflow itself
+    runner.run("linclust", stepArgs(source, tmpDir + "/clu_redundancy", linclustDir, "", linclustPar),
+               tmpDir + "/clu_redundancy", false, true);
+    runner.run("createsubdb", stepArgs(tmpDir + "/clu_redundancy", source, tmpDir + "/input_step_redundancy", "", ""),
+               tmpDir + "/input_step_redundancy");
+
+    std::string input = tmpDir + "/input_step_redundancy";
+    std::vector<std::string> mergeArgs;
+    mergeArgs.push_back(source);
+    mergeArgs.push_back(tmpDir + "/clu");
+    mergeArgs.push_back(tmpDir + "/clu_redundancy");
+    const size_t steps = prefilterPar.size();
+    for (size_t step = 0; step < steps; step++) {
+        const std::string pref = tmpDir + "/pref_step" + SSTR(step);
+        const std::string aln = tmpDir + "/aln_step" + SSTR(step);
+        const std::string clu = tmpDir + "/clu_step" + SSTR(step);
+        runner.run("prefilter", prefilter, stepArgs(input, input, pref, "", prefilterPar[step]), pref, true);
+        runAlignment(runner, alignModule, stepArgs(input, input, pref, aln, alignPar[step]), aln, true);
+        runner.release(input);
+        runner.run("clust", stepArgs(input, aln, clu, "", clusterPar[step]), clu);
+        mergeArgs.push_back(clu);
+
+        const std::string nextInput = tmpDir + "/input_step" + SSTR(step + 1);
+        if (step == steps - 1) {
+            runner.run("mergeclusters", mergeArgs, tmpDir + "/clu");
+        } else {
+            runner.run("createsubdb", stepArgs(clu, input, nextInput, "", ""), nextInput);
+        }
+        input = nextInput;
+    }
+
+    if (std::rename((tmpDir + "/clu").c_str(), output.c_str()) != 0
+        || std::rename((tmpDir + "/clu.index").c_str(), (output + ".index").c_str()) != 0) {
+        Debug(Debug::ERROR) << "Could not move result to " << output << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    if (removeTmp) {
+        Debug(Debug::INFO) << "Remove temporary files\n";
+        removeDb(tmpDir + "/clu_redundancy");
+        removeDb(tmpDir + "/input_step_redundancy");
+        for (size_t step = 0; step < steps; step++) {
+            removeDb(tmpDir + "/pref_step" + SSTR(step));
+            removeDb(tmpDir + "/aln_step" + SSTR(step));
+            removeDb(tmpDir + "/clu_step" + SSTR(step));
+            removeDb(tmpDir + "/input_step" + SSTR(step + 1));
+        }
+    }
+}
+
+// same steps as clustering.sh
+static void runClustering(WorkflowRunner &runner, const std::string &source, const std::string &output,
+                          const std::string &tmpDir, const std::string &alignModule, const std::string &redundancyPar,
+                          const std::string &prefilterPar, const std::string &alignPar, const std::string &clusterPar,
+                          bool greedyAlign, bool removeTmp) {
+    std::vector<std::string> args;
+    args.push_back(source);
+    args.push_back(tmpDir + "/aln_redundancy");
+    std::vector<std::string> parameterArgs = WorkflowRunner::splitParameters(redundancyPar);
+    args.insert(args.end(), parameterArgs.begin(), parameterArgs.end());
+    runner.run("clusthash", args, tmpDir + "/aln_redundancy");
+    runner.run("clust", stepArgs(source, tmpDir + "/aln_redundancy", tmpDir + "/clu_redundancy", "", clusterPar),
+               tmpDir + "/clu_redundancy");
+    const std::string input = tmpDir + "/input_step_redundancy";
+    runner.run("createsubdb", stepArgs(tmpDir + "/clu_redundancy", source, input, "", ""), input);
+
+    runner.run("prefilter", prefilter, stepArgs(input, input, tmpDir + "/pref", "", prefilterPar), tmpDir + "/pref", true);
+    if (greedyAlign) {
+        // align writes the clustering directly, greedy clustering is only enabled without RUNNER
+        runAlignment(runner, alignModule, stepArgs(input, input, tmpDir + "/pref", tmpDir + "/clu_step0", alignPar),
+                     tmpDir + "/clu_step0", true);
+    } else {
+        runAlignment(runner, alignModule, stepArgs(input, input, tmpDir + "/pref", tmpDir + "/aln", alignPar),
+                     tmpDir + "/aln", true);
+    }
+    runner.release(input);
+    runner.run("clust", stepArgs(input, tmpDir + "/aln", tmpDir + "/clu_step0", "", clusterPar), tmpDir + "/clu_step0");
+
+    std::vector<std::string> mergeArgs;
+    mergeArgs.push_back(source);
+    mergeArgs.push_back(output);
+    mergeArgs.push_back(tmpDir + "/clu_redundancy");
+    mergeArgs.push_back(tmpDir + "/clu_step0");
+    runner.run("mergeclusters", mergeArgs, output);
+
+    if (removeTmp) {
+        Debug(Debug::INFO) << "Remove temporary files\n";
+        removeDb(tmpDir + "/pref");
+        removeDb(tmpDir + "/aln");
+        removeDb(tmpDir + "/clu_step0");
+        removeDb(tmpDir + "/clu_redundancy");
+        removeDb(tmpDir + "/aln_redundancy");
+        removeDb(tmpDir + "/input_step_redundancy");
+    }
+}
+
 int clusteringworkflow(int argc, const char **argv, const Command& command) {
     Parameters& par = Parameters::getInstance();
     setWorkflowDefaults(&par);
@@ -127,6 +270,14 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         Debug(Debug::WARNING) << "WARNING: connected component clustering produces less clusters in a single step clustering.\n"
                               << "Please use --single-step-cluster";
     }
+    // align can write the greedy incremental clustering directly in a single step clustering
+    const bool greedyAlign = par.greedyClustering && par.cascaded == false
+                             && par.clusteringMode == Parameters::GREEDY && isUngappedMode == false
+                             && par.runner.empty();
+    if (par.greedyClustering && greedyAlign == false) {
+        Debug(Debug::WARNING) << "WARNING: --greedy-clustering needs --single-step-clustering, --cluster-mode 2 and no RUNNER. Disabling it.\n";
+    }
+    par.greedyClustering = greedyAlign;
     if (clusterStepsSet == false) {
         par.clusterSteps = setAutomaticIterations(par.sensitivity);
         Debug(Debug::INFO) << "Set cluster iterations to " << par.clusterSteps << "\n";
@@ -144,13 +295,20 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
     FileUtil::symlinkAlias(tmpDir, "latest");
 
     const int originalRescoreMode = par.rescoreMode;
+    const std::string alignModule = isUngappedMode ? "rescorediagonal" : "align";
+    // every in process step parses its own parameters into par
+    const std::string source = par.db1;
+    const std::string output = par.db2;
+    const bool removeTmp = par.removeTmpFiles;
+    WorkflowRunner runner(par.runner);
 
     CommandCaller cmd;
     cmd.addVariable("REMOVE_TMP", par.removeTmpFiles ? "TRUE" : NULL);
     par.rescoreMode = Parameters::RESCORE_MODE_ALIGNMENT;
-    cmd.addVariable("ALIGN_MODULE", isUngappedMode ? "rescorediagonal" : "align");
+    cmd.addVariable("ALIGN_MODULE", alignModule.c_str());
     par.rescoreMode = originalRescoreMode;
     cmd.addVariable("RUNNER", par.runner.c_str());
+    cmd.addVariable("GREEDY_ALIGN", greedyAlign ? "TRUE" : NULL);
 
     if (par.cascaded) {
         // save some values to restore them later
@@ -161,7 +319,8 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         par.kmerSize = Parameters::CLUST_LINEAR_DEFAULT_K;
         int maskMode = par.maskMode;
         par.maskMode = 0;
-        cmd.addVariable("LINCLUST_PAR", par.createParameterString(par.linclustworkflow).c_str());
+        const std::string linclustPar = par.createParameterString(par.linclustworkflow);
+        cmd.addVariable("LINCLUST_PAR", linclustPar.c_str());
         par.alphabetSize = alphabetSize;
         par.kmerSize = kmerSize;
         par.maskMode = maskMode;
@@ -171,15 +330,21 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         par.minDiagScoreThr = 0;
         par.diagonalScoring = 0;
         par.compBiasCorrection = 0;
-        cmd.addVariable("PREFILTER0_PAR", par.createParameterString(par.prefilter).c_str());
+        std::vector<std::string> prefilterPar;
+        std::vector<std::string> alignPar;
+        std::vector<std::string> clusterPar;
+        prefilterPar.push_back(par.createParameterString(par.prefilter));
         if (isUngappedMode) {
             par.rescoreMode = Parameters::RESCORE_MODE_ALIGNMENT;
-            cmd.addVariable("ALIGNMENT0_PAR", par.createParameterString(par.rescorediagonal).c_str());
+            alignPar.push_back(par.createParameterString(par.rescorediagonal));
             par.rescoreMode = originalRescoreMode;
         } else {
-            cmd.addVariable("ALIGNMENT0_PAR", par.createParameterString(par.align).c_str());
+            alignPar.push_back(par.createParameterString(par.align));
         }
-        cmd.addVariable("CLUSTER0_PAR",   par.createParameterString(par.clust).c_str());
+        clusterPar.push_back(par.createParameterString(par.clust));
+        cmd.addVariable("PREFILTER0_PAR", prefilterPar[0].c_str());
+        cmd.addVariable("ALIGNMENT0_PAR", alignPar[0].c_str());
+        cmd.addVariable("CLUSTER0_PAR",   clusterPar[0].c_str());
         par.diagonalScoring = 1;
         par.compBiasCorrection = 1;
         par.minDiagScoreThr = minDiagScoreThr;
@@ -187,18 +352,27 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         for(int step = 1; step < par.clusterSteps; step++){
             par.sensitivity =  1.0 + sensStepSize * step;
 
-            cmd.addVariable(std::string("PREFILTER"+SSTR(step)+"_PAR").c_str(), par.createParameterString(par.prefilter).c_str());
+            prefilterPar.push_back(par.createParameterString(par.prefilter));
             if (isUngappedMode) {
                 par.rescoreMode = Parameters::RESCORE_MODE_ALIGNMENT;
-                cmd.addVariable(std::string("ALIGNMENT"+SSTR(step)+"_PAR").c_str(), par.createParameterString(par.rescorediagonal).c_str());
+                alignPar.push_back(par.createParameterString(par.rescorediagonal));
                 par.rescoreMode = originalRescoreMode;
             } else {
-                cmd.addVariable(std::string("ALIGNMENT"+SSTR(step)+"_PAR").c_str(), par.createParameterString(par.align).c_str());
+                alignPar.push_back(par.createParameterString(par.align));
             }
-            cmd.addVariable(std::string("CLUSTER"  +SSTR(step)+"_PAR").c_str(), par.createParameterString(par.clust).c_str());
+            clusterPar.push_back(par.createParameterString(par.clust));
+            cmd.addVariable(std::string("PREFILTER"+SSTR(step)+"_PAR").c_str(), prefilterPar[step].c_str());
+            cmd.addVariable(std::string("ALIGNMENT"+SSTR(step)+"_PAR").c_str(), alignPar[step].c_str());
+            cmd.addVariable(std::string("CLUSTER"  +SSTR(step)+"_PAR").c_str(), clusterPar[step].c_str());
         }
         cmd.addVariable("STEPS", SSTR(par.clusterSteps).c_str());
 
+        if (par.inProcess) {
+            runCascadedClustering(runner, source, output, tmpDir, alignModule, linclustPar,
+                                  prefilterPar, alignPar, clusterPar, removeTmp);
+            return EXIT_SUCCESS;
+        }
+
         // set parameter for first step
         FileUtil::writeFile(tmpDir + "/cascaded_clustering.sh", cascaded_clustering_sh, cascaded_clustering_sh_len);
         std::string program(tmpDir + "/cascaded_clustering.sh");
@@ -207,16 +381,22 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         // same as above, clusthash needs a smaller alphabetsize
         size_t alphabetSize = par.alphabetSize;
         par.alphabetSize = Parameters::CLUST_HASH_DEFAULT_ALPH_SIZE;
-        cmd.addVariable("DETECTREDUNDANCY_PAR", par.createParameterString(par.clusthash).c_str());
+        const std::string redundancyPar = par.createParameterString(par.clusthash);
+        cmd.addVariable("DETECTREDUNDANCY_PAR", redundancyPar.c_str());
         par.alphabetSize = alphabetSize;
 
-        cmd.addVariable("PREFILTER_PAR", par.createParameterString(par.prefilter).c_str());
-        if (isUngappedMode) {
-            cmd.addVariable("ALIGNMENT_PAR", par.createParameterString(par.rescorediagonal).c_str());
-        } else {
-            cmd.addVariable("ALIGNMENT_PAR", par.createParameterString(par.align).c_str());
+        const std::string prefilterPar = par.createParameterString(par.prefilter);
+        const std::string alignPar = par.createParameterString(isUngappedMode ? par.rescorediagonal : par.align);
+        const std::string clusterPar = par.createParameterString(par.clust);
+        cmd.addVariable("PREFILTER_PAR", prefilterPar.c_str());
+        cmd.addVariable("ALIGNMENT_PAR", alignPar.c_str());
+        cmd.addVariable("CLUSTER_PAR", clusterPar.c_str());
+
+        if (par.inProcess) {
+            runClustering(runner, source, output, tmpDir, alignModule, redundancyPar,
+                          prefilterPar, alignPar, clusterPar, greedyAlign, removeTmp);
+            return EXIT_SUCCESS;
         }
-        cmd.addVariable("CLUSTER_PAR", par.createParameterString(par.clust).c_str());
         FileUtil::writeFile(tmpDir + "/clustering.sh", clustering_sh, clustering_sh_len);
         std::string program(tmpDir+ "/clustering.sh");
         cmd.execProgram(program.c_str(), par.filenames);
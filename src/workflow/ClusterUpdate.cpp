@@ -22,8 +22,26 @@ int clusterupdate(int argc, const char **argv, const Command& command) {
     int maxAccept = par.maxAccept;
     par.maxAccept = 1;
     cmd.addVariable("SEARCH_PAR", par.createParameterString(par.clusterUpdateSearch).c_str());
+    if (par.useKmerTable) {
+        cmd.addVariable("USE_KMER_TABLE", "TRUE");
+        cmd.addVariable("ALIGN_PAR", par.createParameterString(par.align).c_str());
+    }
     par.maxAccept = maxAccept;
 
+    if (par.useKmerTable) {
+        // the table is built with the linclust k-mer defaults, lookups take the parameters from the table
+        int kmerSize = par.kmerSize;
+        int alphabetSize = par.alphabetSize;
+        int maskMode = par.maskMode;
+        par.kmerSize = Parameters::CLUST_LINEAR_DEFAULT_K;
+        par.alphabetSize = Parameters::CLUST_LINEAR_DEFAULT_ALPH_SIZE;
+        par.maskMode = 0;
+        cmd.addVariable("KMERMATCHER_PAR", par.createParameterString(par.kmermatcher).c_str());
+        par.kmerSize = kmerSize;
+        par.alphabetSize = alphabetSize;
+        par.maskMode = maskMode;
+    }
+
     cmd.addVariable("CLUST_PAR", par.createParameterString(par.clusteringWorkflow).c_str());
 
     std::string scriptPath(par.db6);
@@ -5,6 +5,7 @@
 #include "Util.h"
 #include "Debug.h"
 #include "Parameters.h"
+#include "DBReader.h"
 
 #include "easysearch.sh.h"
 
@@ -45,6 +46,22 @@ int easysearch(int argc, const char **argv, const Command &command) {
                                      par.PARAM_V.category & ~MMseqsParameter::COMMAND_EXPERT);
     par.parseParameters(argc, argv, command, 4);
 
+    if (par.streamResults) {
+        // only the last module of a single step search writes its result to a named pipe
+        bool canStream = par.numIterations <= 1 && par.sensSteps <= 1 && par.sliceSearch == false;
+        if (FileUtil::fileExists((par.db2 + ".dbtype").c_str())) {
+            canStream = canStream && DBReader<unsigned int>::parseDbType(par.db2.c_str()) != Sequence::HMM_PROFILE;
+        }
+#ifdef HAVE_MPI
+        // MPI modules merge their results from split files
+        canStream = false;
+#endif
+        if (canStream == false) {
+            Debug(Debug::WARNING) << "Results can only be streamed in single step sequence searches. Disabling --stream-results.\n";
+            par.streamResults = false;
+        }
+    }
+
     if (FileUtil::directoryExists(par.db4.c_str()) == false) {
         Debug(Debug::INFO) << "Tmp " << par.db4 << " folder does not exist or is not a directory.\n";
         if (FileUtil::makeDir(par.db4.c_str()) == false) {
@@ -72,6 +89,7 @@ int easysearch(int argc, const char **argv, const Command &command) {
     cmd.addVariable("REMOVE_TMP", par.removeTmpFiles ? "TRUE" : NULL);
     cmd.addVariable("GREEDY_BEST_HITS", par.greedyBestHits ? "TRUE" : NULL);
     cmd.addVariable("LEAVE_INPUT", par.dbOut ? "TRUE" : NULL);
+    cmd.addVariable("STREAM", par.streamResults ? "TRUE" : NULL);
 
     cmd.addVariable("RUNNER", par.runner.c_str());
 
@@ -196,6 +196,8 @@ int search(int argc, const char **argv, const Command& command) {
     } else if (par.numIterations > 1) {
         cmd.addVariable("NUM_IT", SSTR(par.numIterations).c_str());
         cmd.addVariable("SUBSTRACT_PAR", par.createParameterString(par.subtractdbs).c_str());
+        // converged queries can only gain hits in the last iteration if its e-value is less strict
+        cmd.addVariable("CONVERGE_LAST", par.evalThr <= par.evalProfile ? "TRUE" : NULL);
 
         float originalEval = par.evalThr;
         par.evalThr = par.evalProfile;
@@ -285,6 +287,18 @@ int search(int argc, const char **argv, const Command& command) {
         cmd.addVariable("SEARCH", program.c_str());
         program = std::string(tmpDir + "/translated_search.sh");
     }
+    if (FileUtil::isNamedPipe(par.db3.c_str())) {
+        // blastp.sh and translated_search.sh let their last module write to the pipe directly
+        bool canStream = par.sliceSearch == false && targetDbType != Sequence::HMM_PROFILE
+                         && par.numIterations <= 1 && par.sensSteps <= 1 && par.runner.empty();
+#ifdef HAVE_MPI
+        canStream = false;
+#endif
+        if (canStream == false) {
+            Debug(Debug::ERROR) << "Results can only be streamed to " << par.db3 << " from a single step sequence search without MPI.\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
     cmd.execProgram(program.c_str(), par.filenames);
 
     // Should never get here